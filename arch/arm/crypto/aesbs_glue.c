@@ -0,0 +1,605 @@
+/*
+ * Glue Code for the bit sliced NEON version of the AES Cipher Algorithm
+ *
+ * The core in aesbs-core.S does eight blocks at a time, so only the modes
+ * that have eight independent blocks to give it are provided: ECB, CBC
+ * decryption, CTR and XTS.  CBC encryption is serial and goes through the
+ * "aes" cipher one block at a time, as does everything in interrupt
+ * context, where the NEON unit can't be used.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/hardirq.h>
+#include <linux/err.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/b128ops.h>
+#include <crypto/gf128mul.h>
+#include <asm/neon.h>
+
+#define AESBS_BLOCKS	8
+#define AESBS_RK_SIZE	(8 * AES_BLOCK_SIZE)	/* one plane per bit */
+
+asmlinkage void aesbs_ecb_encrypt(u8 *out, const u8 *in, const u8 *rk,
+				  int rounds, unsigned int blocks);
+asmlinkage void aesbs_ecb_decrypt(u8 *out, const u8 *in, const u8 *rk,
+				  int rounds, unsigned int blocks);
+
+struct aesbs_ctx {
+	int rounds;
+	u8 enc[(AES_MAX_KEYLENGTH / AES_BLOCK_SIZE) * AESBS_RK_SIZE];
+	u8 dec[(AES_MAX_KEYLENGTH / AES_BLOCK_SIZE) * AESBS_RK_SIZE];
+	struct crypto_cipher *fallback;
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx data;
+	struct crypto_cipher *tweak;
+};
+
+/*
+ * Converts round key rk to the bit sliced form: byte p of plane i is 0xff
+ * if bit i of byte m of rk ^ c is set, where m is p for the blocks' own
+ * column order and 4 * (p % 4) + p / 4 for the row order the core keeps
+ * the state in between the first and the last ShiftRows.
+ */
+static void aesbs_convert_rk(u8 *out, const u32 *rk, int rows, u8 c)
+{
+	unsigned int i, p, m;
+	u8 b;
+
+	for (p = 0; p < AES_BLOCK_SIZE; p++) {
+		m = rows ? 4 * (p % 4) + p / 4 : p;
+		b = (rk[m / 4] >> (8 * (m % 4))) ^ c;
+		for (i = 0; i < 8; i++)
+			out[i * AES_BLOCK_SIZE + p] = (b >> i) & 1 ? 0xff : 0;
+	}
+}
+
+/*
+ * The S-box circuits of the core leave out the constant 0x63 of the
+ * affine map of SubBytes, on the output side, and that of its inverse,
+ * which is 0x63 again on the input side.  A constant in every byte
+ * passes unchanged through (Inv)ShiftRows and (Inv)MixColumns, so it is
+ * added to the round keys instead: those after an S-box when encrypting,
+ * all but the first, and those before one when decrypting, all but the
+ * last.  The decryption schedule is kept in the order the core uses it.
+ */
+static void aesbs_convert_key(struct aesbs_ctx *ctx,
+			      const struct crypto_aes_ctx *rk)
+{
+	int rounds = 6 + rk->key_length / 4;
+	int r;
+
+	ctx->rounds = rounds;
+	for (r = 0; r <= rounds; r++) {
+		const u32 *k = rk->key_enc + 4 * r;
+		int rows = r > 0 && r < rounds;
+
+		aesbs_convert_rk(ctx->enc + r * AESBS_RK_SIZE, k, rows,
+				 r ? 0x63 : 0);
+		aesbs_convert_rk(ctx->dec + (rounds - r) * AESBS_RK_SIZE, k,
+				 rows, r ? 0x63 : 0);
+	}
+}
+
+static int aesbs_set_key_common(struct crypto_tfm *tfm,
+				struct aesbs_ctx *ctx, const u8 *in_key,
+				unsigned int key_len)
+{
+	struct crypto_aes_ctx rk;
+	int err;
+
+	err = crypto_aes_expand_key(&rk, in_key, key_len);
+	if (err) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return err;
+	}
+
+	crypto_cipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_cipher_set_flags(ctx->fallback, crypto_tfm_get_flags(tfm) &
+						CRYPTO_TFM_REQ_MASK);
+	err = crypto_cipher_setkey(ctx->fallback, in_key, key_len);
+	if (!err)
+		aesbs_convert_key(ctx, &rk);
+
+	memset(&rk, 0, sizeof(rk));
+	return err;
+}
+
+static int aesbs_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			 unsigned int key_len)
+{
+	return aesbs_set_key_common(tfm, crypto_tfm_ctx(tfm), in_key, key_len);
+}
+
+/* the first half of the key is the data key, the second the tweak key */
+static int aesbs_xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			     unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	if (key_len % 2) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	key_len /= 2;
+
+	crypto_cipher_clear_flags(ctx->tweak, CRYPTO_TFM_REQ_MASK);
+	crypto_cipher_set_flags(ctx->tweak, crypto_tfm_get_flags(tfm) &
+					    CRYPTO_TFM_REQ_MASK);
+	err = crypto_cipher_setkey(ctx->tweak, in_key + key_len, key_len);
+	if (err) {
+		tfm->crt_flags |= crypto_cipher_get_flags(ctx->tweak) &
+				  CRYPTO_TFM_RES_MASK;
+		return err;
+	}
+
+	return aesbs_set_key_common(tfm, &ctx->data, in_key, key_len);
+}
+
+/*
+ * The walks below run with the NEON unit claimed, so they must not
+ * sleep.  In interrupt context neon is 0 and aesbs_crypt() falls back
+ * to the "aes" cipher.
+ */
+static int aesbs_begin(struct blkcipher_desc *desc)
+{
+	if (in_interrupt())
+		return 0;
+
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+	kernel_neon_begin();
+	return 1;
+}
+
+static void aesbs_end(int neon)
+{
+	if (neon)
+		kernel_neon_end();
+}
+
+/*
+ * Encrypts or decrypts blocks blocks from in to out, which may be the
+ * same.  The core only does multiples of eight, the rest goes through a
+ * bounce buffer rather than the table driven fallback, which would make
+ * the timing depend on the data again.
+ */
+static void aesbs_crypt(struct aesbs_ctx *ctx, int enc, int neon, u8 *out,
+			const u8 *in, unsigned int blocks)
+{
+	u8 buf[AESBS_BLOCKS * AES_BLOCK_SIZE];
+	unsigned int n = blocks & ~(AESBS_BLOCKS - 1);
+
+	if (!neon) {
+		for (; blocks; blocks--) {
+			if (enc)
+				crypto_cipher_encrypt_one(ctx->fallback, out, in);
+			else
+				crypto_cipher_decrypt_one(ctx->fallback, out, in);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		}
+		return;
+	}
+
+	if (n) {
+		if (enc)
+			aesbs_ecb_encrypt(out, in, ctx->enc, ctx->rounds, n);
+		else
+			aesbs_ecb_decrypt(out, in, ctx->dec, ctx->rounds, n);
+		in += n * AES_BLOCK_SIZE;
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+	if (blocks) {
+		memcpy(buf, in, blocks * AES_BLOCK_SIZE);
+		if (enc)
+			aesbs_ecb_encrypt(buf, buf, ctx->enc, ctx->rounds,
+					  AESBS_BLOCKS);
+		else
+			aesbs_ecb_decrypt(buf, buf, ctx->dec, ctx->rounds,
+					  AESBS_BLOCKS);
+		memcpy(out, buf, blocks * AES_BLOCK_SIZE);
+	}
+}
+
+static int ecb_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes, int enc)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err, neon;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	neon = aesbs_begin(desc);
+	while ((nbytes = walk.nbytes)) {
+		aesbs_crypt(ctx, enc, neon, walk.dst.virt.addr,
+			    walk.src.virt.addr, nbytes / AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk,
+					  nbytes % AES_BLOCK_SIZE);
+	}
+	aesbs_end(neon);
+
+	return err;
+}
+
+static int ecb_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return ecb_crypt(desc, dst, src, nbytes, 1);
+}
+
+static int ecb_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return ecb_crypt(desc, dst, src, nbytes, 0);
+}
+
+static int cbc_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		do {
+			crypto_xor(walk.iv, s, AES_BLOCK_SIZE);
+			crypto_cipher_encrypt_one(ctx->fallback, d, walk.iv);
+			memcpy(walk.iv, d, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+/*
+ * The ciphertext of each group of blocks is copied aside first: it is
+ * needed for the chaining after the group is decrypted, possibly in place.
+ */
+static int cbc_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	u8 buf[AESBS_BLOCKS * AES_BLOCK_SIZE] __aligned(4);
+	struct blkcipher_walk walk;
+	unsigned int n, len;
+	int err, neon;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	neon = aesbs_begin(desc);
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		do {
+			n = min_t(unsigned int, AESBS_BLOCKS,
+				  nbytes / AES_BLOCK_SIZE);
+			len = n * AES_BLOCK_SIZE;
+
+			memcpy(buf, s, len);
+			aesbs_crypt(ctx, 0, neon, d, buf, n);
+			crypto_xor(d, walk.iv, AES_BLOCK_SIZE);
+			crypto_xor(d + AES_BLOCK_SIZE, buf, len - AES_BLOCK_SIZE);
+			memcpy(walk.iv, buf + len - AES_BLOCK_SIZE,
+			       AES_BLOCK_SIZE);
+			s += len;
+			d += len;
+		} while ((nbytes -= len) >= AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	aesbs_end(neon);
+
+	return err;
+}
+
+static int ctr_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	u8 ks[AESBS_BLOCKS * AES_BLOCK_SIZE] __aligned(4);
+	struct blkcipher_walk walk;
+	unsigned int i, n, len;
+	int err, neon;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	neon = aesbs_begin(desc);
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		do {
+			n = min_t(unsigned int, AESBS_BLOCKS,
+				  nbytes / AES_BLOCK_SIZE);
+			len = n * AES_BLOCK_SIZE;
+
+			for (i = 0; i < n; i++) {
+				memcpy(ks + i * AES_BLOCK_SIZE, walk.iv,
+				       AES_BLOCK_SIZE);
+				crypto_inc(walk.iv, AES_BLOCK_SIZE);
+			}
+			aesbs_crypt(ctx, 1, neon, ks, ks, n);
+			crypto_xor(ks, s, len);
+			memcpy(d, ks, len);
+			s += len;
+			d += len;
+		} while ((nbytes -= len) >= AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	if (walk.nbytes) {
+		memcpy(ks, walk.iv, AES_BLOCK_SIZE);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		aesbs_crypt(ctx, 1, neon, ks, ks, 1);
+		crypto_xor(ks, walk.src.virt.addr, nbytes);
+		memcpy(walk.dst.virt.addr, ks, nbytes);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+	aesbs_end(neon);
+
+	return err;
+}
+
+/* the running tweak is kept in walk.iv, as crypto/xts.c does */
+static int xts_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes, int enc)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	be128 buf[AESBS_BLOCKS], t[AESBS_BLOCKS];
+	struct blkcipher_walk walk;
+	unsigned int i, n;
+	int err, neon;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	crypto_cipher_encrypt_one(ctx->tweak, walk.iv, walk.iv);
+
+	neon = aesbs_begin(desc);
+	while ((nbytes = walk.nbytes)) {
+		be128 *s = (be128 *)walk.src.virt.addr;
+		be128 *d = (be128 *)walk.dst.virt.addr;
+
+		do {
+			n = min_t(unsigned int, AESBS_BLOCKS,
+				  nbytes / AES_BLOCK_SIZE);
+
+			for (i = 0; i < n; i++) {
+				t[i] = *(be128 *)walk.iv;
+				be128_xor(&buf[i], &t[i], &s[i]);
+				gf128mul_x_ble((be128 *)walk.iv,
+					       (be128 *)walk.iv);
+			}
+			aesbs_crypt(&ctx->data, enc, neon, (u8 *)buf,
+				    (u8 *)buf, n);
+			for (i = 0; i < n; i++)
+				be128_xor(&d[i], &buf[i], &t[i]);
+			s += n;
+			d += n;
+		} while ((nbytes -= n * AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	aesbs_end(neon);
+
+	return err;
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 1);
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 0);
+}
+
+static int aesbs_init_tfm(struct crypto_tfm *tfm)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->fallback = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+	return 0;
+}
+
+static void aesbs_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->fallback);
+}
+
+static int aesbs_xts_init_tfm(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	err = aesbs_init_tfm(tfm);
+	if (err)
+		return err;
+
+	ctx->tweak = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->tweak)) {
+		crypto_free_cipher(ctx->data.fallback);
+		return PTR_ERR(ctx->tweak);
+	}
+	return 0;
+}
+
+static void aesbs_xts_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->tweak);
+	aesbs_exit_tfm(tfm);
+}
+
+static struct crypto_alg ecb_alg = {
+	.cra_name		= "ecb(aes)",
+	.cra_driver_name	= "ecb-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ecb_alg.cra_list),
+	.cra_init		= aesbs_init_tfm,
+	.cra_exit		= aesbs_exit_tfm,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= ecb_encrypt,
+			.decrypt	= ecb_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg cbc_alg = {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(cbc_alg.cra_list),
+	.cra_init		= aesbs_init_tfm,
+	.cra_exit		= aesbs_exit_tfm,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= cbc_encrypt,
+			.decrypt	= cbc_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg ctr_alg = {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ctr_alg.cra_list),
+	.cra_init		= aesbs_init_tfm,
+	.cra_exit		= aesbs_exit_tfm,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= ctr_crypt,
+			.decrypt	= ctr_crypt,
+		},
+	},
+};
+
+static struct crypto_alg xts_alg = {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(xts_alg.cra_list),
+	.cra_init		= aesbs_xts_init_tfm,
+	.cra_exit		= aesbs_xts_exit_tfm,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_set_key,
+			.encrypt	= xts_encrypt,
+			.decrypt	= xts_decrypt,
+		},
+	},
+};
+
+static int __init aesbs_init(void)
+{
+	int err;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	if ((err = crypto_register_alg(&ecb_alg)))
+		goto ecb_err;
+	if ((err = crypto_register_alg(&cbc_alg)))
+		goto cbc_err;
+	if ((err = crypto_register_alg(&ctr_alg)))
+		goto ctr_err;
+	if ((err = crypto_register_alg(&xts_alg)))
+		goto xts_err;
+	return 0;
+
+xts_err:
+	crypto_unregister_alg(&ctr_alg);
+ctr_err:
+	crypto_unregister_alg(&cbc_alg);
+cbc_err:
+	crypto_unregister_alg(&ecb_alg);
+ecb_err:
+	return err;
+}
+
+static void __exit aesbs_fini(void)
+{
+	crypto_unregister_alg(&xts_alg);
+	crypto_unregister_alg(&ctr_alg);
+	crypto_unregister_alg(&cbc_alg);
+	crypto_unregister_alg(&ecb_alg);
+}
+
+module_init(aesbs_init);
+module_exit(aesbs_fini);
+
+MODULE_DESCRIPTION("Rijndael (AES) Cipher Algorithm, bit sliced NEON");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("ecb(aes)");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
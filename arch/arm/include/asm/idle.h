@@ -0,0 +1,16 @@
+#ifndef __ASM_ARM_IDLE_H
+#define __ASM_ARM_IDLE_H
+
+/*
+ * Called from cpu_idle() on the idle CPU: IDLE_START before the tick is
+ * stopped, IDLE_END once it has been restarted and the CPU is about to
+ * schedule.  Same events as the x86_64 notifier.
+ */
+#define IDLE_START 1
+#define IDLE_END 2
+
+struct notifier_block;
+void idle_notifier_register(struct notifier_block *n);
+void idle_notifier_unregister(struct notifier_block *n);
+
+#endif /* __ASM_ARM_IDLE_H */
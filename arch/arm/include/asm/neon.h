@@ -0,0 +1,24 @@
+/*
+ * arch/arm/include/asm/neon.h
+ *
+ * NEON in kernel mode, see arch/arm/vfp/vfpmodule.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASMARM_NEON_H
+#define __ASMARM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON instructions in the kernel must be bracketed by these.  They
+ * disable preemption and may not be used in interrupt context.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+#endif
@@ -64,6 +64,7 @@ EXPORT_SYMBOL(bt_is_running);
 static struct rfkill *bt_lock_dvfs_rfk;
 static struct rfkill *bt_lock_dvfs_l2_rfk;
 #include <mach/cpu-freq-v210.h>
+static struct s5pv210_freq_floor bt_freq_floor = S5PV210_FREQ_FLOOR_INIT("bt");
 #endif
 
 void bt_uart_rts_ctrl(int flag)
@@ -275,15 +276,15 @@ static int bluetooth_lock_dvfs(void *data, enum rfkill_user_states state)
 	
 	switch (state) {
 		case RFKILL_USER_STATE_UNBLOCKED:
-			s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_9);
+			s5pv210_freq_floor_release(&bt_freq_floor);
 			pr_debug("[BT] dvfs unlock\n");
 			break;
 		case RFKILL_USER_STATE_SOFT_BLOCKED:
-			s5pv210_lock_dvfs_high_level(DVFS_LOCK_TOKEN_9, L3);
+			s5pv210_freq_floor_request(&bt_freq_floor, L3);
 			pr_debug("[BT] dvfs lock to L3\n");
 			break;
 		case RFKILL_USER_STATE_HARD_BLOCKED:
-			s5pv210_lock_dvfs_high_level(DVFS_LOCK_TOKEN_9, L2);
+			s5pv210_freq_floor_request(&bt_freq_floor, L2);
 			pr_debug("[BT] dvfs lock to L2\n");
 			break;			
 		default:
@@ -21,6 +21,11 @@
 #include <linux/suspend.h>
 #include <linux/regulator/consumer.h>
 #include <linux/gpio.h>
+#include <linux/plist.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/system.h>
 
 #include <mach/map.h>
@@ -66,10 +71,29 @@ struct s5pv210_dvs_conf {
 };
 
 #ifdef CONFIG_DVFS_LIMIT
-static unsigned int g_dvfs_high_lock_token = 0;
-static unsigned int g_dvfs_high_lock_limit = 4;
-static unsigned int g_dvfslockval[DVFS_LOCK_TOKEN_NUM];
-//static DEFINE_MUTEX(dvfs_high_lock);
+/*
+ * Frequency floor requests, sorted by perf level. The first node is the
+ * request with the lowest level, i.e. the highest frequency asked for.
+ */
+static DEFINE_SPINLOCK(freq_floor_lock);
+static struct plist_head freq_floor_list =
+	PLIST_HEAD_INIT(freq_floor_list, &freq_floor_lock);
+
+/*
+ * Requests behind the legacy token interface, named apart from the
+ * converted drivers (mfc, bt) that register requests of their own
+ */
+static struct s5pv210_freq_floor dvfs_token_floor[DVFS_LOCK_TOKEN_NUM] = {
+	[DVFS_LOCK_TOKEN_1] = S5PV210_FREQ_FLOOR_INIT("mfc_token"),
+	[DVFS_LOCK_TOKEN_2] = S5PV210_FREQ_FLOOR_INIT("fimc_token"),
+	[DVFS_LOCK_TOKEN_3] = S5PV210_FREQ_FLOOR_INIT("snd_rp_token"),
+	[DVFS_LOCK_TOKEN_4] = S5PV210_FREQ_FLOOR_INIT("tv_token"),
+	[DVFS_LOCK_TOKEN_5] = S5PV210_FREQ_FLOOR_INIT("early_suspend_token"),
+	[DVFS_LOCK_TOKEN_6] = S5PV210_FREQ_FLOOR_INIT("apps_token"),
+	[DVFS_LOCK_TOKEN_7] = S5PV210_FREQ_FLOOR_INIT("touch_token"),
+	[DVFS_LOCK_TOKEN_8] = S5PV210_FREQ_FLOOR_INIT("usb_token"),
+	[DVFS_LOCK_TOKEN_9] = S5PV210_FREQ_FLOOR_INIT("bt_token"),
+};
 #endif
 
 const unsigned long arm_volt_max = 1350000;
@@ -326,63 +350,202 @@ static void s5pv210_cpufreq_clksrcs_MPLL2APLL(unsigned int index,
 }
 
 #ifdef CONFIG_DVFS_LIMIT
-void s5pv210_lock_dvfs_high_level(uint nToken, uint perf_level) 
+/* Returns the perf level currently held by the floor, MAX_PERF_LEVEL if none */
+static unsigned int __s5pv210_freq_floor_level(void)
 {
-	uint freq_level;
-	struct cpufreq_policy *policy;
+	if (plist_head_empty(&freq_floor_list))
+		return MAX_PERF_LEVEL;
 
-	printk(KERN_DEBUG "%s : lock with token(%d) level(%d) current(%X)\n",
-			__func__, nToken, perf_level, g_dvfs_high_lock_token);
+	return plist_first(&freq_floor_list)->prio;
+}
 
-	if (g_dvfs_high_lock_token & (1 << nToken))
-		return;
+static unsigned int s5pv210_freq_floor_level(void)
+{
+	unsigned long flags;
+	unsigned int level;
+
+	spin_lock_irqsave(&freq_floor_lock, flags);
+	level = __s5pv210_freq_floor_level();
+	spin_unlock_irqrestore(&freq_floor_lock, flags);
+
+	return level;
+}
+
+/* Returns the current floor in kHz, 0 if nobody holds one */
+unsigned int s5pv210_freq_floor(void)
+{
+	unsigned int level = s5pv210_freq_floor_level();
+
+	if (level == MAX_PERF_LEVEL)
+		return 0;
+
+	return freq_table[level].frequency;
+}
+EXPORT_SYMBOL(s5pv210_freq_floor);
+
+/*
+ * Let cpufreq pick up the new floor. The policy notifier below turns the
+ * floor into policy->min, and the governor is told about the new limits,
+ * so a raised floor takes effect at once and a dropped one is given back
+ * at the governor's next sample.
+ */
+static void s5pv210_freq_floor_update(void)
+{
+	cpufreq_update_policy(0);
+}
+
+/*
+ * s5pv210_freq_floor_request: add @req with @perf_level, or move it to
+ * @perf_level if it is already active. Must be called from process context.
+ */
+int s5pv210_freq_floor_request(struct s5pv210_freq_floor *req,
+		unsigned int perf_level)
+{
+	unsigned long flags;
+	unsigned int old_level, new_level;
+	bool changed = false;
 
 	if (perf_level > (MAX_PERF_LEVEL - 1))
-		return;
+		return -EINVAL;
 
-	//mutex_lock(&dvfs_high_lock);
+	spin_lock_irqsave(&freq_floor_lock, flags);
+	old_level = __s5pv210_freq_floor_level();
+	if (req->active) {
+		if (req->node.prio != perf_level) {
+			plist_del(&req->node, &freq_floor_list);
+			changed = true;
+		}
+	} else {
+		req->active = true;
+		req->since = ktime_get();
+		req->count++;
+		changed = true;
+	}
+	if (changed) {
+		plist_node_init(&req->node, perf_level);
+		plist_add(&req->node, &freq_floor_list);
+	}
+	new_level = __s5pv210_freq_floor_level();
+	spin_unlock_irqrestore(&freq_floor_lock, flags);
 
-	g_dvfs_high_lock_token |= (1 << nToken);
-	g_dvfslockval[nToken] = perf_level;
+	if (new_level != old_level)
+		s5pv210_freq_floor_update();
 
-	if (perf_level <  g_dvfs_high_lock_limit)
-		g_dvfs_high_lock_limit = perf_level;
+	return 0;
+}
+EXPORT_SYMBOL(s5pv210_freq_floor_request);
+
+/* s5pv210_freq_floor_release: drop @req. Does nothing if it is not active. */
+void s5pv210_freq_floor_release(struct s5pv210_freq_floor *req)
+{
+	unsigned long flags;
+	unsigned int old_level, new_level;
 
-	//mutex_unlock(&dvfs_high_lock);
+	spin_lock_irqsave(&freq_floor_lock, flags);
+	if (!req->active) {
+		spin_unlock_irqrestore(&freq_floor_lock, flags);
+		return;
+	}
+	old_level = __s5pv210_freq_floor_level();
+	plist_del(&req->node, &freq_floor_list);
+	req->active = false;
+	req->total = ktime_add(req->total, ktime_sub(ktime_get(), req->since));
+	new_level = __s5pv210_freq_floor_level();
+	spin_unlock_irqrestore(&freq_floor_lock, flags);
+
+	if (new_level != old_level)
+		s5pv210_freq_floor_update();
+}
+EXPORT_SYMBOL(s5pv210_freq_floor_release);
 
-	policy = cpufreq_cpu_get(0);
-	if (policy == NULL)
+void s5pv210_lock_dvfs_high_level(uint nToken, uint perf_level)
+{
+	if (nToken >= DVFS_LOCK_TOKEN_NUM)
 		return;
 
-	freq_level = freq_table[perf_level].frequency;
+	/* A token keeps the level it was first locked with */
+	if (dvfs_token_floor[nToken].active)
+		return;
 
-	cpufreq_driver_target(policy, freq_level, CPUFREQ_RELATION_L);
+	s5pv210_freq_floor_request(&dvfs_token_floor[nToken], perf_level);
 }
 EXPORT_SYMBOL(s5pv210_lock_dvfs_high_level);
 
-void s5pv210_unlock_dvfs_high_level(unsigned int nToken) 
+void s5pv210_unlock_dvfs_high_level(unsigned int nToken)
+{
+	if (nToken >= DVFS_LOCK_TOKEN_NUM)
+		return;
+
+	s5pv210_freq_floor_release(&dvfs_token_floor[nToken]);
+}
+EXPORT_SYMBOL(s5pv210_unlock_dvfs_high_level);
+
+static int s5pv210_freq_floor_policy_notifier(struct notifier_block *nb,
+		unsigned long event, void *data)
 {
-	unsigned int i;
+	struct cpufreq_policy *policy = data;
+	unsigned int floor;
 
-	//mutex_lock(&dvfs_high_lock);
+	if (event != CPUFREQ_ADJUST)
+		return NOTIFY_DONE;
 
-	g_dvfs_high_lock_token &= ~(1 << nToken);
-	g_dvfslockval[nToken] = MAX_PERF_LEVEL;
-	g_dvfs_high_lock_limit = MAX_PERF_LEVEL;
+	floor = s5pv210_freq_floor();
+	if (floor)
+		cpufreq_verify_within_limits(policy, floor,
+				policy->cpuinfo.max_freq);
 
-	if (g_dvfs_high_lock_token) {
-		for (i = 0; i < DVFS_LOCK_TOKEN_NUM; i++) {
-			if (g_dvfslockval[i] < g_dvfs_high_lock_limit)
-				g_dvfs_high_lock_limit = g_dvfslockval[i];
-		}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block s5pv210_freq_floor_nb = {
+	.notifier_call = s5pv210_freq_floor_policy_notifier,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static int s5pv210_freq_floor_show(struct seq_file *s, void *unused)
+{
+	struct s5pv210_freq_floor *req;
+	unsigned long flags;
+	ktime_t now = ktime_get();
+
+	seq_printf(s, "floor: %u kHz\n", s5pv210_freq_floor());
+	seq_printf(s, "%-16s %5s %8s %10s %8s %12s\n", "name", "level",
+			"kHz", "held(ms)", "count", "total(ms)");
+
+	spin_lock_irqsave(&freq_floor_lock, flags);
+	plist_for_each_entry(req, &freq_floor_list, node) {
+		s64 held = ktime_to_ms(ktime_sub(now, req->since));
+
+		seq_printf(s, "%-16s    L%d %8u %10lld %8u %12lld\n",
+				req->name, req->node.prio,
+				freq_table[req->node.prio].frequency, held,
+				req->count, ktime_to_ms(req->total) + held);
 	}
+	spin_unlock_irqrestore(&freq_floor_lock, flags);
+
+	return 0;
+}
 
-	//mutex_unlock(&dvfs_high_lock);
+static int s5pv210_freq_floor_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5pv210_freq_floor_show, inode->i_private);
+}
 
-	printk(KERN_DEBUG "%s : unlock with token(%d) current(%X) level(%d)\n",
-			__func__, nToken, g_dvfs_high_lock_token, g_dvfs_high_lock_limit);
+static const struct file_operations s5pv210_freq_floor_fops = {
+	.open		= s5pv210_freq_floor_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init s5pv210_freq_floor_debugfs_init(void)
+{
+	debugfs_create_file("cpufreq_floor", S_IRUGO, NULL, NULL,
+			&s5pv210_freq_floor_fops);
+	return 0;
 }
-EXPORT_SYMBOL(s5pv210_unlock_dvfs_high_level);
+late_initcall(s5pv210_freq_floor_debugfs_init);
+#endif
 #endif
 
 static int no_cpufreq_access;
@@ -402,6 +565,9 @@ static int s5pv210_cpufreq_target(struct cpufreq_policy *policy,
 	unsigned int index, reg, arm_volt, int_volt;
 	unsigned int pll_changing = 0;
 	unsigned int bus_speed_changing = 0;
+#ifdef CONFIG_DVFS_LIMIT
+	unsigned int floor_level;
+#endif
 
 	mutex_lock(&set_freq_lock);
 
@@ -440,10 +606,10 @@ static int s5pv210_cpufreq_target(struct cpufreq_policy *policy,
 	}
 
 #ifdef CONFIG_DVFS_LIMIT
-	if (g_dvfs_high_lock_token) {
-		if (index > g_dvfs_high_lock_limit)
-			index = g_dvfs_high_lock_limit;
-	}
+	/* Covers the window before the floor has reached policy->min */
+	floor_level = s5pv210_freq_floor_level();
+	if (index > floor_level)
+		index = floor_level;
 #endif
 
 	if ((s3c_freqs.freqs.old <= freq_table[L3].frequency) && (index == L0))
@@ -761,11 +927,6 @@ static int __init s5pv210_cpufreq_driver_init(struct cpufreq_policy *policy)
 			sizeof(struct s3c_freq));
 	previous_arm_volt = dvs_conf[level].arm_volt;
 
-#ifdef CONFIG_DVFS_LIMIT
-	for(i = 0; i < DVFS_LOCK_TOKEN_NUM; i++)
-		g_dvfslockval[i] = MAX_PERF_LEVEL;
-#endif
-
 	return cpufreq_frequency_table_cpuinfo(policy, freq_table);
 }
 
@@ -827,6 +988,10 @@ error:
 finish:
 #endif
 	register_pm_notifier(&s5pv210_cpufreq_notifier);
+#ifdef CONFIG_DVFS_LIMIT
+	cpufreq_register_notifier(&s5pv210_freq_floor_nb,
+			CPUFREQ_POLICY_NOTIFIER);
+#endif
 
 	return cpufreq_register_driver(&s5pv210_cpufreq_driver);
 }
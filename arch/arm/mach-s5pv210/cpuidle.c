@@ -16,6 +16,7 @@
 #include <linux/cpuidle.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <asm/proc-fns.h>
 #include <asm/cacheflush.h>
 
@@ -39,6 +40,22 @@ static dma_addr_t phy_regs_save;
 
 #define MAX_CHK_DEV	0xf
 
+/*
+ * DIDLE break-even model. Every entry pays for the VIC/GPIO/wakeup setup
+ * and the register save on the way in, and for the resume path, cpu_init()
+ * and the restore on the way out, all with the core clocked. Those costs
+ * are measured on each entry and averaged; DIDLE is only worth it when the
+ * CPU stays down for DIDLE_COST_FACTOR times the total cost.
+ */
+#define DIDLE_WAKEUP_US		50	/* APLL relock (30us) + resume path */
+#define DIDLE_COST_FACTOR	4
+#define DIDLE_INIT_RESIDENCY	1000	/* until the first measurements */
+
+/* Average save + restore cost in us, scaled by 8 */
+static unsigned int didle_cost_avg;
+static ktime_t didle_save_time;
+static ktime_t didle_resume_time;
+
 /*
  * Specific device list for checking before entering
  * didle mode
@@ -235,25 +252,25 @@ static void s5p_enter_idle(void)
 static int s5p_enter_idle_state(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	struct timeval before, after;
-	int idle_time;
+	ktime_t before, after;
 
 	local_irq_disable();
-	do_gettimeofday(&before);
+	before = ktime_get();
 
 	s5p_enter_idle();
 
-	do_gettimeofday(&after);
+	after = ktime_get();
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-			(after.tv_usec - before.tv_usec);
-	return idle_time;
+
+	return (int)ktime_to_us(ktime_sub(after, before));
 }
 
-static void s5p_enter_didle(void)
+/* Returns 1 if the SoC actually went down, 0 if an interrupt was pending */
+static int s5p_enter_didle(void)
 {
 	unsigned long tmp;
 	unsigned long save_eint_mask;
+	int entered = 0;
 
 	/* store the physical address of the register recovery block */
 	__raw_writel(phy_regs_save, S5P_INFORM2);
@@ -329,10 +346,13 @@ static void s5p_enter_didle(void)
 	 * we resume as it saves its own register state and restore it
 	 * during the resume.
 	 */
+	didle_save_time = ktime_get();
 	s5pv210_didle_save(regs_save);
 
 	/* restore the cpu state using the kernel's cpu init code. */
 	cpu_init();
+	didle_resume_time = ktime_get();
+	entered = 1;
 
 skipped_didle:
 	__raw_writel(save_eint_mask, S5P_EINT_WAKEUP_MASK);
@@ -357,6 +377,31 @@ skipped_didle:
 	__raw_writel(vic_regs[1], S5P_VIC1REG(VIC_INT_ENABLE));
 	__raw_writel(vic_regs[2], S5P_VIC2REG(VIC_INT_ENABLE));
 	__raw_writel(vic_regs[3], S5P_VIC3REG(VIC_INT_ENABLE));
+
+	return entered;
+}
+
+/*
+ * Fold the cost of the last DIDLE entry into the average and move the
+ * state's exit latency and target residency with it, so the governor
+ * works from measured numbers.
+ */
+static void s5p_didle_update_cost(struct cpuidle_state *state,
+				  ktime_t before, ktime_t after)
+{
+	unsigned int cost;
+
+	cost = ktime_to_us(ktime_sub(didle_save_time, before)) +
+	       ktime_to_us(ktime_sub(after, didle_resume_time));
+
+	if (!didle_cost_avg)
+		didle_cost_avg = cost << 3;
+	else
+		didle_cost_avg += cost - (didle_cost_avg >> 3);
+
+	/* The whole cost bounds the exit part from above */
+	state->exit_latency = DIDLE_WAKEUP_US + (didle_cost_avg >> 3);
+	state->target_residency = DIDLE_COST_FACTOR * state->exit_latency;
 }
 
 #ifdef CONFIG_RFKILL
@@ -385,8 +430,14 @@ extern void bt_uart_rts_ctrl(int flag);
 static int s5p_enter_didle_state(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	struct timeval before, after;
-	int idle_time;
+	ktime_t before, after;
+	int entered;
+
+	/* Devices that DIDLE would disturb are busy: fall back to WFI */
+	if (s5p_idle_bm_check()) {
+		dev->last_state = &dev->states[0];
+		return s5p_enter_idle_state(dev, &dev->states[0]);
+	}
 
 #ifdef CONFIG_RFKILL
 	/* BT-UART RTS Control (RTS High) */
@@ -394,33 +445,23 @@ static int s5p_enter_didle_state(struct cpuidle_device *dev,
 #endif
 
 	local_irq_disable();
-	do_gettimeofday(&before);
+	before = ktime_get();
+
+	entered = s5p_enter_didle();
 
-	s5p_enter_didle();
-	do_gettimeofday(&after);
+	after = ktime_get();
+	if (entered)
+		s5p_didle_update_cost(state, before, after);
+	else
+		dev->last_state = &dev->states[0];
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-			(after.tv_usec - before.tv_usec);
 
 #ifdef CONFIG_RFKILL
 	/* BT-UART RTS Control (RTS Low) */
 	bt_uart_rts_ctrl(0);
 #endif
 
-	return idle_time;
-}
-
-static int s5p_enter_idle_bm(struct cpuidle_device *dev,
-				struct cpuidle_state *state)
-{
-#ifdef CONFIG_CPU_DIDLE
-	if (s5p_idle_bm_check())
-		return s5p_enter_idle_state(dev, state);
-	else
-		return s5p_enter_didle_state(dev, state);
-#else
-	return s5p_enter_idle_state(dev, state);
-#endif
+	return (int)ktime_to_us(ktime_sub(after, before));
 }
 
 static DEFINE_PER_CPU(struct cpuidle_device, s5p_cpuidle_device);
@@ -449,13 +490,29 @@ static int s5p_init_cpuidle(void)
 	device->state_count = 1;
 
 	/* Wait for interrupt state */
-	device->states[0].enter = s5p_enter_idle_bm;
+	device->states[0].enter = s5p_enter_idle_state;
 	device->states[0].exit_latency = 1;	/* uS */
-	device->states[0].target_residency = 10000;
-	device->states[0].flags = CPUIDLE_FLAG_TIME_VALID;
+	device->states[0].target_residency = 1;
+	device->states[0].flags = CPUIDLE_FLAG_TIME_VALID |
+				  CPUIDLE_FLAG_SHALLOW;
 	strcpy(device->states[0].name, "IDLE");
 	strcpy(device->states[0].desc, "ARM clock gating - WFI");
 
+#ifdef CONFIG_CPU_DIDLE
+	/*
+	 * Deep idle state; latency and residency are refined from
+	 * measurements once it has been entered.
+	 */
+	device->states[1].enter = s5p_enter_didle_state;
+	device->states[1].exit_latency = DIDLE_WAKEUP_US;
+	device->states[1].target_residency = DIDLE_INIT_RESIDENCY;
+	device->states[1].flags = CPUIDLE_FLAG_TIME_VALID |
+				  CPUIDLE_FLAG_CHECK_BM | CPUIDLE_FLAG_DEEP;
+	strcpy(device->states[1].name, "DIDLE");
+	strcpy(device->states[1].desc, "ARM power gating - DIDLE");
+	device->state_count++;
+#endif
+
 	ret = cpuidle_register_device(device);
 	if (ret) {
 		printk(KERN_ERR "%s: Failed registering device\n", __func__);
@@ -13,6 +13,8 @@
 #define __ASM_ARCH_CPU_FREQ_H
 
 #include <linux/cpufreq.h>
+#include <linux/plist.h>
+#include <linux/ktime.h>
 
 /*
  * APLL M,P,S value for target frequency
@@ -58,6 +60,28 @@ enum {
 	DVFS_LOCK_TOKEN_NUM
 };
 
+/*
+ * A named request for a minimum CPU frequency. Drivers embed one per
+ * use case, request a perf level while they need it and release it when
+ * done. The highest frequency asked for by any active request wins.
+ */
+struct s5pv210_freq_floor {
+	struct plist_node	node;
+	const char		*name;
+	bool			active;
+	ktime_t			since;	/* when it became active */
+	ktime_t			total;	/* time held before the current hold */
+	unsigned int		count;
+};
+
+#define S5PV210_FREQ_FLOOR_INIT(_name)	{ .name = _name }
+
+extern int s5pv210_freq_floor_request(struct s5pv210_freq_floor *req,
+		unsigned int perf_level);
+extern void s5pv210_freq_floor_release(struct s5pv210_freq_floor *req);
+extern unsigned int s5pv210_freq_floor(void);
+
+/* Token interface, kept for drivers not converted to named requests */
 extern void s5pv210_lock_dvfs_high_level(uint nToken, uint perf_level);
 extern void s5pv210_unlock_dvfs_high_level(unsigned int nToken);
 #endif
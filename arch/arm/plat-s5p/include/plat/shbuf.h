@@ -0,0 +1,63 @@
+/* linux/arch/arm/plat-s5p/include/plat/shbuf.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Shared physically contiguous buffer handles for S5P media drivers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef _S5P_SHBUF_H
+#define _S5P_SHBUF_H
+
+#include <linux/types.h>
+#include <linux/err.h>
+#include <linux/kref.h>
+
+struct file;
+
+#define S5P_SHBUF_MAX_PLANES	3
+
+/*
+ * A shared buffer describes up to three physically contiguous planes
+ * owned by an exporting driver. Userspace sees it as a file descriptor;
+ * importing drivers take a reference while the hardware uses the planes.
+ * The exporter's release callback runs when the fd has been closed and
+ * the last importer has dropped its reference.
+ *
+ * s5p_shbuf_export() returns the file without an fd, so the exporter can
+ * fd_install() it once nothing else can fail, or fput() it to back out.
+ */
+struct s5p_shbuf {
+	struct kref	ref;
+	int		nr_planes;
+	dma_addr_t	base[S5P_SHBUF_MAX_PLANES];
+	size_t		length[S5P_SHBUF_MAX_PLANES];
+	void		(*release)(struct s5p_shbuf *buf);
+	void		*priv;
+};
+
+#ifdef CONFIG_S5P_SHBUF
+extern struct file *s5p_shbuf_export(int nr_planes, dma_addr_t *base,
+			size_t *length, void (*release)(struct s5p_shbuf *buf),
+			void *priv);
+extern struct s5p_shbuf *s5p_shbuf_get(int fd);
+extern void s5p_shbuf_put(struct s5p_shbuf *buf);
+#else
+static inline struct file *s5p_shbuf_export(int nr_planes, dma_addr_t *base,
+			size_t *length, void (*release)(struct s5p_shbuf *buf),
+			void *priv)
+{
+	return ERR_PTR(-ENOSYS);
+}
+static inline struct s5p_shbuf *s5p_shbuf_get(int fd)
+{
+	return ERR_PTR(-ENOSYS);
+}
+static inline void s5p_shbuf_put(struct s5p_shbuf *buf) { }
+#endif
+
+#endif /* _S5P_SHBUF_H */
@@ -0,0 +1,124 @@
+/* linux/arch/arm/plat-s5p/shbuf.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Shared physically contiguous buffer handles for S5P media drivers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/anon_inodes.h>
+#include <plat/shbuf.h>
+
+static void s5p_shbuf_free(struct kref *ref)
+{
+	struct s5p_shbuf *buf = container_of(ref, struct s5p_shbuf, ref);
+
+	if (buf->release)
+		buf->release(buf);
+
+	kfree(buf);
+}
+
+static int s5p_shbuf_release(struct inode *inode, struct file *file)
+{
+	s5p_shbuf_put(file->private_data);
+
+	return 0;
+}
+
+/* map the first plane, which is all single-plane formats need */
+static int s5p_shbuf_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct s5p_shbuf *buf = file->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (size > PAGE_ALIGN(buf->length[0]))
+		return -EINVAL;
+
+	vma->vm_flags |= VM_RESERVED | VM_IO;
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	if (remap_pfn_range(vma, vma->vm_start, __phys_to_pfn(buf->base[0]),
+				size, vma->vm_page_prot))
+		return -EAGAIN;
+
+	return 0;
+}
+
+static const struct file_operations s5p_shbuf_fops = {
+	.release	= s5p_shbuf_release,
+	.mmap		= s5p_shbuf_mmap,
+};
+
+struct file *s5p_shbuf_export(int nr_planes, dma_addr_t *base,
+		size_t *length, void (*release)(struct s5p_shbuf *buf),
+		void *priv)
+{
+	struct s5p_shbuf *buf;
+	struct file *file;
+	int i;
+
+	if (nr_planes <= 0 || nr_planes > S5P_SHBUF_MAX_PLANES)
+		return ERR_PTR(-EINVAL);
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return ERR_PTR(-ENOMEM);
+
+	kref_init(&buf->ref);
+	buf->release = release;
+	buf->priv = priv;
+	buf->nr_planes = nr_planes;
+	for (i = 0; i < nr_planes; i++) {
+		buf->base[i] = base[i];
+		buf->length[i] = length[i];
+	}
+
+	file = anon_inode_getfile("s5p-shbuf", &s5p_shbuf_fops, buf, O_RDWR);
+	/* a failed export leaves the exporter's resources untouched */
+	if (IS_ERR(file))
+		kfree(buf);
+
+	return file;
+}
+EXPORT_SYMBOL(s5p_shbuf_export);
+
+struct s5p_shbuf *s5p_shbuf_get(int fd)
+{
+	struct s5p_shbuf *buf;
+	struct file *file;
+
+	file = fget(fd);
+	if (!file)
+		return ERR_PTR(-EBADF);
+
+	if (file->f_op != &s5p_shbuf_fops) {
+		fput(file);
+		return ERR_PTR(-EINVAL);
+	}
+
+	buf = file->private_data;
+	kref_get(&buf->ref);
+	fput(file);
+
+	return buf;
+}
+EXPORT_SYMBOL(s5p_shbuf_get);
+
+void s5p_shbuf_put(struct s5p_shbuf *buf)
+{
+	if (buf)
+		kref_put(&buf->ref, s5p_shbuf_free);
+}
+EXPORT_SYMBOL(s5p_shbuf_put);
@@ -47,13 +47,16 @@
 
 #define ACE_AES_SW_AES_BLOCK_SIZE	16
 
+#define ACE_BC_QUEUE_LEN		32
+#define ACE_HASH_QUEUE_LEN		32
+
 #define CONFIG_ACE_SWAES_FOR_SMALLBLOCK
 #define CONFIG_ACE_BC_ASYNC
 #define CONFIG_ACE_BC_IRQMODE
 
-//#define CONFIG_ACE_HASH
+#define CONFIG_ACE_HASH
+#define CONFIG_ACE_HASH_ASYNC
 
-#undef CONFIG_ACE_HASH_ASYNC		/* not supported */
 #undef CONFIG_ACE_HASH_IRQMODE		/* not supported */
 
 #undef CONFIG_ACE_RESCHE_THAN_WAIT
@@ -451,6 +454,7 @@ static int s5p_ace_aes_engine_start(struct s5p_ace_aes_ctx *sctx,
 				u8 *out, const u8 *in, u32 len, int irqen)
 {
 	u32 reg;
+	unsigned long flags;
 #if defined(CONFIG_ACE_NEED_KEYCNGMODE)
 	u32 first_blklen;
 #endif
@@ -483,10 +487,14 @@ static int s5p_ace_aes_engine_start(struct s5p_ace_aes_ctx *sctx,
 	s5p_ace_write_sfr(ACE_FC_BRDMAC, ACE_FC_BRDMACFLUSH_ON);
 	s5p_ace_write_sfr(ACE_FC_BTDMAC, ACE_FC_BTDMACFLUSH_ON);
 
-	/* Select Input MUX as AES */
+	/* Select Input MUX as AES. FIFOCTRL is shared with the hash path,
+	 * and this may run from the interrupt handler.
+	 */
+	spin_lock_irqsave(&s5p_ace_dev.lock, flags);
 	reg = s5p_ace_read_sfr(ACE_FC_FIFOCTRL);
 	reg = (reg & ~ACE_FC_SELBC_MASK) | ACE_FC_SELBC_AES;
 	s5p_ace_write_sfr(ACE_FC_FIFOCTRL, reg);
+	spin_unlock_irqrestore(&s5p_ace_dev.lock, flags);
 
 	/* Stop flushing BRDMA and BTDMA */
 	reg = ACE_FC_BRDMACFLUSH_OFF;
@@ -672,12 +680,35 @@ void s5p_ace_sg_update(struct scatterlist **sg, size_t *offset,
 					size_t count)
 {
 	*offset += count;
-	if (*offset >= sg_dma_len(*sg)) {
+	while (*sg && *offset >= sg_dma_len(*sg)) {
 		*offset -= sg_dma_len(*sg);
 		*sg = sg_next(*sg);
 	}
 }
 
+/* Length of the physically contiguous run starting at offset in sg.
+ * Adjacent entries that continue the same physical range are merged
+ * so that they can go to the engine as a single DMA.
+ */
+static size_t s5p_ace_sg_contig_len(struct scatterlist *sg, size_t offset,
+					size_t max)
+{
+	dma_addr_t end;
+	size_t len;
+
+	len = sg_dma_len(sg) - offset;
+	end = sg_phys(sg) + sg_dma_len(sg);
+	while (len < max) {
+		sg = sg_next(sg);
+		if (!sg || sg_phys(sg) != end)
+			break;
+		len += sg_dma_len(sg);
+		end += sg_dma_len(sg);
+	}
+
+	return min(len, max);
+}
+
 int s5p_ace_sg_set_from_sg(struct scatterlist *dst, struct scatterlist *src,
 			u32 num)
 {
@@ -834,6 +865,16 @@ static int s5p_ace_aes_crypt_unaligned(struct s5p_ace_aes_ctx *sctx,
 #endif
 }
 
+static size_t s5p_ace_aes_crypt_dma_count(struct s5p_ace_aes_ctx *sctx)
+{
+	size_t count;
+
+	count = s5p_ace_sg_contig_len(sctx->in_sg, sctx->in_ofs, sctx->total);
+	count = s5p_ace_sg_contig_len(sctx->out_sg, sctx->out_ofs, count);
+
+	return count;
+}
+
 static int s5p_ace_aes_crypt_dma_start(struct s5p_ace_device *dev)
 {
 	struct s5p_ace_aes_ctx *sctx = dev->ctx_bc;
@@ -847,9 +888,7 @@ static int s5p_ace_aes_crypt_dma_start(struct s5p_ace_device *dev)
 #endif
 
 	while (1) {
-		count = sctx->total;
-		count = min(count, sg_dma_len(sctx->in_sg) - sctx->in_ofs);
-		count = min(count, sg_dma_len(sctx->out_sg) - sctx->out_ofs);
+		count = s5p_ace_aes_crypt_dma_count(sctx);
 
 #if defined(CONFIG_ACE_DEBUG)
 		printk(KERN_NOTICE "total_start: %d (%d)\n",
@@ -1005,6 +1044,39 @@ static int s5p_ace_aes_crypt_dma_wait(struct s5p_ace_device *dev)
 	return ret;
 }
 
+#if defined(CONFIG_ACE_BC_IRQMODE)
+/* Called from the interrupt handler when a DMA run has finished.
+ * If the rest of the request starts with another run the engine can take,
+ * it is started right here instead of making a round trip through the
+ * tasklet. Returns non-zero when the tasklet has to take over.
+ */
+static int s5p_ace_aes_crypt_dma_chain(struct s5p_ace_device *dev)
+{
+	struct s5p_ace_aes_ctx *sctx = dev->ctx_bc;
+	int ret;
+
+	if (!sctx || !sctx->dma_size)
+		return 1;
+
+	ret = s5p_ace_aes_crypt_dma_wait(dev);
+	sctx->dma_size = 0;
+	if (ret || !sctx->total)
+		return 1;
+
+	/* Small pieces are done in software, leave them to the tasklet */
+	if (s5p_ace_aes_crypt_dma_count(sctx) <= ACE_AES_SW_AES_BLOCK_SIZE)
+		return 1;
+
+	ret = s5p_ace_aes_crypt_dma_start(dev);
+	if (ret) {
+		sctx->dma_size = 0;
+		return 1;
+	}
+
+	return 0;
+}
+#endif
+
 static int s5p_ace_aes_handle_req(struct s5p_ace_device *dev)
 {
 	struct crypto_async_request *async_req;
@@ -1133,7 +1205,6 @@ static int s5p_ace_aes_crypt(struct ablkcipher_request *req, u32 encmode)
 	struct s5p_ace_reqctx *rctx = ablkcipher_request_ctx(req);
 	unsigned long flags;
 	int ret;
-	unsigned long timeout;
 
 #if defined(CONFIG_ACE_WATCHDOG)
 	do_gettimeofday(&timestamp[0]);		/* 0: request */
@@ -1146,17 +1217,6 @@ static int s5p_ace_aes_crypt(struct ablkcipher_request *req, u32 encmode)
 
 	rctx->mode = encmode;
 
-	timeout = jiffies + msecs_to_jiffies(10);
-	while (time_before(jiffies, timeout)) {
-		if (s5p_ace_dev.queue_bc.list.prev != &req->base.list)
-			break;
-		ndelay(50);	/* wait */
-	}
-	if (s5p_ace_dev.queue_bc.list.prev == &req->base.list) {
-		printk(KERN_ERR "%s : Time Out.\n", __func__);
-		return -EAGAIN;
-	}
-
 	spin_lock_irqsave(&s5p_ace_dev.lock, flags);
 #if defined(CONFIG_ACE_DISABLE_BACKLOG)
 	list_add_tail(&req->base.list, &s5p_ace_dev.queue_bc.list);
@@ -1539,6 +1599,28 @@ const unsigned char sha1_digest_emptymsg[SHA1_DIGEST_SIZE] = {
 	0x32, 0x55, 0xBF, 0xFF, 0x95, 0x60, 0x18, 0x90,
 	0xAF, 0xD8, 0x07, 0x09};
 
+/* Upper bound on each hash engine poll, in microseconds */
+#define ACE_HASH_POLL_US		10000
+
+/* Wait for any of the bits in mask to be set in sfr. This can run from
+ * the hash tasklet, so give up rather than spin forever on a hung engine.
+ */
+static int s5p_ace_hash_poll(u32 sfr, u32 mask)
+{
+	int us = ACE_HASH_POLL_US;
+
+	while (!(s5p_ace_read_sfr(sfr) & mask)) {
+		if (us-- == 0) {
+			printk(KERN_ERR "SHA1 : engine time out (0x%08X)\n",
+					s5p_ace_read_sfr(sfr));
+			return -ETIMEDOUT;
+		}
+		udelay(1);
+	}
+
+	return 0;
+}
+
 /*
  *	out == NULL - This is not a final message block.
  *		Intermediate value is stored at pCtx->digest.
@@ -1550,6 +1632,8 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 {
 	u32 reg;
 	u32 *buffer;
+	unsigned long flags;
+	int ret;
 
 #if defined(CONFIG_ACE_DEBUG)
 	printk(KERN_NOTICE "Out: 0x%08X, In: 0x%08X, Len: %d\n",
@@ -1580,10 +1664,14 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 #endif
 		ACE_HASH_SWAPDO_ON | ACE_HASH_SWAPIV_ON);
 
-	/* Select Hash input mux as external source */
+	/* Select Hash input mux as external source. The block cipher
+	 * interrupt handler may be changing FIFOCTRL at the same time.
+	 */
+	spin_lock_irqsave(&s5p_ace_dev.lock, flags);
 	reg = s5p_ace_read_sfr(ACE_FC_FIFOCTRL);
 	reg = (reg & ~ACE_FC_SELHASH_MASK) | ACE_FC_SELHASH_EXOUT;
 	s5p_ace_write_sfr(ACE_FC_FIFOCTRL, reg);
+	spin_unlock_irqrestore(&s5p_ace_dev.lock, flags);
 
 	/* Set Hash as SHA1 and start Hash engine */
 	reg = ACE_HASH_ENGSEL_SHA1HASH | ACE_HASH_STARTBIT_ON;
@@ -1600,6 +1688,7 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 		if ((out != NULL) && (len == 0)) {
 			/* ACE H/W does not compute hash for empty string */
 			memcpy(out, sha1_digest_emptymsg, SHA1_DIGEST_SIZE);
+			clear_bit(FLAGS_HASH_BUSY, &s5p_ace_dev.flags);
 			return 0;
 		}
 	}
@@ -1639,8 +1728,9 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 	s5p_ace_write_sfr(ACE_FC_HRDMAS, virt_to_phys((void *)in));
 	s5p_ace_write_sfr(ACE_FC_HRDMAL, len);
 
-	while (!(s5p_ace_read_sfr(ACE_FC_INTPEND) & ACE_FC_HRDMA))
-		;	/* wait */
+	ret = s5p_ace_hash_poll(ACE_FC_INTPEND, ACE_FC_HRDMA);
+	if (ret)
+		goto out;
 	s5p_ace_write_sfr(ACE_FC_INTPEND, ACE_FC_HRDMA);
 
 	/*while ((s5p_ace_read_sfr(ACE_HASH_STATUS) & ACE_HASH_BUFRDY_MASK)
@@ -1650,10 +1740,10 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 		/* Set Pause bit */
 		s5p_ace_write_sfr(ACE_HASH_CONTROL2, ACE_HASH_PAUSE_ON);
 
-		while ((s5p_ace_read_sfr(ACE_HASH_STATUS)
-				& ACE_HASH_PARTIALDONE_MASK)
-					== ACE_HASH_PARTIALDONE_OFF)
-			;	/* wait */
+		ret = s5p_ace_hash_poll(ACE_HASH_STATUS,
+					ACE_HASH_PARTIALDONE_MASK);
+		if (ret)
+			goto out;
 		s5p_ace_write_sfr(ACE_HASH_STATUS, ACE_HASH_PARTIALDONE_ON);
 
 		/* Update chaining variables */
@@ -1662,14 +1752,14 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 		/* Update pre-message length */
 		/* Note that the unit of pre-message length is a BIT!!! */
 		sctx->prelen_low += (len << 3);
-		if (sctx->prelen_low < len)
+		if (sctx->prelen_low < (len << 3))
 			sctx->prelen_high++;
 		sctx->prelen_high += (len >> 29);
 	} else {
-		while ((s5p_ace_read_sfr(ACE_HASH_STATUS)
-				& ACE_HASH_MSGDONE_MASK)
-					== ACE_HASH_MSGDONE_OFF)
-			;	/* wait */
+		ret = s5p_ace_hash_poll(ACE_HASH_STATUS,
+					ACE_HASH_MSGDONE_MASK);
+		if (ret)
+			goto out;
 		s5p_ace_write_sfr(ACE_HASH_STATUS, ACE_HASH_MSGDONE_ON);
 
 		/* Read hash result */
@@ -1681,6 +1771,14 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 	buffer[3] = s5p_ace_read_sfr(ACE_HASH_RESULT4);
 	buffer[4] = s5p_ace_read_sfr(ACE_HASH_RESULT5);
 
+out:
+	if (ret) {
+		/* Drop whatever the engine still holds */
+		s5p_ace_write_sfr(ACE_FC_HRDMAC, ACE_FC_HRDMACFLUSH_ON);
+		s5p_ace_write_sfr(ACE_FC_HRDMAC, ACE_FC_HRDMACFLUSH_OFF);
+		s5p_ace_write_sfr(ACE_FC_INTPEND, ACE_FC_HRDMA);
+	}
+
 	clear_bit(FLAGS_HASH_BUSY, &s5p_ace_dev.flags);
 
 #if !defined(CONFIG_ACE_USE_ACP)
@@ -1689,49 +1787,209 @@ static int s5p_ace_sha1_engine(struct s5p_ace_hash_ctx *sctx,
 #endif
 #endif
 
+	return ret;
+}
+
+/* The last block is always kept in sctx->buffer, since the final block
+ * has to be handed to the engine together with the message length.
+ */
+static int s5p_ace_sha1_update_data(struct s5p_ace_hash_ctx *sctx,
+				const u8 *data, unsigned int len)
+{
+	u32 partlen;
+	const u8 *src;
+	int ret;
+
+	partlen = sctx->buflen;
+	src = data;
+
+	/* Quick path */
+	if ((partlen == 0) && ((len & (SHA1_BLOCK_SIZE - 1)) == 0)) {
+		if (len > SHA1_BLOCK_SIZE) {
+			ret = s5p_ace_sha1_engine(sctx, NULL, src,
+						len - SHA1_BLOCK_SIZE);
+			if (ret)
+				return ret;
+		}
+		if (len > 0) {
+			memcpy(sctx->buffer, src + len - SHA1_BLOCK_SIZE,
+				SHA1_BLOCK_SIZE);
+			sctx->buflen = SHA1_BLOCK_SIZE;
+		}
+		return 0;
+	}
+
+	if (partlen != 0) {
+		if (partlen + len <= SHA1_BLOCK_SIZE) {
+			memcpy(sctx->buffer + partlen, src, len);
+			sctx->buflen += len;
+			return 0;
+		}
+
+		partlen = SHA1_BLOCK_SIZE - partlen;
+		memcpy(sctx->buffer + sctx->buflen, src, partlen);
+
+		ret = s5p_ace_sha1_engine(sctx, NULL, sctx->buffer,
+					SHA1_BLOCK_SIZE);
+		if (ret)
+			return ret;
+
+		len -= partlen;
+		src += partlen;
+	}
+
+	partlen = len & (SHA1_BLOCK_SIZE - 1);
+	partlen = (partlen == 0 ? SHA1_BLOCK_SIZE : partlen);
+	len -= partlen;
+	if (len > 0) {
+		ret = s5p_ace_sha1_engine(sctx, NULL, src, len);
+		if (ret)
+			return ret;
+	}
+
+	memcpy(sctx->buffer, src + len, partlen);
+	sctx->buflen = partlen;
+
 	return 0;
 }
 
 #if defined(CONFIG_ACE_HASH_ASYNC)
-static int s5p_ace_sha1_init(struct ahash_request *req)
+#define ACE_HASH_OP_UPDATE		0x1
+#define ACE_HASH_OP_FINAL		0x2
+
+struct s5p_ace_hash_reqctx {
+	u32				op;
+	struct s5p_ace_hash_ctx		sctx;
+};
+
+static int s5p_ace_sha1_handle_req(struct ahash_request *req)
 {
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct s5p_ace_hash_ctx *sctx = crypto_ahash_ctx(tfm);
+	struct s5p_ace_hash_reqctx *rctx = ahash_request_ctx(req);
+	struct crypto_hash_walk walk;
+	int nbytes;
+	int ret = 0;
 
-	sctx->prelen_high = sctx->prelen_low = 0;
-	sctx->buflen = 0;
+	if (rctx->op & ACE_HASH_OP_UPDATE) {
+		nbytes = crypto_hash_walk_first(req, &walk);
+		/* Runs from the tasklet, so the walk must not yield */
+		walk.flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+		for (; nbytes > 0; nbytes = crypto_hash_walk_done(&walk, ret))
+			ret = s5p_ace_sha1_update_data(&rctx->sctx,
+						(const u8 *)walk.data, nbytes);
+		if (nbytes < 0)
+			return nbytes;
+	}
 
-	/* To Do */
+	if (rctx->op & ACE_HASH_OP_FINAL) {
+		ret = s5p_ace_sha1_engine(&rctx->sctx, req->result,
+				rctx->sctx.buffer, rctx->sctx.buflen);
 
-	return 0;
+		/* Wipe context */
+		memset(&rctx->sctx, 0, sizeof(rctx->sctx));
+	}
+
+	return ret;
 }
 
-static int s5p_ace_sha1_update(struct ahash_request *req)
+static void s5p_ace_hash_task(unsigned long data)
 {
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct s5p_ace_hash_ctx *sctx = crypto_ahash_ctx(tfm);
+	struct s5p_ace_device *dev = (struct s5p_ace_device *)data;
+	struct crypto_async_request *async_req, *backlog;
+	struct ahash_request *req;
+	unsigned long flags;
+	int ret;
 
-	/* To Do */
+	if (test_bit(FLAGS_SUSPENDED, &dev->flags))
+		return;
 
-	return 0;
+	/* Keep the clock on until the queue is drained */
+	s5p_ace_clock_gating(ACE_CLOCK_ON);
+
+	while (1) {
+		spin_lock_irqsave(&dev->lock, flags);
+		backlog = crypto_get_backlog(&dev->queue_hash);
+		async_req = crypto_dequeue_request(&dev->queue_hash);
+		spin_unlock_irqrestore(&dev->lock, flags);
+
+		if (!async_req)
+			break;
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+
+		req = ahash_request_cast(async_req);
+		ret = s5p_ace_sha1_handle_req(req);
+		req->base.complete(&req->base, ret);
+	}
+
+	s5p_ace_clock_gating(ACE_CLOCK_OFF);
 }
 
-static int s5p_ace_sha1_final(struct ahash_request *req)
+static int s5p_ace_sha1_enqueue(struct ahash_request *req, u32 op)
 {
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct s5p_ace_hash_ctx *sctx = crypto_ahash_ctx(tfm);
+	struct s5p_ace_hash_reqctx *rctx = ahash_request_ctx(req);
+	unsigned long flags;
+	int ret;
 
-	/* To Do */
+	rctx->op = op;
+
+	spin_lock_irqsave(&s5p_ace_dev.lock, flags);
+	ret = ahash_enqueue_request(&s5p_ace_dev.queue_hash, req);
+	spin_unlock_irqrestore(&s5p_ace_dev.lock, flags);
+
+	s5p_ace_resume_device(&s5p_ace_dev);
+	tasklet_schedule(&s5p_ace_dev.task_hash);
+
+	return ret;
+}
+
+static int s5p_ace_sha1_init(struct ahash_request *req)
+{
+	struct s5p_ace_hash_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->sctx.prelen_high = rctx->sctx.prelen_low = 0;
+	rctx->sctx.buflen = 0;
 
 	return 0;
 }
 
+static int s5p_ace_sha1_update(struct ahash_request *req)
+{
+	if (!req->nbytes)
+		return 0;
+
+	return s5p_ace_sha1_enqueue(req, ACE_HASH_OP_UPDATE);
+}
+
+static int s5p_ace_sha1_final(struct ahash_request *req)
+{
+	return s5p_ace_sha1_enqueue(req, ACE_HASH_OP_FINAL);
+}
+
+static int s5p_ace_sha1_finup(struct ahash_request *req)
+{
+	return s5p_ace_sha1_enqueue(req,
+			ACE_HASH_OP_UPDATE | ACE_HASH_OP_FINAL);
+}
+
 static int s5p_ace_sha1_digest(struct ahash_request *req)
 {
 	s5p_ace_sha1_init(req);
-	s5p_ace_sha1_update(req);
-	s5p_ace_sha1_final(req);
 
+	return s5p_ace_sha1_finup(req);
+}
+
+static int s5p_ace_hash_export(struct ahash_request *req, void *out)
+{
+	struct s5p_ace_hash_reqctx *rctx = ahash_request_ctx(req);
+	memcpy(out, &rctx->sctx, sizeof(rctx->sctx));
+	return 0;
+}
+
+static int s5p_ace_hash_import(struct ahash_request *req, const void *in)
+{
+	struct s5p_ace_hash_reqctx *rctx = ahash_request_ctx(req);
+	memcpy(&rctx->sctx, in, sizeof(rctx->sctx));
 	return 0;
 }
 #else
@@ -1749,81 +2007,41 @@ static int s5p_ace_sha1_update(struct shash_desc *desc,
 			      const u8 *data, unsigned int len)
 {
 	struct s5p_ace_hash_ctx *sctx = shash_desc_ctx(desc);
-	u32 partlen;
-	const u8 *src;
 	int ret;
 
-	partlen = sctx->buflen;
-	src = data;
-
 	s5p_ace_clock_gating(ACE_CLOCK_ON);
-
-	/* Quick path */
-	if ((partlen == 0) && ((len & (SHA1_BLOCK_SIZE - 1)) == 0)) {
-		if (len > SHA1_BLOCK_SIZE)
-			ret = s5p_ace_sha1_engine(sctx, NULL, src,
-						len - SHA1_BLOCK_SIZE);
-		if (len > 0) {
-			memcpy(sctx->buffer, src, SHA1_BLOCK_SIZE);
-			sctx->buflen = SHA1_BLOCK_SIZE;
-		}
-		goto out;
-	}
-
-	if (partlen != 0) {
-		if (partlen + len <= SHA1_BLOCK_SIZE) {
-			memcpy(sctx->buffer + partlen, src, len);
-			sctx->buflen += len;
-			goto out;
-		} else {
-			partlen = SHA1_BLOCK_SIZE - partlen;
-			memcpy(sctx->buffer + partlen, src, partlen);
-
-			ret = s5p_ace_sha1_engine(sctx, NULL, sctx->buffer,
-						SHA1_BLOCK_SIZE);
-
-			len -= partlen;
-			src += partlen;
-		}
-	}
-
-	partlen = len & (SHA1_BLOCK_SIZE - 1);
-	partlen = (partlen == 0 ? SHA1_BLOCK_SIZE : partlen);
-	len -= partlen;
-	if (len > 0)
-		ret = s5p_ace_sha1_engine(sctx, NULL, src, len);
-
-	memcpy(sctx->buffer, src + len, partlen);
-	sctx->buflen = partlen;
-
-out:
+	ret = s5p_ace_sha1_update_data(sctx, data, len);
 	s5p_ace_clock_gating(ACE_CLOCK_OFF);
 
-	return 0;
+	return ret;
 }
 
 static int s5p_ace_sha1_final(struct shash_desc *desc, u8 *out)
 {
 	struct s5p_ace_hash_ctx *sctx = shash_desc_ctx(desc);
+	int ret;
 
 	s5p_ace_clock_gating(ACE_CLOCK_ON);
-	s5p_ace_sha1_engine(sctx, out, sctx->buffer, sctx->buflen);
+	ret = s5p_ace_sha1_engine(sctx, out, sctx->buffer, sctx->buflen);
 	s5p_ace_clock_gating(ACE_CLOCK_OFF);
 
 	/* Wipe context */
 	memset(sctx, 0, sizeof(*sctx));
 
-	return 0;
+	return ret;
 }
 
 static int s5p_ace_sha1_digest(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out)
 {
+	int ret;
+
 	s5p_ace_sha1_init(desc);
-	s5p_ace_sha1_update(desc, data, len);
-	s5p_ace_sha1_final(desc, out);
+	ret = s5p_ace_sha1_update(desc, data, len);
+	if (ret)
+		return ret;
 
-	return 0;
+	return s5p_ace_sha1_final(desc, out);
 }
 
 static int s5p_ace_hash_export(struct shash_desc *desc, void *out)
@@ -1844,6 +2062,8 @@ static int s5p_ace_hash_import(struct shash_desc *desc, const void *in)
 static int s5p_ace_hash_cra_init(struct crypto_tfm *tfm)
 {
 #if defined(CONFIG_ACE_HASH_ASYNC)
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+				sizeof(struct s5p_ace_hash_reqctx));
 #endif
 
 #if defined(CONFIG_ACE_DEBUG)
@@ -1855,9 +2075,6 @@ static int s5p_ace_hash_cra_init(struct crypto_tfm *tfm)
 
 static void s5p_ace_hash_cra_exit(struct crypto_tfm *tfm)
 {
-#if defined(CONFIG_ACE_HASH_ASYNC)
-#endif
-
 #if defined(CONFIG_ACE_DEBUG)
 	printk(KERN_NOTICE "%s\n", __func__);
 #endif
@@ -1869,16 +2086,21 @@ static struct ahash_alg algs_hash[] = {
 	.init		=	s5p_ace_sha1_init,
 	.update		=	s5p_ace_sha1_update,
 	.final		=	s5p_ace_sha1_final,
+	.finup		=	s5p_ace_sha1_finup,
 	.digest		=	s5p_ace_sha1_digest,
+	.export		=	s5p_ace_hash_export,
+	.import		=	s5p_ace_hash_import,
 	.halg.digestsize	=	SHA1_DIGEST_SIZE,
+	.halg.statesize		=	sizeof(struct s5p_ace_hash_ctx),
 	.halg.base	= {
 		.cra_name		=	"sha1",
 		.cra_driver_name	=	"sha1-s5p-ace",
-		.cra_priority		=	200,
+		/* Below sha1-generic (0) until the self-test has passed
+		 * on hardware; tcrypt still reaches it by driver name. */
+		.cra_priority		=	-1,
 		.cra_flags		=	CRYPTO_ALG_TYPE_AHASH
 						| CRYPTO_ALG_ASYNC,
 		.cra_blocksize		=	SHA1_BLOCK_SIZE,
-		.cra_ctxsize		=	sizeof(struct s5p_ace_hash_ctx),
 		.cra_alignmask		=	0,
 		.cra_module		=	THIS_MODULE,
 		.cra_init		=	s5p_ace_hash_cra_init,
@@ -1922,13 +2144,21 @@ static irqreturn_t s5p_ace_interrupt(int irq, void *data)
 {
 	struct s5p_ace_device *dev = data;
 
-	s5p_ace_write_sfr(ACE_FC_INTPEND,
-		ACE_FC_BRDMA | ACE_FC_BTDMA | ACE_FC_HRDMA);
+	/* Only ack what is handled here. Without CONFIG_ACE_HASH_IRQMODE the
+	 * hash path polls HRDMA itself and must not lose it.
+	 */
+#if defined(CONFIG_ACE_BC_IRQMODE)
+	s5p_ace_write_sfr(ACE_FC_INTPEND, ACE_FC_BRDMA | ACE_FC_BTDMA);
+#endif
+#if defined(CONFIG_ACE_HASH_IRQMODE)
+	s5p_ace_write_sfr(ACE_FC_INTPEND, ACE_FC_HRDMA);
+#endif
 
 #if defined(CONFIG_ACE_BC_IRQMODE)
 	s5p_ace_write_sfr(ACE_FC_INTENCLR, ACE_FC_BRDMA | ACE_FC_BTDMA);
 
-	tasklet_schedule(&dev->task_bc);
+	if (s5p_ace_aes_crypt_dma_chain(dev))
+		tasklet_schedule(&dev->task_bc);
 #endif
 
 #if defined(CONFIG_ACE_HASH_IRQMODE)
@@ -2016,13 +2246,13 @@ static int __init s5p_ace_probe(struct platform_device *pdev)
 #endif
 
 #if defined(CONFIG_ACE_BC_ASYNC)
-	crypto_init_queue(&s5p_adt->queue_bc, 1);
+	crypto_init_queue(&s5p_adt->queue_bc, ACE_BC_QUEUE_LEN);
 	tasklet_init(&s5p_adt->task_bc, s5p_ace_bc_task,
 			(unsigned long)s5p_adt);
 #endif
 
 #if defined(CONFIG_ACE_HASH_ASYNC)
-	crypto_init_queue(&s5p_adt->queue_hash, 1);
+	crypto_init_queue(&s5p_adt->queue_hash, ACE_HASH_QUEUE_LEN);
 	tasklet_init(&s5p_adt->task_hash, s5p_ace_hash_task,
 			(unsigned long)s5p_adt);
 #endif
@@ -2207,6 +2437,9 @@ static int s5p_ace_resume(struct platform_device *dev)
 #endif
 
 	s5p_ace_resume_device(&s5p_ace_dev);
+#if defined(CONFIG_ACE_HASH_ASYNC)
+	tasklet_schedule(&s5p_ace_dev.task_hash);
+#endif
 
 	/* To do */
 	return 0;
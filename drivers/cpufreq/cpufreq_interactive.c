@@ -0,0 +1,846 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * 'interactive' samples load with a short timer that is (re)started when
+ * a CPU leaves idle, jumps straight to hispeed_freq on a load spike or on
+ * user input, and only ramps down after the current speed has been held
+ * for min_sample_time.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/tick.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/slab.h>
+#include <linux/input.h>
+#include <linux/notifier.h>
+#include <linux/rcupdate.h>
+
+#include <asm/idle.h>
+
+#define DEF_GO_HISPEED_LOAD		(85)
+#define DEF_MIN_SAMPLE_TIME		(80 * USEC_PER_MSEC)
+#define DEF_TIMER_RATE			(20 * USEC_PER_MSEC)
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+					unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name			= "interactive",
+	.governor		= cpufreq_governor_interactive,
+	.max_transition_latency	= 10000000,
+	.owner			= THIS_MODULE,
+};
+
+struct cpufreq_interactive_cpuinfo {
+	struct timer_list cpu_timer;
+	u64 time_in_idle;
+	u64 time_in_idle_timestamp;
+	u64 target_set_time;
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int target_freq;
+	int governor_enabled;
+	int idling;
+
+	/* residency, protected by set_speed_lock */
+	u64 *time_in_state;
+	unsigned int nr_states;
+	int cur_state;
+	u64 state_timestamp;
+};
+static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
+
+/* speed changes are made from an RT thread, timers only pick the target */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static DEFINE_SPINLOCK(speedchange_cpumask_lock);
+
+/*
+ * set_speed_lock serializes frequency changes with governor stop and
+ * limit changes, and protects the statistics below.
+ */
+static DEFINE_MUTEX(set_speed_lock);
+static DEFINE_MUTEX(gov_lock);
+static int active_count;
+
+static struct interactive_tuners {
+	unsigned int hispeed_freq;
+	unsigned int go_hispeed_load;
+	unsigned int min_sample_time;
+	unsigned int timer_rate;
+	unsigned int input_boost;
+} tuners = {
+	.go_hispeed_load = DEF_GO_HISPEED_LOAD,
+	.min_sample_time = DEF_MIN_SAMPLE_TIME,
+	.timer_rate = DEF_TIMER_RATE,
+	.input_boost = 1,
+};
+
+static struct interactive_stats {
+	u64 transitions;
+	u64 latency_total;
+	u64 latency_max;
+} gov_stats;
+
+static inline u64 ktime_now_us(void)
+{
+	return ktime_to_us(ktime_get());
+}
+
+static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu,
+							cputime64_t *wall)
+{
+	cputime64_t idle_time;
+	cputime64_t cur_wall_time;
+	cputime64_t busy_time;
+
+	cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	idle_time = cputime64_sub(cur_wall_time, busy_time);
+	if (wall)
+		*wall = (cputime64_t)jiffies_to_usecs(cur_wall_time);
+
+	return (cputime64_t)jiffies_to_usecs(idle_time);
+}
+
+static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+
+static void cpufreq_interactive_timer_resched(
+	struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	pcpu->time_in_idle = get_cpu_idle_time(smp_processor_id(),
+					       &pcpu->time_in_idle_timestamp);
+	mod_timer(&pcpu->cpu_timer,
+		  jiffies + usecs_to_jiffies(tuners.timer_rate));
+}
+
+static void cpufreq_interactive_kick(unsigned int cpu)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	cpumask_set_cpu(cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+	wake_up_process(speedchange_task);
+}
+
+static unsigned int cpufreq_interactive_hispeed(struct cpufreq_policy *policy)
+{
+	unsigned int freq = tuners.hispeed_freq;
+
+	if (!freq || freq > policy->max)
+		freq = policy->max;
+
+	return freq;
+}
+
+static void cpufreq_interactive_timer(unsigned long data)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, data);
+	struct cpufreq_policy *policy;
+	u64 now, now_idle, delta_time, delta_idle;
+	unsigned int cpu_load, new_freq, hispeed, index;
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	policy = pcpu->policy;
+	now_idle = get_cpu_idle_time(data, &now);
+	delta_idle = now_idle - pcpu->time_in_idle;
+	delta_time = now - pcpu->time_in_idle_timestamp;
+
+	/* window too short to say anything, just sample again */
+	if (!delta_time)
+		goto rearm;
+
+	if (delta_idle > delta_time)
+		cpu_load = 0;
+	else
+		cpu_load = div64_u64(100 * (delta_time - delta_idle),
+				     delta_time);
+
+	hispeed = cpufreq_interactive_hispeed(policy);
+
+	if (cpu_load >= tuners.go_hispeed_load) {
+		if (pcpu->target_freq < hispeed)
+			new_freq = hispeed;
+		else
+			new_freq = max(hispeed, policy->max * cpu_load / 100);
+	} else {
+		new_freq = policy->max * cpu_load / 100;
+	}
+
+	if (cpufreq_frequency_table_target(policy, pcpu->freq_table,
+					   new_freq, CPUFREQ_RELATION_L,
+					   &index))
+		goto rearm;
+
+	new_freq = pcpu->freq_table[index].frequency;
+
+	/* ramp down only after the current speed has been held long enough */
+	if (new_freq < pcpu->target_freq &&
+	    now - pcpu->target_set_time < tuners.min_sample_time)
+		goto rearm;
+
+	if (new_freq != pcpu->target_freq) {
+		pcpu->target_freq = new_freq;
+		pcpu->target_set_time = now;
+		cpufreq_interactive_kick(data);
+	}
+
+rearm:
+	/*
+	 * At the floor there is nothing left to ramp down, so an idle CPU
+	 * needs no timer; idle exit restarts sampling.
+	 */
+	if (!timer_pending(&pcpu->cpu_timer) &&
+	    !(pcpu->idling && pcpu->target_freq == policy->min))
+		cpufreq_interactive_timer_resched(pcpu);
+}
+
+static void cpufreq_interactive_idle_start(void)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, smp_processor_id());
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	/* keep sampling while idle above the floor so we still ramp down */
+	if (pcpu->target_freq != pcpu->policy->min &&
+	    !timer_pending(&pcpu->cpu_timer))
+		cpufreq_interactive_timer_resched(pcpu);
+
+	pcpu->idling = 1;
+}
+
+static void cpufreq_interactive_idle_end(void)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, smp_processor_id());
+
+	pcpu->idling = 0;
+
+	/* idle exit: start a fresh window so a burst is seen within one rate */
+	if (pcpu->governor_enabled && !timer_pending(&pcpu->cpu_timer))
+		cpufreq_interactive_timer_resched(pcpu);
+}
+
+static int cpufreq_interactive_idle_notifier(struct notifier_block *nb,
+					     unsigned long val, void *data)
+{
+	switch (val) {
+	case IDLE_START:
+		cpufreq_interactive_idle_start();
+		break;
+	case IDLE_END:
+		cpufreq_interactive_idle_end();
+		break;
+	}
+
+	return 0;
+}
+
+static struct notifier_block cpufreq_interactive_idle_nb = {
+	.notifier_call = cpufreq_interactive_idle_notifier,
+};
+
+static int cpufreq_interactive_freq_index(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < pcpu->nr_states; i++)
+		if (pcpu->freq_table[i].frequency == freq)
+			return i;
+
+	return -1;
+}
+
+/* Charge the time since the last change to the speed we were running at. */
+static void cpufreq_interactive_account(
+	struct cpufreq_interactive_cpuinfo *pcpu, u64 now)
+{
+	if (pcpu->time_in_state && pcpu->cur_state >= 0)
+		pcpu->time_in_state[pcpu->cur_state] +=
+			now - pcpu->state_timestamp;
+
+	pcpu->state_timestamp = now;
+	pcpu->cur_state = cpufreq_interactive_freq_index(pcpu,
+							  pcpu->policy->cur);
+}
+
+/* Must be called with set_speed_lock held. */
+static void cpufreq_interactive_set_speed(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int freq,
+	unsigned int relation)
+{
+	u64 start, latency;
+
+	if (freq == pcpu->policy->cur)
+		return;
+
+	start = ktime_now_us();
+	__cpufreq_driver_target(pcpu->policy, freq, relation);
+	latency = ktime_now_us() - start;
+
+	gov_stats.transitions++;
+	gov_stats.latency_total += latency;
+	if (latency > gov_stats.latency_max)
+		gov_stats.latency_max = latency;
+
+	cpufreq_interactive_account(pcpu, start + latency);
+}
+
+static int cpufreq_interactive_speedchange_task(void *data)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu, *pjcpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	unsigned int cpu, j, max_freq;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		__set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		mutex_lock(&set_speed_lock);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			pcpu = &per_cpu(cpuinfo, cpu);
+			if (!pcpu->governor_enabled)
+				continue;
+
+			/* CPUs sharing a clock run at the fastest request */
+			max_freq = 0;
+			for_each_cpu(j, pcpu->policy->cpus) {
+				pjcpu = &per_cpu(cpuinfo, j);
+				if (pjcpu->target_freq > max_freq)
+					max_freq = pjcpu->target_freq;
+			}
+
+			cpufreq_interactive_set_speed(pcpu, max_freq,
+						      CPUFREQ_RELATION_H);
+		}
+
+		mutex_unlock(&set_speed_lock);
+	}
+
+	return 0;
+}
+
+/************************** input boost ************************/
+
+static void cpufreq_interactive_boost(void)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int cpu, hispeed;
+	u64 now = ktime_now_us();
+
+	for_each_online_cpu(cpu) {
+		pcpu = &per_cpu(cpuinfo, cpu);
+		if (!pcpu->governor_enabled)
+			continue;
+
+		hispeed = cpufreq_interactive_hispeed(pcpu->policy);
+
+		/* hold the boost for min_sample_time from the last event */
+		pcpu->target_set_time = now;
+		if (pcpu->target_freq < hispeed) {
+			pcpu->target_freq = hispeed;
+			cpufreq_interactive_kick(cpu);
+		}
+	}
+}
+
+static void cpufreq_interactive_input_event(struct input_handle *handle,
+					    unsigned int type,
+					    unsigned int code, int value)
+{
+	if (tuners.input_boost && active_count)
+		cpufreq_interactive_boost();
+}
+
+static int cpufreq_interactive_input_connect(struct input_handler *handler,
+					     struct input_dev *dev,
+					     const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void cpufreq_interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id cpufreq_interactive_ids[] = {
+	{
+		/* touchscreens */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	{
+		/* keypads */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler cpufreq_interactive_input_handler = {
+	.event		= cpufreq_interactive_input_event,
+	.connect	= cpufreq_interactive_input_connect,
+	.disconnect	= cpufreq_interactive_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= cpufreq_interactive_ids,
+};
+
+/************************** sysfs interface ************************/
+
+#define show_one(file_name, object)					\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%u\n", tuners.object);			\
+}
+show_one(hispeed_freq, hispeed_freq);
+show_one(go_hispeed_load, go_hispeed_load);
+show_one(min_sample_time, min_sample_time);
+show_one(timer_rate, timer_rate);
+show_one(input_boost, input_boost);
+
+static ssize_t store_hispeed_freq(struct kobject *a, struct attribute *b,
+				  const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	tuners.hispeed_freq = input;
+
+	return count;
+}
+
+static ssize_t store_go_hispeed_load(struct kobject *a, struct attribute *b,
+				     const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || input > 100)
+		return -EINVAL;
+
+	tuners.go_hispeed_load = input;
+
+	return count;
+}
+
+static ssize_t store_min_sample_time(struct kobject *a, struct attribute *b,
+				     const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	tuners.min_sample_time = input;
+
+	return count;
+}
+
+static ssize_t store_timer_rate(struct kobject *a, struct attribute *b,
+				const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || !input)
+		return -EINVAL;
+
+	tuners.timer_rate = input;
+
+	return count;
+}
+
+static ssize_t store_input_boost(struct kobject *a, struct attribute *b,
+				 const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	tuners.input_boost = !!input;
+
+	return count;
+}
+
+/*
+ * "transitions", average and worst transition latency in us, then one
+ * "cpu<N> <kHz> <us>" line per frequency with the time spent there.
+ */
+static ssize_t show_stats(struct kobject *kobj, struct attribute *attr,
+			  char *buf)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int cpu;
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&set_speed_lock);
+
+	len += sprintf(buf + len, "transitions %llu\n", gov_stats.transitions);
+	len += sprintf(buf + len, "latency_avg_us %llu\n",
+		       gov_stats.transitions ?
+		       div64_u64(gov_stats.latency_total, gov_stats.transitions) : 0);
+	len += sprintf(buf + len, "latency_max_us %llu\n", gov_stats.latency_max);
+
+	for_each_online_cpu(cpu) {
+		pcpu = &per_cpu(cpuinfo, cpu);
+		if (!pcpu->governor_enabled || pcpu->policy->cpu != cpu)
+			continue;
+
+		cpufreq_interactive_account(pcpu, ktime_now_us());
+
+		for (i = 0; i < pcpu->nr_states; i++) {
+			if (pcpu->freq_table[i].frequency ==
+			    CPUFREQ_ENTRY_INVALID)
+				continue;
+			if (len >= PAGE_SIZE - 48)
+				break;
+
+			len += sprintf(buf + len, "cpu%u %u %llu\n", cpu,
+				       pcpu->freq_table[i].frequency,
+				       pcpu->time_in_state[i]);
+		}
+	}
+
+	mutex_unlock(&set_speed_lock);
+
+	return len;
+}
+
+define_one_global_rw(hispeed_freq);
+define_one_global_rw(go_hispeed_load);
+define_one_global_rw(min_sample_time);
+define_one_global_rw(timer_rate);
+define_one_global_rw(input_boost);
+define_one_global_ro(stats);
+
+static struct attribute *interactive_attributes[] = {
+	&hispeed_freq.attr,
+	&go_hispeed_load.attr,
+	&min_sample_time.attr,
+	&timer_rate.attr,
+	&input_boost.attr,
+	&stats.attr,
+	NULL
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+/************************** sysfs end ************************/
+
+static int cpufreq_interactive_start(struct cpufreq_policy *policy)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int j, nr_states;
+	u64 now = ktime_now_us();
+	int rc;
+
+	if (!cpu_online(policy->cpu) || !policy->cur)
+		return -EINVAL;
+
+	freq_table = cpufreq_frequency_get_table(policy->cpu);
+	if (!freq_table)
+		return -EINVAL;
+
+	for (nr_states = 0; freq_table[nr_states].frequency !=
+	     CPUFREQ_TABLE_END; nr_states++)
+		;
+
+	mutex_lock(&gov_lock);
+
+	for_each_cpu(j, policy->cpus) {
+		pcpu = &per_cpu(cpuinfo, j);
+		pcpu->time_in_state = kcalloc(nr_states, sizeof(u64),
+					      GFP_KERNEL);
+		if (!pcpu->time_in_state) {
+			rc = -ENOMEM;
+			goto err_alloc;
+		}
+	}
+
+	for_each_cpu(j, policy->cpus) {
+		pcpu = &per_cpu(cpuinfo, j);
+		pcpu->policy = policy;
+		pcpu->freq_table = freq_table;
+		pcpu->target_freq = policy->cur;
+		pcpu->target_set_time = now;
+		pcpu->nr_states = nr_states;
+		pcpu->cur_state = cpufreq_interactive_freq_index(pcpu,
+								  policy->cur);
+		pcpu->state_timestamp = now;
+		pcpu->time_in_idle = get_cpu_idle_time(j,
+					&pcpu->time_in_idle_timestamp);
+		smp_wmb();
+		pcpu->governor_enabled = 1;
+	}
+
+	if (++active_count == 1) {
+		rc = sysfs_create_group(cpufreq_global_kobject,
+					&interactive_attr_group);
+		if (rc)
+			goto err_sysfs;
+
+		memset(&gov_stats, 0, sizeof(gov_stats));
+
+		idle_notifier_register(&cpufreq_interactive_idle_nb);
+	}
+
+	mutex_unlock(&gov_lock);
+
+	return 0;
+
+err_sysfs:
+	active_count--;
+	for_each_cpu(j, policy->cpus)
+		per_cpu(cpuinfo, j).governor_enabled = 0;
+err_alloc:
+	for_each_cpu(j, policy->cpus) {
+		pcpu = &per_cpu(cpuinfo, j);
+		kfree(pcpu->time_in_state);
+		pcpu->time_in_state = NULL;
+	}
+	mutex_unlock(&gov_lock);
+
+	return rc;
+}
+
+static void cpufreq_interactive_stop(struct cpufreq_policy *policy)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int j;
+
+	mutex_lock(&gov_lock);
+
+	for_each_cpu(j, policy->cpus) {
+		pcpu = &per_cpu(cpuinfo, j);
+		pcpu->governor_enabled = 0;
+	}
+	smp_wmb();
+
+	/* let idle notifiers that saw us enabled finish before the timers go */
+	synchronize_rcu();
+
+	for_each_cpu(j, policy->cpus)
+		del_timer_sync(&per_cpu(cpuinfo, j).cpu_timer);
+
+	if (--active_count == 0) {
+		idle_notifier_unregister(&cpufreq_interactive_idle_nb);
+
+		sysfs_remove_group(cpufreq_global_kobject,
+				   &interactive_attr_group);
+	}
+
+	mutex_unlock(&gov_lock);
+
+	/* wait for a speed change in flight before freeing its stats */
+	mutex_lock(&set_speed_lock);
+	for_each_cpu(j, policy->cpus) {
+		pcpu = &per_cpu(cpuinfo, j);
+		kfree(pcpu->time_in_state);
+		pcpu->time_in_state = NULL;
+	}
+	mutex_unlock(&set_speed_lock);
+}
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+					unsigned int event)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, policy->cpu);
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		return cpufreq_interactive_start(policy);
+
+	case CPUFREQ_GOV_STOP:
+		cpufreq_interactive_stop(policy);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
+		if (policy->max < policy->cur)
+			cpufreq_interactive_set_speed(pcpu, policy->max,
+						      CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			cpufreq_interactive_set_speed(pcpu, policy->min,
+						      CPUFREQ_RELATION_L);
+		mutex_unlock(&set_speed_lock);
+		break;
+	}
+
+	return 0;
+}
+
+static int __init cpufreq_gov_interactive_init(void)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	unsigned int cpu;
+	int err;
+
+	for_each_possible_cpu(cpu) {
+		pcpu = &per_cpu(cpuinfo, cpu);
+		init_timer(&pcpu->cpu_timer);
+		pcpu->cpu_timer.function = cpufreq_interactive_timer;
+		pcpu->cpu_timer.data = cpu;
+	}
+
+	speedchange_task = kthread_create(cpufreq_interactive_speedchange_task,
+					  NULL, "cfinteractive");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler(speedchange_task, SCHED_FIFO, &param);
+	get_task_struct(speedchange_task);
+	wake_up_process(speedchange_task);
+
+	err = input_register_handler(&cpufreq_interactive_input_handler);
+	if (err)
+		goto err_input;
+
+	err = cpufreq_register_governor(&cpufreq_gov_interactive);
+	if (err)
+		goto err_governor;
+
+	return 0;
+
+err_governor:
+	input_unregister_handler(&cpufreq_interactive_input_handler);
+err_input:
+	kthread_stop(speedchange_task);
+	put_task_struct(speedchange_task);
+
+	return err;
+}
+
+static void __exit cpufreq_gov_interactive_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	input_unregister_handler(&cpufreq_interactive_input_handler);
+	kthread_stop(speedchange_task);
+	put_task_struct(speedchange_task);
+}
+
+MODULE_DESCRIPTION("'cpufreq_interactive' - A cpufreq governor for "
+	"latency sensitive workloads");
+MODULE_LICENSE("GPL");
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_gov_interactive_init);
+#else
+module_init(cpufreq_gov_interactive_init);
+#endif
+module_exit(cpufreq_gov_interactive_exit);
@@ -50,7 +50,7 @@ static int __cpuidle_register_device(struct cpuidle_device *dev);
 static void cpuidle_idle_call(void)
 {
 	struct cpuidle_device *dev = __get_cpu_var(cpuidle_devices);
-	struct cpuidle_state *target_state;
+	struct cpuidle_state *target_state, *selected_state;
 	int next_state;
 
 	/* check if the device is ready */
@@ -82,6 +82,7 @@ static void cpuidle_idle_call(void)
 	}
 
 	target_state = &dev->states[next_state];
+	selected_state = target_state;
 
 	/* enter the state and update stats */
 	dev->last_state = target_state;
@@ -92,6 +93,20 @@ static void cpuidle_idle_call(void)
 	target_state->time += (unsigned long long)dev->last_residency;
 	target_state->usage++;
 
+	/*
+	 * charge mispredictions to the state the governor asked for; the
+	 * first state has nothing shallower, so it is never too deep
+	 */
+	if (selected_state->flags & CPUIDLE_FLAG_TIME_VALID) {
+		if (next_state &&
+		    dev->last_residency < selected_state->target_residency)
+			selected_state->too_deep++;
+		else if (next_state + 1 < dev->state_count &&
+			 dev->last_residency >=
+			 dev->states[next_state + 1].target_residency)
+			selected_state->too_shallow++;
+	}
+
 	/* give the governor an opportunity to reflect on the outcome */
 	if (cpuidle_curr_governor->reflect)
 		cpuidle_curr_governor->reflect(dev);
@@ -177,6 +192,8 @@ int cpuidle_enable_device(struct cpuidle_device *dev)
 	for (i = 0; i < dev->state_count; i++) {
 		dev->states[i].usage = 0;
 		dev->states[i].time = 0;
+		dev->states[i].too_deep = 0;
+		dev->states[i].too_shallow = 0;
 	}
 	dev->last_residency = 0;
 	dev->last_state = NULL;
@@ -35,8 +35,11 @@
 
 #define PRIVATE_MAX(a,b) ((a)>(b)?(a):(b))
 
-#define	KEY_TO_INDEX(pHash, key, uSize) \
-	((pHash)->pfnHashFunc((pHash)->uKeySize, (key), (uSize)) % (uSize))
+#define HASH_MIGRATE_STEP		4
+#define HASH_BUCKET_CACHE_LIMIT	32
+
+#define	HASH_TO_INDEX(uHash, uSize) \
+	((uHash) & ((uSize) - 1))
 
 #define	KEY_COMPARE(pHash, pKey1, pKey2) \
 	((pHash)->pfnKeyComp((pHash)->uKeySize, (pKey1), (pKey2)))
@@ -47,6 +50,9 @@ struct _BUCKET_
 	struct _BUCKET_ *pNext;
 
 	
+	IMG_UINT32 uHash;
+
+	
 	IMG_UINTPTR_T v;
 
 	
@@ -76,8 +82,37 @@ struct _HASH_TABLE_
 
 	
 	HASH_KEY_COMP *pfnKeyComp;
+
+	
+	IMG_BOOL bSingleWordKey;
+
+	
+	BUCKET **ppOldTable;
+	IMG_UINT32 uOldSize;
+	IMG_UINT32 uMigrateIndex;
+
+	
+	BUCKET *pFreeBuckets;
+	IMG_UINT32 uFreeBucketCount;
 };
 
+static INLINE IMG_UINT32
+_HashWord (IMG_UINTPTR_T k)
+{
+	IMG_UINT32 uHashPart = (IMG_UINT32)k;
+
+	uHashPart += (uHashPart << 12);
+	uHashPart ^= (uHashPart >> 22);
+	uHashPart += (uHashPart << 4);
+	uHashPart ^= (uHashPart >> 9);
+	uHashPart += (uHashPart << 10);
+	uHashPart ^= (uHashPart >> 2);
+	uHashPart += (uHashPart << 7);
+	uHashPart ^= (uHashPart >> 12);
+
+	return uHashPart;
+}
+
 IMG_UINT32
 HASH_Func_Default (IMG_SIZE_T uKeySize, IMG_VOID *pKey, IMG_UINT32 uHashTabLen)
 {
@@ -92,18 +127,7 @@ HASH_Func_Default (IMG_SIZE_T uKeySize, IMG_VOID *pKey, IMG_UINT32 uHashTabLen)
 
 	for (ui = 0; ui < uKeyLen; ui++)
 	{
-		IMG_UINT32 uHashPart = (IMG_UINT32)*p++;
-
-		uHashPart += (uHashPart << 12);
-		uHashPart ^= (uHashPart >> 22);
-		uHashPart += (uHashPart << 4);
-		uHashPart ^= (uHashPart >> 9);
-		uHashPart += (uHashPart << 10);
-		uHashPart ^= (uHashPart >> 2);
-		uHashPart += (uHashPart << 7);
-		uHashPart ^= (uHashPart >> 12);
-
-		uHashKey += uHashPart;
+		uHashKey += _HashWord(*p++);
 	}
 
 	return uHashKey;
@@ -128,56 +152,145 @@ HASH_Key_Comp_Default (IMG_SIZE_T uKeySize, IMG_VOID *pKey1, IMG_VOID *pKey2)
 	return IMG_TRUE;
 }
 
-static PVRSRV_ERROR
-_ChainInsert (HASH_TABLE *pHash, BUCKET *pBucket, BUCKET **ppBucketTable, IMG_UINT32 uSize)
+static INLINE IMG_UINT32
+_KeyHash (HASH_TABLE *pHash, IMG_VOID *pKey)
+{
+	if (pHash->bSingleWordKey)
+	{
+		return _HashWord(*(IMG_UINTPTR_T *)pKey);
+	}
+
+	return pHash->pfnHashFunc(pHash->uKeySize, pKey, pHash->uSize);
+}
+
+static INLINE IMG_BOOL
+_KeyMatch (HASH_TABLE *pHash, BUCKET *pBucket, IMG_UINT32 uHash, IMG_VOID *pKey)
+{
+	if (pBucket->uHash != uHash)
+	{
+		return IMG_FALSE;
+	}
+
+	if (pHash->bSingleWordKey)
+	{
+		return (IMG_BOOL)(pBucket->k[0] == *(IMG_UINTPTR_T *)pKey);
+	}
+
+	return KEY_COMPARE(pHash, pBucket->k, pKey);
+}
+
+static BUCKET *
+_BucketAlloc (HASH_TABLE *pHash)
+{
+	BUCKET *pBucket = pHash->pFreeBuckets;
+
+	if (pBucket != IMG_NULL)
+	{
+		pHash->pFreeBuckets = pBucket->pNext;
+		pHash->uFreeBucketCount--;
+		return pBucket;
+	}
+
+	if(OSAllocMem(PVRSRV_PAGEABLE_SELECT,
+					sizeof(BUCKET) + pHash->uKeySize,
+					(IMG_VOID **)&pBucket, IMG_NULL,
+					"Hash Table entry") != PVRSRV_OK)
+	{
+		return IMG_NULL;
+	}
+
+	return pBucket;
+}
+
+static IMG_VOID
+_BucketFree (HASH_TABLE *pHash, BUCKET *pBucket)
+{
+	if (pHash->uFreeBucketCount < HASH_BUCKET_CACHE_LIMIT)
+	{
+		pBucket->pNext = pHash->pFreeBuckets;
+		pHash->pFreeBuckets = pBucket;
+		pHash->uFreeBucketCount++;
+		return;
+	}
+
+	OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET) + pHash->uKeySize, pBucket, IMG_NULL);
+}
+
+static IMG_VOID
+_ChainInsert (BUCKET *pBucket, BUCKET **ppBucketTable, IMG_UINT32 uSize)
 {
 	IMG_UINT32 uIndex;
 
 	PVR_ASSERT (pBucket != IMG_NULL);
 	PVR_ASSERT (ppBucketTable != IMG_NULL);
 	PVR_ASSERT (uSize != 0);
-	if ((int)pBucket == -1)
- 	{
-	  PVR_DPF((PVR_DBG_ERROR, "invalied bucket value ; pBucket == -1  !!!!!!"));
-  }
-  
-	if ((pBucket == IMG_NULL) || (ppBucketTable == IMG_NULL) || (uSize == 0))
-	{
-		PVR_DPF((PVR_DBG_ERROR, "_ChainInsert: invalid parameter"));
-		return PVRSRV_ERROR_INVALID_PARAMS;
-	}
 
-	uIndex = KEY_TO_INDEX(pHash, pBucket->k, uSize);	 
+	uIndex = HASH_TO_INDEX(pBucket->uHash, uSize);
 	pBucket->pNext = ppBucketTable[uIndex];
 	ppBucketTable[uIndex] = pBucket;
-
-	return PVRSRV_OK;
 }
 
-static PVRSRV_ERROR
-_Rehash (HASH_TABLE *pHash,
-	 BUCKET **ppOldTable, IMG_UINT32 uOldSize,
-         BUCKET **ppNewTable, IMG_UINT32 uNewSize)
+static IMG_VOID
+_MigrateStep (HASH_TABLE *pHash, IMG_UINT32 uChains)
 {
-	IMG_UINT32 uIndex;
-	for (uIndex=0; uIndex< uOldSize; uIndex++)
-    {
-		BUCKET *pBucket;
-		pBucket = ppOldTable[uIndex];
+	if (pHash->ppOldTable == IMG_NULL)
+	{
+		return;
+	}
+
+	while (uChains-- != 0 && pHash->uMigrateIndex < pHash->uOldSize)
+	{
+		BUCKET *pBucket = pHash->ppOldTable[pHash->uMigrateIndex];
+
 		while (pBucket != IMG_NULL)
 		{
-			PVRSRV_ERROR eError;
 			BUCKET *pNextBucket = pBucket->pNext;
-			eError = _ChainInsert (pHash, pBucket, ppNewTable, uNewSize);
-			if (eError != PVRSRV_OK)
+			_ChainInsert (pBucket, pHash->ppBucketTable, pHash->uSize);
+			pBucket = pNextBucket;
+		}
+		pHash->ppOldTable[pHash->uMigrateIndex] = IMG_NULL;
+		pHash->uMigrateIndex++;
+	}
+
+	if (pHash->uMigrateIndex == pHash->uOldSize)
+	{
+		OSFreeMem (PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uOldSize, pHash->ppOldTable, IMG_NULL);
+		pHash->ppOldTable = IMG_NULL;
+		pHash->uOldSize = 0;
+		pHash->uMigrateIndex = 0;
+	}
+}
+
+static BUCKET **
+_FindBucket (HASH_TABLE *pHash, IMG_VOID *pKey, IMG_UINT32 uHash)
+{
+	BUCKET **ppBucket;
+
+	for (ppBucket = &(pHash->ppBucketTable[HASH_TO_INDEX(uHash, pHash->uSize)]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
+	{
+		if (_KeyMatch (pHash, *ppBucket, uHash, pKey))
+		{
+			return ppBucket;
+		}
+	}
+
+	if (pHash->ppOldTable != IMG_NULL)
+	{
+		IMG_UINT32 uIndex = HASH_TO_INDEX(uHash, pHash->uOldSize);
+
+		if (uIndex >= pHash->uMigrateIndex)
+		{
+			for (ppBucket = &(pHash->ppOldTable[uIndex]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
 			{
-				PVR_DPF((PVR_DBG_ERROR, "_Rehash: call to _ChainInsert failed"));
-				return eError;
+				if (_KeyMatch (pHash, *ppBucket, uHash, pKey))
+				{
+					return ppBucket;
+				}
 			}
-			pBucket = pNextBucket;
 		}
-    }
-	return PVRSRV_OK;
+	}
+
+	return IMG_NULL;
 }
 
 static IMG_BOOL
@@ -196,6 +309,9 @@ _Resize (HASH_TABLE *pHash, IMG_UINT32 uNewSize)
                   "HASH_Resize: oldsize=0x%x  newsize=0x%x  count=0x%x",
 				pHash->uSize, uNewSize, pHash->uCount));
 
+		
+		_MigrateStep (pHash, pHash->uOldSize);
+
 		OSAllocMem(PVRSRV_PAGEABLE_SELECT,
                       sizeof (BUCKET *) * uNewSize,
                       (IMG_PVOID*)&ppNewTable, IMG_NULL,
@@ -206,13 +322,11 @@ _Resize (HASH_TABLE *pHash, IMG_UINT32 uNewSize)
         for (uIndex=0; uIndex<uNewSize; uIndex++)
             ppNewTable[uIndex] = IMG_NULL;
 
-        if (_Rehash (pHash, pHash->ppBucketTable, pHash->uSize, ppNewTable, uNewSize) != PVRSRV_OK)
-		{
-			return IMG_FALSE;
-		}
+		
+		pHash->ppOldTable = pHash->ppBucketTable;
+		pHash->uOldSize = pHash->uSize;
+		pHash->uMigrateIndex = 0;
 
-        OSFreeMem (PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uSize, pHash->ppBucketTable, IMG_NULL);
-        
         pHash->ppBucketTable = ppNewTable;
         pHash->uSize = uNewSize;
     }
@@ -230,6 +344,11 @@ HASH_TABLE * HASH_Create_Extended (IMG_UINT32 uInitialLen, IMG_SIZE_T uKeySize,
 	uInitialLen = 1024;	
 #endif
 
+	
+	for (uIndex = 1; uIndex < uInitialLen; uIndex <<= 1)
+		;
+	uInitialLen = uIndex;
+
 	if(OSAllocMem(PVRSRV_PAGEABLE_SELECT,
 					sizeof(HASH_TABLE),
 					(IMG_VOID **)&pHash, IMG_NULL,
@@ -244,6 +363,14 @@ HASH_TABLE * HASH_Create_Extended (IMG_UINT32 uInitialLen, IMG_SIZE_T uKeySize,
 	pHash->uKeySize = uKeySize;
 	pHash->pfnHashFunc = pfnHashFunc;
 	pHash->pfnKeyComp = pfnKeyComp;
+	pHash->bSingleWordKey = (IMG_BOOL)(uKeySize == sizeof(IMG_UINTPTR_T) &&
+									   pfnHashFunc == &HASH_Func_Default &&
+									   pfnKeyComp == &HASH_Key_Comp_Default);
+	pHash->ppOldTable = IMG_NULL;
+	pHash->uOldSize = 0;
+	pHash->uMigrateIndex = 0;
+	pHash->pFreeBuckets = IMG_NULL;
+	pHash->uFreeBucketCount = 0;
 
 	OSAllocMem(PVRSRV_PAGEABLE_SELECT,
                   sizeof (BUCKET *) * pHash->uSize,
@@ -281,6 +408,17 @@ HASH_Delete (HASH_TABLE *pHash)
 			PVR_DPF ((PVR_DBG_ERROR, "HASH_Delete: leak detected in hash table!"));
 			PVR_DPF ((PVR_DBG_ERROR, "Likely Cause: client drivers not freeing alocations before destroying devmemcontext"));
 		}
+		while (pHash->pFreeBuckets != IMG_NULL)
+		{
+			BUCKET *pBucket = pHash->pFreeBuckets;
+			pHash->pFreeBuckets = pBucket->pNext;
+			OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET) + pHash->uKeySize, pBucket, IMG_NULL);
+		}
+		if (pHash->ppOldTable != IMG_NULL)
+		{
+			OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uOldSize, pHash->ppOldTable, IMG_NULL);
+			pHash->ppOldTable = IMG_NULL;
+		}
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uSize, pHash->ppBucketTable, IMG_NULL);
 		pHash->ppBucketTable = IMG_NULL;
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(HASH_TABLE), pHash, IMG_NULL);
@@ -305,10 +443,10 @@ HASH_Insert_Extended (HASH_TABLE *pHash, IMG_VOID *pKey, IMG_UINTPTR_T v)
 		return IMG_FALSE;
 	}
 
-	if(OSAllocMem(PVRSRV_PAGEABLE_SELECT,
-					sizeof(BUCKET) + pHash->uKeySize,
-					(IMG_VOID **)&pBucket, IMG_NULL,
-					"Hash Table entry") != PVRSRV_OK)
+	_MigrateStep (pHash, HASH_MIGRATE_STEP);
+
+	pBucket = _BucketAlloc (pHash);
+	if (pBucket == IMG_NULL)
 	{
 		return IMG_FALSE;
 	}
@@ -316,10 +454,8 @@ HASH_Insert_Extended (HASH_TABLE *pHash, IMG_VOID *pKey, IMG_UINTPTR_T v)
 	pBucket->v = v;
 	 
 	OSMemCopy(pBucket->k, pKey, pHash->uKeySize);
-	if (_ChainInsert (pHash, pBucket, pHash->ppBucketTable, pHash->uSize) != PVRSRV_OK)
-	{
-		return IMG_FALSE;
-	}
+	pBucket->uHash = _KeyHash (pHash, pKey);
+	_ChainInsert (pBucket, pHash->ppBucketTable, pHash->uSize);
 
 	pHash->uCount++;
 
@@ -349,7 +485,6 @@ IMG_UINTPTR_T
 HASH_Remove_Extended(HASH_TABLE *pHash, IMG_VOID *pKey)
 {
 	BUCKET **ppBucket;
-	IMG_UINT32 uIndex;
 
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x",
 			(IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey));
@@ -362,38 +497,34 @@ HASH_Remove_Extended(HASH_TABLE *pHash, IMG_VOID *pKey)
 		return 0;
 	}
 
-	uIndex = KEY_TO_INDEX(pHash, pKey, pHash->uSize);
+	_MigrateStep (pHash, HASH_MIGRATE_STEP);
 
-	for (ppBucket = &(pHash->ppBucketTable[uIndex]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
+	ppBucket = _FindBucket (pHash, pKey, _KeyHash (pHash, pKey));
+	if (ppBucket != IMG_NULL)
 	{
-		 
-		if (KEY_COMPARE(pHash, (*ppBucket)->k, pKey))
-		{
-			BUCKET *pBucket = *ppBucket;
-			IMG_UINTPTR_T v = pBucket->v;
-			(*ppBucket) = pBucket->pNext;
+		BUCKET *pBucket = *ppBucket;
+		IMG_UINTPTR_T v = pBucket->v;
+		(*ppBucket) = pBucket->pNext;
 
-			OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET) + pHash->uKeySize, pBucket, IMG_NULL);
-			
+		_BucketFree (pHash, pBucket);
 
-			pHash->uCount--;
+		pHash->uCount--;
 
-			
-			if (pHash->uSize > (pHash->uCount << 2) &&
-                pHash->uSize > pHash->uMinimumSize)
-            {
-                
+		
+		if (pHash->uSize > (pHash->uCount << 2) &&
+            pHash->uSize > pHash->uMinimumSize)
+        {
+            
 
-				_Resize (pHash,
-                         PRIVATE_MAX (pHash->uSize >> 1,
-                                      pHash->uMinimumSize));
-            }
+			_Resize (pHash,
+                     PRIVATE_MAX (pHash->uSize >> 1,
+                                  pHash->uMinimumSize));
+        }
 
-			PVR_DPF ((PVR_DBG_MESSAGE,
-                      "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x%x",
-                      (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
-			return v;
-		}
+		PVR_DPF ((PVR_DBG_MESSAGE,
+                  "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x%x",
+                  (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
+		return v;
 	}
 	PVR_DPF ((PVR_DBG_MESSAGE,
               "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x0 !!!!",
@@ -414,7 +545,6 @@ IMG_UINTPTR_T
 HASH_Retrieve_Extended (HASH_TABLE *pHash, IMG_VOID *pKey)
 {
 	BUCKET **ppBucket;
-	IMG_UINT32 uIndex;
 
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Retrieve_Extended: Hash=0x%x, pKey=0x%x",
 			(IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey));
@@ -427,21 +557,15 @@ HASH_Retrieve_Extended (HASH_TABLE *pHash, IMG_VOID *pKey)
 		return 0;
 	}
 
-	uIndex = KEY_TO_INDEX(pHash, pKey, pHash->uSize);
-
-	for (ppBucket = &(pHash->ppBucketTable[uIndex]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
+	ppBucket = _FindBucket (pHash, pKey, _KeyHash (pHash, pKey));
+	if (ppBucket != IMG_NULL)
 	{
-		 
-		if (KEY_COMPARE(pHash, (*ppBucket)->k, pKey))
-		{
-			BUCKET *pBucket = *ppBucket;
-			IMG_UINTPTR_T v = pBucket->v;
+		IMG_UINTPTR_T v = (*ppBucket)->v;
 
-			PVR_DPF ((PVR_DBG_MESSAGE,
-                      "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x%x",
-                      (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
-			return v;
-		}
+		PVR_DPF ((PVR_DBG_MESSAGE,
+                  "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x%x",
+                  (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
+		return v;
 	}
 	PVR_DPF ((PVR_DBG_MESSAGE,
               "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x0 !!!!",
@@ -454,6 +578,22 @@ HASH_Retrieve (HASH_TABLE *pHash, IMG_UINTPTR_T k)
 {
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Retrieve: Hash=0x%x, k=0x%x",
 			(IMG_UINTPTR_T)pHash, k));
+
+	if (pHash != IMG_NULL && pHash->bSingleWordKey && pHash->ppOldTable == IMG_NULL)
+	{
+		IMG_UINT32 uHash = _HashWord(k);
+		BUCKET *pBucket;
+
+		for (pBucket = pHash->ppBucketTable[HASH_TO_INDEX(uHash, pHash->uSize)]; pBucket != IMG_NULL; pBucket = pBucket->pNext)
+		{
+			if (pBucket->k[0] == k)
+			{
+				return pBucket->v;
+			}
+		}
+		return 0;
+	}
+
 	return HASH_Retrieve_Extended(pHash, &k);
 }
 
@@ -486,5 +626,10 @@ HASH_Dump (HASH_TABLE *pHash)
 	PVR_TRACE(("hash table: uMinimumSize=%d  size=%d  count=%d",
 			pHash->uMinimumSize, pHash->uSize, pHash->uCount));
 	PVR_TRACE(("  empty=%d  max=%d", uEmptyCount, uMaxLength));
+	if (pHash->ppOldTable != IMG_NULL)
+	{
+		PVR_TRACE(("  resizing from %d, %d chains migrated",
+				pHash->uOldSize, pHash->uMigrateIndex));
+	}
 }
 #endif
@@ -32,6 +32,7 @@
 
 #ifdef __linux__
 #include <linux/kernel.h>
+#include <linux/rbtree.h>
 #include "proc.h"
 #endif
 
@@ -41,6 +42,9 @@
 
 #define MINIMUM_HASH_SIZE (64)
 
+#define RA_SIZE_CLASS_COUNT	32
+#define RA_BT_CACHE_LIMIT	128
+
 #if defined(VALIDATE_ARENA_TEST)
 
 typedef enum RESOURCE_DESCRIPTOR_TAG {
@@ -86,6 +90,9 @@ struct _BT_
 	
 	struct _BT_ *pNextFree;
 	struct _BT_ *pPrevFree;
+
+	
+	struct rb_node sFreeNode;
 	
 	BM_MAPPING *psMapping;
 
@@ -125,10 +132,15 @@ struct _RA_ARENA_
 	IMG_VOID *pImportHandle;
 
 	
-#define FREE_TABLE_LIMIT 32
+	BT *aHeadFree [RA_SIZE_CLASS_COUNT];
+	IMG_UINT32 ui32FreeClassMask;
+
+	
+	struct rb_root sFreeTree;
 
 	
-	BT *aHeadFree [FREE_TABLE_LIMIT];
+	BT *pBTCache;
+	IMG_UINT32 ui32BTCacheCount;
 
 	
 	BT *pHeadSegment;
@@ -203,17 +215,60 @@ _RequestAllocFail (IMG_VOID *_h,
 	return IMG_FALSE;
 }
 
-static IMG_UINT32
-pvr_log2 (IMG_SIZE_T n)
+static BT *
+_BTAlloc (RA_ARENA *pArena)
+{
+	BT *pBT = pArena->pBTCache;
+
+	if (pBT != IMG_NULL)
+	{
+		pArena->pBTCache = pBT->pNextFree;
+		pArena->ui32BTCacheCount--;
+	}
+	else if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+					sizeof(BT),
+					(IMG_VOID **)&pBT, IMG_NULL,
+					"Boundary Tag") != PVRSRV_OK)
+	{
+		return IMG_NULL;
+	}
+
+	OSMemSet(pBT, 0, sizeof(BT));
+
+#if defined(VALIDATE_ARENA_TEST)
+	pBT->ui32BoundaryTagID = ++ui32BoundaryTagID;
+#endif
+
+	return pBT;
+}
+
+static IMG_VOID
+_BTRelease (RA_ARENA *pArena, BT *pBT)
 {
-	IMG_UINT32 l = 0;
-	n>>=1;
-	while (n>0)
+	if (pArena->ui32BTCacheCount < RA_BT_CACHE_LIMIT)
 	{
-		n>>=1;
-		l++;
+		pBT->pNextFree = pArena->pBTCache;
+		pArena->pBTCache = pBT;
+		pArena->ui32BTCacheCount++;
+		return;
 	}
-	return l;
+
+	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pBT, IMG_NULL);
+}
+
+static IMG_UINT32
+_SizeClass (RA_ARENA *pArena, IMG_SIZE_T uSize)
+{
+	IMG_SIZE_T uQuanta;
+
+	if (uSize == 0 || (uSize % pArena->uQuantum) != 0)
+		return RA_SIZE_CLASS_COUNT;
+
+	uQuanta = uSize / pArena->uQuantum;
+	if (uQuanta > RA_SIZE_CLASS_COUNT)
+		return RA_SIZE_CLASS_COUNT;
+
+	return (IMG_UINT32)(uQuanta - 1);
 }
 
 static PVRSRV_ERROR
@@ -314,20 +369,12 @@ _SegmentSplit (RA_ARENA *pArena, BT *pBT, IMG_SIZE_T uSize)
 		return IMG_NULL;
 	}
 
-	if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					sizeof(BT),
-					(IMG_VOID **)&pNeighbour, IMG_NULL,
-					"Boundary Tag") != PVRSRV_OK)
+	pNeighbour = _BTAlloc (pArena);
+	if (pNeighbour == IMG_NULL)
 	{
 		return IMG_NULL;
 	}
 
-	OSMemSet(pNeighbour, 0, sizeof(BT));
-
-#if defined(VALIDATE_ARENA_TEST)
-	pNeighbour->ui32BoundaryTagID = ++ui32BoundaryTagID;
-#endif
-
 	pNeighbour->pPrevSegment = pBT;
 	pNeighbour->pNextSegment = pBT->pNextSegment;
 	if (pBT->pNextSegment == IMG_NULL)
@@ -363,51 +410,131 @@ _SegmentSplit (RA_ARENA *pArena, BT *pBT, IMG_SIZE_T uSize)
 	return pNeighbour;
 }
 
+static IMG_VOID
+_FreeTreeInsert (RA_ARENA *pArena, BT *pBT)
+{
+	struct rb_node **ppsLink = &pArena->sFreeTree.rb_node;
+	struct rb_node *psParent = IMG_NULL;
+
+	while (*ppsLink != IMG_NULL)
+	{
+		BT *pBTScan = rb_entry(*ppsLink, BT, sFreeNode);
+
+		psParent = *ppsLink;
+		if (pBT->uSize < pBTScan->uSize
+			|| (pBT->uSize == pBTScan->uSize && pBT->base < pBTScan->base))
+			ppsLink = &(*ppsLink)->rb_left;
+		else
+			ppsLink = &(*ppsLink)->rb_right;
+	}
+
+	rb_link_node(&pBT->sFreeNode, psParent, ppsLink);
+	rb_insert_color(&pBT->sFreeNode, &pArena->sFreeTree);
+}
+
+static struct rb_node *
+_FreeTreeFirstFit (RA_ARENA *pArena, IMG_SIZE_T uSize)
+{
+	struct rb_node *psNode = pArena->sFreeTree.rb_node;
+	struct rb_node *psBest = IMG_NULL;
+
+	while (psNode != IMG_NULL)
+	{
+		BT *pBT = rb_entry(psNode, BT, sFreeNode);
+
+		if (pBT->uSize >= uSize)
+		{
+			psBest = psNode;
+			psNode = psNode->rb_left;
+		}
+		else
+		{
+			psNode = psNode->rb_right;
+		}
+	}
+
+	return psBest;
+}
+
 static IMG_VOID
 _FreeListInsert (RA_ARENA *pArena, BT *pBT)
 {
 	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	uIndex = _SizeClass (pArena, pBT->uSize);
 	pBT->type = btt_free;
+	if (uIndex == RA_SIZE_CLASS_COUNT)
+	{
+		_FreeTreeInsert (pArena, pBT);
+		return;
+	}
 	pBT->pNextFree = pArena->aHeadFree [uIndex];
 	pBT->pPrevFree = IMG_NULL;
 	if (pArena->aHeadFree[uIndex] != IMG_NULL)
 		pArena->aHeadFree[uIndex]->pPrevFree = pBT;
 	pArena->aHeadFree [uIndex] = pBT;
+	pArena->ui32FreeClassMask |= (1U << uIndex);
 }
 
 static IMG_VOID
 _FreeListRemove (RA_ARENA *pArena, BT *pBT)
 {
 	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	uIndex = _SizeClass (pArena, pBT->uSize);
+	if (uIndex == RA_SIZE_CLASS_COUNT)
+	{
+		rb_erase(&pBT->sFreeNode, &pArena->sFreeTree);
+		return;
+	}
 	if (pBT->pNextFree != IMG_NULL)
 		pBT->pNextFree->pPrevFree = pBT->pPrevFree;
 	if (pBT->pPrevFree == IMG_NULL)
 		pArena->aHeadFree[uIndex] = pBT->pNextFree;
 	else
 		pBT->pPrevFree->pNextFree = pBT->pNextFree;
+	if (pArena->aHeadFree[uIndex] == IMG_NULL)
+		pArena->ui32FreeClassMask &= ~(1U << uIndex);
+}
+
+#if defined(RA_STATS)
+static IMG_SIZE_T
+_LargestFreeSegment (RA_ARENA *pArena)
+{
+	struct rb_node *psNode = rb_last(&pArena->sFreeTree);
+	IMG_SIZE_T uLargest = 0;
+
+	if (pArena->ui32FreeClassMask != 0)
+		uLargest = (IMG_SIZE_T)fls(pArena->ui32FreeClassMask) * pArena->uQuantum;
+
+	if (psNode != IMG_NULL && rb_entry(psNode, BT, sFreeNode)->uSize > uLargest)
+		uLargest = rb_entry(psNode, BT, sFreeNode)->uSize;
+
+	return uLargest;
 }
 
+static IMG_UINT32
+_FragmentationPercent (RA_ARENA *pArena)
+{
+	IMG_SIZE_T uFreeQuanta = pArena->sStatistics.uFreeResourceCount / pArena->uQuantum;
+	IMG_SIZE_T uLargestQuanta = _LargestFreeSegment (pArena) / pArena->uQuantum;
+
+	if (uFreeQuanta == 0)
+		return 0;
+
+	return 100 - (IMG_UINT32)((uLargestQuanta * 100) / uFreeQuanta);
+}
+#endif
+
 static BT *
-_BuildSpanMarker (IMG_UINTPTR_T base, IMG_SIZE_T uSize)
+_BuildSpanMarker (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 {
 	BT *pBT;
 
-	if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					sizeof(BT),
-					(IMG_VOID **)&pBT, IMG_NULL,
-					"Boundary Tag") != PVRSRV_OK)
+	pBT = _BTAlloc (pArena);
+	if (pBT == IMG_NULL)
 	{
 		return IMG_NULL;
 	}
 
-	OSMemSet(pBT, 0, sizeof(BT));
-
-#if defined(VALIDATE_ARENA_TEST)
-	pBT->ui32BoundaryTagID = ++ui32BoundaryTagID;
-#endif
-
 	pBT->type = btt_span;
 	pBT->base = base;
 	pBT->uSize = uSize;
@@ -417,24 +544,16 @@ _BuildSpanMarker (IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 }
 
 static BT *
-_BuildBT (IMG_UINTPTR_T base, IMG_SIZE_T uSize)
+_BuildBT (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 {
 	BT *pBT;
 
-	if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					sizeof(BT),
-					(IMG_VOID **)&pBT, IMG_NULL,
-					"Boundary Tag") != PVRSRV_OK)
+	pBT = _BTAlloc (pArena);
+	if (pBT == IMG_NULL)
 	{
 		return IMG_NULL;
 	}
 
-	OSMemSet(pBT, 0, sizeof(BT));
-
-#if defined(VALIDATE_ARENA_TEST)
-	pBT->ui32BoundaryTagID = ++ui32BoundaryTagID;
-#endif
-
 	pBT->type = btt_free;
 	pBT->base = base;
 	pBT->uSize = uSize;
@@ -453,7 +572,7 @@ _InsertResource (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 		return IMG_NULL;
 	}
 
-	pBT = _BuildBT (base, uSize);
+	pBT = _BuildBT (pArena, base, uSize);
 	if (pBT != IMG_NULL)
 	{
 
@@ -496,7 +615,7 @@ _InsertResourceSpan (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 			  "RA_InsertResourceSpan: arena='%s', base=0x%x, size=0x%x",
 			  pArena->name, base, uSize));
 
-	pSpanStart = _BuildSpanMarker (base, uSize);
+	pSpanStart = _BuildSpanMarker (pArena, base, uSize);
 	if (pSpanStart == IMG_NULL)
 	{
 		goto fail_start;
@@ -507,7 +626,7 @@ _InsertResourceSpan (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 	pSpanStart->eResourceType = IMPORTED_RESOURCE_TYPE;
 #endif
 
-	pSpanEnd = _BuildSpanMarker (base + uSize, 0);
+	pSpanEnd = _BuildSpanMarker (pArena, base + uSize, 0);
 	if (pSpanEnd == IMG_NULL)
 	{
 		goto fail_end;
@@ -518,7 +637,7 @@ _InsertResourceSpan (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 	pSpanEnd->eResourceType = IMPORTED_RESOURCE_TYPE;
 #endif
 
-	pBT = _BuildBT (base, uSize);
+	pBT = _BuildBT (pArena, base, uSize);
 	if (pBT == IMG_NULL)
 	{
 		goto fail_bt;
@@ -555,13 +674,13 @@ _InsertResourceSpan (RA_ARENA *pArena, IMG_UINTPTR_T base, IMG_SIZE_T uSize)
 	return pBT;
 
   fail_SegListInsert:
-	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pBT, IMG_NULL);
+	_BTRelease (pArena, pBT);
 	
   fail_bt:
-	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pSpanEnd, IMG_NULL);
+	_BTRelease (pArena, pSpanEnd);
 	
   fail_end:
-	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pSpanStart, IMG_NULL);
+	_BTRelease (pArena, pSpanStart);
 	
   fail_start:
 	return IMG_NULL;
@@ -602,7 +721,7 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 		_SegmentListRemove (pArena, pNeighbour);
 		pBT->base = pNeighbour->base;
 		pBT->uSize += pNeighbour->uSize;
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pNeighbour, IMG_NULL);
+		_BTRelease (pArena, pNeighbour);
 		
 #ifdef RA_STATS
 		pArena->sStatistics.uFreeSegmentCount--;
@@ -618,7 +737,7 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 		_FreeListRemove (pArena, pNeighbour);
 		_SegmentListRemove (pArena, pNeighbour);
 		pBT->uSize += pNeighbour->uSize;
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pNeighbour, IMG_NULL);
+		_BTRelease (pArena, pNeighbour);
 		
 #ifdef RA_STATS
 		pArena->sStatistics.uFreeSegmentCount--;
@@ -668,11 +787,11 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 		pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
 		pArena->sStatistics.uTotalResourceCount-=pBT->uSize;
 #endif
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), next, IMG_NULL);
+		_BTRelease (pArena, next);
 		
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), prev, IMG_NULL);
+		_BTRelease (pArena, prev);
 		
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pBT, IMG_NULL);
+		_BTRelease (pArena, pBT);
 		
 	}
 	else
@@ -681,158 +800,190 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 
 
 static IMG_BOOL
-_AttemptAllocAligned (RA_ARENA *pArena,
-					  IMG_SIZE_T uSize,
-					  BM_MAPPING **ppsMapping,
-					  IMG_UINT32 uFlags,
-					  IMG_UINT32 uAlignment,
-					  IMG_UINT32 uAlignmentOffset,
-					  IMG_UINTPTR_T *base)
+_BTFits (BT *pBT,
+		 IMG_SIZE_T uSize,
+		 IMG_UINT32 uFlags,
+		 IMG_UINT32 uAlignment,
+		 IMG_UINT32 uAlignmentOffset,
+		 IMG_UINTPTR_T *pAlignedBase)
 {
-	IMG_UINT32 uIndex;
-	PVR_ASSERT (pArena!=IMG_NULL);
-	if (pArena == IMG_NULL)
+	IMG_UINTPTR_T aligned_base;
+
+	if (uAlignment>1)
+		aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
+	else
+		aligned_base = pBT->base;
+	PVR_DPF ((PVR_DBG_MESSAGE,
+			  "RA_AttemptAllocAligned: pBT-base=0x%x "
+			  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
+			pBT->base, pBT->uSize, aligned_base, uSize));
+
+	if (pBT->base + pBT->uSize < aligned_base + uSize)
 	{
-		PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: invalid parameter - pArena"));
 		return IMG_FALSE;
 	}
 
-	if (uAlignment>1)
-		uAlignmentOffset %= uAlignment;
+	if (pBT->psMapping && pBT->psMapping->ui32Flags != uFlags)
+	{
+		PVR_DPF ((PVR_DBG_MESSAGE,
+				"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+		return IMG_FALSE;
+	}
 
-	
+	*pAlignedBase = aligned_base;
+	return IMG_TRUE;
+}
 
-	uIndex = pvr_log2 (uSize);
+static IMG_BOOL
+_AllocFromBT (RA_ARENA *pArena,
+			  BT *pBT,
+			  IMG_SIZE_T uSize,
+			  IMG_UINTPTR_T aligned_base,
+			  BM_MAPPING **ppsMapping,
+			  IMG_UINTPTR_T *base)
+{
+	_FreeListRemove (pArena, pBT);
 
-#if 0
-	
-	if (1u<<uIndex < uSize)
-		uIndex++;
-#endif
+	PVR_ASSERT (pBT->type == btt_free);
 
-	while (uIndex < FREE_TABLE_LIMIT && pArena->aHeadFree[uIndex]==IMG_NULL)
-		uIndex++;
+#ifdef RA_STATS
+	pArena->sStatistics.uLiveSegmentCount++;
+	pArena->sStatistics.uFreeSegmentCount--;
+	pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
+#endif
 
-	while (uIndex < FREE_TABLE_LIMIT)
+	
+	if (aligned_base > pBT->base)
 	{
-		if (pArena->aHeadFree[uIndex]!=IMG_NULL)
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
+		
+		if (pNeighbour==IMG_NULL)
 		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
 			
-			BT *pBT;
-
-			pBT = pArena->aHeadFree [uIndex];
-			while (pBT!=IMG_NULL)
-			{
-				IMG_UINTPTR_T aligned_base;
-
-				if (uAlignment>1)
-					aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
-				else
-					aligned_base = pBT->base;
-				PVR_DPF ((PVR_DBG_MESSAGE,
-						  "RA_AttemptAllocAligned: pBT-base=0x%x "
-						  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
-						pBT->base, pBT->uSize, aligned_base, uSize));
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
 
-				if (pBT->base + pBT->uSize >= aligned_base + uSize)
-				{
-					if(!pBT->psMapping || pBT->psMapping->ui32Flags == uFlags)
-					{
-						_FreeListRemove (pArena, pBT);
+		_FreeListInsert (pArena, pBT);
+#ifdef RA_STATS
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
+#endif
+		pBT = pNeighbour;
+	}
 
-						PVR_ASSERT (pBT->type == btt_free);
+	
+	if (pBT->uSize > uSize)
+	{
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, uSize);
+		
+		if (pNeighbour==IMG_NULL)
+		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
+			
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
 
+		_FreeListInsert (pArena, pNeighbour);
 #ifdef RA_STATS
-						pArena->sStatistics.uLiveSegmentCount++;
-						pArena->sStatistics.uFreeSegmentCount--;
-						pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
 #endif
+	}
 
-						
-						if (aligned_base > pBT->base)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
-							
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
-								
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pBT);
-	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
-	#endif
-							pBT = pNeighbour;
-						}
-
-						
-						if (pBT->uSize > uSize)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, uSize);
-							
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
-								
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pNeighbour);
-	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
-	#endif
-						}
-
-						pBT->type = btt_live;
+	pBT->type = btt_live;
 
 #if defined(VALIDATE_ARENA_TEST)
-						if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
-						}
-						else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
-						}
-						else
-						{
-							PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
-							PVR_DBG_BREAK;
-						}
+	if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
+	}
+	else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
+	}
+	else
+	{
+		PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
+		PVR_DBG_BREAK;
+	}
 #endif
-						if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
-						{
-							_FreeBT (pArena, pBT, IMG_FALSE);
-							return IMG_FALSE;
-						}
+	if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
+	{
+		_FreeBT (pArena, pBT, IMG_FALSE);
+		return IMG_FALSE;
+	}
 
-						if (ppsMapping!=IMG_NULL)
-							*ppsMapping = pBT->psMapping;
+	if (ppsMapping!=IMG_NULL)
+		*ppsMapping = pBT->psMapping;
 
-						*base = pBT->base;
+	*base = pBT->base;
 
-						return IMG_TRUE;
-					}
-					else
-					{
-						PVR_DPF ((PVR_DBG_MESSAGE,
-								"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+	return IMG_TRUE;
+}
 
-					}
+static IMG_BOOL
+_AttemptAllocAligned (RA_ARENA *pArena,
+					  IMG_SIZE_T uSize,
+					  BM_MAPPING **ppsMapping,
+					  IMG_UINT32 uFlags,
+					  IMG_UINT32 uAlignment,
+					  IMG_UINT32 uAlignmentOffset,
+					  IMG_UINTPTR_T *base)
+{
+	IMG_UINTPTR_T aligned_base;
+	IMG_SIZE_T uQuanta;
+	struct rb_node *psNode;
+	BT *pBT;
+
+	PVR_ASSERT (pArena!=IMG_NULL);
+	if (pArena == IMG_NULL)
+	{
+		PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: invalid parameter - pArena"));
+		return IMG_FALSE;
+	}
+
+	if (uAlignment>1)
+		uAlignmentOffset %= uAlignment;
+
+	
+	uQuanta = (uSize + pArena->uQuantum - 1) / pArena->uQuantum;
+	if (uQuanta <= RA_SIZE_CLASS_COUNT)
+	{
+		IMG_UINT32 ui32Mask = pArena->ui32FreeClassMask;
+
+		if (uQuanta > 1)
+			ui32Mask &= ~((1U << (uQuanta - 1)) - 1);
+
+		while (ui32Mask != 0)
+		{
+			IMG_UINT32 uIndex = __ffs(ui32Mask);
+
+			for (pBT = pArena->aHeadFree[uIndex]; pBT != IMG_NULL; pBT = pBT->pNextFree)
+			{
+				if (_BTFits (pBT, uSize, uFlags, uAlignment, uAlignmentOffset, &aligned_base))
+				{
+					return _AllocFromBT (pArena, pBT, uSize, aligned_base, ppsMapping, base);
 				}
-				pBT = pBT->pNextFree;
 			}
 
+			ui32Mask &= ui32Mask - 1;
+		}
+	}
+
+	
+	for (psNode = _FreeTreeFirstFit (pArena, uSize); psNode != IMG_NULL; psNode = rb_next(psNode))
+	{
+		pBT = rb_entry(psNode, BT, sFreeNode);
+
+		if (_BTFits (pBT, uSize, uFlags, uAlignment, uAlignmentOffset, &aligned_base))
+		{
+			return _AllocFromBT (pArena, pBT, uSize, aligned_base, ppsMapping, base);
 		}
-		uIndex++;
 	}
 
 	return IMG_FALSE;
@@ -874,8 +1025,12 @@ RA_Create (IMG_CHAR *name,
 	pArena->pImportFree = imp_free;
 	pArena->pBackingStoreFree = backingstore_free;
 	pArena->pImportHandle = pImportHandle;
-	for (i=0; i<FREE_TABLE_LIMIT; i++)
+	for (i=0; i<RA_SIZE_CLASS_COUNT; i++)
 		pArena->aHeadFree[i] = IMG_NULL;
+	pArena->ui32FreeClassMask = 0;
+	pArena->sFreeTree = RB_ROOT;
+	pArena->pBTCache = IMG_NULL;
+	pArena->ui32BTCacheCount = 0;
 	pArena->pHeadSegment = IMG_NULL;
 	pArena->pTailSegment = IMG_NULL;
 	pArena->uQuantum = uQuantum;
@@ -980,8 +1135,10 @@ RA_Delete (RA_ARENA *pArena)
 	PVR_DPF ((PVR_DBG_MESSAGE,
 			  "RA_Delete: name='%s'", pArena->name));
 
-	for (uIndex=0; uIndex<FREE_TABLE_LIMIT; uIndex++)
+	for (uIndex=0; uIndex<RA_SIZE_CLASS_COUNT; uIndex++)
 		pArena->aHeadFree[uIndex] = IMG_NULL;
+	pArena->ui32FreeClassMask = 0;
+	pArena->sFreeTree = RB_ROOT;
 
 	while (pArena->pHeadSegment != IMG_NULL)
 	{
@@ -1001,6 +1158,15 @@ RA_Delete (RA_ARENA *pArena)
 		pArena->sStatistics.uSpanCount--;
 #endif
 	}
+
+	while (pArena->pBTCache != IMG_NULL)
+	{
+		BT *pBT = pArena->pBTCache;
+
+		pArena->pBTCache = pBT->pNextFree;
+		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(BT), pBT, IMG_NULL);
+	}
+	pArena->ui32BTCacheCount = 0;
 #if defined(CONFIG_PROC_FS) && defined(DEBUG)
 	{
 		IMG_VOID (*pfnRemoveProcEntrySeq)(struct proc_dir_entry*);
@@ -1557,6 +1723,14 @@ static void RA_ProcSeqShowInfo(struct seq_file *sfile, void* el)
 	case 10:
 		seq_printf(sfile, "export count\t\t%u\n", pArena->sStatistics.uExportCount);
 		break;
+	case 11:
+		seq_printf(sfile, "largest free segment\t%u (0x%x)\n",
+							_LargestFreeSegment(pArena),
+							(IMG_UINT)_LargestFreeSegment(pArena));
+		break;
+	case 12:
+		seq_printf(sfile, "fragmentation\t\t%u%%\n", _FragmentationPercent(pArena));
+		break;
 #endif
 	}
 
@@ -1565,7 +1739,7 @@ static void RA_ProcSeqShowInfo(struct seq_file *sfile, void* el)
 static void* RA_ProcSeqOff2ElementInfo(struct seq_file * sfile, loff_t off)
 {
 #ifdef RA_STATS
-	if(off <= 9)
+	if(off <= 11)
 #else
 	if(off <= 1)
 #endif
@@ -1667,6 +1841,14 @@ PVRSRV_ERROR RA_GetStats(RA_ARENA *pArena,
 	i32Count = OSSNPrintf(pszStr, 100, "export count\t\t%u\n", pArena->sStatistics.uExportCount);
 	UPDATE_SPACE(pszStr, i32Count, ui32StrLen);
 
+	CHECK_SPACE(ui32StrLen);
+	i32Count = OSSNPrintf(pszStr, 100, "largest free segment\t%u\n", _LargestFreeSegment(pArena));
+	UPDATE_SPACE(pszStr, i32Count, ui32StrLen);
+
+	CHECK_SPACE(ui32StrLen);
+	i32Count = OSSNPrintf(pszStr, 100, "fragmentation\t\t%u%%\n", _FragmentationPercent(pArena));
+	UPDATE_SPACE(pszStr, i32Count, ui32StrLen);
+
 	CHECK_SPACE(ui32StrLen);
 	i32Count = OSSNPrintf(pszStr, 100, "  segment Chain:\n");
 	UPDATE_SPACE(pszStr, i32Count, ui32StrLen);
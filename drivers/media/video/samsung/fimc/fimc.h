@@ -27,6 +27,7 @@
 #include <media/videobuf-core.h>
 #include <plat/media.h>
 #include <plat/fimc.h>
+#include <plat/shbuf.h>
 #endif
 
 #define FIMC_NAME		"s3c-fimc"
@@ -40,6 +41,7 @@
 #define FIMC_MAX_CTXS		2
 #define FIMC_TPID		3
 #define FIMC_CAPBUFS		16
+#define FIMC_CAPBUF_SLOTS	(FIMC_CAPBUFS * 4)
 #define FIMC_ONESHOT_TIMEOUT	200
 #define FIMC_DQUEUE_TIMEOUT	200
 #define FIMC_FIFOOFF_CNT	1000000 /* Sufficiently big value for stop */
@@ -150,6 +152,27 @@ struct fimc_meminfo {
 	dma_addr_t	curr;		/* current addr */
 };
 
+/* capture buffer pool: regions carved from reserved memory, kept
+ * across REQBUFS and open/close so the same layout can be handed out
+ * again without re-carving
+ */
+struct fimc_capbuf_slot {
+	dma_addr_t	base;
+	size_t		length;
+	size_t		garbage;
+	int		align;
+	int		in_use;
+};
+
+struct fimc_capbuf_pool {
+	struct fimc_capbuf_slot	slot[FIMC_CAPBUF_SLOTS];
+	int			nr_slots;
+	dma_addr_t		end;		/* top of carved region */
+	u32			alloc_cnt;
+	u32			reuse_cnt;
+	u32			shrink_cnt;
+};
+
 struct fimc_buf {
 	dma_addr_t	base[3];
 	size_t		length[3];
@@ -179,6 +202,7 @@ struct fimc_buf_set {
 	u32			flags;
 	atomic_t		mapped_cnt;
 	struct list_head	list;
+	struct s5p_shbuf	*shbuf;	/* imported, held while queued */
 };
 
 /* for capture device */
@@ -377,6 +401,7 @@ struct fimc_control {
 	struct clk			*clk;		/* interface clock */
 	struct regulator	*regulator;		/* pd regulator */
 	struct fimc_meminfo		mem;		/* for reserved mem */
+	struct fimc_capbuf_pool		capbuf_pool;	/* for capture bufs */
 
 	/* kernel helpers */
 	struct mutex			lock;		/* controller lock */
@@ -484,6 +509,11 @@ extern int fimc_dma_alloc(struct fimc_control *ctrl,
 					int i, int align);
 extern void fimc_dma_free(struct fimc_control *ctrl,
 					struct fimc_buf_set *bs, int i);
+extern int fimc_capbuf_get(struct fimc_control *ctrl,
+					struct fimc_buf_set *bs,
+					int i, int align);
+extern void fimc_capbuf_put_all(struct fimc_control *ctrl);
+extern size_t fimc_capbuf_shrink(struct fimc_control *ctrl);
 extern u32 fimc_mapping_rot_flip(u32 rot, u32 flip);
 extern int fimc_get_scaler_factor(u32 src, u32 tar, u32 *ratio, u32 *shift);
 extern void fimc_get_nv12t_size(int img_hres, int img_vres,
@@ -546,6 +576,7 @@ extern int fimc_outdev_stop_streaming(struct fimc_control *ctrl,
 					struct fimc_ctx *ctx);
 extern int fimc_outdev_resume_dma(struct fimc_control *ctrl,
 					struct fimc_ctx *ctx);
+extern void fimc_outdev_put_shbufs(struct fimc_ctx *ctx);
 extern int fimc_outdev_start_camif(void *param);
 extern int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b);
 extern int fimc_querybuf_output(void *fh, struct v4l2_buffer *b);
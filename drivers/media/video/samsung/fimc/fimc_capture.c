@@ -953,9 +953,7 @@ static int fimc_alloc_buffers(struct fimc_control *ctrl, int size[], int align)
 			if (!cap->bufs[i].length[plane])
 				continue;
 
-			fimc_dma_alloc(ctrl, &cap->bufs[i], plane, align);
-
-			if (!cap->bufs[i].base[plane])
+			if (fimc_capbuf_get(ctrl, &cap->bufs[i], plane, align))
 				goto err_alloc;
 		}
 
@@ -966,12 +964,10 @@ static int fimc_alloc_buffers(struct fimc_control *ctrl, int size[], int align)
 	return 0;
 
 err_alloc:
-	for (i = 0; i < cap->nr_bufs; i++) {
-		if (cap->bufs[i].base[plane])
-			fimc_dma_free(ctrl, &cap->bufs[i], plane);
+	fimc_capbuf_put_all(ctrl);
 
+	for (i = 0; i < cap->nr_bufs; i++)
 		memset(&cap->bufs[i], 0, sizeof(cap->bufs[i]));
-	}
 
 	return -ENOMEM;
 }
@@ -992,7 +988,7 @@ static void fimc_free_buffers(struct fimc_control *ctrl)
 		cap->bufs[i].state = VIDEOBUF_NEEDS_INIT;
 	}
 
-	ctrl->mem.curr = ctrl->mem.base;
+	fimc_capbuf_put_all(ctrl);
 }
 
 int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b)
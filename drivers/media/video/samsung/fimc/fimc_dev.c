@@ -38,6 +38,9 @@
 
 #include "fimc.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/fimc.h>
+
 #define CLEAR_FIMC2_BUFF
 
 struct fimc_global *fimc_dev;
@@ -104,6 +107,134 @@ void fimc_dma_free(struct fimc_control *ctrl, struct fimc_buf_set *bs, int i)
 	mutex_unlock(&ctrl->alloc_lock);
 }
 
+/* Give back idle slots from the top of the carved region. Slots below
+ * a busy one stay carved but remain available for reuse.
+ * Must be called with alloc_lock held.
+ */
+static size_t __fimc_capbuf_shrink(struct fimc_control *ctrl)
+{
+	struct fimc_capbuf_pool *pool = &ctrl->capbuf_pool;
+	struct fimc_capbuf_slot *slot;
+	dma_addr_t old_end = pool->end;
+
+	while (pool->nr_slots > 0) {
+		slot = &pool->slot[pool->nr_slots - 1];
+		if (slot->in_use || slot->base + slot->length != pool->end)
+			break;
+
+		pool->end = slot->base - slot->garbage;
+		memset(slot, 0, sizeof(*slot));
+		pool->nr_slots--;
+	}
+
+	if (old_end == pool->end)
+		return 0;
+
+	if (ctrl->mem.curr == old_end)
+		ctrl->mem.curr = pool->end;
+
+	pool->shrink_cnt++;
+	trace_fimc_capbuf_shrink(ctrl->id, pool->nr_slots, old_end - pool->end);
+
+	return old_end - pool->end;
+}
+
+int fimc_capbuf_get(struct fimc_control *ctrl, struct fimc_buf_set *bs,
+							int i, int align)
+{
+	struct fimc_capbuf_pool *pool = &ctrl->capbuf_pool;
+	struct fimc_capbuf_slot *slot;
+	dma_addr_t start, base, end;
+	int n, reused = 0;
+
+	if (!bs->length[i])
+		return -EINVAL;
+
+	mutex_lock(&ctrl->alloc_lock);
+
+	for (n = 0; n < pool->nr_slots; n++) {
+		slot = &pool->slot[n];
+		if (!slot->in_use && slot->length == bs->length[i] &&
+						slot->align == align) {
+			pool->reuse_cnt++;
+			reused = 1;
+			goto found;
+		}
+	}
+
+	end = ctrl->mem.base + ctrl->mem.size;
+	start = max(pool->end, ctrl->mem.curr);
+	base = align ? ALIGN(start, align) : start;
+
+	if (pool->nr_slots == FIMC_CAPBUF_SLOTS ||
+				base + bs->length[i] > end) {
+		/* reclaim idle slots of other sizes and retry once */
+		if (!__fimc_capbuf_shrink(ctrl))
+			goto overflow;
+
+		start = max(pool->end, ctrl->mem.curr);
+		base = align ? ALIGN(start, align) : start;
+		if (pool->nr_slots == FIMC_CAPBUF_SLOTS ||
+				base + bs->length[i] > end)
+			goto overflow;
+	}
+
+	slot = &pool->slot[pool->nr_slots++];
+	slot->base = base;
+	slot->length = bs->length[i];
+	slot->garbage = base - start;
+	slot->align = align;
+
+	pool->end = base + bs->length[i];
+	ctrl->mem.curr = pool->end;
+	pool->alloc_cnt++;
+
+found:
+	slot->in_use = 1;
+	bs->base[i] = slot->base;
+	bs->garbage[i] = slot->garbage;
+
+	trace_fimc_capbuf_get(ctrl->id, slot->base, slot->length, align,
+				reused, pool->alloc_cnt, pool->reuse_cnt);
+
+	mutex_unlock(&ctrl->alloc_lock);
+
+	return 0;
+
+overflow:
+	bs->base[i] = 0;
+	bs->length[i] = 0;
+	bs->garbage[i] = 0;
+
+	mutex_unlock(&ctrl->alloc_lock);
+
+	return -ENOMEM;
+}
+
+void fimc_capbuf_put_all(struct fimc_control *ctrl)
+{
+	struct fimc_capbuf_pool *pool = &ctrl->capbuf_pool;
+	int n;
+
+	mutex_lock(&ctrl->alloc_lock);
+
+	for (n = 0; n < pool->nr_slots; n++)
+		pool->slot[n].in_use = 0;
+
+	mutex_unlock(&ctrl->alloc_lock);
+}
+
+size_t fimc_capbuf_shrink(struct fimc_control *ctrl)
+{
+	size_t released;
+
+	mutex_lock(&ctrl->alloc_lock);
+	released = __fimc_capbuf_shrink(ctrl);
+	mutex_unlock(&ctrl->alloc_lock);
+
+	return released;
+}
+
 void fimc_clk_en(struct fimc_control *ctrl, bool on)
 {
 	struct platform_device *pdev;
@@ -457,6 +588,7 @@ struct fimc_control *fimc_register_controller(struct platform_device *pdev)
 	ctrl->mem.base = pdata->pmem_start;
 	ctrl->mem.size = pdata->pmem_size;
 	ctrl->mem.curr = ctrl->mem.base;
+	ctrl->capbuf_pool.end = ctrl->mem.base;
 
 	ctrl->status = FIMC_STREAMOFF;
 	switch (pdata->hw_ver) {
@@ -954,7 +1086,9 @@ static int fimc_open(struct file *filp)
 					ctrl->fb.lcd_vres);
 		}
 
-		ctrl->mem.curr = ctrl->mem.base;
+		if (!ctrl->capbuf_pool.nr_slots)
+			ctrl->capbuf_pool.end = ctrl->mem.base;
+		ctrl->mem.curr = ctrl->capbuf_pool.end;
 		ctrl->status = FIMC_STREAMOFF;
 
 		if (0 != ctrl->id)
@@ -1015,15 +1149,11 @@ static int fimc_release(struct file *filp)
 	}
 
 	if (ctrl->cap) {
-		ctrl->mem.curr = ctrl->mem.base;
 		kfree(filp->private_data);
 		filp->private_data = NULL;
 
-		for (i = 0; i < FIMC_CAPBUFS; i++) {
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 0);
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 1);
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 2);
-		}
+		/* keep the carved buffers for the next session */
+		fimc_capbuf_put_all(ctrl);
 
 		fimc_clk_en(ctrl, false);
 
@@ -1091,6 +1221,7 @@ static int fimc_release(struct file *filp)
 			}
 		}
 
+		fimc_outdev_put_shbufs(ctx);
 		memset(ctx, 0x00, sizeof(struct fimc_ctx));
 
 		ctx->ctx_num = ctx_id;
@@ -1108,7 +1239,7 @@ static int fimc_release(struct file *filp)
 
 			fimc_clk_en(ctrl, false);
 
-			ctrl->mem.curr = ctrl->mem.base;
+			ctrl->mem.curr = ctrl->capbuf_pool.end;
 
 			kfree(ctrl->out);
 			ctrl->out = NULL;
@@ -1323,6 +1454,40 @@ static DEVICE_ATTR(log_level, 0644, \
 			fimc_show_log_level,
 			fimc_store_log_level);
 
+static ssize_t fimc_show_capbuf_pool(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fimc_control *ctrl = get_fimc_ctrl(to_platform_device(dev)->id);
+	struct fimc_capbuf_pool *pool = &ctrl->capbuf_pool;
+	int n, busy = 0;
+
+	mutex_lock(&ctrl->alloc_lock);
+	for (n = 0; n < pool->nr_slots; n++)
+		busy += pool->slot[n].in_use;
+	n = sprintf(buf, "slots: %d (%d busy)\ncarved: %u bytes\n"
+			"allocs: %u\nreuses: %u\nshrinks: %u\n",
+			pool->nr_slots, busy,
+			(u32)(pool->end - ctrl->mem.base),
+			pool->alloc_cnt, pool->reuse_cnt, pool->shrink_cnt);
+	mutex_unlock(&ctrl->alloc_lock);
+
+	return n;
+}
+
+static ssize_t fimc_store_capbuf_pool(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct fimc_control *ctrl = get_fimc_ctrl(to_platform_device(dev)->id);
+
+	fimc_capbuf_shrink(ctrl);
+
+	return len;
+}
+
+static DEVICE_ATTR(capbuf_pool, 0644, \
+			fimc_show_capbuf_pool,
+			fimc_store_capbuf_pool);
+
 static int __devinit fimc_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fimc *pdata;
@@ -1407,6 +1572,13 @@ static int __devinit fimc_probe(struct platform_device *pdev)
 		fimc_err("failed to add sysfs entries\n");
 		goto err_global;
 	}
+
+	ret = device_create_file(&(pdev->dev), &dev_attr_capbuf_pool);
+	if (ret < 0) {
+		fimc_err("failed to add sysfs entries\n");
+		device_remove_file(&(pdev->dev), &dev_attr_log_level);
+		goto err_global;
+	}
 	printk(KERN_INFO "FIMC%d registered successfully\n", ctrl->id);
 
 	return 0;
@@ -1431,6 +1603,7 @@ static int fimc_remove(struct platform_device *pdev)
 	fimc_unregister_controller(pdev);
 
 	device_remove_file(&(pdev->dev), &dev_attr_log_level);
+	device_remove_file(&(pdev->dev), &dev_attr_capbuf_pool);
 
 	kfree(fimc_dev);
 	fimc_dev = NULL;
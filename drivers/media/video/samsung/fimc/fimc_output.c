@@ -171,10 +171,22 @@ int fimc_outdev_resume_dma(struct fimc_control *ctrl, struct fimc_ctx *ctx)
 	return 0;
 }
 
+void fimc_outdev_put_shbufs(struct fimc_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < FIMC_OUTBUFS; i++) {
+		s5p_shbuf_put(ctx->src[i].shbuf);
+		ctx->src[i].shbuf = NULL;
+	}
+}
+
 static void fimc_init_out_buf(struct fimc_ctx *ctx)
 {
 	int i;
 
+	fimc_outdev_put_shbufs(ctx);
+
 	for (i = 0; i < FIMC_OUTBUFS; i++) {
 		ctx->src[i].state = VIDEOBUF_IDLE;
 		ctx->src[i].flags = 0x0;
@@ -230,6 +242,10 @@ static int fimc_outdev_set_src_buf(struct fimc_control *ctrl,
 		return -EINVAL;
 	}
 
+	/* idle capture buffers give way to the output path */
+	if ((*curr + size * FIMC_OUTBUFS) > (ctrl->mem.base + ctrl->mem.size))
+		fimc_capbuf_shrink(ctrl);
+
 	if ((*curr + size * FIMC_OUTBUFS) > (ctrl->mem.base + ctrl->mem.size)) {
 		fimc_err("%s: Reserved memory is not sufficient\n", __func__);
 		return -EINVAL;
@@ -322,6 +338,9 @@ static int fimc_outdev_set_dst_buf(struct fimc_control *ctrl,
 	end = ctrl->mem.base + ctrl->mem.size;
 	size = PAGE_ALIGN(width * height * 4);
 
+	if ((*curr + (size * FIMC_OUTBUFS)) > end)
+		fimc_capbuf_shrink(ctrl);
+
 	if ((*curr + (size * FIMC_OUTBUFS)) > end) {
 		fimc_err("%s: Reserved memory is not sufficient\n",
 					__func__);
@@ -1254,7 +1273,7 @@ int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b)
 	ctx->is_requested = 0;
 
 	if (b->count == 0) {
-		ctrl->mem.curr = ctrl->mem.base;
+		ctrl->mem.curr = ctrl->capbuf_pool.end;
 
 		switch (ctx->overlay.mode) {
 		case FIMC_OVLY_DMA_AUTO:	/* fall through */
@@ -1292,7 +1311,8 @@ int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b)
 			ctx->overlay.req_idx = FIMC_MMAP_IDX;
 			if (ret)
 				return ret;
-		} else if (b->memory == V4L2_MEMORY_USERPTR) {
+		} else if (b->memory == V4L2_MEMORY_USERPTR ||
+				b->memory == V4L2_MEMORY_S5P_SHBUF) {
 			if (mode == FIMC_OVLY_DMA_AUTO ||
 					mode == FIMC_OVLY_NOT_FIXED)
 				ctx->overlay.req_idx = FIMC_USERPTR_IDX;
@@ -2067,6 +2087,34 @@ static int fimc_update_in_queue_addr(struct fimc_control *ctrl,
 	return 0;
 }
 
+/* Point the source buffer at the planes of an imported shared buffer. */
+static int fimc_import_shbuf(struct fimc_control *ctrl,
+			     struct fimc_ctx *ctx, u32 idx, int fd)
+{
+	struct s5p_shbuf *shbuf;
+	dma_addr_t addr[3] = { 0, };
+	int i;
+
+	shbuf = s5p_shbuf_get(fd);
+	if (IS_ERR(shbuf)) {
+		fimc_err("%s: invalid shared buffer fd(%d)\n", __func__, fd);
+		return PTR_ERR(shbuf);
+	}
+
+	for (i = 0; i < shbuf->nr_planes; i++)
+		addr[i] = shbuf->base[i];
+
+	if (fimc_update_in_queue_addr(ctrl, ctx, idx, addr) < 0) {
+		s5p_shbuf_put(shbuf);
+		return -EINVAL;
+	}
+
+	s5p_shbuf_put(ctx->src[idx].shbuf);
+	ctx->src[idx].shbuf = shbuf;
+
+	return 0;
+}
+
 int fimc_qbuf_output(void *fh, struct v4l2_buffer *b)
 {
 	struct fimc_buf *buf = (struct fimc_buf *)b->m.userptr;
@@ -2098,6 +2146,10 @@ int fimc_qbuf_output(void *fh, struct v4l2_buffer *b)
 		ret = fimc_update_in_queue_addr(ctrl, ctx, b->index, buf->base);
 		if (ret < 0)
 			return ret;
+	} else if (b->memory == V4L2_MEMORY_S5P_SHBUF) {
+		ret = fimc_import_shbuf(ctrl, ctx, b->index, b->m.offset);
+		if (ret < 0)
+			return ret;
 	}
 
 	/* Attach the buffer to the incoming queue. */
@@ -2202,6 +2254,10 @@ int fimc_dqbuf_output(void *fh, struct v4l2_buffer *b)
 
 	b->index = idx;
 
+	/* the hardware is done with it, let the exporter reclaim the frame */
+	s5p_shbuf_put(ctx->src[idx].shbuf);
+	ctx->src[idx].shbuf = NULL;
+
 	fimc_info2("ctx(%d) dqueued idx = %d\n", ctx->ctx_num, b->index);
 
 	return ret;
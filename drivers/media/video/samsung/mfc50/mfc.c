@@ -30,6 +30,7 @@
 #include <linux/kernel.h>
 #include <linux/string.h>
 #include <linux/fs.h>
+#include <linux/file.h>
 #include <linux/mm.h>
 #include <linux/miscdevice.h>
 #include <linux/platform_device.h>
@@ -49,6 +50,7 @@
 #include <plat/media.h>
 #include <mach/media.h>
 #include <plat/mfc.h>
+#include <plat/shbuf.h>
 #ifdef CONFIG_DVFS_LIMIT
 #include <mach/cpu-freq-v210.h>
 #endif
@@ -67,6 +69,9 @@ static struct mutex mfc_mutex;
 static struct clk *mfc_sclk;
 static struct regulator *mfc_pd_regulator;
 const struct firmware	*mfc_fw_info;
+#ifdef CONFIG_DVFS_LIMIT
+static struct s5pv210_freq_floor mfc_freq_floor = S5PV210_FREQ_FLOOR_INIT("mfc");
+#endif
 
 static int mfc_open(struct inode *inode, struct file *file)
 {
@@ -85,7 +90,7 @@ static int mfc_open(struct inode *inode, struct file *file)
 		}
 
 #ifdef CONFIG_DVFS_LIMIT
-		s5pv210_lock_dvfs_high_level(DVFS_LOCK_TOKEN_1, L2);
+		s5pv210_freq_floor_request(&mfc_freq_floor, L2);
 #endif
 		clk_enable(mfc_sclk);
 
@@ -140,7 +145,7 @@ err_mem_inst:
 err_regulator:
 	if (!mfc_is_running()) {
 #ifdef CONFIG_DVFS_LIMIT
-		s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_1);
+		s5pv210_freq_floor_release(&mfc_freq_floor);
 #endif
 		/* Turn off mfc power domain regulator */
 		ret = regulator_disable(mfc_pd_regulator);
@@ -186,7 +191,7 @@ static int mfc_release(struct inode *inode, struct file *file)
 out_release:
 	if (!mfc_is_running()) {
 #ifdef CONFIG_DVFS_LIMIT
-		s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_1);
+		s5pv210_freq_floor_release(&mfc_freq_floor);
 #endif
 		/* Turn off mfc power domain regulator */
 		ret = regulator_disable(mfc_pd_regulator);
@@ -199,11 +204,104 @@ out_release:
 	return ret;
 }
 
+struct mfc_frame_export {
+	struct file		*file;		/* MFC instance, pinned */
+	struct mfc_inst_ctx	*mfc_ctx;
+	int			slot;		/* DPB slot held for the importer */
+};
+
+static void mfc_shbuf_release(struct s5p_shbuf *buf)
+{
+	struct mfc_frame_export *exp = buf->priv;
+
+	/* the decoder may reuse the slot from the next decode on */
+	clear_bit(exp->slot, &exp->mfc_ctx->dpb_held);
+	fput(exp->file);
+	kfree(exp);
+}
+
+/*
+ * Hand a decoded DPB frame out as a shared buffer so that FIMC can scale
+ * it straight from MFC memory. The addresses must be those of one DPB
+ * slot, and that slot is kept out of the decoder's release mask until
+ * every importer is done with it. The handle also pins the MFC instance,
+ * so the DPB stays allocated. The caller installs *shfile in an fd.
+ */
+static enum mfc_error_code mfc_export_frame(struct file *file,
+		struct mfc_inst_ctx *mfc_ctx, union mfc_args *args,
+		struct file **shfile)
+{
+	struct mfc_export_frame_arg *exp_arg = &args->export_frame;
+	struct mfc_frame_buf_arg *dpb = &mfc_ctx->dec_dpb_buff_paddr;
+	struct mfc_frame_export *exp;
+	unsigned int luma_sz, chroma_sz, luma_stride, slot;
+	dma_addr_t base[2];
+	size_t length[2];
+
+	luma_sz = mfc_ctx->shared_mem.allocated_luma_dpb_size;
+	chroma_sz = mfc_ctx->shared_mem.allocated_chroma_dpb_size;
+	/* H.264 keeps each frame's motion vectors after its luma plane */
+	luma_stride = luma_sz + mfc_ctx->shared_mem.allocated_mv_size;
+
+	if (!luma_sz || !chroma_sz ||
+	    exp_arg->in_Y_addr < dpb->luma ||
+	    exp_arg->in_C_addr < dpb->chroma) {
+		mfc_err("MFCINST_ERR_FRM_BUF_INVALID\n");
+		return MFCINST_ERR_FRM_BUF_INVALID;
+	}
+
+	slot = (exp_arg->in_Y_addr - dpb->luma) / luma_stride;
+	if (slot >= mfc_ctx->totalDPBCnt || slot >= BITS_PER_LONG ||
+	    exp_arg->in_Y_addr != dpb->luma + slot * luma_stride ||
+	    exp_arg->in_C_addr != dpb->chroma + slot * chroma_sz) {
+		mfc_err("MFCINST_ERR_FRM_BUF_INVALID\n");
+		return MFCINST_ERR_FRM_BUF_INVALID;
+	}
+
+	/* one handle per frame, the decoder cannot hold back a slot twice */
+	if (test_and_set_bit(slot, &mfc_ctx->dpb_held)) {
+		mfc_err("MFCINST_ERR_FRM_BUF_INVALID: DPB[%d] already exported\n",
+				slot);
+		return MFCINST_ERR_FRM_BUF_INVALID;
+	}
+
+	exp = kmalloc(sizeof(*exp), GFP_KERNEL);
+	if (!exp) {
+		clear_bit(slot, &mfc_ctx->dpb_held);
+		mfc_err("MFCINST_MEMORY_ALLOC_FAIL\n");
+		return MFCINST_MEMORY_ALLOC_FAIL;
+	}
+	exp->file = file;
+	exp->mfc_ctx = mfc_ctx;
+	exp->slot = slot;
+
+	/* luma lives on port1, chroma on port0 */
+	base[0] = exp_arg->in_Y_addr;
+	base[1] = exp_arg->in_C_addr;
+	length[0] = luma_sz;
+	length[1] = chroma_sz;
+
+	get_file(file);
+	*shfile = s5p_shbuf_export(2, base, length, mfc_shbuf_release, exp);
+	if (IS_ERR(*shfile)) {
+		*shfile = NULL;
+		fput(file);
+		kfree(exp);
+		clear_bit(slot, &mfc_ctx->dpb_held);
+		mfc_err("MFCINST_MEMORY_ALLOC_FAIL\n");
+		return MFCINST_MEMORY_ALLOC_FAIL;
+	}
+
+	return MFCINST_RET_OK;
+}
+
 static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int ret, ex_ret;
 	struct mfc_inst_ctx *mfc_ctx = NULL;
 	struct mfc_common_args in_param;
+	struct file *shfile = NULL;
+	int shfd = -1;
 
 	mutex_lock(&mfc_mutex);
 	clk_enable(mfc_sclk);
@@ -400,6 +498,36 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 		mutex_unlock(&mfc_mutex);
 		break;
 
+	case IOCTL_MFC_EXPORT_FRAME:
+		/* the fd is only installed once the result reaches userspace */
+		shfd = get_unused_fd_flags(O_CLOEXEC);
+		if (shfd < 0) {
+			mfc_err("MFCINST_MEMORY_ALLOC_FAIL\n");
+			in_param.ret_code = MFCINST_MEMORY_ALLOC_FAIL;
+			ret = shfd;
+			break;
+		}
+
+		mutex_lock(&mfc_mutex);
+		if (mfc_ctx->MfcState < MFCINST_STATE_DEC_INITIALIZE) {
+			mfc_err("MFCINST_ERR_STATE_INVALID\n");
+			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+			ret = -EINVAL;
+		} else {
+			in_param.ret_code = mfc_export_frame(file, mfc_ctx,
+						&(in_param.args), &shfile);
+			ret = in_param.ret_code;
+		}
+		mutex_unlock(&mfc_mutex);
+
+		if (shfile) {
+			in_param.args.export_frame.out_fd = shfd;
+		} else {
+			put_unused_fd(shfd);
+			shfd = -1;
+		}
+		break;
+
 	case IOCTL_MFC_GET_MMAP_SIZE:
 
 		if (mfc_ctx->MfcState < MFCINST_STATE_OPENED) {
@@ -438,6 +566,17 @@ out_ioctl:
 		ret = -EIO;
 	}
 
+	if (shfile) {
+		if (ex_ret) {
+			/* userspace never learnt the fd, drop the handle */
+			put_unused_fd(shfd);
+			fput(shfile);
+			ret = -EFAULT;
+		} else {
+			fd_install(shfd, shfile);
+		}
+	}
+
 	mfc_debug_L0("---------------IOCTL return = %d ---------------\n", ret);
 
 	return ret;
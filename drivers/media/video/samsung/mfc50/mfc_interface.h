@@ -31,6 +31,7 @@
 #define IOCTL_MFC_FREE_BUF			0x00800011
 #define IOCTL_MFC_GET_PHYS_ADDR			0x00800012
 #define IOCTL_MFC_GET_MMAP_SIZE			0x00800014
+#define IOCTL_MFC_EXPORT_FRAME			0x00800015
 
 #define IOCTL_MFC_SET_CONFIG			0x00800101
 #define IOCTL_MFC_GET_CONFIG			0x00800102
@@ -307,6 +308,12 @@ struct mfc_mem_free_arg {
 	unsigned int u_addr;
 };
 
+struct mfc_export_frame_arg {
+	unsigned int in_Y_addr;              /* [IN]  physical address of the decoded luma plane             */
+	unsigned int in_C_addr;              /* [IN]  physical address of the decoded chroma plane           */
+	int out_fd;                          /* [OUT] shared buffer fd, close it when done                   */
+};
+
 typedef enum {
 	MFC_BUFFER_NO_CACHE = 0,
 	MFC_BUFFER_CACHE = 1
@@ -327,6 +334,7 @@ union mfc_args {
 	struct mfc_mem_alloc_arg mem_alloc;
 	struct mfc_mem_free_arg mem_free;
 	struct mfc_get_phys_addr_arg get_phys_addr;
+	struct mfc_export_frame_arg export_frame;
 
 	mfc_buffer_type buf_type;
 };
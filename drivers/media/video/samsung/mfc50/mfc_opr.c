@@ -248,8 +248,8 @@ static void mfc_set_dec_stream_buffer(struct mfc_inst_ctx *mfc_ctx, int buf_addr
 	
 	port0_base_paddr = mfc_port0_base_paddr;
 
-	/* release buffer */
-	WRITEL(0xffffffff, MFC_SI_CH0_RELEASE_BUFFER);
+	/* release buffer, except frames still shared with other devices */
+	WRITEL(~mfc_ctx->dpb_held, MFC_SI_CH0_RELEASE_BUFFER);
 
 	/* Set stream & desc buffer */
 	WRITEL((buf_addr - port0_base_paddr) >> 11, MFC_SI_CH0_ES_ADDR);
@@ -173,6 +173,7 @@ struct mfc_inst_ctx {
 	unsigned int codec_buff_paddr;
 	unsigned int pred_buff_paddr;
 	struct mfc_frame_buf_arg dec_dpb_buff_paddr;
+	unsigned long dpb_held;		/* DPB slots pinned by exported frames */
 	unsigned int shared_mem_paddr;
 	unsigned int shared_mem_vaddr;
 	unsigned int IsStartedIFrame;
@@ -23,6 +23,8 @@
 #include <linux/android_pmem.h>
 #include <linux/mempolicy.h>
 #include <linux/sched.h>
+#include <linux/sort.h>
+#include <linux/dma-mapping.h>
 #include <asm/io.h>
 #include <asm/uaccess.h>
 #include <asm/cacheflush.h>
@@ -82,6 +84,8 @@ struct pmem_data {
 struct pmem_bits {
 	unsigned allocated:1;		/* 1 if allocated, 0 if free */
 	unsigned order:7;		/* size of the region in pmem space */
+	/* links a free region into the free list for its order */
+	struct list_head free_link;
 };
 
 struct pmem_region_node {
@@ -116,6 +120,25 @@ struct pmem_info {
 	/* the bitmap for the region indicating which entries are allocated
 	 * and which are free */
 	struct pmem_bits *bitmap;
+	/* free regions of each order, so allocation pops one instead of
+	 * walking the bitmap; nr_free counts the entries of each list */
+	struct list_head *free_list;
+	unsigned long *nr_free;
+	/* largest order a region can have in this space */
+	int max_order;
+	/* allocator statistics, shown in debugfs */
+	unsigned long nr_allocs;
+	unsigned long nr_frees;
+	unsigned long nr_alloc_failed;
+	unsigned long nr_splits;
+	unsigned long nr_merges;
+	/* cache maintenance statistics, shown in debugfs; whole_bytes is what
+	 * flushing every touched allocation in full would have cost.  Syncs
+	 * only hold pmem_data->sem for reading, so these take their own lock */
+	spinlock_t sync_lock;
+	unsigned long nr_syncs;
+	u64 sync_bytes;
+	u64 sync_whole_bytes;
 	/* indicates the region should not be managed with an allocator */
 	unsigned no_allocator;
 	/* indicates maps of this region should be cached, if a mix of
@@ -232,6 +255,20 @@ static int is_master_owner(struct file *file)
 	return ret;
 }
 
+static void pmem_free_list_add(int id, int index)
+{
+	int order = PMEM_ORDER(id, index);
+
+	list_add(&pmem[id].bitmap[index].free_link, &pmem[id].free_list[order]);
+	pmem[id].nr_free[order]++;
+}
+
+static void pmem_free_list_del(int id, int index)
+{
+	list_del(&pmem[id].bitmap[index].free_link);
+	pmem[id].nr_free[PMEM_ORDER(id, index)]--;
+}
+
 static int pmem_free(int id, int index)
 {
 	/* caller should hold the write lock on pmem_sem! */
@@ -244,21 +281,26 @@ static int pmem_free(int id, int index)
 	}
 	/* clean up the bitmap, merging any buddies */
 	pmem[id].bitmap[curr].allocated = 0;
+	pmem[id].nr_frees++;
 	/* find a slots buddy Buddy# = Slot# ^ (1 << order)
 	 * if the buddy is also free merge them
-	 * repeat until the buddy is not free or end of the bitmap is reached
+	 * repeat until the buddy is not free or would run off the end of the
+	 * space (the top regions of a space that is not a power of two in
+	 * size have no buddy)
 	 */
-	do {
+	while (PMEM_ORDER(id, curr) < pmem[id].max_order) {
 		buddy = PMEM_BUDDY_INDEX(id, curr);
-		if (PMEM_IS_FREE(id, buddy) &&
-				PMEM_ORDER(id, buddy) == PMEM_ORDER(id, curr)) {
-			PMEM_ORDER(id, buddy)++;
-			PMEM_ORDER(id, curr)++;
-			curr = min(buddy, curr);
-		} else {
+		if (buddy + (1 << PMEM_ORDER(id, curr)) > pmem[id].num_entries)
 			break;
-		}
-	} while (curr < pmem[id].num_entries);
+		if (!PMEM_IS_FREE(id, buddy) ||
+		    PMEM_ORDER(id, buddy) != PMEM_ORDER(id, curr))
+			break;
+		pmem_free_list_del(id, buddy);
+		curr = min(buddy, curr);
+		PMEM_ORDER(id, curr)++;
+		pmem[id].nr_merges++;
+	}
+	pmem_free_list_add(id, curr);
 
 	return 0;
 }
@@ -380,10 +422,9 @@ static int pmem_allocate(int id, unsigned long len)
 {
 	/* caller should hold the write lock on pmem_sem! */
 	/* return the corresponding pdata[] entry */
-	int curr = 0;
-	int end = pmem[id].num_entries;
 	int best_fit = -1;
 	unsigned long order = pmem_order(len);
+	unsigned long curr;
 
 	if (pmem[id].no_allocator) {
 		DLOG("no allocator");
@@ -397,32 +438,28 @@ static int pmem_allocate(int id, unsigned long len)
 		return -1;
 	DLOG("order %lx\n", order);
 
-	/* look through the bitmap:
-	 * 	if you find a free slot of the correct order use it
-	 * 	otherwise, use the best fit (smallest with size > order) slot
+	/* take a free slot of the correct order if there is one,
+	 * otherwise the best fit is a slot from the smallest non-empty
+	 * larger order
 	 */
-	while (curr < end) {
-		if (PMEM_IS_FREE(id, curr)) {
-			if (PMEM_ORDER(id, curr) == (unsigned char)order) {
-				/* set the not free bit and clear others */
-				best_fit = curr;
-				break;
-			}
-			if (PMEM_ORDER(id, curr) > (unsigned char)order &&
-			    (best_fit < 0 ||
-			     PMEM_ORDER(id, curr) < PMEM_ORDER(id, best_fit)))
-				best_fit = curr;
+	for (curr = order; curr <= pmem[id].max_order; curr++) {
+		if (!list_empty(&pmem[id].free_list[curr])) {
+			best_fit = list_first_entry(&pmem[id].free_list[curr],
+					struct pmem_bits, free_link) -
+					pmem[id].bitmap;
+			break;
 		}
-		curr = PMEM_NEXT_INDEX(id, curr);
 	}
 
 	/* if best_fit < 0, there are no suitable slots,
 	 * return an error
 	 */
 	if (best_fit < 0) {
+		pmem[id].nr_alloc_failed++;
 		printk("pmem: no space left to allocate!\n");
 		return -1;
 	}
+	pmem_free_list_del(id, best_fit);
 
 	/* now partition the best fit:
 	 * 	split the slot into 2 buddies of order - 1
@@ -433,8 +470,12 @@ static int pmem_allocate(int id, unsigned long len)
 		PMEM_ORDER(id, best_fit) -= 1;
 		buddy = PMEM_BUDDY_INDEX(id, best_fit);
 		PMEM_ORDER(id, buddy) = PMEM_ORDER(id, best_fit);
+		pmem[id].bitmap[buddy].allocated = 0;
+		pmem_free_list_add(id, buddy);
+		pmem[id].nr_splits++;
 	}
 	pmem[id].bitmap[best_fit].allocated = 1;
+	pmem[id].nr_allocs++;
 	return best_fit;
 }
 
@@ -779,6 +820,150 @@ void put_pmem_file(struct file *file)
 	fput(file);
 }
 
+/* cache line aligned [start, end) offsets into an allocation */
+struct pmem_sync_range {
+	unsigned long start;
+	unsigned long end;
+};
+
+#define PMEM_SYNC_RANGES 32
+
+static int pmem_sync_range_cmp(const void *a, const void *b)
+{
+	const struct pmem_sync_range *ra = a, *rb = b;
+
+	if (ra->start < rb->start)
+		return -1;
+	return ra->start > rb->start;
+}
+
+/* sorts the ranges and folds overlapping or touching ones together,
+ * returns the new number of ranges */
+static int pmem_merge_sync_ranges(struct pmem_sync_range *ranges, int n)
+{
+	int i, j;
+
+	if (n < 2)
+		return n;
+	sort(ranges, n, sizeof(*ranges), pmem_sync_range_cmp, NULL);
+	for (i = 0, j = 1; j < n; j++) {
+		if (ranges[j].start <= ranges[i].end) {
+			if (ranges[j].end > ranges[i].end)
+				ranges[i].end = ranges[j].end;
+			continue;
+		}
+		ranges[++i] = ranges[j];
+	}
+	return i + 1;
+}
+
+static void pmem_cache_op(void *start, void *end, unsigned int op)
+{
+	switch (op) {
+	case PMEM_CACHE_OP_CLEAN:
+		dmac_map_area(start, end - start, DMA_TO_DEVICE);
+		break;
+	case PMEM_CACHE_OP_INV:
+		dmac_map_area(start, end - start, DMA_FROM_DEVICE);
+		break;
+	default:
+		dmac_flush_range(start, end);
+		break;
+	}
+}
+
+static unsigned long pmem_sync_ranges(void *vaddr,
+				      struct pmem_sync_range *ranges, int n,
+				      unsigned int op)
+{
+	unsigned long bytes = 0;
+	int i;
+
+	n = pmem_merge_sync_ranges(ranges, n);
+	for (i = 0; i < n; i++) {
+		pmem_cache_op(vaddr + ranges[i].start, vaddr + ranges[i].end,
+			      op);
+		bytes += ranges[i].end - ranges[i].start;
+	}
+	return bytes;
+}
+
+static void pmem_account_sync(int id, unsigned long bytes,
+			      unsigned long whole)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pmem[id].sync_lock, flags);
+	pmem[id].nr_syncs++;
+	pmem[id].sync_bytes += bytes;
+	pmem[id].sync_whole_bytes += whole;
+	spin_unlock_irqrestore(&pmem[id].sync_lock, flags);
+}
+
+/* expands the rects into cache line aligned ranges clipped to bytes lo to hi
+ * of the allocation at vaddr, merges them and runs op on what is left.
+ * Lines of a rect that fall in the same or the next cache line are merged as
+ * they are generated, so a tall rect with a small stride costs one range.
+ * Invalidate ranges keep the exact rect bounds: rounding them out would
+ * throw away dirty data sharing the edge lines, while the unaligned ends
+ * make the invalidate clean those lines first */
+static unsigned long pmem_sync_rects(void *vaddr, unsigned long lo,
+				     unsigned long hi, unsigned int op,
+				     const struct pmem_dirty_rect *rects,
+				     unsigned int count)
+{
+	struct pmem_sync_range ranges[PMEM_SYNC_RANGES];
+	unsigned long bytes = 0;
+	unsigned int i;
+	int n = 0;
+
+	for (i = 0; i < count; i++) {
+		const struct pmem_dirty_rect *rect = &rects[i];
+		unsigned long height = rect->height ? rect->height : 1;
+		unsigned long line;
+
+		if (!rect->width || rect->offset >= hi)
+			continue;
+		if (!rect->stride)
+			height = 1;
+		else if (height - 1 > (hi - rect->offset - 1) / rect->stride)
+			height = (hi - rect->offset - 1) / rect->stride + 1;
+
+		for (line = 0; line < height; line++) {
+			unsigned long start = rect->offset + line * rect->stride;
+			unsigned long end = start + min(rect->width,
+							hi - start);
+
+			if (op != PMEM_CACHE_OP_INV) {
+				start &= ~(L1_CACHE_BYTES - 1);
+				end = min(ALIGN(end, L1_CACHE_BYTES), hi);
+			}
+			if (start < lo)
+				start = lo;
+			if (start >= end)
+				continue;
+			if (n && start >= ranges[n - 1].start &&
+			    start <= ranges[n - 1].end) {
+				if (end > ranges[n - 1].end)
+					ranges[n - 1].end = end;
+				continue;
+			}
+			if (n == PMEM_SYNC_RANGES) {
+				n = pmem_merge_sync_ranges(ranges, n);
+				if (n == PMEM_SYNC_RANGES) {
+					bytes += pmem_sync_ranges(vaddr, ranges,
+								  n, op);
+					n = 0;
+				}
+			}
+			ranges[n].start = start;
+			ranges[n].end = end;
+			n++;
+		}
+	}
+	return bytes + pmem_sync_ranges(vaddr, ranges, n, op);
+}
+
 void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 {
 	struct pmem_data *data;
@@ -786,7 +971,8 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 	void *vaddr;
 	struct pmem_region_node *region_node;
 	struct list_head *elt;
-	void *flush_start, *flush_end;
+	struct pmem_dirty_rect rect;
+	unsigned long whole, bytes = 0;
 
 	if (!is_pmem_file(file) || !has_allocation(file)) {
 		return;
@@ -799,25 +985,82 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 
 	down_read(&data->sem);
 	vaddr = pmem_start_vaddr(id, data);
+	whole = pmem_len(id, data);
 	/* if this isn't a submmapped file, flush the whole thing */
 	if (unlikely(!(data->flags & PMEM_FLAGS_CONNECTED))) {
-		dmac_flush_range(vaddr, vaddr + pmem_len(id, data));
+		dmac_flush_range(vaddr, vaddr + whole);
+		bytes = whole;
 		goto end;
 	}
-	/* otherwise, flush the region of the file we are drawing */
+	/* otherwise, flush the part of the region of the file we are
+	 * drawing */
 	list_for_each(elt, &data->region_list) {
 		region_node = list_entry(elt, struct pmem_region_node, list);
 		if ((offset >= region_node->region.offset) &&
 		    ((offset + len) <= (region_node->region.offset +
 			region_node->region.len))) {
-			flush_start = vaddr + region_node->region.offset;
-			flush_end = flush_start + region_node->region.len;
-			dmac_flush_range(flush_start, flush_end);
+			rect.offset = offset;
+			rect.stride = 0;
+			rect.width = len;
+			rect.height = 1;
+			bytes = pmem_sync_rects(vaddr, 0, whole,
+						PMEM_CACHE_OP_FLUSH, &rect, 1);
 			break;
 		}
 	}
 end:
 	up_read(&data->sem);
+	pmem_account_sync(id, bytes, whole);
+}
+
+/* runs the cache operation op over just the dirty rects of the allocation,
+ * rects are in bytes from the start of the allocation and are clipped to it,
+ * or for a connected file to the regions of it the client has mapped, as
+ * flush_pmem_file does.  Returns the number of bytes the cache operations
+ * covered */
+long sync_pmem_file_rects(struct file *file, unsigned int op,
+			  const struct pmem_dirty_rect *rects,
+			  unsigned int count)
+{
+	struct pmem_data *data;
+	int id;
+	void *vaddr;
+	struct pmem_region_node *region_node;
+	struct list_head *elt;
+	unsigned long whole, bytes = 0;
+
+	if (op > PMEM_CACHE_OP_INV)
+		return -EINVAL;
+	if (!is_pmem_file(file) || !has_allocation(file))
+		return -EINVAL;
+
+	id = get_id(file);
+	data = (struct pmem_data *)file->private_data;
+	if (!pmem[id].cached || file->f_flags & O_SYNC)
+		return 0;
+
+	down_read(&data->sem);
+	vaddr = pmem_start_vaddr(id, data);
+	whole = pmem_len(id, data);
+	if (likely(!(data->flags & PMEM_FLAGS_CONNECTED))) {
+		bytes = pmem_sync_rects(vaddr, 0, whole, op, rects, count);
+		goto end;
+	}
+	/* an invalidate outside the client's regions would throw away another
+	 * client's writes */
+	list_for_each(elt, &data->region_list) {
+		region_node = list_entry(elt, struct pmem_region_node, list);
+		bytes += pmem_sync_rects(vaddr, region_node->region.offset,
+					 region_node->region.offset +
+					 region_node->region.len,
+					 op, rects, count);
+	}
+end:
+	up_read(&data->sem);
+	pmem_account_sync(id, bytes, whole);
+	DLOG("sync op %u %u rects %lu of %lu bytes\n", op, count, bytes,
+	     whole);
+	return bytes;
 }
 
 static int pmem_connect(unsigned long connect, struct file *file)
@@ -1156,6 +1399,25 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			flush_pmem_file(file, region.offset, region.len);
 			break;
 		}
+	case PMEM_CACHE_SYNC_RECTS:
+		{
+			struct pmem_dirty_rects rects;
+			long bytes;
+			DLOG("sync rects\n");
+			if (copy_from_user(&rects, (void __user *)arg,
+					   sizeof(struct pmem_dirty_rects)))
+				return -EFAULT;
+			if (rects.count > PMEM_MAX_DIRTY_RECTS)
+				return -EINVAL;
+			bytes = sync_pmem_file_rects(file, rects.op,
+						     rects.rects, rects.count);
+			if (bytes < 0)
+				return bytes;
+			if (put_user(bytes, &((struct pmem_dirty_rects __user *)
+					      arg)->flushed))
+				return -EFAULT;
+			break;
+		}
 	default:
 		if (pmem[id].ioctl)
 			return pmem[id].ioctl(file, cmd, arg);
@@ -1171,6 +1433,64 @@ static ssize_t debug_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/* free space by order, the largest free region and how much of the free
+ * space lies outside it (0% when all free space is one region) */
+static int debug_allocator_stats(int id, char *buffer, int bufmax)
+{
+	unsigned long free_entries = 0;
+	int largest = -1;
+	int order;
+	int n;
+
+	down_read(&pmem[id].bitmap_sem);
+	for (order = 0; order <= pmem[id].max_order; order++) {
+		free_entries += pmem[id].nr_free[order] << order;
+		if (pmem[id].nr_free[order])
+			largest = order;
+	}
+
+	n = scnprintf(buffer, bufmax,
+		      "free %lu KB largest %lu KB fragmentation %lu%%\n",
+		      free_entries * PMEM_MIN_ALLOC / 1024,
+		      largest < 0 ? 0 :
+		      (1UL << largest) * PMEM_MIN_ALLOC / 1024,
+		      free_entries ?
+		      100 - ((largest < 0 ? 0 : 1UL << largest) * 100 /
+			     free_entries) : 0);
+	n += scnprintf(buffer + n, bufmax - n,
+		       "allocs %lu frees %lu failed %lu splits %lu merges %lu\n",
+		       pmem[id].nr_allocs, pmem[id].nr_frees,
+		       pmem[id].nr_alloc_failed, pmem[id].nr_splits,
+		       pmem[id].nr_merges);
+	n += scnprintf(buffer + n, bufmax - n, "free regions by order:");
+	for (order = 0; order <= pmem[id].max_order; order++)
+		n += scnprintf(buffer + n, bufmax - n, " %lu",
+			       pmem[id].nr_free[order]);
+	n += scnprintf(buffer + n, bufmax - n, "\n");
+	up_read(&pmem[id].bitmap_sem);
+
+	return n;
+}
+
+/* bytes the cache operations covered against what flushing the whole of
+ * each allocation would have cost */
+static int debug_sync_stats(int id, char *buffer, int bufmax)
+{
+	unsigned long nr_syncs;
+	u64 bytes, whole;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pmem[id].sync_lock, flags);
+	nr_syncs = pmem[id].nr_syncs;
+	bytes = pmem[id].sync_bytes;
+	whole = pmem[id].sync_whole_bytes;
+	spin_unlock_irqrestore(&pmem[id].sync_lock, flags);
+
+	return scnprintf(buffer, bufmax,
+			 "cache syncs %lu synced %llu KB whole %llu KB\n",
+			 nr_syncs, bytes >> 10, whole >> 10);
+}
+
 static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 			  loff_t *ppos)
 {
@@ -1183,7 +1503,11 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 	int n = 0;
 
 	DLOG("debug open\n");
-	n = scnprintf(buffer, debug_bufmax,
+	n = 0;
+	if (!pmem[id].no_allocator)
+		n = debug_allocator_stats(id, buffer, debug_bufmax);
+	n += debug_sync_stats(id, buffer + n, debug_bufmax - n);
+	n += scnprintf(buffer + n, debug_bufmax - n,
 		      "pid #: mapped regions (offset, len) (offset,len)...\n");
 
 	down(&pmem[id].data_list_sem);
@@ -1240,6 +1564,7 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	pmem[id].ioctl = ioctl;
 	pmem[id].release = release;
 	init_rwsem(&pmem[id].bitmap_sem);
+	spin_lock_init(&pmem[id].sync_lock);
 	init_MUTEX(&pmem[id].data_list_sem);
 	INIT_LIST_HEAD(&pmem[id].data_list);
 	pmem[id].dev.name = pdata->name;
@@ -1262,9 +1587,21 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	memset(pmem[id].bitmap, 0, sizeof(struct pmem_bits) *
 					  pmem[id].num_entries);
 
+	pmem[id].max_order = pmem[id].num_entries ?
+				fls(pmem[id].num_entries) - 1 : 0;
+	pmem[id].free_list = kmalloc((pmem[id].max_order + 1) *
+				     sizeof(struct list_head), GFP_KERNEL);
+	pmem[id].nr_free = kzalloc((pmem[id].max_order + 1) *
+				   sizeof(unsigned long), GFP_KERNEL);
+	if (!pmem[id].free_list || !pmem[id].nr_free)
+		goto err_no_mem_for_free_lists;
+	for (i = 0; i <= pmem[id].max_order; i++)
+		INIT_LIST_HEAD(&pmem[id].free_list[i]);
+
 	for (i = sizeof(pmem[id].num_entries) * 8 - 1; i >= 0; i--) {
 		if ((pmem[id].num_entries) &  1<<i) {
 			PMEM_ORDER(id, index) = i;
+			pmem_free_list_add(id, index);
 			index = PMEM_NEXT_INDEX(id, index);
 		}
 	}
@@ -1293,6 +1630,9 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 #endif
 	return 0;
 error_cant_remap:
+err_no_mem_for_free_lists:
+	kfree(pmem[id].free_list);
+	kfree(pmem[id].nr_free);
 	kfree(pmem[id].bitmap);
 err_no_mem_for_metadata:
 	misc_deregister(&pmem[id].dev);
@@ -52,6 +52,20 @@ MODULE_ALIAS("mmc:block");
 
 static DECLARE_BITMAP(dev_use, MMC_NUM_MINORS);
 
+/*
+ * Discards smaller than the card's preferred erase size are held back for
+ * a while so that neighbouring ones can be merged into them.
+ */
+static int discard_batch = 1;
+module_param(discard_batch, bool, 0644);
+MODULE_PARM_DESC(discard_batch, "Merge small discards before sending them to the card");
+
+static int secure_discard;
+module_param(secure_discard, bool, 0644);
+MODULE_PARM_DESC(secure_discard, "Use secure trim or erase for discards where supported");
+
+#define MMC_BLK_DISCARD_DELAY	(HZ / 2)
+
 /*
  * There is one mmc_blk_data per slot.
  */
@@ -62,6 +76,14 @@ struct mmc_blk_data {
 
 	unsigned int	usage;
 	unsigned int	read_only;
+
+	/*
+	 * Discard held back by mmc_blk_queue_discard(), only touched with
+	 * the host claimed.
+	 */
+	unsigned int	discard_from;
+	unsigned int	discard_nr;
+	struct delayed_work discard_work;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -141,13 +163,6 @@ static const struct block_device_operations mmc_bdops = {
 	.owner			= THIS_MODULE,
 };
 
-struct mmc_blk_request {
-	struct mmc_request	mrq;
-	struct mmc_command	cmd;
-	struct mmc_command	stop;
-	struct mmc_data		data;
-};
-
 static u32 mmc_sd_num_wr_blocks(struct mmc_card *card)
 {
 	int err;
@@ -265,121 +280,205 @@ mmc_blk_set_blksize(struct mmc_blk_data *md, struct mmc_card *card)
 }
 
 
-static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
+/*
+ * Wait for the card to leave the programming state after a write.
+ */
+static int mmc_blk_wait_ready(struct mmc_card *card, struct request *req)
 {
-	struct mmc_blk_data *md = mq->data;
-	struct mmc_card *card = md->queue.card;
-	struct mmc_blk_request brq;
-	int ret = 1, disable_multi = 0;
-	int errorCount = 0;
+	struct mmc_command cmd;
+	int err;
 
-#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
-	if (mmc_bus_needs_resume(card->host)) {
-		mmc_resume_bus(card->host);
-		mmc_blk_set_blksize(md, card);
-	}
+	do {
+		cmd.opcode = MMC_SEND_STATUS;
+		cmd.arg = card->rca << 16;
+		cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		err = mmc_wait_for_cmd(card->host, &cmd, 5);
+		if (err) {
+			printk(KERN_DEBUG "%s: error %d requesting status\n",
+			       req->rq_disk->disk_name, err);
+			return err;
+		}
+		/*
+		 * Some cards mishandle the status bits,
+		 * so make sure to check both the busy
+		 * indication and the card state.
+		 */
+	} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
+		(R1_CURRENT_STATE(cmd.resp[0]) == 7));
+
+#if 0
+	if (cmd.resp[0] & ~0x00000900)
+		printk(KERN_ERR "%s: status = %08x\n",
+		       req->rq_disk->disk_name, cmd.resp[0]);
+	if (mmc_decode_status(cmd.resp))
+		return -EIO;
 #endif
 
-	mmc_claim_host(card->host);
+	return 0;
+}
 
-	do {
-		struct mmc_command cmd;
-		u32 readcmd, writecmd, status = 0;
-
-		memset(&brq, 0, sizeof(struct mmc_blk_request));
-		brq.mrq.cmd = &brq.cmd;
-		brq.mrq.data = &brq.data;
-
-		brq.cmd.arg = blk_rq_pos(req);
-		if (!mmc_card_blockaddr(card))
-			brq.cmd.arg <<= 9;
-		brq.cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-		brq.data.blksz = 512;
-		brq.stop.opcode = MMC_STOP_TRANSMISSION;
-		brq.stop.arg = 0;
-		brq.stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-		brq.data.blocks = blk_rq_sectors(req);
+/*
+ * Called by the core when a request is done, before the next one is
+ * started.  Anything short of a clean and complete transfer holds the
+ * next request back so that mmc_blk_rw_rq() can retry synchronously.
+ * Writes also wait here for the card to finish programming.
+ */
+static int mmc_blk_err_check(struct mmc_card *card,
+			     struct mmc_async_req *areq)
+{
+	struct mmc_queue_req *mqrq = container_of(areq, struct mmc_queue_req,
+						  mmc_active);
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
 
-		/*
-		 * The block layer doesn't support all sector count
-		 * restrictions, so we need to be prepared for too big
-		 * requests.
-		 */
-		if (brq.data.blocks > card->host->max_blk_count)
-			brq.data.blocks = card->host->max_blk_count;
+	if (brq->cmd.error || brq->data.error || brq->stop.error)
+		return 1;
 
-		/*
-		 * After a read error, we redo the request one sector at a time
-		 * in order to accurately determine which sectors can be read
-		 * successfully.
-		 */
-		if (disable_multi && brq.data.blocks > 1)
-			brq.data.blocks = 1;
-
-		if (brq.data.blocks > 1) {
-			/* SPI multiblock writes terminate using a special
-			 * token, not a STOP_TRANSMISSION request.
-			 */
-			if (!mmc_host_is_spi(card->host)
-					|| rq_data_dir(req) == READ)
-				brq.mrq.stop = &brq.stop;
-			readcmd = MMC_READ_MULTIPLE_BLOCK;
-			writecmd = MMC_WRITE_MULTIPLE_BLOCK;
-		} else {
-			brq.mrq.stop = NULL;
-			readcmd = MMC_READ_SINGLE_BLOCK;
-			writecmd = MMC_WRITE_BLOCK;
-		}
+	if (brq->data.bytes_xfered != blk_rq_bytes(req))
+		return 1;
 
-		if (rq_data_dir(req) == READ) {
-			brq.cmd.opcode = readcmd;
-			brq.data.flags |= MMC_DATA_READ;
-		} else {
-			brq.cmd.opcode = writecmd;
-			brq.data.flags |= MMC_DATA_WRITE;
-		}
+	if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ &&
+	    mmc_blk_wait_ready(card, req))
+		return 1;
 
-		mmc_set_data_timeout(&brq.data, card);
+	return 0;
+}
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+/*
+ * Set up the next transfer of mqrq->req: build the commands, map the
+ * data and, if writing, fill the bounce buffer.
+ */
+static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
+			       struct mmc_card *card, int disable_multi,
+			       struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+	u32 readcmd, writecmd;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->data.blksz = 512;
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	brq->data.blocks = blk_rq_sectors(req);
 
-		/*
-		 * Adjust the sg list so it is the same size as the
-		 * request.
+	/*
+	 * The block layer doesn't support all sector count
+	 * restrictions, so we need to be prepared for too big
+	 * requests.
+	 */
+	if (brq->data.blocks > card->host->max_blk_count)
+		brq->data.blocks = card->host->max_blk_count;
+
+	/*
+	 * After a read error, we redo the request one sector at a time
+	 * in order to accurately determine which sectors can be read
+	 * successfully.
+	 */
+	if (disable_multi && brq->data.blocks > 1)
+		brq->data.blocks = 1;
+
+	if (brq->data.blocks > 1) {
+		/* SPI multiblock writes terminate using a special
+		 * token, not a STOP_TRANSMISSION request.
 		 */
-		if (brq.data.blocks != blk_rq_sectors(req)) {
-			int i, data_size = brq.data.blocks << 9;
-			struct scatterlist *sg;
-
-			for_each_sg(brq.data.sg, sg, brq.data.sg_len, i) {
-				data_size -= sg->length;
-				if (data_size <= 0) {
-					sg->length += data_size;
-					i++;
-					break;
-				}
+		if (!mmc_host_is_spi(card->host)
+				|| rq_data_dir(req) == READ)
+			brq->mrq.stop = &brq->stop;
+		readcmd = MMC_READ_MULTIPLE_BLOCK;
+		writecmd = MMC_WRITE_MULTIPLE_BLOCK;
+	} else {
+		brq->mrq.stop = NULL;
+		readcmd = MMC_READ_SINGLE_BLOCK;
+		writecmd = MMC_WRITE_BLOCK;
+	}
+
+	if (rq_data_dir(req) == READ) {
+		brq->cmd.opcode = readcmd;
+		brq->data.flags |= MMC_DATA_READ;
+	} else {
+		brq->cmd.opcode = writecmd;
+		brq->data.flags |= MMC_DATA_WRITE;
+	}
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	/*
+	 * Adjust the sg list so it is the same size as the
+	 * request.
+	 */
+	if (brq->data.blocks != blk_rq_sectors(req)) {
+		int i, data_size = brq->data.blocks << 9;
+		struct scatterlist *sg;
+
+		for_each_sg(brq->data.sg, sg, brq->data.sg_len, i) {
+			data_size -= sg->length;
+			if (data_size <= 0) {
+				sg->length += data_size;
+				i++;
+				break;
 			}
-			brq.data.sg_len = i;
 		}
+		brq->data.sg_len = i;
+	}
 
-		mmc_queue_bounce_pre(mq);
+	mmc_queue_bounce_pre(mqrq);
 
-		mmc_wait_for_req(card->host, &brq.mrq);
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_err_check;
+}
 
-		mmc_queue_bounce_post(mq);
+/*
+ * Complete mqrq->req, whose first transfer has already been issued through
+ * mmc_start_req().  Errors and leftovers are retried synchronously; the
+ * core does not start the next request until this has happened.  'ready'
+ * is set when mmc_blk_err_check() passed, i.e. the transfer was clean and
+ * a written card is out of programming state already.
+ */
+static int mmc_blk_rw_rq(struct mmc_queue *mq, struct mmc_queue_req *mqrq,
+			 int ready)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+	int ret = 1, disable_multi = 0, issued = 1;
+	int errorCount = 0;
+
+	do {
+		u32 status = 0;
+
+		if (!issued) {
+			mmc_blk_rw_rq_prep(mqrq, card, disable_multi, mq);
+			mmc_wait_for_req(card->host, &brq->mrq);
+			ready = 0;
+		}
+		issued = 0;
+
+		mmc_queue_bounce_post(mqrq);
 
 		/*
 		 * Check for errors here, but don't jump to cmd_err
 		 * until later as we need to wait for the card to leave
 		 * programming mode even when things go wrong.
 		 */
-		if (brq.cmd.error || brq.data.error || brq.stop.error) {
-			if (brq.data.blocks > 1 && rq_data_dir(req) == READ) {
+		if (brq->cmd.error || brq->data.error || brq->stop.error) {
+			if (brq->data.blocks > 1 && rq_data_dir(req) == READ) {
 				/* Redo read one sector at a time */
 				printk(KERN_WARNING "%s: retrying using single "
 				       "block read\n", req->rq_disk->disk_name);
-				if(brq.data.error == -EILSEQ) {
+				if(brq->data.error == -EILSEQ) {
 					mq->rx_retries++;
 					if(mq->rx_retries == 3) {
 						mq->rx_retries = 0;
@@ -398,63 +497,39 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 			disable_multi = 0;
 		}
 
-		if (brq.cmd.error) {
+		if (brq->cmd.error) {
 			printk(KERN_DEBUG "%s: error %d sending read/write "
 			       "command, response %#x, card status %#x\n",
-			       req->rq_disk->disk_name, brq.cmd.error,
-			       brq.cmd.resp[0], status);
+			       req->rq_disk->disk_name, brq->cmd.error,
+			       brq->cmd.resp[0], status);
 		}
 
-		if (brq.data.error) {
-			if (brq.data.error == -ETIMEDOUT && brq.mrq.stop)
+		if (brq->data.error) {
+			if (brq->data.error == -ETIMEDOUT && brq->mrq.stop)
 				/* 'Stop' response contains card status */
-				status = brq.mrq.stop->resp[0];
+				status = brq->mrq.stop->resp[0];
 			printk(KERN_DEBUG "%s: error %d transferring data,"
 			       " sector %u, nr %u, card status %#x\n",
-			       req->rq_disk->disk_name, brq.data.error,
+			       req->rq_disk->disk_name, brq->data.error,
 			       (unsigned)blk_rq_pos(req),
 			       (unsigned)blk_rq_sectors(req), status);
 			       errorCount++;
 		}
 
-		if (brq.stop.error) {
+		if (brq->stop.error) {
 			printk(KERN_DEBUG "%s: error %d sending stop command, "
 			       "response %#x, card status %#x\n",
-			       req->rq_disk->disk_name, brq.stop.error,
-			       brq.stop.resp[0], status);
+			       req->rq_disk->disk_name, brq->stop.error,
+			       brq->stop.resp[0], status);
 		}
 
-		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
-			do {
-				int err;
-
-				cmd.opcode = MMC_SEND_STATUS;
-				cmd.arg = card->rca << 16;
-				cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
-				err = mmc_wait_for_cmd(card->host, &cmd, 5);
-				if (err) {
-					printk(KERN_DEBUG "%s: error %d requesting status\n",
-					       req->rq_disk->disk_name, err);
-					goto cmd_err;
-				}
-				/*
-				 * Some cards mishandle the status bits,
-				 * so make sure to check both the busy
-				 * indication and the card state.
-				 */
-			} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
-				(R1_CURRENT_STATE(cmd.resp[0]) == 7));
-
-#if 0
-			if (cmd.resp[0] & ~0x00000900)
-				printk(KERN_ERR "%s: status = %08x\n",
-				       req->rq_disk->disk_name, cmd.resp[0]);
-			if (mmc_decode_status(cmd.resp))
+		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ &&
+		    !ready) {
+			if (mmc_blk_wait_ready(card, req))
 				goto cmd_err;
-#endif
 		}
 
-		if (brq.cmd.error || brq.stop.error || brq.data.error) {
+		if (brq->cmd.error || brq->stop.error || brq->data.error) {
 			if (rq_data_dir(req) == READ) {
 				/*
 				 * After an error, we redo I/O one sector at a
@@ -462,7 +537,7 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 				 * read a single sector.
 				 */
 				spin_lock_irq(&md->lock);
-				ret = __blk_end_request(req, -EIO, brq.data.blksz);
+				ret = __blk_end_request(req, -EIO, brq->data.blksz);
 				spin_unlock_irq(&md->lock);				
 				if(ret && errorCount>15)
 				  {
@@ -473,7 +548,7 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 				 continue;
 			}
 			else {
-				if(brq.data.error == -EILSEQ) {
+				if(brq->data.error == -EILSEQ) {
 					mq->tx_retries++;
 					mmc_card_adjust_cfg(card->host, WRITE);
 					if(mq->tx_retries < 3)
@@ -489,12 +564,10 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 		 * A block was successfully transferred.
 		 */
 		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
+		ret = __blk_end_request(req, 0, brq->data.bytes_xfered);
 		spin_unlock_irq(&md->lock);
 	} while (ret);
 
-	mmc_release_host(card->host);
-
 	return 1;
 
  cmd_err:
@@ -517,12 +590,10 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 		}
 	} else {
 		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
+		ret = __blk_end_request(req, 0, brq->data.bytes_xfered);
 		spin_unlock_irq(&md->lock);
 	}
 
-	mmc_release_host(card->host);
-
 	spin_lock_irq(&md->lock);
 	while (ret)
 		ret = __blk_end_request(req, -EIO, blk_rq_cur_bytes(req));
@@ -531,6 +602,196 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	return 0;
 }
 
+static int mmc_blk_do_discard(struct mmc_card *card, unsigned int from,
+			      unsigned int nr)
+{
+	int err;
+
+	if (secure_discard && mmc_can_secure_erase_trim(card)) {
+		if (!mmc_can_trim(card))
+			return mmc_erase(card, from, nr, MMC_SECURE_ERASE_ARG);
+
+		err = mmc_erase(card, from, nr, MMC_SECURE_TRIM1_ARG);
+		if (!err)
+			err = mmc_erase(card, from, nr, MMC_SECURE_TRIM2_ARG);
+		return err;
+	}
+
+	if (mmc_can_trim(card))
+		return mmc_erase(card, from, nr, MMC_TRIM_ARG);
+
+	/* Plain erase only covers the whole erase groups in the range */
+	return mmc_erase(card, from, nr, MMC_ERASE_ARG);
+}
+
+static void mmc_blk_flush_discard(struct mmc_blk_data *md,
+				  struct mmc_card *card)
+{
+	int err;
+
+	if (!md->discard_nr)
+		return;
+
+	err = mmc_blk_do_discard(card, md->discard_from, md->discard_nr);
+	if (err)
+		printk(KERN_DEBUG "%s: error %d discarding sectors %u-%u\n",
+		       md->disk->disk_name, err, md->discard_from,
+		       md->discard_from + md->discard_nr - 1);
+	md->discard_nr = 0;
+}
+
+static void mmc_blk_discard_work(struct work_struct *work)
+{
+	struct mmc_blk_data *md = container_of(work, struct mmc_blk_data,
+					       discard_work.work);
+	struct mmc_card *card = md->queue.card;
+
+	/* The queue is being torn down */
+	if (!card)
+		return;
+
+	mmc_claim_host(card->host);
+	mmc_blk_flush_discard(md, card);
+	mmc_release_host(card->host);
+}
+
+/*
+ * Add [from, from + nr) to the held back discard.  A discard touching the
+ * held back one is merged into it, any other sends the held back one to
+ * the card first.  Once it covers the preferred erase size it goes out,
+ * otherwise mmc_blk_discard_work() sends it if nothing else turns up.
+ */
+static void mmc_blk_queue_discard(struct mmc_blk_data *md, unsigned int from,
+				  unsigned int nr)
+{
+	struct mmc_card *card = md->queue.card;
+	unsigned int end = from + nr;
+	unsigned int pend = md->discard_from + md->discard_nr;
+
+	if (md->discard_nr && from <= pend && end >= md->discard_from) {
+		md->discard_from = min(from, md->discard_from);
+		md->discard_nr = max(end, pend) - md->discard_from;
+	} else {
+		mmc_blk_flush_discard(md, card);
+		md->discard_from = from;
+		md->discard_nr = nr;
+	}
+
+	if (md->discard_nr >= max(card->pref_erase, card->erase_size))
+		mmc_blk_flush_discard(md, card);
+	else
+		schedule_delayed_work(&md->discard_work,
+				      MMC_BLK_DISCARD_DELAY);
+}
+
+/*
+ * A held back discard must reach the card before anything that reads or
+ * writes the sectors it covers.
+ */
+static int mmc_blk_discard_overlaps(struct mmc_blk_data *md,
+				    struct request *req)
+{
+	unsigned int pos = blk_rq_pos(req);
+
+	return md->discard_nr &&
+	       pos < md->discard_from + md->discard_nr &&
+	       pos + blk_rq_sectors(req) > md->discard_from;
+}
+
+static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	unsigned int from = blk_rq_pos(req);
+	unsigned int nr = blk_rq_sectors(req);
+	int err = 0;
+
+	if (!mmc_can_erase(card)) {
+		err = -EOPNOTSUPP;
+	} else if (discard_batch && !secure_discard) {
+		mmc_blk_queue_discard(md, from, nr);
+	} else {
+		mmc_blk_flush_discard(md, card);
+		err = mmc_blk_do_discard(card, from, nr);
+	}
+
+	spin_lock_irq(&md->lock);
+	__blk_end_request(req, err, blk_rq_bytes(req));
+	spin_unlock_irq(&md->lock);
+
+	return err ? 0 : 1;
+}
+
+static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_async_req *areq = NULL;
+	int ret = 1, err;
+
+	if (rqc) {
+		mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+		areq = &mq->mqrq_cur->mmc_active;
+	}
+
+	areq = mmc_start_req(card->host, areq, &err);
+	if (areq) {
+		ret = mmc_blk_rw_rq(mq, container_of(areq, struct mmc_queue_req,
+						     mmc_active), !err);
+		/*
+		 * A failed request holds back the one behind it, start that
+		 * one now that the failure has been dealt with.
+		 */
+		if (err && rqc)
+			mmc_start_req(card->host, &mq->mqrq_cur->mmc_active,
+				      NULL);
+	}
+
+	return ret;
+}
+
+/*
+ * Issue rqc, if any, and complete the request issued before it.  rqc is
+ * prepared while the previous request is still on the bus and started as
+ * soon as that one is done, so the two overlap.  A NULL rqc just drains
+ * the request in flight.  Discards are sent synchronously.
+ */
+static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *rqc)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	int ret;
+
+	/* The host stays claimed for as long as requests keep coming */
+	if (rqc && !mq->mqrq_prev->req) {
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+		if (mmc_bus_needs_resume(card->host)) {
+			mmc_resume_bus(card->host);
+			mmc_blk_set_blksize(md, card);
+		}
+#endif
+		mmc_claim_host(card->host);
+	}
+
+	if (rqc && (blk_discard_rq(rqc) || mmc_blk_discard_overlaps(md, rqc))) {
+		/* Nothing may be in flight while erase commands go out */
+		mmc_blk_issue_rw_rq(mq, NULL);
+		if (blk_discard_rq(rqc)) {
+			ret = mmc_blk_issue_discard_rq(mq, rqc);
+			goto out;
+		}
+		mmc_blk_flush_discard(md, card);
+	}
+
+	ret = mmc_blk_issue_rw_rq(mq, rqc);
+
+ out:
+	if (!rqc)
+		mmc_release_host(card->host);
+
+	return ret;
+}
+
 
 static inline int mmc_blk_readonly(struct mmc_card *card)
 {
@@ -575,6 +836,7 @@ static struct mmc_blk_data *mmc_blk_alloc(struct mmc_card *card)
 		goto err_putdisk;
 
 	md->queue.issue_fn = mmc_blk_issue_rq;
+	INIT_DELAYED_WORK(&md->discard_work, mmc_blk_discard_work);
 	md->queue.data = md;
 
 	md->disk->major	= MMC_BLOCK_MAJOR;
@@ -677,6 +939,10 @@ static void mmc_blk_remove(struct mmc_card *card)
 		/* Then flush out any already in there */
 		mmc_cleanup_queue(&md->queue);
 
+		/* A held back discard is only a hint, drop it */
+		cancel_delayed_work_sync(&md->discard_work);
+		md->discard_nr = 0;
+
 		mmc_blk_put(md);
 	}
 	mmc_set_drvdata(card, NULL);
@@ -693,6 +959,11 @@ static int mmc_blk_suspend(struct mmc_card *card, pm_message_t state)
 
 	if (md) {
 		mmc_queue_suspend(&md->queue);
+
+		cancel_delayed_work_sync(&md->discard_work);
+		mmc_claim_host(card->host);
+		mmc_blk_flush_discard(md, card);
+		mmc_release_host(card->host);
 	}
 	return 0;
 }
@@ -14,6 +14,8 @@
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
 #include <linux/slab.h>
+#include <linux/time.h>
+#include <linux/math64.h>
 
 #include <linux/scatterlist.h>
 
@@ -895,6 +897,209 @@ static int mmc_test_multi_read_high(struct mmc_test_card *test)
 
 #endif /* CONFIG_HIGHMEM */
 
+/*******************************************************************/
+/*  Performance tests                                              */
+/*******************************************************************/
+
+#define PERF_REQUESTS		256
+#define PERF_DISCARDS		16
+
+/*
+ * Throughput in kB/s for a transfer of 'bytes' that took 'ts'
+ */
+static unsigned int mmc_test_rate(u64 bytes, struct timespec *ts)
+{
+	u64 ns = timespec_to_ns(ts);
+
+	if (!ns)
+		return 0;
+
+	return div64_u64(bytes * NSEC_PER_SEC, ns) / 1024;
+}
+
+struct mmc_test_async_req {
+	struct mmc_async_req	areq;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct scatterlist	sg;
+	struct mmc_test_card	*test;
+};
+
+static int mmc_test_check_async(struct mmc_card *card,
+	struct mmc_async_req *areq)
+{
+	struct mmc_test_async_req *rq;
+
+	rq = container_of(areq, struct mmc_test_async_req, areq);
+
+	if (rq->cmd.error)
+		return rq->cmd.error;
+	if (rq->data.error)
+		return rq->data.error;
+	if (rq->mrq.stop && rq->stop.error)
+		return rq->stop.error;
+	if (rq->data.bytes_xfered != rq->data.blocks * rq->data.blksz)
+		return RESULT_FAIL;
+
+	if (rq->data.flags & MMC_DATA_WRITE)
+		return mmc_test_wait_busy(rq->test);
+
+	return 0;
+}
+
+static void mmc_test_prepare_async(struct mmc_test_card *test,
+	struct mmc_test_async_req *rq, u8 *buffer, unsigned dev_addr,
+	unsigned blocks, int write)
+{
+	memset(rq, 0, sizeof(struct mmc_test_async_req));
+
+	rq->mrq.cmd = &rq->cmd;
+	rq->mrq.data = &rq->data;
+	rq->mrq.stop = &rq->stop;
+
+	sg_init_one(&rq->sg, buffer, blocks * 512);
+
+	mmc_test_prepare_mrq(test, &rq->mrq, &rq->sg, 1, dev_addr,
+		blocks, 512, write);
+
+	rq->areq.mrq = &rq->mrq;
+	rq->areq.err_check = mmc_test_check_async;
+	rq->test = test;
+}
+
+/*
+ * Transfer PERF_REQUESTS requests back to back, alternating between the
+ * two halves of the buffer.  Blocking mode waits for each request before
+ * setting up the next, non-blocking mode sets up the next request while
+ * the previous one is still being transferred.
+ */
+static int mmc_test_perf_transfer(struct mmc_test_card *test, int write,
+	int nonblock)
+{
+	struct mmc_host *host = test->card->host;
+	struct mmc_test_async_req *rq;
+	struct timespec ts1, ts2, ts;
+	unsigned int blocks, i;
+	int ret;
+
+	blocks = BUFFER_SIZE / 2 / 512;
+	blocks = min(blocks, host->max_blk_count);
+	blocks = min(blocks, host->max_req_size / 512);
+	blocks = min(blocks, host->max_seg_size / 512);
+
+	ret = mmc_test_set_blksize(test, 512);
+	if (ret)
+		return ret;
+
+	rq = kmalloc(sizeof(struct mmc_test_async_req) * 2, GFP_KERNEL);
+	if (!rq)
+		return -ENOMEM;
+
+	getnstimeofday(&ts1);
+
+	for (i = 0;i < PERF_REQUESTS;i++) {
+		struct mmc_test_async_req *cur = &rq[i & 1];
+
+		mmc_test_prepare_async(test, cur,
+			test->buffer + (i & 1) * blocks * 512,
+			(i & 1) * blocks, blocks, write);
+
+		if (nonblock) {
+			mmc_start_req(host, &cur->areq, &ret);
+		} else {
+			mmc_wait_for_req(host, &cur->mrq);
+			ret = mmc_test_check_async(test->card, &cur->areq);
+		}
+		if (ret)
+			goto out;
+	}
+
+	if (nonblock) {
+		mmc_start_req(host, NULL, &ret);
+		if (ret)
+			goto out;
+	}
+
+	getnstimeofday(&ts2);
+
+	ts = timespec_sub(ts2, ts1);
+
+	printk(KERN_INFO "%s: Transfer of %u x %u sectors (%s, %s) took "
+		"%lu.%09lu seconds (%u kB/s)\n",
+		mmc_hostname(host), PERF_REQUESTS, blocks,
+		write ? "write" : "read",
+		nonblock ? "non-blocking" : "blocking",
+		(unsigned long)ts.tv_sec, (unsigned long)ts.tv_nsec,
+		mmc_test_rate((u64)PERF_REQUESTS * blocks * 512, &ts));
+
+out:
+	kfree(rq);
+	return ret;
+}
+
+static int mmc_test_perf_write(struct mmc_test_card *test)
+{
+	return mmc_test_perf_transfer(test, 1, 0);
+}
+
+static int mmc_test_perf_read(struct mmc_test_card *test)
+{
+	return mmc_test_perf_transfer(test, 0, 0);
+}
+
+static int mmc_test_perf_write_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf_transfer(test, 1, 1);
+}
+
+static int mmc_test_perf_read_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf_transfer(test, 0, 1);
+}
+
+/*
+ * Discard PERF_DISCARDS consecutive preferred erase units, one command
+ * each, using TRIM where the card has it.
+ */
+static int mmc_test_perf_discard(struct mmc_test_card *test)
+{
+	struct mmc_card *card = test->card;
+	struct timespec ts1, ts2, ts;
+	unsigned int nr, arg, i;
+	int ret;
+
+	if (!(card->host->caps & MMC_CAP_ERASE))
+		return RESULT_UNSUP_HOST;
+	if (!mmc_can_erase(card))
+		return RESULT_UNSUP_CARD;
+
+	arg = mmc_can_trim(card) ? MMC_TRIM_ARG : MMC_ERASE_ARG;
+	nr = max(card->pref_erase, card->erase_size);
+
+	getnstimeofday(&ts1);
+
+	for (i = 0;i < PERF_DISCARDS;i++) {
+		ret = mmc_erase(card, i * nr, nr, arg);
+		if (ret)
+			return ret;
+	}
+
+	getnstimeofday(&ts2);
+
+	ts = timespec_sub(ts2, ts1);
+
+	printk(KERN_INFO "%s: Discard of %u x %u sectors (%s) took "
+		"%lu.%09lu seconds (%u kB/s)\n",
+		mmc_hostname(card->host), PERF_DISCARDS, nr,
+		arg == MMC_TRIM_ARG ? "trim" : "erase",
+		(unsigned long)ts.tv_sec, (unsigned long)ts.tv_nsec,
+		mmc_test_rate((u64)PERF_DISCARDS * nr * 512, &ts));
+
+	return 0;
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -1042,6 +1247,39 @@ static const struct mmc_test_case mmc_test_cases[] = {
 
 #endif /* CONFIG_HIGHMEM */
 
+	{
+		.name = "Write performance, blocking requests",
+		.prepare = mmc_test_prepare_write,
+		.run = mmc_test_perf_write,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Write performance, non-blocking requests",
+		.prepare = mmc_test_prepare_write,
+		.run = mmc_test_perf_write_nonblock,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Read performance, blocking requests",
+		.prepare = mmc_test_prepare_read,
+		.run = mmc_test_perf_read,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Read performance, non-blocking requests",
+		.prepare = mmc_test_prepare_read,
+		.run = mmc_test_perf_read_nonblock,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Discard performance",
+		.run = mmc_test_perf_discard,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
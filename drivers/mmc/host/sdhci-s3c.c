@@ -29,6 +29,10 @@
 
 #define MAX_BUS_CLK	(4)
 
+#ifdef CONFIG_MMC_SDHCI_S3C_ADMA
+static int use_adma = 1;
+#endif
+
 /**
  * struct sdhci_s3c - S3C SDHCI instance
  * @host: The SDHCI host created
@@ -435,6 +439,24 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	/* PIO currently has problems with multi-block IO */
 	host->quirks |= SDHCI_QUIRK_NO_MULTIBLOCK;
 
+#elif defined(CONFIG_MMC_SDHCI_S3C_ADMA)
+
+	/* The HSMMC block implements ADMA2 even where the capability
+	 * register does not say so. With a descriptor chain the whole
+	 * scatterlist goes to the controller in one go, so the block
+	 * layer does not have to bounce multi-segment requests through
+	 * a single contiguous buffer. Unaligned segment heads are fixed
+	 * up through the sdhci align buffer rather than falling back
+	 * to PIO. use_adma=0 keeps SDMA, to compare the two. */
+	if (use_adma)
+		host->quirks |= SDHCI_QUIRK_FORCE_ADMA;
+	else
+		host->quirks |= SDHCI_QUIRK_BROKEN_ADMA;
+
+#else
+
+	host->quirks |= SDHCI_QUIRK_BROKEN_ADMA;
+
 #endif /* CONFIG_MMC_SDHCI_S3C_DMA */
 
 	/* It seems we do not get an DATA transfer complete on non-busy
@@ -442,6 +464,7 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	 * SDHCI block, or a missing configuration that needs to be set. */
 	host->quirks |= SDHCI_QUIRK_NO_BUSY_IRQ;
 
+	/* Only apply to SDMA; ADMA copes with unaligned segments. */
 	host->quirks |= (SDHCI_QUIRK_32BIT_DMA_ADDR |
 			 SDHCI_QUIRK_32BIT_DMA_SIZE);
 
@@ -609,6 +632,11 @@ static void __exit sdhci_s3c_exit(void)
 module_init(sdhci_s3c_init);
 module_exit(sdhci_s3c_exit);
 
+#ifdef CONFIG_MMC_SDHCI_S3C_ADMA
+module_param(use_adma, bool, 0444);
+MODULE_PARM_DESC(use_adma, "Use ADMA2 rather than SDMA (default on).");
+#endif
+
 MODULE_DESCRIPTION("Samsung SDHCI (HSMMC) glue");
 MODULE_AUTHOR("Ben Dooks, <ben@simtec.co.uk>");
 MODULE_LICENSE("GPL v2");
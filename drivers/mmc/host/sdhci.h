@@ -244,6 +244,8 @@ struct sdhci_host {
 #define SDHCI_QUIRK_NO_HISPD_BIT			(1<<27)
 /* Controller has unreliable card present bit */
 #define SDHCI_QUIRK_BROKEN_CARD_PRESENT_BIT		(1<<28)
+/* Controller has bad caps bits, but really supports ADMA2 */
+#define SDHCI_QUIRK_FORCE_ADMA				(1<<29)
 
 	int			irq;		/* Device IRQ */
 	void __iomem *		ioaddr;		/* Mapped address */
@@ -52,6 +52,13 @@ struct bcmsdh_info
 	osl_t   *osh;
 	bool	regfail;	/* Save status of last reg_read/reg_write call */
 	uint32	sbwad;		/* Save backplane window address */
+#ifdef BCMSDH_LOOPBACK
+	bool	nochip;		/* No device: every access is answered here */
+	bool	loopback;	/* F2 data looped back in host memory */
+	void	*lb_head;	/* Frames written on F2 not yet read, oldest first */
+	void	*lb_tail;
+	uint	lb_off;		/* Bytes of lb_head already read */
+#endif /* BCMSDH_LOOPBACK */
 };
 /* local copy of bcm sd handler */
 bcmsdh_info_t * l_bcmsdh = NULL;
@@ -96,12 +103,52 @@ bcmsdh_attach(osl_t *osh, void *cfghdl, void **regsva, uint irq)
 	return bcmsdh;
 }
 
+#ifdef BCMSDH_LOOPBACK
+/* A handle with no SD host or device behind it, for host-side benchmarks
+ * on a board without the chip.  Register and CIS reads return zeros, apart
+ * from the chip clock CSR, which reports the clocks available; writes are
+ * dropped.  F2 data goes through the loopback queue when it is enabled,
+ * and is otherwise dropped on writes and zeros on reads.
+ */
+bcmsdh_info_t *
+bcmsdh_attach_nochip(osl_t *osh, void **regsva)
+{
+	bcmsdh_info_t *bcmsdh;
+
+	if ((bcmsdh = (bcmsdh_info_t *)MALLOC(osh, sizeof(bcmsdh_info_t))) == NULL) {
+		BCMSDH_ERROR(("bcmsdh_attach_nochip: out of memory, malloced %d bytes\n",
+		              MALLOCED(osh)));
+		return NULL;
+	}
+	bzero((char *)bcmsdh, sizeof(bcmsdh_info_t));
+
+	l_bcmsdh = bcmsdh;
+
+	bcmsdh->osh = osh;
+	bcmsdh->nochip = TRUE;
+	bcmsdh->init_success = TRUE;
+
+	*regsva = (uint32 *)SI_ENUM_BASE;
+	bcmsdh->sbwad = SI_ENUM_BASE;
+	return bcmsdh;
+}
+
+bool
+bcmsdh_nochip(void *sdh)
+{
+	return ((bcmsdh_info_t *)sdh)->nochip;
+}
+#endif /* BCMSDH_LOOPBACK */
+
 int
 bcmsdh_detach(osl_t *osh, void *sdh)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
 	if (bcmsdh != NULL) {
+#ifdef BCMSDH_LOOPBACK
+		bcmsdh_loopback(bcmsdh, FALSE);
+#endif /* BCMSDH_LOOPBACK */
 		if (bcmsdh->sdioh) {
 			sdioh_detach(osh, bcmsdh->sdioh);
 			bcmsdh->sdioh = NULL;
@@ -118,6 +165,10 @@ bcmsdh_iovar_op(void *sdh, const char *name,
                 void *params, int plen, void *arg, int len, bool set)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return BCME_UNSUPPORTED;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_iovar_op(bcmsdh->sdioh, name, params, plen, arg, len, set);
 }
 
@@ -129,6 +180,10 @@ bcmsdh_intr_query(void *sdh)
 	bool on;
 
 	ASSERT(bcmsdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return FALSE;
+#endif /* BCMSDH_LOOPBACK */
 	status = sdioh_interrupt_query(bcmsdh->sdioh, &on);
 	if (SDIOH_API_SUCCESS(status))
 		return FALSE;
@@ -142,6 +197,10 @@ bcmsdh_intr_enable(void *sdh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 	SDIOH_API_RC status;
 	ASSERT(bcmsdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 
 	status = sdioh_interrupt_set(bcmsdh->sdioh, TRUE);
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
@@ -153,6 +212,10 @@ bcmsdh_intr_disable(void *sdh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 	SDIOH_API_RC status;
 	ASSERT(bcmsdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 
 	status = sdioh_interrupt_set(bcmsdh->sdioh, FALSE);
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
@@ -164,6 +227,10 @@ bcmsdh_intr_reg(void *sdh, bcmsdh_cb_fn_t fn, void *argh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 	SDIOH_API_RC status;
 	ASSERT(bcmsdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 
 	status = sdioh_interrupt_register(bcmsdh->sdioh, fn, argh);
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
@@ -175,6 +242,10 @@ bcmsdh_intr_dereg(void *sdh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 	SDIOH_API_RC status;
 	ASSERT(bcmsdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 
 	status = sdioh_interrupt_deregister(bcmsdh->sdioh);
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
@@ -187,6 +258,10 @@ bcmsdh_intr_pending(void *sdh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
 	ASSERT(sdh);
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return FALSE;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_interrupt_pending(bcmsdh->sdioh);
 }
 #endif
@@ -216,6 +291,16 @@ bcmsdh_cfg_read(void *sdh, uint fnc_num, uint32 addr, int *err)
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		if (err)
+			*err = 0;
+		if (fnc_num == SDIO_FUNC_1 && addr == SBSDIO_FUNC1_CHIPCLKCSR)
+			return (SBSDIO_ALP_AVAIL | SBSDIO_HT_AVAIL);
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 #ifdef SDIOH_API_ACCESS_RETRY_LIMIT
 	do {
 		if (retry)	/* wait for 1 ms till bus get settled down */
@@ -248,6 +333,14 @@ bcmsdh_cfg_write(void *sdh, uint fnc_num, uint32 addr, uint8 data, int *err)
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		if (err)
+			*err = 0;
+		return;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 #ifdef SDIOH_API_ACCESS_RETRY_LIMIT
 	do {
 		if (retry)	/* wait for 1 ms till bus get settled down */
@@ -276,6 +369,14 @@ bcmsdh_cfg_read_word(void *sdh, uint fnc_num, uint32 addr, int *err)
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		if (err)
+			*err = 0;
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	status = sdioh_request_word(bcmsdh->sdioh, SDIOH_CMD_TYPE_NORMAL, SDIOH_READ, fnc_num,
 	                            addr, &data, 4);
 
@@ -299,6 +400,14 @@ bcmsdh_cfg_write_word(void *sdh, uint fnc_num, uint32 addr, uint32 data, int *er
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		if (err)
+			*err = 0;
+		return;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	status = sdioh_request_word(bcmsdh->sdioh, SDIOH_CMD_TYPE_NORMAL, SDIOH_WRITE, fnc_num,
 	                            addr, &data, 4);
 
@@ -328,6 +437,13 @@ bcmsdh_cis_read(void *sdh, uint func, uint8 *cis, uint length)
 	ASSERT(cis);
 	ASSERT(length <= SBSDIO_CIS_SIZE_LIMIT);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		bzero(cis, length);
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	status = sdioh_cis_read(bcmsdh->sdioh, func, cis, length);
 
 	if (ascii) {
@@ -382,6 +498,13 @@ bcmsdh_reg_read(void *sdh, uint32 addr, uint size)
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		bcmsdh->regfail = FALSE;
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	if (bar0 != bcmsdh->sbwad) {
 		if (bcmsdhsdio_set_sbaddr_window(bcmsdh, bar0))
 			return 0xFFFFFFFF;
@@ -436,6 +559,13 @@ bcmsdh_reg_write(void *sdh, uint32 addr, uint size, uint32 data)
 
 	ASSERT(bcmsdh->init_success);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		bcmsdh->regfail = FALSE;
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	if (bar0 != bcmsdh->sbwad) {
 		if ((err = bcmsdhsdio_set_sbaddr_window(bcmsdh, bar0)))
 			return err;
@@ -464,6 +594,114 @@ bcmsdh_regfail(void *sdh)
 	return ((bcmsdh_info_t *)sdh)->regfail;
 }
 
+#ifdef BCMSDH_LOOPBACK
+void
+bcmsdh_loopback(void *sdh, bool enable)
+{
+	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
+
+	if (!enable && bcmsdh->lb_head) {
+		PKTFREE(bcmsdh->osh, bcmsdh->lb_head, FALSE);
+		bcmsdh->lb_head = bcmsdh->lb_tail = NULL;
+		bcmsdh->lb_off = 0;
+	}
+	bcmsdh->loopback = enable;
+}
+
+bool
+bcmsdh_loopback_pending(void *sdh)
+{
+	return (((bcmsdh_info_t *)sdh)->lb_head != NULL);
+}
+
+static int
+bcmsdh_loopback_queue(bcmsdh_info_t *bcmsdh, uint8 *buf, uint nbytes, void *pkt)
+{
+	void *p;
+
+	if ((p = PKTGET(bcmsdh->osh, nbytes, TRUE)) == NULL)
+		return BCME_NOMEM;
+	if (pkt)
+		pktcopy(bcmsdh->osh, pkt, 0, nbytes, PKTDATA(bcmsdh->osh, p));
+	else
+		bcopy(buf, PKTDATA(bcmsdh->osh, p), nbytes);
+
+	if (bcmsdh->lb_tail)
+		PKTSETNEXT(bcmsdh->osh, bcmsdh->lb_tail, p);
+	else
+		bcmsdh->lb_head = p;
+	bcmsdh->lb_tail = p;
+
+	return 0;
+}
+
+static int
+bcmsdh_loopback_write(bcmsdh_info_t *bcmsdh, uint8 *buf, uint nbytes, void *pkt)
+{
+	uint len, next;
+	int err;
+
+	/* A chain is written as it is sent, one packet after the other */
+	if (pkt && PKTNEXT(bcmsdh->osh, pkt))
+		return bcmsdh_loopback_queue(bcmsdh, NULL, pkttotlen(bcmsdh->osh, pkt), pkt);
+
+	/* Like the dongle, split a write into frames at their hardware tags
+	 * (length, then its complement); padding stays with the last frame.
+	 */
+	for (; nbytes; buf += len, nbytes -= len) {
+		len = nbytes;
+		next = ltoh16_ua(buf);
+		if ((next >= 4) && ((next + 4) <= nbytes) && ltoh16_ua(buf + next) &&
+		    ((ltoh16_ua(buf + next) ^ ltoh16_ua(buf + next + 2)) == 0xffff))
+			len = next;
+		if ((err = bcmsdh_loopback_queue(bcmsdh, buf, len, NULL)))
+			return err;
+	}
+
+	return 0;
+}
+
+/* Like the F2 fifo: a read returns the rest of the current frame followed by
+ * padding, and reaching the end of a frame moves on to the next one.
+ */
+static int
+bcmsdh_loopback_read(bcmsdh_info_t *bcmsdh, uint8 *buf, uint nbytes, void *pkt)
+{
+	osl_t *osh = bcmsdh->osh;
+	void *p = bcmsdh->lb_head;
+	uint8 *src = NULL;
+	uint n = 0;
+
+	if (!nbytes)
+		return 0;
+
+	if (p) {
+		src = (uint8 *)PKTDATA(osh, p) + bcmsdh->lb_off;
+		n = MIN(nbytes, PKTLEN(osh, p) - bcmsdh->lb_off);
+	}
+
+	if (pkt && PKTNEXT(osh, pkt)) {
+		if (n)
+			pktfrombuf(osh, pkt, 0, n, src);
+	} else {
+		if (n)
+			bcopy(src, buf, n);
+		bzero(buf + n, nbytes - n);
+	}
+
+	if (p && ((bcmsdh->lb_off += n) >= PKTLEN(osh, p))) {
+		bcmsdh->lb_head = PKTNEXT(osh, p);
+		if (!bcmsdh->lb_head)
+			bcmsdh->lb_tail = NULL;
+		PKTSETNEXT(osh, p, NULL);
+		PKTFREE(osh, p, FALSE);
+		bcmsdh->lb_off = 0;
+	}
+
+	return 0;
+}
+#endif /* BCMSDH_LOOPBACK */
+
 int
 bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
                 uint8 *buf, uint nbytes, void *pkt,
@@ -482,6 +720,16 @@ bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	BCMSDH_INFO(("%s:fun = %d, addr = 0x%x, size = %d\n",
 	             __FUNCTION__, fn, addr, nbytes));
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->loopback && (fn == SDIO_FUNC_2))
+		return bcmsdh_loopback_read(bcmsdh, buf, nbytes, pkt);
+	if (bcmsdh->nochip) {
+		if (!pkt || !PKTNEXT(bcmsdh->osh, pkt))
+			bzero(buf, nbytes);
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	/* Async not implemented yet */
 	ASSERT(!(flags & SDIO_REQ_ASYNC));
 	if (flags & SDIO_REQ_ASYNC)
@@ -501,8 +749,9 @@ bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	if (width == 4)
 		addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
-	status = sdioh_request_buffer(bcmsdh->sdioh, SDIOH_DATA_PIO, incr_fix,
-	                              SDIOH_READ, fn, addr, width, nbytes, buf, pkt);
+	status = sdioh_request_buffer(bcmsdh->sdioh,
+	                              (flags & SDIO_REQ_DMABUF) ? SDIOH_DATA_DMA : SDIOH_DATA_PIO,
+	                              incr_fix, SDIOH_READ, fn, addr, width, nbytes, buf, pkt);
 
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_SDIO_ERROR);
 }
@@ -525,6 +774,13 @@ bcmsdh_send_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	BCMSDH_INFO(("%s:fun = %d, addr = 0x%x, size = %d\n",
 	            __FUNCTION__, fn, addr, nbytes));
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->loopback && (fn == SDIO_FUNC_2))
+		return bcmsdh_loopback_write(bcmsdh, buf, nbytes, pkt);
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
+
 	/* Async not implemented yet */
 	ASSERT(!(flags & SDIO_REQ_ASYNC));
 	if (flags & SDIO_REQ_ASYNC)
@@ -544,8 +800,9 @@ bcmsdh_send_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	if (width == 4)
 		addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
-	status = sdioh_request_buffer(bcmsdh->sdioh, SDIOH_DATA_PIO, incr_fix,
-	                              SDIOH_WRITE, fn, addr, width, nbytes, buf, pkt);
+	status = sdioh_request_buffer(bcmsdh->sdioh,
+	                              (flags & SDIO_REQ_DMABUF) ? SDIOH_DATA_DMA : SDIOH_DATA_PIO,
+	                              incr_fix, SDIOH_WRITE, fn, addr, width, nbytes, buf, pkt);
 
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
 }
@@ -560,6 +817,14 @@ bcmsdh_rwdata(void *sdh, uint rw, uint32 addr, uint8 *buf, uint nbytes)
 	ASSERT(bcmsdh->init_success);
 	ASSERT((addr & SBSDIO_SBWINDOW_MASK) == 0);
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip) {
+		if (!rw)
+			bzero(buf, nbytes);
+		return 0;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	addr &= SBSDIO_SB_OFT_ADDR_MASK;
 	addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
@@ -575,6 +840,10 @@ bcmsdh_abort(void *sdh, uint fn)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_abort(bcmsdh->sdioh, fn);
 }
 
@@ -583,6 +852,10 @@ bcmsdh_start(void *sdh, int stage)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_start(bcmsdh->sdioh, stage);
 }
 
@@ -591,6 +864,10 @@ bcmsdh_stop(void *sdh)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_stop(bcmsdh->sdioh);
 }
 
@@ -611,6 +888,10 @@ bcmsdh_query_iofnum(void *sdh)
 	if (!bcmsdh)
 		bcmsdh = l_bcmsdh;
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 2;
+#endif /* BCMSDH_LOOPBACK */
 	return (sdioh_query_iofnum(bcmsdh->sdioh));
 }
 
@@ -619,6 +900,10 @@ bcmsdh_reset(bcmsdh_info_t *sdh)
 {
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
+#ifdef BCMSDH_LOOPBACK
+	if (bcmsdh->nochip)
+		return 0;
+#endif /* BCMSDH_LOOPBACK */
 	return sdioh_sdio_reset(bcmsdh->sdioh);
 }
 
@@ -886,12 +886,60 @@ sdioh_request_word(sdioh_info_t *sd, uint cmd_type, uint rw, uint func, uint add
 	return ((err_ret == 0) ? SDIOH_API_RC_SUCCESS : SDIOH_API_RC_FAIL);
 }
 
+/* Length of a CMD53 transfer of len bytes: the hosts want whole words */
+static uint
+sdioh_xfer_len(uint len)
+{
+	len += 3;
+	len &= 0xFFFFFFFC;
+
+#ifdef CONFIG_MMC_MSM7X00A
+	if ((len % 64) == 32) {
+		sd_trace(("%s: Rounding up TX packet +=32\n", __FUNCTION__));
+		len += 32;
+	}
+#endif /* CONFIG_MMC_MSM7X00A */
+
+	return len;
+}
+
+/* One CMD53 transfer at buf, len from sdioh_xfer_len().  The caller holds
+ * the host and has made buf DMA-able and aligned.
+ */
+static int
+sdioh_buffer_xfer(sdioh_info_t *sd, bool fifo, uint write, uint func,
+                  uint addr, uint8 *buf, uint len)
+{
+	int err_ret;
+
+	ASSERT(((uint32)buf & DMA_ALIGN_MASK) == 0);
+
+	if ((write) && (!fifo)) {
+		err_ret = sdio_memcpy_toio(gInstance->func[func], addr, buf, len);
+	} else if (write) {
+		err_ret = sdio_memcpy_toio(gInstance->func[func], addr, buf, len);
+	} else if (fifo) {
+		err_ret = sdio_readsb(gInstance->func[func], buf, addr, len);
+	} else {
+		err_ret = sdio_memcpy_fromio(gInstance->func[func], buf, addr, len);
+	}
+
+	if (err_ret) {
+		sd_err(("%s: %s FAILED %p, addr=0x%05x, len=%d, ERR=0x%08x\n",
+			__FUNCTION__, (write) ? "TX" : "RX", buf, addr, len, err_ret));
+	} else {
+		sd_trace(("%s: %s xfr'd %p, addr=0x%05x, len=%d\n",
+			__FUNCTION__, (write) ? "TX" : "RX", buf, addr, len));
+	}
+
+	return err_ret;
+}
+
 static SDIOH_API_RC
 sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
                      uint addr, void *pkt)
 {
 	bool fifo = (fix_inc == SDIOH_DATA_FIX);
-	uint32	SGCount = 0;
 	int err_ret = 0;
 
 	void *pnext;
@@ -905,59 +953,18 @@ sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
 	/* Claim host controller */
 	sdio_claim_host(gInstance->func[func]);
 	for (pnext = pkt; pnext; pnext = PKTNEXT(sd->osh, pnext)) {
-		uint pkt_len = PKTLEN(sd->osh, pnext);
-		pkt_len += 3;
-		pkt_len &= 0xFFFFFFFC;
+		uint pkt_len = sdioh_xfer_len(PKTLEN(sd->osh, pnext));
 
-#ifdef CONFIG_MMC_MSM7X00A
-		if ((pkt_len % 64) == 32) {
-			sd_trace(("%s: Rounding up TX packet +=32\n", __FUNCTION__));
-			pkt_len += 32;
-		}
-#endif /* CONFIG_MMC_MSM7X00A */
 		/* Make sure the packet is aligned properly. If it isn't, then this
 		 * is the fault of sdioh_request_buffer() which is supposed to give
 		 * us something we can work with.
 		 */
-		ASSERT(((uint32)(PKTDATA(sd->osh, pkt)) & DMA_ALIGN_MASK) == 0);
-
-		if ((write) && (!fifo)) {
-			err_ret = sdio_memcpy_toio(gInstance->func[func], addr,
-				((uint8*)PKTDATA(sd->osh, pnext)),
-				pkt_len);
-		} else if (write) {
-			err_ret = sdio_memcpy_toio(gInstance->func[func], addr,
-				((uint8*)PKTDATA(sd->osh, pnext)),
-				pkt_len);
-		} else if (fifo) {
-			err_ret = sdio_readsb(gInstance->func[func],
-				((uint8*)PKTDATA(sd->osh, pnext)),
-				addr,
-				pkt_len);
-		} else {
-			err_ret = sdio_memcpy_fromio(gInstance->func[func],
-				((uint8*)PKTDATA(sd->osh, pnext)),
-				addr,
-				pkt_len);
-		}
-
-		if (err_ret) {
-			sd_err(("%s: %s FAILED %p[%d], addr=0x%05x, pkt_len=%d, ERR=0x%08x\n",
-				__FUNCTION__,
-				(write) ? "TX" : "RX",
-				pnext, SGCount, addr, pkt_len, err_ret));
-		} else {
-			sd_trace(("%s: %s xfr'd %p[%d], addr=0x%05x, len=%d\n",
-				__FUNCTION__,
-				(write) ? "TX" : "RX",
-				pnext, SGCount, addr, pkt_len));
-		}
+		err_ret = sdioh_buffer_xfer(sd, fifo, write, func, addr,
+		                            (uint8*)PKTDATA(sd->osh, pnext), pkt_len);
 
 		if (!fifo) {
 			addr += pkt_len;
 		}
-		SGCount ++;
-
 	}
 
 	/* Release host controller */
@@ -978,6 +985,9 @@ sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
  * aligned, then there may only be one packet, and in this case, it is copied to a new
  * aligned packet.
  *
+ * A buffer passed for DMA (SDIOH_DATA_DMA) is DMA-able, aligned and has the word
+ * round-up behind it, and is transferred where it is.
+ *
  */
 extern SDIOH_API_RC
 sdioh_request_buffer(sdioh_info_t *sd, uint pio_dma, uint fix_inc, uint write, uint func,
@@ -990,8 +1000,17 @@ sdioh_request_buffer(sdioh_info_t *sd, uint pio_dma, uint fix_inc, uint write, u
 
 	DHD_PM_RESUME_WAIT(sdioh_request_buffer_wait);
 	DHD_PM_RESUME_RETURN_ERROR(SDIOH_API_RC_FAIL);
-	/* Case 1: we don't have a packet. */
-	if (pkt == NULL) {
+	/* Case 0: a buffer the caller set up for DMA. */
+	if ((pkt == NULL) && (pio_dma == SDIOH_DATA_DMA)) {
+		sd_data(("%s: DMA %s buffer, len=%d\n",
+		         __FUNCTION__, write ? "TX" : "RX", buflen_u));
+		sdio_claim_host(gInstance->func[func]);
+		Status = sdioh_buffer_xfer(sd, (fix_inc == SDIOH_DATA_FIX), write, func, addr,
+		                           buffer, sdioh_xfer_len(buflen_u)) ?
+		        SDIOH_API_RC_FAIL : SDIOH_API_RC_SUCCESS;
+		sdio_release_host(gInstance->func[func]);
+	} else if (pkt == NULL) {
+		/* Case 1: we don't have a packet. */
 		sd_data(("%s: Creating new %s Packet, len=%d\n",
 		         __FUNCTION__, write ? "TX" : "RX", buflen_u));
 #ifdef DHD_USE_STATIC_BUF
@@ -356,6 +356,9 @@ extern bool dhd_prec_enq(dhd_pub_t *dhdp, struct pktq *q, void *pkt, int prec);
 /* Receive frame for delivery to OS.  Callee disposes of rxp. */
 extern void dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *rxp, int numpkt);
 
+/* Hand frames queued by dhd_rx_frame() to the OS.  Call without the sdlock. */
+extern void dhd_rx_flush(dhd_pub_t *dhdp);
+
 /* Return pointer to interface name */
 extern char *dhd_ifname(dhd_pub_t *dhdp, int idx);
 
@@ -509,6 +512,11 @@ extern uint dhd_pktgen_len;
 #define MAX_PKTGEN_LEN 1800
 #endif
 
+#ifdef BCMSDH_LOOPBACK
+/* Bring the bus up on a fake device instead of waiting for the chip */
+extern uint dhd_loopback;
+#endif /* BCMSDH_LOOPBACK */
+
 
 /* optionally set by a module_param_string() */
 #define MOD_PARAM_PATHLEN	2048
@@ -241,6 +241,12 @@ typedef struct dhd_if {
 } dhd_if_t;
 
 /* Local private structure (extension of pub) */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 29))
+#define DHD_RX_NAPI
+#define DHD_NAPI_WEIGHT	64	/* Frames handed to GRO per poll */
+#define DHD_NAPI_QLEN	1000	/* Frames queued for the poll before dropping */
+#endif
+
 typedef struct dhd_info {
 #if defined(CONFIG_WIRELESS_EXT)
 	wl_iw_t		iw;		/* wireless extensions state (must be first) */
@@ -283,6 +289,12 @@ typedef struct dhd_info {
 	wait_queue_head_t ctrl_wait;
 	atomic_t pend_8021x_cnt;
 
+#ifdef DHD_RX_NAPI
+	/* Received frames are queued by the DPC and fed to GRO from NAPI poll */
+	struct napi_struct napi;
+	struct sk_buff_head rxq;
+#endif /* DHD_RX_NAPI */
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
 #endif /* CONFIG_HAS_EARLYSUSPEND */
@@ -417,12 +429,28 @@ extern uint dhd_rxbound;
 module_param(dhd_txbound, uint, 0);
 module_param(dhd_rxbound, uint, 0);
 
+/* Tx superframe (glom) size, 0 or 1 disables; off until dongle firmware is known to take them */
+extern uint dhd_txglom;
+module_param(dhd_txglom, uint, 0);
+
 /* Deferred transmits */
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
 
+#ifdef DHD_RX_NAPI
+/* Deliver received frames through NAPI and GRO rather than netif_rx */
+uint dhd_rx_napi = TRUE;
+module_param(dhd_rx_napi, uint, 0);
+#endif /* DHD_RX_NAPI */
+
 
 
+#ifdef BCMSDH_LOOPBACK
+/* Bring the bus up on a fake device, for "rxbench" on a board without the chip */
+uint dhd_loopback = FALSE;
+module_param(dhd_loopback, uint, 0);
+#endif /* BCMSDH_LOOPBACK */
+
 #ifdef SDTEST
 /* Echo packet generator (pkts/s) */
 uint dhd_pktgen = 0;
@@ -1269,7 +1297,15 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		skb_pull(skb, ETH_HLEN);
 
 		/* Process special event packets and then discard them */
-		if (ntoh16(skb->protocol) == ETHER_TYPE_BRCM)
+		if (ntoh16(skb->protocol) == ETHER_TYPE_BRCM) {
+			/* Subframes from the rx pool only have their headers
+			 * in the skb head; the event parser walks it linearly.
+			 */
+			if (skb_linearize(skb)) {
+				dhdp->rx_dropped++;
+				dev_kfree_skb_any(skb);
+				continue;
+			}
 			dhd_wl_host_event(dhd, &ifidx,
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
 			skb->mac_header,
@@ -1278,6 +1314,7 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 #endif
 			&event,
 			&data);
+		}
 
 		ASSERT(ifidx < DHD_MAX_IFS && dhd->iflist[ifidx]);
 		if (dhd->iflist[ifidx] && !dhd->iflist[ifidx]->state)
@@ -1289,6 +1326,19 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
+#ifdef DHD_RX_NAPI
+		/* Queue for the poll; dhd_rx_flush() hands the batch to the stack */
+		if (dhd_rx_napi) {
+			if (skb_queue_len(&dhd->rxq) < DHD_NAPI_QLEN) {
+				skb_queue_tail(&dhd->rxq, skb);
+			} else {
+				dhdp->rx_dropped++;
+				dev_kfree_skb_any(skb);
+			}
+			continue;
+		}
+#endif /* DHD_RX_NAPI */
+
 		if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
@@ -1311,6 +1361,48 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 	}
 }
 
+void
+dhd_rx_flush(dhd_pub_t *dhdp)
+{
+#ifdef DHD_RX_NAPI
+	dhd_info_t *dhd = (dhd_info_t *)dhdp->info;
+
+	if (skb_queue_empty(&dhd->rxq))
+		return;
+
+	/* Outside of softirq context the poll has to be run explicitly,
+	 * local_bh_enable() does that once the NAPI is scheduled.
+	 */
+	local_bh_disable();
+	napi_schedule(&dhd->napi);
+	local_bh_enable();
+#endif /* DHD_RX_NAPI */
+}
+
+#ifdef DHD_RX_NAPI
+static int
+dhd_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while ((work < budget) && (skb = skb_dequeue(&dhd->rxq))) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* Pick up frames queued after the queue looked empty */
+		if (!skb_queue_empty(&dhd->rxq))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+#endif /* DHD_RX_NAPI */
+
 void
 dhd_event(struct dhd_info *dhd, char *evpkt, int evlen, int ifidx)
 {
@@ -2055,6 +2147,12 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25)) && 1
 	mutex_init(&dhd->wl_start_lock);
 #endif 
+#ifdef DHD_RX_NAPI
+	/* Received frames for all interfaces go through the primary's NAPI */
+	skb_queue_head_init(&dhd->rxq);
+	netif_napi_add(net, &dhd->napi, dhd_napi_poll, DHD_NAPI_WEIGHT);
+	napi_enable(&dhd->napi);
+#endif /* DHD_RX_NAPI */
 	/* Link to info module */
 	dhd->pub.info = dhd;
 
@@ -2515,6 +2613,14 @@ dhd_detach(dhd_pub_t *dhdp)
 				tasklet_kill(&dhd->tasklet);
 
 			dhd_bus_detach(dhdp);
+
+#ifdef DHD_RX_NAPI
+			if (dhd->napi.poll) {
+				napi_disable(&dhd->napi);
+				netif_napi_del(&dhd->napi);
+				skb_queue_purge(&dhd->rxq);
+			}
+#endif /* DHD_RX_NAPI */
 	
 			if (dhdp->prot)
 				dhd_prot_detach(dhdp);
@@ -87,9 +87,27 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define DHD_TXBUF_SZ	(4 * 1024)	/* Largest frame sent from the aligned tx buffer */
+
+#define DHD_TXGLOM_MAX	16	/* Max frames packed into one tx superframe */
+#define DHD_TXGLOM_BUFSZ (16 * 1024)	/* Max size of one tx superframe */
+#define DHD_TXGLOM_DESCLEN	ROUNDUP(SDPCM_HDRLEN + DHD_TXGLOM_MAX * sizeof(uint16), ALIGNMENT)
+
 #define MEMBLOCK	2048		/* Block size used for downloading of dongle image */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold biggest possible glom */
 
+#define DHD_RXPOOL_NUM	8	/* MAX_DATA_BUF sized superframe buffers in the rx pool */
+#define DHD_RXPOOL_HDRLEN 128	/* Bytes past the data offset copied into the skb head */
+
+#ifdef BCMSDH_LOOPBACK
+#define DHD_RXBENCH_GLOM	8	/* Default frames per superframe for rxbench */
+#define DHD_RXBENCH_GLOM_MAX	16
+#define DHD_NOCHIP_BLOCKSIZE	64	/* F2 block size assumed without a chip */
+#define DHD_NOCHIP(bus)		bcmsdh_nochip((bus)->sdh)
+#else
+#define DHD_NOCHIP(bus)		(FALSE)
+#endif /* BCMSDH_LOOPBACK */
+
 /* Packet alignment for most efficient SDIO (can change based on platform) */
 #ifndef DHD_SDALIGN
 #define DHD_SDALIGN	32
@@ -214,6 +232,10 @@ typedef struct dhd_bus {
 	uint8		*rxctl;			/* Aligned pointer into rxbuf */
 	uint8		*databuf;		/* Buffer for receiving big glom packet */
 	uint8		*dataptr;		/* Aligned pointer into databuf */
+	uint8		*txbuf;			/* Buffer for sending unaligned frames */
+	uint8		*txptr;			/* Aligned pointer into txbuf */
+	uint8		*txglombuf;		/* Buffer for building tx superframes */
+	uint8		*txglomptr;		/* Aligned pointer into txglombuf */
 	uint		rxlen;			/* Length of valid data in buffer */
 
 	uint8		sdpcm_ver;		/* Bus protocol reported by dongle */
@@ -245,6 +267,8 @@ typedef struct dhd_bus {
 	int32		sd_mode;		/* Mode control to bus driver */
 	int32		sd_rxchain;		/* If bcmsdh api accepts PKT chains */
 	bool		use_rxchain;		/* If dhd should use PKT chains */
+	bool		rxpool;			/* Rx buffer pool allocated */
+	bool		use_rxpool;		/* Read superframes into the rx pool */
 	bool		sleeping;		/* Is SDIO bus sleeping? */
 	bool		rxflow_mode;	/* Rx flow control mode */
 	bool		rxflow;			/* Is rx flow control on */
@@ -292,6 +316,15 @@ typedef struct dhd_bus {
 	uint		rxglomfail;		/* Failed deglom attempts */
 	uint		rxglomframes;		/* Number of glom frames (superframes) */
 	uint		rxglompkts;		/* Number of packets from glom frames */
+	uint		rxglompool;		/* Number of glom frames read into the rx pool */
+	uint		txglomfail;		/* Failed tx superframe writes */
+	uint		txglomframes;		/* Number of tx superframes sent */
+	uint		txglompkts;		/* Number of packets sent in superframes */
+#ifdef BCMSDH_LOOPBACK
+	uint		rxbench_glom;		/* Frames per superframe for rxbench */
+	uint		rxbench_ms;		/* Duration of the last rxbench run */
+	struct si_pub	nochip_sih;		/* Chip info reported without a chip */
+#endif /* BCMSDH_LOOPBACK */
 	uint		f2rxhdrs;		/* Number of header reads */
 	uint		f2rxdata;		/* Number of frame data reads */
 	uint		f2txdata;		/* Number of f2 frame writes */
@@ -326,6 +359,9 @@ uint dhd_txbound;
 uint dhd_rxbound;
 uint dhd_txminmax;
 
+/* Max frames per tx superframe (0 or 1: one frame per F2 write) */
+uint dhd_txglom;
+
 /* override the RAM size if possible */
 #define DONGLE_MIN_MEMSIZE (128 *1024)
 int dhd_dongle_memsize;
@@ -373,6 +409,9 @@ extern void bcmsdh_enable_hw_oob_intr(void *sdh, bool enable);
 /* Limit on rounding up frames */
 static const uint max_roundup = 512;
 
+#define TXBUF_LEN	(DHD_TXBUF_SZ + max_roundup + DHD_SDALIGN)
+#define TXGLOMBUF_LEN	(DHD_TXGLOM_DESCLEN + DHD_TXGLOM_BUFSZ + max_roundup + 3 * DHD_SDALIGN)
+
 /* Try doing readahead */
 static bool dhd_readahead;
 
@@ -442,6 +481,11 @@ static bool dhdsdio_chipmatch(uint16 chipid);
 static bool dhdsdio_probe_attach(dhd_bus_t *bus, osl_t *osh, void *sdh,
                                  void * regsva, uint16  devid);
 static bool dhdsdio_probe_malloc(dhd_bus_t *bus, osl_t *osh, void *sdh);
+#ifdef BCMSDH_LOOPBACK
+static int dhdsdio_rxbench(dhd_bus_t *bus, uint count);
+static void dhdsdio_nochip_attach(dhd_bus_t *bus);
+static int dhdsdio_nochip_start(dhd_bus_t *bus);
+#endif /* BCMSDH_LOOPBACK */
 static bool dhdsdio_probe_init(dhd_bus_t *bus, osl_t *osh, void *sdh);
 static void dhdsdio_release_dongle(dhd_bus_t *bus, osl_t *osh);
 
@@ -905,6 +949,32 @@ dhd_enable_oob_intr(struct dhd_bus *bus, bool enable)
 	} while (0);
 
 
+/* Aborts a failed F2 write and waits for the dongle to drop the frame */
+static void
+dhdsdio_txfail(dhd_bus_t *bus)
+{
+	bcmsdh_info_t *sdh = bus->sdh;
+	uint8 hi, lo;
+	int i;
+
+	bus->tx_sderrs++;
+
+	bcmsdh_abort(sdh, SDIO_FUNC_2);
+	bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
+	                 SFC_WF_TERM, NULL);
+	bus->f1regdata++;
+
+	for (i = 0; i < 3; i++) {
+		hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
+		lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
+		bus->f1regdata += 2;
+		if ((hi == 0) && (lo == 0))
+			break;
+	}
+}
+
 /* Writes a HW/SW header into the packet and sends it. */
 /* Assumes: (a) header space already there, (b) caller holds lock */
 static int
@@ -918,7 +988,8 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 	uint retries = 0;
 	bcmsdh_info_t *sdh;
 	void *new;
-	int i;
+	void *sendpkt;
+	bool bounce = FALSE;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -932,30 +1003,38 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 
 	frame = (uint8*)PKTDATA(osh, pkt);
 
-	/* Add alignment padding, allocate new packet if needed */
+	/* Add alignment padding in the headroom; without enough headroom
+	 * the frame is sent from the aligned tx buffer instead, or copied
+	 * to a new packet if it does not fit there.
+	 */
 	if ((pad = ((uintptr)frame % DHD_SDALIGN))) {
 		if (PKTHEADROOM(osh, pkt) < pad) {
 			DHD_INFO(("%s: insufficient headroom %d for %d pad\n",
 			          __FUNCTION__, (int)PKTHEADROOM(osh, pkt), pad));
 			bus->dhd->tx_realloc++;
-			new = PKTGET(osh, (PKTLEN(osh, pkt) + DHD_SDALIGN), TRUE);
-			if (!new) {
-				DHD_ERROR(("%s: couldn't allocate new %d-byte packet\n",
-				           __FUNCTION__, PKTLEN(osh, pkt) + DHD_SDALIGN));
-				ret = BCME_NOMEM;
-				goto done;
-			}
+			if (PKTLEN(osh, pkt) <= DHD_TXBUF_SZ) {
+				bounce = TRUE;
+				pad = 0;
+			} else {
+				new = PKTGET(osh, (PKTLEN(osh, pkt) + DHD_SDALIGN), TRUE);
+				if (!new) {
+					DHD_ERROR(("%s: couldn't allocate new %d-byte packet\n",
+					           __FUNCTION__, PKTLEN(osh, pkt) + DHD_SDALIGN));
+					ret = BCME_NOMEM;
+					goto done;
+				}
 
-			PKTALIGN(osh, new, PKTLEN(osh, pkt), DHD_SDALIGN);
-			bcopy(PKTDATA(osh, pkt), PKTDATA(osh, new), PKTLEN(osh, pkt));
-			if (free_pkt)
-				PKTFREE(osh, pkt, TRUE);
-			/* free the pkt if canned one is not used */
-			free_pkt = TRUE;
-			pkt = new;
-			frame = (uint8*)PKTDATA(osh, pkt);
-			ASSERT(((uintptr)frame % DHD_SDALIGN) == 0);
-			pad = 0;
+				PKTALIGN(osh, new, PKTLEN(osh, pkt), DHD_SDALIGN);
+				bcopy(PKTDATA(osh, pkt), PKTDATA(osh, new), PKTLEN(osh, pkt));
+				if (free_pkt)
+					PKTFREE(osh, pkt, TRUE);
+				/* free the pkt if canned one is not used */
+				free_pkt = TRUE;
+				pkt = new;
+				frame = (uint8*)PKTDATA(osh, pkt);
+				ASSERT(((uintptr)frame % DHD_SDALIGN) == 0);
+				pad = 0;
+			}
 		} else {
 			PKTPUSH(osh, pkt, pad);
 			frame = (uint8*)PKTDATA(osh, pkt);
@@ -1012,9 +1091,18 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 #endif
 	}
 
+	sendpkt = pkt;
+	if (bounce) {
+		/* Zero the round-up tail rather than send stale bytes */
+		bcopy(frame, bus->txptr, PKTLEN(osh, pkt));
+		bzero(bus->txptr + PKTLEN(osh, pkt), len - PKTLEN(osh, pkt));
+		frame = bus->txptr;
+		sendpkt = NULL;
+	}
+
 	do {
 		ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
-		                      frame, len, pkt, NULL, NULL);
+		                      frame, len, sendpkt, NULL, NULL);
 		bus->f2txdata++;
 		ASSERT(ret != BCME_PENDING);
 
@@ -1022,24 +1110,7 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 			/* On failure, abort the command and terminate the frame */
 			DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
 			          __FUNCTION__, ret));
-			bus->tx_sderrs++;
-
-			bcmsdh_abort(sdh, SDIO_FUNC_2);
-			bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
-			                 SFC_WF_TERM, NULL);
-			bus->f1regdata++;
-
-			for (i = 0; i < 3; i++) {
-				uint8 hi, lo;
-				hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
-				lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
-				bus->f1regdata += 2;
-				if ((hi == 0) && (lo == 0))
-					break;
-			}
-
+			dhdsdio_txfail(bus);
 		}
 		if (ret == 0) {
 			bus->tx_seq = (bus->tx_seq + 1) % SDPCM_SEQUENCE_WRAP;
@@ -1158,6 +1229,202 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	return ret;
 }
 
+/* The superframe buffer is only allocated once glomming is turned on */
+static int
+dhdsdio_txglom_attach(dhd_bus_t *bus)
+{
+	if (bus->txglombuf)
+		return BCME_OK;
+
+	if (!(bus->txglombuf = MALLOC(bus->dhd->osh, TXGLOMBUF_LEN))) {
+		DHD_ERROR(("%s: MALLOC of %d-byte txglombuf failed\n",
+		           __FUNCTION__, (int)TXGLOMBUF_LEN));
+		return BCME_NOMEM;
+	}
+	bus->txglomptr = (uint8 *)ROUNDUP((uintptr)bus->txglombuf, DHD_SDALIGN);
+
+	return BCME_OK;
+}
+
+/* Sends up to maxframes queued data frames as one superframe, laid out the
+ * way dhdsdio_rxglom() takes one apart: a descriptor frame on the glom
+ * channel listing the subframe lengths, then the superframe, a glom channel
+ * header followed by the subframes.  Each subframe carries its own hardware
+ * and software header and is zero-padded at the tail to DHD_SDALIGN.  The
+ * next-length field of each subframe holds the length of the one after it
+ * and is zero on the last.  The first length in the descriptor includes the
+ * superframe header; block round-up goes on the end of the last subframe
+ * without being counted anywhere.
+ *
+ * The descriptor and the superframe are copied back to back into txglombuf,
+ * which is sent where it is in a single F2 write: one CMD53 once the block
+ * round-up applies, instead of one for the descriptor and one per frame.
+ * A frame too long for the next-length field or the buffer ends the
+ * superframe and is left for dhdsdio_txpkt(), as is a lone frame.  The
+ * descriptor and every subframe take a sequence number, so the superframe
+ * is also bounded by the dongle's credit.
+ * Returns the number of frames taken off the queue, all of them completed.
+ */
+static uint
+dhdsdio_txglom(dhd_bus_t *bus, uint maxframes, uint8 tx_prec_map)
+{
+	osl_t *osh = bus->dhd->osh;
+	bcmsdh_info_t *sdh = bus->sdh;
+	void *pkts[DHD_TXGLOM_MAX];
+	uint16 lens[DHD_TXGLOM_MAX];
+	uint8 *frame;
+	uint npkts, credit, hdrlen, datalen, len, pad, i;
+	uint16 sublen, totlen, desclen;
+	uint32 swheader;
+	void *pkt;
+	int ret, prec_out;
+
+	if (!bus->txglomptr)
+		return 0;
+
+	credit = (uint8)(bus->tx_max - bus->tx_seq);
+	if ((credit & 0x80) || (credit < 3))
+		return 0;
+	maxframes = MIN(maxframes, MIN(credit - 1, MIN(dhd_txglom, DHD_TXGLOM_MAX)));
+	if (maxframes < 2)
+		return 0;
+
+	/* Take frames while they fit */
+	totlen = 0;
+	for (npkts = 0; npkts < maxframes; npkts++) {
+		dhd_os_sdlock_txq(bus->dhd);
+		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+			dhd_os_sdunlock_txq(bus->dhd);
+			break;
+		}
+
+		/* Next-length is in 16-byte units, which limits the subframe size */
+		hdrlen = npkts ? 0 : SDPCM_HDRLEN;
+		sublen = (uint16)ROUNDUP(PKTLEN(osh, pkt), DHD_SDALIGN);
+		if ((sublen > (0xff << 4)) || ((totlen + hdrlen + sublen) > DHD_TXGLOM_BUFSZ)) {
+			pktq_penq_head(&bus->txq, prec_out, pkt);
+			dhd_os_sdunlock_txq(bus->dhd);
+			break;
+		}
+		dhd_os_sdunlock_txq(bus->dhd);
+
+		pkts[npkts] = pkt;
+		lens[npkts] = (uint16)(hdrlen + sublen);
+		totlen += lens[npkts];
+	}
+
+	if (npkts == 0)
+		return 0;
+
+	if (npkts == 1) {
+		datalen = PKTLEN(osh, pkts[0]) - SDPCM_HDRLEN;
+		if (dhdsdio_txpkt(bus, pkts[0], SDPCM_DATA_CHANNEL, TRUE))
+			bus->dhd->tx_errors++;
+		else
+			bus->dhd->dstats.tx_bytes += datalen;
+		return 1;
+	}
+
+	/* Descriptor */
+	frame = bus->txglomptr;
+	desclen = (uint16)(SDPCM_HDRLEN + npkts * sizeof(uint16));
+	*(uint16*)frame = htol16(desclen);
+	*(((uint16*)frame) + 1) = htol16(~desclen);
+	swheader = ((SDPCM_GLOM_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) |
+	        SDPCM_GLOMDESC_FLAG | bus->tx_seq |
+	        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
+	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+	for (i = 0; i < npkts; i++)
+		htol16_ua_store(lens[i], frame + SDPCM_HDRLEN + i * sizeof(uint16));
+
+	/* Superframe header right behind it */
+	frame += desclen;
+	*(uint16*)frame = htol16(totlen);
+	*(((uint16*)frame) + 1) = htol16(~totlen);
+	swheader = ((SDPCM_GLOM_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) |
+	        ((bus->tx_seq + 1) & SDPCM_SEQUENCE_MASK) |
+	        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
+	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+	frame += SDPCM_HDRLEN;
+
+	/* Subframes, each over the header space reserved in front of its data */
+	for (i = 0; i < npkts; i++) {
+		pkt = pkts[i];
+		len = PKTLEN(osh, pkt);
+		sublen = (uint16)(lens[i] - (i ? 0 : SDPCM_HDRLEN));
+
+		bcopy(PKTDATA(osh, pkt), frame, len);
+		bzero(frame + len, sublen - len);
+
+		*(uint16*)frame = htol16((uint16)len);
+		*(((uint16*)frame) + 1) = htol16(~(uint16)len);
+		swheader = ((SDPCM_DATA_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) |
+		        ((bus->tx_seq + 1 + i) & SDPCM_SEQUENCE_MASK) |
+		        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+		if ((i + 1) < npkts)
+			swheader |= ((lens[i + 1] >> 4) << SDPCM_NEXTLEN_SHIFT) & SDPCM_NEXTLEN_MASK;
+		htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
+		htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+
+		frame += sublen;
+#ifdef DHD_DEBUG
+		tx_packets[PKTPRIO(pkt)]++;
+#endif
+	}
+
+	/* Raise the write to the next SDIO block if it is close, else to a word */
+	len = desclen + totlen;
+	pad = 0;
+	if (bus->roundup && bus->blocksize && (len > bus->blocksize)) {
+		pad = bus->blocksize - (len % bus->blocksize);
+		if ((pad > bus->roundup) || (pad >= bus->blocksize))
+			pad = 0;
+	}
+	pad += ROUNDUP(len + pad, ALIGNMENT) - (len + pad);
+	bzero(bus->txglomptr + len, pad);
+	len += pad;
+
+	DHD_GLOM(("%s: %d frames, %d bytes, seq %d\n", __FUNCTION__, npkts, totlen, bus->tx_seq));
+
+	ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2,
+	                          F2SYNC | SDIO_REQ_DMABUF, bus->txglomptr, len,
+	                          NULL, NULL, NULL);
+	bus->f2txdata++;
+	ASSERT(ret != BCME_PENDING);
+
+	if (ret < 0) {
+		DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
+		          __FUNCTION__, ret));
+		dhdsdio_txfail(bus);
+		bus->txglomfail++;
+	} else {
+		bus->tx_seq = (bus->tx_seq + 1 + npkts) % SDPCM_SEQUENCE_WRAP;
+		bus->txglomframes++;
+		bus->txglompkts += npkts;
+	}
+
+	/* Strip the header space and complete each frame */
+	for (i = 0; i < npkts; i++) {
+		pkt = pkts[i];
+		PKTPULL(osh, pkt, SDPCM_HDRLEN);
+		datalen = PKTLEN(osh, pkt);
+
+		if (ret < 0)
+			bus->dhd->tx_errors++;
+		else
+			bus->dhd->dstats.tx_bytes += datalen;
+
+		dhd_os_sdunlock(bus->dhd);
+		dhd_txcomplete(bus->dhd, pkt, ret == 0);
+		dhd_os_sdlock(bus->dhd);
+		PKTFREE(osh, pkt, TRUE);
+	}
+
+	return npkts;
+}
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -1165,8 +1432,8 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	uint32 intstatus = 0;
 	uint retries = 0;
 	int ret = 0, prec_out;
-	uint cnt = 0;
-	uint datalen;
+	uint cnt = 0, nframes;
+	uint datalen, chan;
 	uint8 tx_prec_map;
 
 	dhd_pub_t *dhd = bus->dhd;
@@ -1176,26 +1443,35 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 	tx_prec_map = ~bus->flowcontrol;
 
-	/* Send frames until the limit or some other event */
-	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt++) {
-		dhd_os_sdlock_txq(bus->dhd);
-		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
-			dhd_os_sdunlock_txq(bus->dhd);
-			break;
-		}
-		dhd_os_sdunlock_txq(bus->dhd);
-		datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
-
 #ifndef SDTEST
-		ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
+	chan = SDPCM_DATA_CHANNEL;
 #else
-		ret = dhdsdio_txpkt(bus, pkt,
-		        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
+	chan = (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL);
 #endif
-		if (ret)
-			bus->dhd->tx_errors++;
-		else
-			bus->dhd->dstats.tx_bytes += datalen;
+
+	/* Send frames until the limit or some other event */
+	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt += nframes) {
+		/* Several frames in one superframe if enabled, else one */
+		nframes = 0;
+		if ((dhd_txglom > 1) && (chan == SDPCM_DATA_CHANNEL))
+			nframes = dhdsdio_txglom(bus, maxframes - cnt, tx_prec_map);
+
+		if (!nframes) {
+			dhd_os_sdlock_txq(bus->dhd);
+			if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+				dhd_os_sdunlock_txq(bus->dhd);
+				break;
+			}
+			dhd_os_sdunlock_txq(bus->dhd);
+			datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
+
+			ret = dhdsdio_txpkt(bus, pkt, chan, TRUE);
+			if (ret)
+				bus->dhd->tx_errors++;
+			else
+				bus->dhd->dstats.tx_bytes += datalen;
+			nframes = 1;
+		}
 
 		/* In poll mode, need to check for other events */
 		if (!bus->intr && cnt)
@@ -1437,9 +1713,15 @@ enum {
 	IOV_SDIOD_DRIVE,
 	IOV_READAHEAD,
 	IOV_SDRXCHAIN,
+	IOV_RXPOOL,
+#ifdef BCMSDH_LOOPBACK
+	IOV_RXBENCH,
+	IOV_RXBENCHGLOM,
+#endif /* BCMSDH_LOOPBACK */
 	IOV_ALIGNCTL,
 	IOV_SDALIGN,
 	IOV_DEVRESET,
+	IOV_TXGLOM,
 	IOV_CPU,
 #ifdef SDTEST
 	IOV_PKTGEN,
@@ -1470,9 +1752,15 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"sdiod_drive",	IOV_SDIOD_DRIVE, 0,	IOVT_UINT32,	0 },
 	{"readahead",	IOV_READAHEAD,	0,	IOVT_BOOL,	0 },
 	{"sdrxchain",	IOV_SDRXCHAIN,	0,	IOVT_BOOL,	0 },
+	{"rxpool",	IOV_RXPOOL,	0,	IOVT_BOOL,	0 },
+#ifdef BCMSDH_LOOPBACK
+	{"rxbench",	IOV_RXBENCH,	0,	IOVT_UINT32,	0 },
+	{"rxbenchglom",	IOV_RXBENCHGLOM, 0,	IOVT_UINT32,	0 },
+#endif /* BCMSDH_LOOPBACK */
 	{"alignctl",	IOV_ALIGNCTL,	0,	IOVT_BOOL,	0 },
 	{"sdalign",	IOV_SDALIGN,	0,	IOVT_BOOL,	0 },
 	{"devreset",	IOV_DEVRESET,	0,	IOVT_BOOL,	0 },
+	{"txglom",	IOV_TXGLOM,	0,	IOVT_UINT32,	0 },
 #ifdef DHD_DEBUG
 	{"sdreg",	IOV_SDREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
 	{"sbreg",	IOV_SBREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
@@ -1532,8 +1820,10 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->rx_hdrfail, bus->rx_badhdr, bus->rx_badseq);
 	bcm_bprintf(strbuf, "fc_rcvd %d, fc_xoff %d, fc_xon %d\n",
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
-	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d\n",
-	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d, rxglompool %d\n",
+	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts, bus->rxglompool);
+	bcm_bprintf(strbuf, "txglom %d, txglomfail %d, txglomframes %d, txglompkts %d\n",
+	            dhd_txglom, bus->txglomfail, bus->txglomframes, bus->txglompkts);
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %d (%d/%d), f2tx %d f1regs %d\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
@@ -1558,6 +1848,11 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 		dhd_dump_pct(strbuf, ", pkts/int", bus->dhd->tx_packets, bus->intrcount);
 		bcm_bprintf(strbuf, "\n");
 
+		dhd_dump_pct(strbuf, "Tx: glom pct", (100 * bus->txglompkts),
+		             bus->dhd->tx_packets);
+		dhd_dump_pct(strbuf, ", pkts/glom", bus->txglompkts, bus->txglomframes);
+		bcm_bprintf(strbuf, "\n");
+
 		dhd_dump_pct(strbuf, "Total: pkts/f2rw",
 		             (bus->dhd->tx_packets + bus->dhd->rx_packets),
 		             (bus->f2txdata + bus->f2rxhdrs + bus->f2rxdata));
@@ -1599,7 +1894,8 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rxrtx = bus->rx_toolong = bus->rxc_errors = 0;
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
-	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
+	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = bus->rxglompool = 0;
+	bus->txglomfail = bus->txglomframes = bus->txglompkts = 0;
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
 }
 
@@ -2240,6 +2536,41 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		else
 			bus->use_rxchain = bool_val;
 		break;
+
+	case IOV_GVAL(IOV_RXPOOL):
+		int_val = (int32)bus->use_rxpool;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXPOOL):
+		if (bool_val && !bus->rxpool)
+			bcmerror = BCME_NOMEM;
+		else
+			bus->use_rxpool = bool_val;
+		break;
+
+#ifdef BCMSDH_LOOPBACK
+	case IOV_GVAL(IOV_RXBENCH):
+		int_val = (int32)bus->rxbench_ms;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXBENCH):
+		bcmerror = dhdsdio_rxbench(bus, (uint)int_val);
+		break;
+
+	case IOV_GVAL(IOV_RXBENCHGLOM):
+		int_val = (int32)bus->rxbench_glom;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXBENCHGLOM):
+		if (int_val < 1 || int_val > DHD_RXBENCH_GLOM_MAX)
+			bcmerror = BCME_RANGE;
+		else
+			bus->rxbench_glom = (uint)int_val;
+		break;
+#endif /* BCMSDH_LOOPBACK */
 	case IOV_GVAL(IOV_ALIGNCTL):
 		int_val = (int32)dhd_alignctl;
 		bcopy(&int_val, arg, val_size);
@@ -2254,6 +2585,21 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		bcopy(&int_val, arg, val_size);
 		break;
 
+	case IOV_GVAL(IOV_TXGLOM):
+		int_val = (int32)dhd_txglom;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOM):
+		if (int_val < 0 || int_val > DHD_TXGLOM_MAX) {
+			bcmerror = BCME_RANGE;
+			break;
+		}
+		if ((int_val > 1) && (bcmerror = dhdsdio_txglom_attach(bus)))
+			break;
+		dhd_txglom = (uint)int_val;
+		break;
+
 #ifdef DHD_DEBUG
 	case IOV_GVAL(IOV_VARS):
 		if (bus->varsz < (uint)len)
@@ -3064,6 +3410,130 @@ done:
 	dhd_os_ioctl_resp_wake(bus->dhd);
 }
 
+/* Reads the superframe described by bus->glomd straight into an rx pool
+ * buffer and builds bus->glom from it without copying payload: each
+ * subframe becomes a packet holding only its headers, with the rest left in
+ * the pool buffer as a page fragment.  Event frames are copied whole.  The
+ * descriptor is kept until the superframe is consumed so a retry can read
+ * it again.
+ * Returns the number of subframes, 0 if the copy path should be used
+ * instead, or -1 if the read failed.
+ */
+static int
+dhdsdio_rxglom_pool(dhd_bus_t *bus)
+{
+	osl_t *osh = bus->dhd->osh;
+	uint8 *buf, *dptr, *sub;
+	uint16 dlen, sublen, totlen, hdrlen, off;
+	void *pfirst, *plast, *pnext;
+	int errcode, num;
+
+	dlen = (uint16)PKTLEN(osh, bus->glomd);
+	dptr = PKTDATA(osh, bus->glomd);
+	if (!dlen || (dlen & 1))
+		return 0;
+
+	for (totlen = off = 0; off < dlen; off += sizeof(uint16)) {
+		sublen = ltoh16_ua(dptr + off);
+		if ((sublen < SDPCM_HDRLEN) || (!off && (sublen < (2 * SDPCM_HDRLEN))))
+			return 0;
+		totlen += sublen;
+	}
+	totlen = ROUNDUP(totlen, bus->blocksize);
+	if (totlen > MAX_DATA_BUF)
+		return 0;
+
+	dhd_os_sdlock_rxq(bus->dhd);
+	buf = PKTRXBUF(osh);
+	dhd_os_sdunlock_rxq(bus->dhd);
+	if (!buf)
+		return 0;
+
+	/* The pool page is DMA-able and totlen is whole blocks, so the read goes
+	 * straight into it without a bounce packet.
+	 */
+	errcode = dhd_bcmsdh_recv_buf(bus, bcmsdh_cur_sbwad(bus->sdh), SDIO_FUNC_2,
+	                              F2SYNC | SDIO_REQ_DMABUF, buf, totlen, NULL, NULL, NULL);
+	bus->f2rxdata++;
+	ASSERT(errcode != BCME_PENDING);
+
+	pfirst = plast = NULL;
+	if (errcode >= 0) {
+		dhd_os_sdlock_rxq(bus->dhd);
+		for (num = 0, sub = buf, off = 0; off < dlen; num++, off += sizeof(uint16)) {
+			sublen = ltoh16_ua(dptr + off);
+			/* Last subframe takes the block padding */
+			if ((off + sizeof(uint16)) == dlen)
+				sublen = totlen - (uint16)(sub - buf);
+
+			/* Copy the superframe header (first only) and the subframe
+			 * header plus enough for the protocol and ethernet headers.
+			 */
+			hdrlen = num ? 0 : SDPCM_DOFFSET_VALUE(&sub[SDPCM_FRAMETAG_LEN]);
+			if (((hdrlen + SDPCM_HDRLEN) <= sublen) &&
+			    (SDPCM_PACKET_CHANNEL(&sub[hdrlen + SDPCM_FRAMETAG_LEN]) ==
+			     SDPCM_DATA_CHANNEL))
+				hdrlen += SDPCM_DOFFSET_VALUE(&sub[hdrlen + SDPCM_FRAMETAG_LEN]) +
+				        DHD_RXPOOL_HDRLEN;
+			else
+				hdrlen = sublen;
+
+			if ((pnext = PKTFRAG(osh, sub, sublen, hdrlen, totlen)) == NULL) {
+				DHD_ERROR(("%s: PKTFRAG failed, num %d len %d\n",
+				           __FUNCTION__, num, sublen));
+				if (pfirst)
+					PKTFREE(osh, pfirst, FALSE);
+				pfirst = NULL;
+				errcode = BCME_NOMEM;
+				break;
+			}
+			if (!pfirst)
+				pfirst = pnext;
+			else
+				PKTSETNEXT(osh, plast, pnext);
+			plast = pnext;
+			sub += sublen;
+		}
+		dhd_os_sdunlock_rxq(bus->dhd);
+	}
+
+	if (errcode < 0) {
+		DHD_ERROR(("%s: glom read of %d bytes failed: %d\n",
+		           __FUNCTION__, totlen, errcode));
+		bus->dhd->rx_errors++;
+
+		if (bus->glomerr++ < 3) {
+			dhdsdio_rxfail(bus, TRUE, TRUE);
+		} else {
+			bus->glomerr = 0;
+			dhdsdio_rxfail(bus, TRUE, FALSE);
+			dhd_os_sdlock_rxq(bus->dhd);
+			PKTFREE(osh, bus->glomd, FALSE);
+			dhd_os_sdunlock_rxq(bus->dhd);
+			bus->rxglomfail++;
+			bus->glomd = NULL;
+			bus->nextlen = 0;
+		}
+		return -1;
+	}
+
+	DHD_GLOM(("%s: read %d-byte superframe into rx pool for %d subframes\n",
+	          __FUNCTION__, totlen, num));
+	bus->glom = pfirst;
+	bus->rxglompool++;
+	return num;
+}
+
+static void
+dhdsdio_rxglom_done(dhd_bus_t *bus)
+{
+	dhd_os_sdlock_rxq(bus->dhd);
+	PKTFREE(bus->dhd->osh, bus->glomd, FALSE);
+	dhd_os_sdunlock_rxq(bus->dhd);
+	bus->glomd = NULL;
+	bus->nextlen = 0;
+}
+
 static uint8
 dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 {
@@ -3080,14 +3550,22 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 
 	int ifidx = 0;
 	bool usechain = bus->use_rxchain;
+	bool pooled = FALSE;
 
 	/* If packets, issue read(s) and send up packet chain */
 	/* Return sequence numbers consumed? */
 
 	DHD_TRACE(("dhdsdio_rxglom: start: glomd %p glom %p\n", bus->glomd, bus->glom));
 
+	/* With the rx pool, read the superframe and slice the chain out of it */
+	if (bus->glomd && bus->use_rxpool && !bus->glom) {
+		if ((errcode = dhdsdio_rxglom_pool(bus)) < 0)
+			return 0;
+		pooled = (errcode > 0);
+	}
+
 	/* If there's a descriptor, generate the packet chain */
-	if (bus->glomd) {
+	if (bus->glomd && !pooled) {
 		dhd_os_sdlock_rxq(bus->dhd);
 
 		pfirst = plast = pnext = NULL;
@@ -3190,7 +3668,10 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 		 * read directly into the chained packet, or allocate a large
 		 * packet and and copy into the chain.
 		 */
-		if (usechain) {
+		if (pooled) {
+			/* Already read */
+			errcode = 0;
+		} else if (usechain) {
 			errcode = dhd_bcmsdh_recv_buf(bus,
 			                              bcmsdh_cur_sbwad(bus->sdh), SDIO_FUNC_2,
 			                              F2SYNC, (uint8*)PKTDATA(osh, pfirst),
@@ -3211,7 +3692,8 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			DHD_ERROR(("COULDN'T ALLOC %d-BYTE GLOM, FORCE FAILURE\n", dlen));
 			errcode = -1;
 		}
-		bus->f2rxdata++;
+		if (!pooled)
+			bus->f2rxdata++;
 		ASSERT(errcode != BCME_PENDING);
 
 		/* On failure, kill the superframe, allow a couple retries */
@@ -3341,8 +3823,16 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 		if (errcode) {
 			/* Terminate frame on error, request a couple retries */
 			if (bus->glomerr++ < 3) {
-				/* Restore superframe header space */
-				PKTPUSH(osh, pfirst, sfdoff);
+				if (pooled) {
+					/* Retry reads into a fresh pool buffer */
+					dhd_os_sdlock_rxq(bus->dhd);
+					PKTFREE(osh, bus->glom, FALSE);
+					dhd_os_sdunlock_rxq(bus->dhd);
+					bus->glom = NULL;
+				} else {
+					/* Restore superframe header space */
+					PKTPUSH(osh, pfirst, sfdoff);
+				}
 				dhdsdio_rxfail(bus, TRUE, TRUE);
 			} else {
 				bus->glomerr = 0;
@@ -3352,6 +3842,8 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 				dhd_os_sdunlock_rxq(bus->dhd);
 				bus->rxglomfail++;
 				bus->glom = NULL;
+				if (pooled)
+					dhdsdio_rxglom_done(bus);
 			}
 			bus->nextlen = 0;
 			return 0;
@@ -3361,6 +3853,8 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 		save_pfirst = pfirst;
 		bus->glom = NULL;
 		plast = NULL;
+		if (pooled)
+			dhdsdio_rxglom_done(bus);
 
 		dhd_os_sdlock_rxq(bus->dhd);
 		for (num = 0; pfirst; rxseq++, pfirst = pnext) {
@@ -3392,7 +3886,22 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			}
 #endif
 
-			PKTSETLEN(osh, pfirst, sublen);
+			/* Pool subframes keep their payload in a page fragment */
+			if (!pooled) {
+				PKTSETLEN(osh, pfirst, sublen);
+			} else if (PKTTRIM(osh, pfirst, sublen) != 0) {
+				DHD_ERROR(("%s: subframe %d trim to %d failed\n",
+				           __FUNCTION__, num, sublen));
+				bus->dhd->rx_errors++;
+				PKTFREE(osh, pfirst, FALSE);
+				if (plast) {
+					PKTSETNEXT(osh, plast, pnext);
+				} else {
+					ASSERT(save_pfirst == pfirst);
+					save_pfirst = pnext;
+				}
+				continue;
+			}
 			PKTPULL(osh, pfirst, doff);
 
 			if (PKTLEN(osh, pfirst) == 0) {
@@ -4344,6 +4853,7 @@ dhd_bus_dpc(struct dhd_bus *bus)
 	/* Call the DPC directly. */
 	DHD_TRACE(("Calling dhdsdio_dpc() from %s\n", __FUNCTION__));
 	resched = dhdsdio_dpc(bus);
+	dhd_rx_flush(bus->dhd);
 
 	return resched;
 }
@@ -4389,6 +4899,7 @@ dhdsdio_isr(void *arg)
 #if defined(SDIO_ISR_THREAD)
 	DHD_TRACE(("Calling dhdsdio_dpc() from %s\n", __FUNCTION__));
 	while (dhdsdio_dpc(bus));
+	dhd_rx_flush(bus->dhd);
 #else
 	bus->dpc_sched = TRUE;
 	dhd_sched_dpc(bus->dhd);
@@ -4397,6 +4908,184 @@ dhdsdio_isr(void *arg)
 
 }
 
+#ifdef BCMSDH_LOOPBACK
+static void
+dhdsdio_rxbench_hdr(dhd_bus_t *bus, uint8 *frame, uint16 len, uint chan, uint8 seq)
+{
+	uint32 swheader;
+
+	*(uint16*)frame = htol16(len);
+	*(((uint16*)frame) + 1) = htol16(~len);
+
+	swheader = ((chan << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) | seq |
+	        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
+	htol32_ua_store(bus->flowcontrol | (bus->tx_max << 8),
+	                frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+}
+
+/* Runs count synthetic data frames through the receive path with the bcmsdh
+ * loopback stub standing in for the dongle's F2 data.  The bus has to be up,
+ * either on the chip with firmware running or on the fake device brought up
+ * with dhd_loopback=1, which answers everything else itself.
+ * Frames are written on F2 packed rxbench_glom at a time into superframes,
+ * each with its glom descriptor, then read back by dhdsdio_readframes() and
+ * delivered to the stack as usual.  Only host-side cost is measured; the run
+ * time is kept for "rxbench" get.
+ */
+static int
+dhdsdio_rxbench(dhd_bus_t *bus, uint count)
+{
+	osl_t *osh = bus->dhd->osh;
+	uint16 lens[DHD_RXBENCH_GLOM_MAX];
+	struct ether_header *eh;
+	uint8 *buf, *frame, *tmpl;
+	uint tmpllen, glom, left, n, i, rxcount;
+	uint16 len, totlen;
+	uint8 rx_seq, seq;
+	uint32 start;
+	bool finished;
+	void *pkt;
+	int err = BCME_OK;
+
+	if (bus->dhd->busstate != DHD_BUS_DATA)
+		return BCME_NOTREADY;
+	if (bus->glom || bus->glomd)
+		return BCME_BUSY;
+
+	/* Payload template: protocol header, ethernet header to us, zeros */
+	if (!(pkt = PKTGET(osh, ETHER_HDR_LEN + ETHER_MAX_DATA, FALSE)))
+		return BCME_NOMEM;
+	bzero(PKTDATA(osh, pkt), PKTLEN(osh, pkt));
+	eh = (struct ether_header *)PKTDATA(osh, pkt);
+	bcopy(&bus->dhd->mac, eh->ether_dhost, ETHER_ADDR_LEN);
+	eh->ether_type = hton16(ETHER_TYPE_IP);
+	dhd_prot_hdrpush(bus->dhd, 0, pkt);
+	tmpl = PKTDATA(osh, pkt);
+	tmpllen = PKTLEN(osh, pkt);
+
+	if (!(buf = MALLOC(osh, MAX_DATA_BUF))) {
+		PKTFREE(osh, pkt, FALSE);
+		return BCME_NOMEM;
+	}
+
+	glom = bus->rxbench_glom;
+	rx_seq = seq = bus->rx_seq;
+	bcmsdh_loopback(bus->sdh, TRUE);
+	start = OSL_SYSUPTIME();
+
+	for (left = count; left; left -= n) {
+		n = MIN(left, glom);
+
+		/* Superframe: header, then 32-byte aligned subframes */
+		frame = buf + ((n > 1) ? SDPCM_HDRLEN : 0);
+		for (i = 0; i < n; i++) {
+			len = (uint16)(SDPCM_HDRLEN + tmpllen);
+			dhdsdio_rxbench_hdr(bus, frame, len, SDPCM_DATA_CHANNEL,
+			                    seq + ((n > 1) ? 1 : 0) + i);
+			bcopy(tmpl, frame + SDPCM_HDRLEN, tmpllen);
+			lens[i] = ROUNDUP(len, DHD_SDALIGN);
+			frame += lens[i];
+		}
+		totlen = (uint16)(frame - buf);
+
+		if (n > 1) {
+			/* Descriptor frame listing the subframe lengths */
+			uint8 desc[SDPCM_HDRLEN + DHD_RXBENCH_GLOM_MAX * sizeof(uint16)];
+
+			lens[0] += SDPCM_HDRLEN;
+			dhdsdio_rxbench_hdr(bus, desc, (uint16)(SDPCM_HDRLEN + n * sizeof(uint16)),
+			                    SDPCM_GLOM_CHANNEL, seq);
+			desc[SDPCM_FRAMETAG_LEN + 1] |= (uint8)(SDPCM_GLOMDESC_FLAG >> 8);
+			for (i = 0; i < n; i++)
+				htol16_ua_store(lens[i], desc + SDPCM_HDRLEN + i * sizeof(uint16));
+			bcmsdh_send_buf(bus->sdh, 0, SDIO_FUNC_2, F2SYNC, desc,
+			                SDPCM_HDRLEN + n * sizeof(uint16), NULL, NULL, NULL);
+
+			dhdsdio_rxbench_hdr(bus, buf, totlen, SDPCM_GLOM_CHANNEL, seq + 1);
+			totlen = ROUNDUP(totlen, bus->blocksize);
+			seq += 1 + n;
+		} else {
+			seq++;
+		}
+		bcmsdh_send_buf(bus->sdh, 0, SDIO_FUNC_2, F2SYNC, buf, totlen, NULL, NULL, NULL);
+
+		/* Read it back through the normal path */
+		do {
+			rxcount = dhdsdio_readframes(bus, dhd_rxbound, &finished);
+		} while (rxcount && (bcmsdh_loopback_pending(bus->sdh) || bus->glomd || bus->glom));
+
+		if (bcmsdh_loopback_pending(bus->sdh) || bus->glomd || bus->glom) {
+			DHD_ERROR(("%s: rx path stalled with %d frames left\n",
+			           __FUNCTION__, left));
+			err = BCME_ERROR;
+			break;
+		}
+
+		dhd_os_sdunlock(bus->dhd);
+		dhd_rx_flush(bus->dhd);
+		dhd_os_sdlock(bus->dhd);
+	}
+
+	bus->rxbench_ms = OSL_SYSUPTIME() - start;
+	bcmsdh_loopback(bus->sdh, FALSE);
+	bus->rx_seq = rx_seq;
+	bus->rxskip = FALSE;
+
+	DHD_ERROR(("%s: %d frames, %d per superframe, %d ms\n",
+	           __FUNCTION__, count - left, glom, bus->rxbench_ms));
+
+	MFREE(osh, buf, MAX_DATA_BUF);
+	PKTFREE(osh, pkt, FALSE);
+	return err;
+}
+
+/* Stands in for dhdsdio_probe_attach() on a bcmsdh handle without a chip:
+ * there is no backplane to scan, so report a 4329 with the SDIO core and
+ * set up only the host-side state.
+ */
+static void
+dhdsdio_nochip_attach(dhd_bus_t *bus)
+{
+	bus->nochip_sih.bustype = DHD_BUS;
+	bus->nochip_sih.buscoretype = SDIOD_CORE_ID;
+	bus->nochip_sih.chip = BCM4329_CHIP_ID;
+	bus->nochip_sih.chiprev = 2;
+	bus->sih = &bus->nochip_sih;
+
+	pktq_init(&bus->txq, (PRIOMASK + 1), QLEN);
+	bus->rxhdr = (uint8 *)ROUNDUP((uintptr)&bus->hdrbuf[0], DHD_SDALIGN);
+
+	/* Nothing interrupts and there is nothing to poll */
+	bus->intr = FALSE;
+	bus->poll = FALSE;
+}
+
+/* Stands in for dhd_bus_start(): no firmware to download and no F2 to
+ * enable, so mark the bus up with the clock on.  Transmits are dropped by
+ * bcmsdh and nothing returns credit, so only a few frames get through.
+ */
+static int
+dhdsdio_nochip_start(dhd_bus_t *bus)
+{
+	static const uint8 nochip_mac[ETHER_ADDR_LEN] = { 0x02, 0x90, 0x4c, 0x00, 0x43, 0x29 };
+
+	bus->blocksize = DHD_NOCHIP_BLOCKSIZE;
+	bus->roundup = MIN(max_roundup, bus->blocksize);
+
+	dhd_os_sdlock(bus->dhd);
+	bus->clkstate = CLK_AVAIL;
+	bus->tx_max = (uint8)(bus->tx_seq + 4);
+	bus->dhd->busstate = DHD_BUS_DATA;
+	dhd_os_sdunlock(bus->dhd);
+
+	bcopy(nochip_mac, &bus->dhd->mac, ETHER_ADDR_LEN);
+
+	DHD_ERROR(("%s: bus up without a chip, rx loopback only\n", __FUNCTION__));
+	return 0;
+}
+#endif /* BCMSDH_LOOPBACK */
+
 #ifdef SDTEST
 static void
 dhdsdio_pktgen_init(dhd_bus_t *bus)
@@ -4938,7 +5627,15 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 	bus->bus = DHD_BUS;
 	bus->tx_seq = SDPCM_SEQUENCE_WRAP - 1;
 	bus->usebufpool = FALSE; /* Use bufpool if allocated, else use locally malloced rxbuf */
+#ifdef BCMSDH_LOOPBACK
+	bus->rxbench_glom = DHD_RXBENCH_GLOM;
+#endif /* BCMSDH_LOOPBACK */
 
+#ifdef BCMSDH_LOOPBACK
+	if (DHD_NOCHIP(bus))
+		dhdsdio_nochip_attach(bus);
+	else
+#endif /* BCMSDH_LOOPBACK */
 	/* attempt to attach to the dongle */
 	if (!(dhdsdio_probe_attach(bus, osh, sdh, regsva, devid))) {
 		DHD_ERROR(("%s: dhdsdio_probe_attach failed\n", __FUNCTION__));
@@ -4975,8 +5672,14 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 	DHD_INFO(("%s: completed!!\n", __FUNCTION__));
 
 
+#ifdef BCMSDH_LOOPBACK
+	if (DHD_NOCHIP(bus))
+		ret = dhdsdio_nochip_start(bus);
+	else
+#endif /* BCMSDH_LOOPBACK */
 	/* if firmware path present try to download and bring up bus */
-	if ((ret = dhd_bus_start(bus->dhd)) != 0) {
+	ret = dhd_bus_start(bus->dhd);
+	if (ret != 0) {
 		DHD_ERROR(("%s: failed\n", __FUNCTION__));
 		goto fail;
 		if (ret == BCME_NOTUP)  {
@@ -5192,6 +5895,28 @@ dhdsdio_probe_malloc(dhd_bus_t *bus, osl_t *osh, void *sdh)
 	else
 		bus->dataptr = bus->databuf;
 
+	/* Allocate buffer to send frames without room for alignment */
+	if (!(bus->txbuf = MALLOC(osh, TXBUF_LEN))) {
+		DHD_ERROR(("%s: MALLOC of %d-byte txbuf failed\n",
+			__FUNCTION__, TXBUF_LEN));
+		goto fail;
+	}
+	if ((uintptr)bus->txbuf % DHD_SDALIGN)
+		bus->txptr = bus->txbuf +
+		        (DHD_SDALIGN - ((uintptr)bus->txbuf % DHD_SDALIGN));
+	else
+		bus->txptr = bus->txbuf;
+
+	/* Tx glomming stays off without its buffer */
+	if ((dhd_txglom > 1) && dhdsdio_txglom_attach(bus))
+		dhd_txglom = 0;
+
+	/* The rx pool is optional, superframes are copied out of databuf without it */
+	if (osl_rxbuf_attach(osh, DHD_RXPOOL_NUM, MAX_DATA_BUF) == BCME_OK)
+		bus->rxpool = bus->use_rxpool = TRUE;
+	else
+		DHD_ERROR(("%s: no rx pool, using copy path\n", __FUNCTION__));
+
 	return TRUE;
 
 fail:
@@ -5357,6 +6082,21 @@ dhdsdio_release_malloc(dhd_bus_t *bus, osl_t *osh)
 #endif
 		bus->databuf = NULL;
 	}
+
+	if (bus->txbuf) {
+		MFREE(osh, bus->txbuf, TXBUF_LEN);
+		bus->txptr = bus->txbuf = NULL;
+	}
+
+	if (bus->txglombuf) {
+		MFREE(osh, bus->txglombuf, TXGLOMBUF_LEN);
+		bus->txglomptr = bus->txglombuf = NULL;
+	}
+
+	if (bus->rxpool) {
+		osl_rxbuf_detach(osh);
+		bus->rxpool = bus->use_rxpool = FALSE;
+	}
 }
 
 
@@ -5368,7 +6108,7 @@ dhdsdio_release_dongle(dhd_bus_t *bus, osl_t *osh)
 	if (bus->dhd && bus->dhd->dongle_reset)
 		return;
 
-	if (bus->sih) {
+	if (bus->sih && !DHD_NOCHIP(bus)) {
 		dhdsdio_clkctl(bus, CLK_AVAIL, FALSE);
 #if !defined(BCMLXSDMMC)
 		si_watchdog(bus->sih, 4);
@@ -5409,11 +6149,61 @@ static bcmsdh_driver_t dhd_sdio = {
 	dhdsdio_disconnect
 };
 
+#ifdef BCMSDH_LOOPBACK
+static osl_t *dhd_nochip_osh;
+static void *dhd_nochip_sdh;
+static void *dhd_nochip_bus;
+
+/* Probe a bcmsdh handle with no device behind it instead of registering
+ * with the SD host driver.
+ */
+static int
+dhd_bus_register_nochip(void)
+{
+	void *regsva;
+
+	if (!(dhd_nochip_osh = osl_attach(NULL, DHD_BUS, FALSE)))
+		return BCME_NOMEM;
+
+	if (!(dhd_nochip_sdh = bcmsdh_attach_nochip(dhd_nochip_osh, &regsva))) {
+		osl_detach(dhd_nochip_osh);
+		dhd_nochip_osh = NULL;
+		return BCME_NOMEM;
+	}
+
+	if (!(dhd_nochip_bus = dhdsdio_probe(VENDOR_BROADCOM, BCM4329_D11NDUAL_ID, 0, 0, 0,
+	                                     DHD_BUS, regsva, NULL, dhd_nochip_sdh))) {
+		bcmsdh_detach(dhd_nochip_osh, dhd_nochip_sdh);
+		osl_detach(dhd_nochip_osh);
+		dhd_nochip_sdh = NULL;
+		dhd_nochip_osh = NULL;
+		return BCME_ERROR;
+	}
+
+	return 0;
+}
+
+static void
+dhd_bus_unregister_nochip(void)
+{
+	dhdsdio_disconnect(dhd_nochip_bus);
+	bcmsdh_detach(dhd_nochip_osh, dhd_nochip_sdh);
+	osl_detach(dhd_nochip_osh);
+	dhd_nochip_bus = dhd_nochip_sdh = NULL;
+	dhd_nochip_osh = NULL;
+}
+#endif /* BCMSDH_LOOPBACK */
+
 int
 dhd_bus_register(void)
 {
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
+#ifdef BCMSDH_LOOPBACK
+	if (dhd_loopback)
+		return dhd_bus_register_nochip();
+#endif /* BCMSDH_LOOPBACK */
+
 	return bcmsdh_register(&dhd_sdio);
 }
 
@@ -5422,6 +6212,13 @@ dhd_bus_unregister(void)
 {
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
+#ifdef BCMSDH_LOOPBACK
+	if (dhd_nochip_sdh) {
+		dhd_bus_unregister_nochip();
+		return;
+	}
+#endif /* BCMSDH_LOOPBACK */
+
 	bcmsdh_unregister();
 }
 
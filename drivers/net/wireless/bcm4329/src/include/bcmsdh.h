@@ -135,6 +135,7 @@ extern int bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
 #define SDIO_REQ_4BYTE	0x1	/* Four-byte target (backplane) width (vs. two-byte) */
 #define SDIO_REQ_FIXED	0x2	/* Fixed address (FIFO) (vs. incrementing address) */
 #define SDIO_REQ_ASYNC	0x4	/* Async request (vs. sync request) */
+#define SDIO_REQ_DMABUF	0x8	/* Buffer is DMA-able and aligned (vs. bounced) */
 
 /* Pending (non-error) return code */
 #define BCME_PENDING	1
@@ -204,5 +205,19 @@ extern uint32 bcmsdh_cur_sbwad(void *sdh);
 /* Function to pass chipid and rev to lower layers for controlling pr's */
 extern void bcmsdh_chipinfo(void *sdh, uint32 chip, uint32 chiprev);
 
+#ifdef BCMSDH_LOOPBACK
+/* Loop F2 data back in host memory instead of sending it to the device:
+ * frames written on F2 are returned in order by subsequent F2 reads, and
+ * reads with nothing queued return zeros (no more frames).  F0/F1 register
+ * and CIS access still go to the device, unless the handle came from
+ * bcmsdh_attach_nochip(), which answers those itself so that the bus can
+ * be brought up on a board without the chip.
+ */
+extern void bcmsdh_loopback(void *sdh, bool enable);
+extern bool bcmsdh_loopback_pending(void *sdh);
+extern bcmsdh_info_t *bcmsdh_attach_nochip(osl_t *osh, void **regsva);
+extern bool bcmsdh_nochip(void *sdh);
+#endif /* BCMSDH_LOOPBACK */
+
 
 #endif	/* _bcmsdh_h_ */
@@ -244,9 +244,13 @@ extern void osl_dma_unmap(osl_t *osh, uint pa, uint size, int direction);
 #define	PKTNEXT(osh, skb)		(((struct sk_buff*)(skb))->next)
 #define	PKTSETNEXT(osh, skb, x)		(((struct sk_buff*)(skb))->next = (struct sk_buff*)(x))
 #define	PKTSETLEN(osh, skb, len)	__skb_trim((struct sk_buff*)(skb), (len))
+#define	PKTTRIM(osh, skb, len)		pskb_trim((struct sk_buff*)(skb), (len))
 #define	PKTPUSH(osh, skb, bytes)	skb_push((struct sk_buff*)(skb), (bytes))
 #define	PKTPULL(osh, skb, bytes)	skb_pull((struct sk_buff*)(skb), (bytes))
 #define	PKTDUP(osh, skb)		osl_pktdup((osh), (skb))
+#define	PKTRXBUF(osh)			osl_rxbuf_get((osh))
+#define	PKTFRAG(osh, buf, len, copylen, bufsize) \
+	osl_pktfrag((osh), (buf), (len), (copylen), (bufsize))
 #define	PKTTAG(skb)			((void*)(((struct sk_buff*)(skb))->cb))
 #define PKTALLOCED(osh)			((osl_pubinfo_t *)(osh))->pktalloced
 #define PKTSETPOOL(osh, skb, x, y)	do {} while (0)
@@ -264,6 +268,11 @@ extern void *osl_pktget_static(osl_t *osh, uint len);
 extern void osl_pktfree_static(osl_t *osh, void *skb, bool send);
 extern void *osl_pktdup(osl_t *osh, void *skb);
 
+extern int osl_rxbuf_attach(osl_t *osh, uint num, uint size);
+extern void osl_rxbuf_detach(osl_t *osh);
+extern void *osl_rxbuf_get(osl_t *osh);
+extern void *osl_pktfrag(osl_t *osh, void *buf, uint len, uint copylen, uint bufsize);
+
 
 
 static INLINE void *
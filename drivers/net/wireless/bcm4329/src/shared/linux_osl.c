@@ -95,6 +95,10 @@ struct osl_info {
 	uint failed;
 	uint bustype;
 	bcm_mem_link_t *dbgmem_list;
+	struct page **rxbuf_pages;
+	uint rxbuf_num;
+	uint rxbuf_order;
+	uint rxbuf_next;
 };
 
 static int16 linuxbcmerrormap[] =
@@ -296,6 +300,7 @@ osl_detach(osl_t *osh)
 		bcm_static_skb = 0;
 	}
 #endif 
+	osl_rxbuf_detach(osh);
 	ASSERT(osh->magic == OS_HANDLE_MAGIC);
 	kfree(osh);
 }
@@ -367,6 +372,110 @@ osl_pktfree(osl_t *osh, void *p, bool send)
 	}
 }
 
+
+int
+osl_rxbuf_attach(osl_t *osh, uint num, uint size)
+{
+	uint i;
+
+	ASSERT(!osh->rxbuf_pages);
+
+	if (!(osh->rxbuf_pages = kzalloc(num * sizeof(struct page *), GFP_KERNEL)))
+		return BCME_NOMEM;
+
+	osh->rxbuf_num = num;
+	osh->rxbuf_order = get_order(size);
+	osh->rxbuf_next = 0;
+
+	for (i = 0; i < num; i++) {
+		osh->rxbuf_pages[i] = alloc_pages(GFP_KERNEL | __GFP_COMP, osh->rxbuf_order);
+		if (!osh->rxbuf_pages[i]) {
+			OSL_MSG_ERROR(("osl_rxbuf_attach: can not alloc rx buffer %d!\n", i));
+			osl_rxbuf_detach(osh);
+			return BCME_NOMEM;
+		}
+	}
+
+	return BCME_OK;
+}
+
+void
+osl_rxbuf_detach(osl_t *osh)
+{
+	uint i;
+
+	if (!osh->rxbuf_pages)
+		return;
+
+	for (i = 0; i < osh->rxbuf_num; i++)
+		if (osh->rxbuf_pages[i])
+			put_page(osh->rxbuf_pages[i]);
+
+	kfree(osh->rxbuf_pages);
+	osh->rxbuf_pages = NULL;
+	osh->rxbuf_num = 0;
+}
+
+
+void *
+osl_rxbuf_get(osl_t *osh)
+{
+	struct page *page;
+	uint i, n;
+
+	if (!osh->rxbuf_pages)
+		return NULL;
+
+	for (n = 0; n < osh->rxbuf_num; n++) {
+		i = osh->rxbuf_next;
+		osh->rxbuf_next = (i + 1) % osh->rxbuf_num;
+		if (page_count(osh->rxbuf_pages[i]) == 1)
+			return page_address(osh->rxbuf_pages[i]);
+	}
+
+	if (!(page = alloc_pages(GFP_ATOMIC | __GFP_COMP | __GFP_NOWARN, osh->rxbuf_order)))
+		return NULL;
+
+	i = osh->rxbuf_next;
+	put_page(osh->rxbuf_pages[i]);
+	osh->rxbuf_pages[i] = page;
+
+	return page_address(page);
+}
+
+
+/* Packet for the len bytes at buf, a slice of the bufsize bytes read into an
+ * rx pool page: copylen bytes go into the packet head, the rest stays in the
+ * page as a fragment.  Any one slice keeps the whole page from going back to
+ * the pool, so the slices are charged the page between them, each in
+ * proportion to its length.
+ */
+void *
+osl_pktfrag(osl_t *osh, void *buf, uint len, uint copylen, uint bufsize)
+{
+	struct sk_buff *skb;
+	struct page *page;
+	uint fraglen;
+
+	copylen = MIN(copylen, len);
+	if (!(skb = osl_pktget(osh, copylen)))
+		return NULL;
+
+	bcopy(buf, skb->data, copylen);
+
+	if ((fraglen = len - copylen)) {
+		page = virt_to_head_page(buf);
+		get_page(page);
+		skb_fill_page_desc(skb, 0, page,
+		                   (uint8 *)buf + copylen - (uint8 *)page_address(page), fraglen);
+		skb->len += fraglen;
+		skb->data_len += fraglen;
+		skb->truesize += (len * (PAGE_SIZE << compound_order(page))) / bufsize;
+	}
+
+	return ((void *) skb);
+}
+
 #ifdef DHD_USE_STATIC_BUF
 void*
 osl_pktget_static(osl_t *osh, uint len)
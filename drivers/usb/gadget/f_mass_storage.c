@@ -216,9 +216,10 @@
  *
  * To provide maximum throughput, the driver uses a circular pipeline of
  * buffer heads (struct fsg_buffhd).  In principle the pipeline can be
- * arbitrarily long; in practice the benefits don't justify having more
- * than 2 stages (i.e., double buffering).  But it helps to think of the
- * pipeline as being a long one.  Each buffer head contains a bulk-in and
+ * arbitrarily long; by default it has 2 stages (i.e., double buffering),
+ * CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS makes it deeper so that USB
+ * transfers keep going while the backing file is slow.  Either way it
+ * helps to think of the pipeline as being a long one.  Each buffer head contains a bulk-in and
  * a bulk-out request pointer (since the buffer can be used for both
  * output and input -- directions always are given from the host's
  * point of view) as well as a pointer to the buffer and various state
@@ -272,6 +273,7 @@
 /* #define DUMP_MSGS */
 
 
+#include <linux/backing-dev.h>
 #include <linux/blkdev.h>
 #include <linux/completion.h>
 #include <linux/dcache.h>
@@ -283,11 +285,13 @@
 #include <linux/kref.h>
 #include <linux/kthread.h>
 #include <linux/limits.h>
+#include <linux/mm.h>
 #include <linux/rwsem.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/freezer.h>
+#include <linux/uio.h>
 #include <linux/utsname.h>
 
 #include <linux/usb/ch9.h>
@@ -717,6 +721,79 @@ static int sleep_thread(struct fsg_common *common)
 
 /*-------------------------------------------------------------------------*/
 
+/* Number of back-to-back sequential READs before we treat the host as
+ * streaming and tune readahead on the backing file for it. */
+#define FSG_SEQ_READS	2
+
+/* Submit reads for [file_offset, file_offset + amount) to the backing
+ * file without waiting for them. */
+static void fsg_lun_readahead(struct fsg_lun *curlun, loff_t file_offset,
+		u32 amount)
+{
+	struct file	*filp = curlun->filp;
+	pgoff_t		index, end;
+
+	amount = min((loff_t) amount, curlun->file_length - file_offset);
+	if (amount == 0)
+		return;
+	index = file_offset >> PAGE_CACHE_SHIFT;
+	end = (file_offset + amount - 1) >> PAGE_CACHE_SHIFT;
+	page_cache_sync_readahead(filp->f_mapping, &filp->f_ra, filp,
+			index, end - index + 1);
+}
+
+static void fsg_lun_read_start(struct fsg_lun *curlun, loff_t file_offset,
+		u32 amount)
+{
+	struct file		*filp = curlun->filp;
+	struct backing_dev_info	*bdi = filp->f_mapping->backing_dev_info;
+
+	if (file_offset == curlun->next_read_offset) {
+		if (curlun->seq_reads < FSG_SEQ_READS &&
+				++curlun->seq_reads == FSG_SEQ_READS)
+			/* Same as POSIX_FADV_SEQUENTIAL */
+			filp->f_ra.ra_pages = bdi->ra_pages * 2;
+	} else if (curlun->seq_reads) {
+		if (curlun->seq_reads == FSG_SEQ_READS)
+			/* Same as POSIX_FADV_NORMAL */
+			filp->f_ra.ra_pages = bdi->ra_pages;
+		curlun->seq_reads = 0;
+	}
+	curlun->read_ahead_len = 0;
+
+	/* Get the whole command's reads in flight before we wait on the
+	 * first buffer, rather than one buffer's worth at a time. */
+	if (amount > FSG_BUFLEN)
+		fsg_lun_readahead(curlun, file_offset, amount);
+}
+
+static void fsg_lun_read_end(struct fsg_lun *curlun, loff_t file_offset,
+		u32 amount)
+{
+	curlun->next_read_offset = file_offset;
+	if (curlun->seq_reads == FSG_SEQ_READS)
+		curlun->read_ahead_len = amount;
+}
+
+/* A streaming host will most likely ask for the next range of the same
+ * size.  Called once the CSW is queued, so the status of the command
+ * that just finished does not wait for the submission. */
+static void fsg_common_read_ahead(struct fsg_common *common)
+{
+	struct fsg_lun	*curlun = common->curlun;
+
+	if (!curlun)
+		return;
+
+	down_read(&common->filesem);
+	if (fsg_lun_is_open(curlun) && curlun->read_ahead_len) {
+		fsg_lun_readahead(curlun, curlun->next_read_offset,
+				curlun->read_ahead_len);
+		curlun->read_ahead_len = 0;
+	}
+	up_read(&common->filesem);
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -755,6 +832,8 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	fsg_lun_read_start(curlun, file_offset, amount_left);
+
 	for (;;) {
 
 		/* Figure out how much we need to read:
@@ -827,8 +906,11 @@ static int do_read(struct fsg_common *common)
 			break;
 		}
 
-		if (amount_left == 0)
+		if (amount_left == 0) {
+			fsg_lun_read_end(curlun, file_offset,
+					common->data_size_from_cmnd);
 			break;		/* No more left to read */
+		}
 
 		/* Send this buffer and go read some more */
 		bh->inreq->zero = 0;
@@ -846,6 +928,34 @@ static int do_read(struct fsg_common *common)
 
 /*-------------------------------------------------------------------------*/
 
+/* Start writeback of the whole pages a write has just completed, as
+ * sync_file_range(SYNC_FILE_RANGE_WRITE) would, without waiting for it.
+ * The backing device then works on the data while more arrives over USB,
+ * instead of taking it all at once at the dirty limit or the next sync.
+ *
+ * Only done with a deepened pipeline: with the default two buffers there
+ * is nothing to overlap it with.  WB_SYNC_NONE skips pages that are still
+ * under writeback, so a host rewriting a hot sector (a FAT block, say)
+ * doesn't wait on the previous write of it.  __filemap_fdatawrite_range()
+ * isn't exported; a modular build falls back to the WB_SYNC_ALL wrapper. */
+static void fsg_lun_write_out(struct fsg_lun *curlun, loff_t file_offset,
+		u32 amount)
+{
+#if FSG_NUM_BUFFERS > 2
+	loff_t	start = file_offset & PAGE_CACHE_MASK;
+	loff_t	end = (file_offset + amount) & PAGE_CACHE_MASK;
+
+	if (end <= start)
+		return;
+#ifndef MODULE
+	__filemap_fdatawrite_range(curlun->filp->f_mapping,
+			start, end - 1, WB_SYNC_NONE);
+#else
+	filemap_fdatawrite_range(curlun->filp->f_mapping, start, end - 1);
+#endif
+#endif
+}
+
 static int do_write(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -854,10 +964,12 @@ static int do_write(struct fsg_common *common)
 	int			get_some_more;
 	u32			amount_left_to_req, amount_left_to_write;
 	loff_t			usb_offset, file_offset, file_offset_tmp;
-	unsigned int		amount;
+	unsigned int		amount, len;
 	unsigned int		partial_page;
 	ssize_t			nwritten;
 	int			rc;
+	struct iovec		iov[FSG_NUM_BUFFERS];
+	int			nr_iov, xfer_failed, short_packet;
 
 	if (curlun->ro) {
 		curlun->sense_data = SS_WRITE_PROTECTED;
@@ -962,37 +1074,69 @@ static int do_write(struct fsg_common *common)
 			continue;
 		}
 
-		/* Write the received data to the backing file */
+		/* Write the received data to the backing file.  All the
+		 * buffers that are already full go out in one vfs_writev()
+		 * call, so a backing file that falls behind catches up with
+		 * fewer and larger writes. */
 		bh = common->next_buffhd_to_drain;
 		if (bh->state == BUF_STATE_EMPTY && !get_some_more)
 			break;			/* We stopped early */
 		if (bh->state == BUF_STATE_FULL) {
-			smp_rmb();
-			common->next_buffhd_to_drain = bh->next;
-			bh->state = BUF_STATE_EMPTY;
-
-			/* Did something go wrong with the transfer? */
-			if (bh->outreq->status != 0) {
+			amount = 0;
+			nr_iov = 0;
+			xfer_failed = 0;
+			short_packet = 0;
+			do {
+				smp_rmb();
+				common->next_buffhd_to_drain = bh->next;
+				bh->state = BUF_STATE_EMPTY;
+
+				/* Did something go wrong with the transfer? */
+				if (bh->outreq->status != 0) {
+					xfer_failed = 1;
+					break;
+				}
+
+				len = bh->outreq->actual;
+				if (curlun->file_length - file_offset - amount <
+						len) {
+					LERROR(curlun,
+	"write %u @ %llu beyond end %llu\n",
+	len, (unsigned long long) file_offset + amount,
+	(unsigned long long) curlun->file_length);
+					len = curlun->file_length - file_offset -
+							amount;
+				}
+				iov[nr_iov].iov_base = bh->buf;
+				iov[nr_iov].iov_len = len;
+				nr_iov++;
+				amount += len;
+
+				/* Did the host decide to stop early? */
+				if (bh->outreq->actual != bh->outreq->length) {
+					short_packet = 1;
+					break;
+				}
+				bh = bh->next;
+			} while (bh->state == BUF_STATE_FULL);
+
+			if (nr_iov == 0) {
 				curlun->sense_data = SS_COMMUNICATION_FAILURE;
 				curlun->sense_data_info = file_offset >> 9;
 				curlun->info_valid = 1;
 				break;
 			}
 
-			amount = bh->outreq->actual;
-			if (curlun->file_length - file_offset < amount) {
-				LERROR(curlun,
-	"write %u @ %llu beyond end %llu\n",
-	amount, (unsigned long long) file_offset,
-	(unsigned long long) curlun->file_length);
-				amount = curlun->file_length - file_offset;
-			}
-
 			/* Perform the write */
 			file_offset_tmp = file_offset;
-			nwritten = vfs_write(curlun->filp,
-					(char __user *) bh->buf,
-					amount, &file_offset_tmp);
+			if (nr_iov == 1)
+				nwritten = vfs_write(curlun->filp,
+						(char __user *) iov[0].iov_base,
+						amount, &file_offset_tmp);
+			else
+				nwritten = vfs_writev(curlun->filp,
+						(struct iovec __user *) iov,
+						nr_iov, &file_offset_tmp);
 			VLDBG(curlun, "file write %u @ %llu -> %d\n", amount,
 					(unsigned long long) file_offset,
 					(int) nwritten);
@@ -1009,6 +1153,7 @@ static int do_write(struct fsg_common *common)
 				nwritten -= (nwritten & 511);
 				/* Round down to a block */
 			}
+			fsg_lun_write_out(curlun, file_offset, nwritten);
 			file_offset += nwritten;
 			amount_left_to_write -= nwritten;
 			common->residue -= nwritten;
@@ -1021,8 +1166,14 @@ static int do_write(struct fsg_common *common)
 				break;
 			}
 
-			/* Did the host decide to stop early? */
-			if (bh->outreq->actual != bh->outreq->length) {
+			if (xfer_failed) {
+				curlun->sense_data = SS_COMMUNICATION_FAILURE;
+				curlun->sense_data_info = file_offset >> 9;
+				curlun->info_valid = 1;
+				break;
+			}
+
+			if (short_packet) {
 				common->short_packet_received = 1;
 				break;
 			}
@@ -2642,6 +2793,8 @@ static int fsg_main_thread(void *common_)
 		if (send_status(common))
 			continue;
 
+		fsg_common_read_ahead(common);
+
 		spin_lock_irq(&common->lock);
 		if (!exception_in_progress(common))
 			common->state = FSG_STATE_IDLE;
@@ -46,8 +46,12 @@
 #include <linux/usb/ch9.h>
 #include <linux/usb/composite.h>
 #include <linux/usb/gadget.h>
+#include <linux/usb/f_mtp.h>
 
 #include <linux/sched.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/workqueue.h>
 #include <asm-generic/siginfo.h>
 
 #include "f_mtp.h"
@@ -94,11 +98,11 @@
 #endif
 /*-------------------------------------------------------------------------*/
 
-#define BULK_BUFFER_SIZE	 4096
+#define BULK_BUFFER_SIZE	 16384
 
 /* number of rx and tx requests to allocate */
-#define RX_REQ_MAX		 4
-#define TX_REQ_MAX		 4
+#define RX_REQ_MAX		 8
+#define TX_REQ_MAX		 8
 
 #define DRIVER_NAME		 "usb_mtp_gadget"
 
@@ -151,6 +155,16 @@ struct mtpg_dev {
 	atomic_t 		wintfd_excl;
 	char cancel_io_buf[USB_PTPREQUEST_CANCELIO_SIZE+1];
 
+	/* MTP_SEND_FILE / MTP_RECEIVE_FILE run on this worker */
+	struct workqueue_struct	*wq;
+	struct work_struct	send_file_work;
+	struct work_struct	receive_file_work;
+	struct file		*xfer_file;
+	loff_t			xfer_file_offset;
+	int64_t			xfer_file_length;
+	int			xfer_result;
+	/* set by a host CANCELIO while a file transfer is running */
+	int			xfer_cancel;
 };
 
 /* Global mtpg_dev Structure
@@ -589,6 +603,228 @@ static ssize_t mtpg_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/*
+ * Stream a file range to the host. Reading the next chunk from the page
+ * cache overlaps with the previous requests still on the bus, as long as
+ * there is an idle tx request to fill. The length is 64-bit so ranges
+ * past 2GB are not truncated; returns 0 or a negative errno.
+ */
+static int mtpg_send_file(struct mtpg_dev *dev, struct file *filp,
+				loff_t offset, int64_t count)
+{
+	struct usb_request *req = 0;
+	int r = 0, xfer;
+	int ret;
+
+	DEBUG_MTPW("[%s] offset %lld count %lld\n", __func__, offset, count);
+
+	while (count > 0) {
+		if (dev->error || dev->xfer_cancel) {
+			r = dev->xfer_cancel ? -ECANCELED : -EIO;
+			break;
+		}
+
+		/* get an idle tx request to use */
+		req = 0;
+		wait_event(dev->write_wq, ((req = req_get(dev, &dev->tx_idle))
+				|| dev->error || dev->xfer_cancel));
+		if (!req)
+			continue;
+
+		if (count > BULK_BUFFER_SIZE)
+			xfer = BULK_BUFFER_SIZE;
+		else
+			xfer = count;
+
+		ret = vfs_read(filp, req->buf, xfer, &offset);
+		if (ret <= 0) {
+			r = ret < 0 ? ret : -EIO;
+			break;
+		}
+
+		req->length = ret;
+		ret = usb_ep_queue(dev->bulk_in, req, GFP_KERNEL);
+		if (ret < 0) {
+			printk("[%s] usb_ep_queue failed %d\n", __func__, ret);
+			dev->error = 1;
+			r = -EIO;
+			break;
+		}
+
+		count -= req->length;
+
+		/* zero this so we don't try to free it on error exit */
+		req = 0;
+	}
+
+	if (req)
+		req_put(dev, &dev->tx_idle, req);
+
+	DEBUG_MTPW("[%s] returning %d\n", __func__, r);
+	return r;
+}
+
+/*
+ * Write data coming from the host to a file range. Whatever the userspace
+ * read path has already pulled off the bus (the rest of the current
+ * request and anything on rx_done) belongs to this transfer and is
+ * consumed first. All idle rx requests are kept queued so the host can
+ * fill them while the previous one is written to the page cache.
+ * Returns 0 or a negative errno, like mtpg_send_file().
+ */
+static int mtpg_receive_file(struct mtpg_dev *dev, struct file *filp,
+				loff_t offset, int64_t count)
+{
+	struct usb_request *req;
+	int r = 0, xfer;
+	int ret;
+
+	DEBUG_MTPR("[%s] offset %lld count %lld\n", __func__, offset, count);
+
+	if (dev->read_count > 0) {
+		if (dev->read_count < count)
+			xfer = dev->read_count;
+		else
+			xfer = count;
+
+		ret = vfs_write(filp, dev->read_buf, xfer, &offset);
+		if (ret != xfer)
+			return -EIO;
+
+		dev->read_buf += xfer;
+		dev->read_count -= xfer;
+		count -= xfer;
+
+		if (dev->read_count == 0) {
+			req_put(dev, &dev->rx_idle, dev->read_req);
+			dev->read_req = 0;
+		}
+	}
+
+	while (count > 0) {
+		if (dev->error || dev->xfer_cancel) {
+			r = dev->xfer_cancel ? -ECANCELED : -EIO;
+			break;
+		}
+
+		while ((req = req_get(dev, &dev->rx_idle))) {
+			req->length = BULK_BUFFER_SIZE;
+			ret = usb_ep_queue(dev->bulk_out, req, GFP_KERNEL);
+			if (ret < 0) {
+				printk("[%s] usb_ep_queue failed %d\n",
+					__func__, ret);
+				req_put(dev, &dev->rx_idle, req);
+				dev->error = 1;
+				break;
+			}
+		}
+
+		req = 0;
+		wait_event(dev->read_wq, ((req = req_get(dev, &dev->rx_done))
+				|| dev->error || dev->xfer_cancel));
+		if (!req)
+			continue;
+
+		if (req->actual < count)
+			xfer = req->actual;
+		else
+			xfer = count;
+
+		ret = vfs_write(filp, req->buf, xfer, &offset);
+		if (ret != xfer) {
+			req_put(dev, &dev->rx_idle, req);
+			r = -EIO;
+			break;
+		}
+		count -= xfer;
+
+		/* anything past the range is left for mtpg_read() */
+		if (xfer < req->actual) {
+			dev->read_req = req;
+			dev->read_buf = req->buf + xfer;
+			dev->read_count = req->actual - xfer;
+		} else {
+			req_put(dev, &dev->rx_idle, req);
+		}
+	}
+
+	DEBUG_MTPR("[%s] returning %d\n", __func__, r);
+	return r;
+}
+
+static void mtpg_send_file_work(struct work_struct *work)
+{
+	struct mtpg_dev *dev = container_of(work, struct mtpg_dev,
+						send_file_work);
+
+	dev->xfer_result = mtpg_send_file(dev, dev->xfer_file,
+				dev->xfer_file_offset, dev->xfer_file_length);
+}
+
+static void mtpg_receive_file_work(struct work_struct *work)
+{
+	struct mtpg_dev *dev = container_of(work, struct mtpg_dev,
+						receive_file_work);
+
+	dev->xfer_result = mtpg_receive_file(dev, dev->xfer_file,
+				dev->xfer_file_offset, dev->xfer_file_length);
+}
+
+static long mtpg_file_ioctl(struct mtpg_dev *dev, unsigned int code,
+				unsigned long arg)
+{
+	struct mtp_file_range mfr;
+	struct file *filp;
+	atomic_t *excl;
+	int ret;
+
+	if (copy_from_user(&mfr, (void __user *)arg, sizeof(mfr)))
+		return -EFAULT;
+
+	if (code == MTP_SEND_FILE)
+		excl = &dev->write_excl;
+	else
+		excl = &dev->read_excl;
+
+	if (_lock(&dev->ioctl_excl))
+		return -EBUSY;
+	if (_lock(excl)) {
+		_unlock(&dev->ioctl_excl);
+		return -EBUSY;
+	}
+
+	if (!dev->online || dev->error) {
+		ret = -EIO;
+		goto out;
+	}
+
+	filp = fget(mfr.fd);
+	if (!filp) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	dev->xfer_file = filp;
+	dev->xfer_file_offset = mfr.offset;
+	dev->xfer_file_length = mfr.length;
+	dev->xfer_cancel = 0;
+
+	if (code == MTP_SEND_FILE)
+		queue_work(dev->wq, &dev->send_file_work);
+	else
+		queue_work(dev->wq, &dev->receive_file_work);
+	flush_workqueue(dev->wq);
+
+	ret = dev->xfer_result;
+	dev->xfer_file = NULL;
+	fput(filp);
+
+out:
+	_unlock(excl);
+	_unlock(&dev->ioctl_excl);
+	return ret;
+}
+
 /*Fixme for Interrupt Transfer*/
 static void interrupt_complete(struct usb_ep *ep, struct usb_request *req )
 {
@@ -647,6 +883,11 @@ static long  mtpg_ioctl(struct file *fd, unsigned int code, unsigned long arg)
 	DEBUG_MTPB("[%s] \tline = [%d] \n", __func__,__LINE__);
 
 	switch (code) {
+		case MTP_SEND_FILE:
+		case MTP_RECEIVE_FILE:
+			status = mtpg_file_ioctl(dev, code, arg);
+			break;
+
 		case MTP_ACM_ENABLE:
 			DEBUG_MTPB("[%s]\tline[%d] MTP_ACM_ENABLE \n", __func__,__LINE__);
 //			mtp_enable();
@@ -900,6 +1141,7 @@ static void mtpg_function_unbind(struct usb_configuration *c, struct usb_functio
 	spin_unlock_irq(&dev->lock);
 
 	misc_deregister(&mtpg_device);
+	destroy_workqueue(dev->wq);
 	kfree(the_mtpg);
 	the_mtpg = NULL;
 }
@@ -1102,6 +1344,7 @@ static void mtpg_function_disable(struct usb_function *f)
 	dev->bulk_out->driver_data = NULL;
 
 	wake_up(&dev->read_wq);
+	wake_up(&dev->write_wq);
 }
 
 
@@ -1135,6 +1378,10 @@ static void mtp_complete_cancel_io(struct usb_ep *ep,
 		/*Debugging*/
 		for(i=0;i<USB_PTPREQUEST_CANCELIO_SIZE; i++)
 			DEBUG_MTPB("[%s] cancel_io_buf[%d] = %x \tline = [%d] \n", __func__,i,dev->cancel_io_buf[i],__LINE__);
+		/* abort a running MTP_SEND_FILE / MTP_RECEIVE_FILE */
+		dev->xfer_cancel = 1;
+		wake_up(&dev->read_wq);
+		wake_up(&dev->write_wq);
 		mtp_send_signal(USB_PTPREQUEST_CANCELIO);
 	}
 
@@ -1239,11 +1486,20 @@ int __init mtp_function_add(struct usb_configuration *c)
 	atomic_set(&mtpg->read_excl, 0);
 	atomic_set(&mtpg->write_excl, 0);
 	atomic_set(&mtpg->wintfd_excl, 0);
+	atomic_set(&mtpg->ioctl_excl, 0);
 
 	INIT_LIST_HEAD(&mtpg->rx_idle);
 	INIT_LIST_HEAD(&mtpg->rx_done);
 	INIT_LIST_HEAD(&mtpg->tx_idle);
 
+	mtpg->wq = create_singlethread_workqueue("f_mtp");
+	if (!mtpg->wq) {
+		kfree(mtpg);
+		return -ENOMEM;
+	}
+	INIT_WORK(&mtpg->send_file_work, mtpg_send_file_work);
+	INIT_WORK(&mtpg->receive_file_work, mtpg_receive_file_work);
+
 	mtpg->function.name = longname;
 	mtpg->function.strings = dev_strings;
 //Test the switch
@@ -1281,6 +1537,7 @@ err_usb_add_function:
 	misc_deregister(&mtpg_device);
 
 err_misc_register:
+	destroy_workqueue(mtpg->wq);
 	kfree(mtpg);
 	printk("mtp gadget driver failed to initialize !!! \n");
 	return rc;
@@ -274,6 +274,12 @@ struct fsg_lun {
 	u32		sense_data_info;
 	u32		unit_attention_data;
 
+	/* Where the last read ended, to spot sequential streams, and how
+	 * much to read ahead from there once the status is sent */
+	loff_t		next_read_offset;
+	unsigned int	seq_reads;
+	u32		read_ahead_len;
+
 	struct device	dev;
 };
 
@@ -289,8 +295,13 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define EP0_BUFSIZE	256
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
-/* Number of buffers we will use.  2 is enough for double-buffering */
+/* Number of buffers we will use.  2 is enough for double-buffering,
+ * more let the USB and backing file I/O run further apart. */
+#ifdef CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS
+#define FSG_NUM_BUFFERS	CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS
+#else
 #define FSG_NUM_BUFFERS	2
+#endif
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
@@ -625,6 +636,9 @@ static int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 	curlun->filp = filp;
 	curlun->file_length = size;
 	curlun->num_sectors = num_sectors;
+	curlun->next_read_offset = 0;
+	curlun->seq_reads = 0;
+	curlun->read_ahead_len = 0;
 	LDBG(curlun, "open backing file: %s\n", filename);
 	rc = 0;
 
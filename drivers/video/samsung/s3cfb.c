@@ -152,13 +152,85 @@ static int s3cfb_draw_logo(struct fb_info *fb)
 	return 0;
 }
 #endif
+/*
+ * Called at every vsync with vsync_lock held. The address programmed here
+ * is picked up by the shadow registers at the next frame start, so a flip
+ * is only reported as done one vsync after it left the queue.
+ */
+static void s3cfb_latch_flips(struct s3cfb_global *fbdev)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	int i;
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		if (win->flip_latching) {
+			win->flip_latching = 0;
+			win->flip_done++;
+		}
+
+		if (win->flip_count) {
+			s3cfb_set_buffer_address_at(fbdev, i,
+					win->flip_yoffset[win->flip_head]);
+			win->flip_head = (win->flip_head + 1) %
+						S3CFB_FLIP_QUEUE_LEN;
+			win->flip_count--;
+			win->flip_latching = 1;
+		}
+	}
+}
+
+/* Put the newest queued buffer up right away, e.g. before the panel stops. */
+static void s3cfb_flush_flips(struct s3cfb_global *fbdev)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	unsigned long flags;
+	int i, last;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		if (win->flip_count) {
+			last = (win->flip_head + win->flip_count - 1) %
+						S3CFB_FLIP_QUEUE_LEN;
+			s3cfb_set_buffer_address_at(fbdev, i,
+					win->flip_yoffset[last]);
+			win->flip_done += win->flip_count;
+			win->flip_count = 0;
+		}
+
+		if (win->flip_latching) {
+			win->flip_latching = 0;
+			win->flip_done++;
+		}
+	}
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	wake_up_interruptible_all(&fbdev->vsync_wq);
+}
+
 static irqreturn_t s3cfb_irq_frame(int irq, void *data)
 {
 	struct s3cfb_global *fbdev = (struct s3cfb_global *)data;
 
 	s3cfb_clear_interrupt(fbdev);
 
-	complete_all(&fbdev->fb_complete);
+	spin_lock(&fbdev->vsync_lock);
+	fbdev->vsync_timestamp = ktime_get();
+	fbdev->vsync_count++;
+	s3cfb_latch_flips(fbdev);
+	spin_unlock(&fbdev->vsync_lock);
+
+	wake_up_interruptible_all(&fbdev->vsync_wq);
+
+	if (fbdev->vsync_sd)
+		sysfs_notify_dirent(fbdev->vsync_sd);
 
 	return IRQ_HANDLED;
 }
@@ -179,7 +251,6 @@ static int s3cfb_init_global(struct s3cfb_global *ctrl)
 	ctrl->output = OUTPUT_RGB;
 	ctrl->rgb_mode = MODE_RGB_P;
 
-	init_completion(&ctrl->fb_complete);
 	mutex_init(&ctrl->lock);
 
 	s3cfb_set_output(ctrl);
@@ -502,12 +573,41 @@ static int s3cfb_blank(int blank_mode, struct fb_info *fb)
 
 	return 0;
 }
+static int s3cfb_queue_flip(struct s3cfb_global *fbdev,
+			    struct s3cfb_window *win, u32 yoffset)
+{
+	unsigned long flags;
+	int ret, tail;
+
+	/* only the fb_info owner queues, so the count can only drop here */
+	ret = wait_event_interruptible_timeout(fbdev->vsync_wq,
+			win->flip_count < S3CFB_FLIP_QUEUE_LEN,
+			msecs_to_jiffies(100));
+	if (ret == 0)
+		return -ETIMEDOUT;
+	if (ret < 0)
+		return ret;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+	tail = (win->flip_head + win->flip_count) % S3CFB_FLIP_QUEUE_LEN;
+	win->flip_yoffset[tail] = yoffset;
+	win->flip_count++;
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	dev_dbg(fbdev->dev, "[fb%d] queued flip to yoffset %d\n",
+		win->id, yoffset);
+
+	return 0;
+}
+
 static int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 {
 	struct fb_fix_screeninfo *fix = &fb->fix;
 	struct s3cfb_window *win = fb->par;
 	struct s3cfb_global *fbdev =
 		platform_get_drvdata(to_platform_device(fb->device));
+	unsigned long flags;
+	int ret;
 
 	if (var->yoffset + var->yres > var->yres_virtual) {
 		dev_err(fbdev->dev, "invalid yoffset value\n");
@@ -517,13 +617,26 @@ static int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 	if (win->owner == DMA_MEM_OTHER)
 		fix->smem_start = win->other_mem_addr;
 
+	if (var->activate & FB_ACTIVATE_VBL) {
+		ret = s3cfb_queue_flip(fbdev, win, var->yoffset);
+		if (ret != -ETIMEDOUT)
+			return ret;
+
+		/* no vsync coming (interrupt off or panel down) */
+		dev_dbg(fbdev->dev, "[fb%d] flip queue stalled\n", win->id);
+	}
+
 	fb->var.yoffset = var->yoffset;
 
 	dev_dbg(fbdev->dev,
 		"[fb%d] yoffset for pan display: %d\n",
 		win->id, var->yoffset);
 
+	/* an immediate pan overrides whatever was still queued */
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+	win->flip_count = 0;
 	s3cfb_set_buffer_address(fbdev, win->id);
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
 
 	return 0;
 }
@@ -613,12 +726,13 @@ static int s3cfb_release(struct fb_info *fb, int user)
 
 static int s3cfb_wait_for_vsync(struct s3cfb_global *ctrl)
 {
+	u32 count = ctrl->vsync_count;
 	int ret;
 
 	dev_dbg(ctrl->dev, "waiting for VSYNC interrupt\n");
 
-	ret = wait_for_completion_interruptible_timeout(
-		&ctrl->fb_complete, msecs_to_jiffies(100));
+	ret = wait_event_interruptible_timeout(ctrl->vsync_wq,
+		ctrl->vsync_count != count, msecs_to_jiffies(100));
 	if (ret == 0)
 		return -ETIMEDOUT;
 	if (ret < 0)
@@ -644,6 +758,7 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		struct s3cfb_user_window user_window;
 		struct s3cfb_user_plane_alpha user_alpha;
 		struct s3cfb_user_chroma user_chroma;
+		struct s3cfb_vsync_info vsync_info;
 		int vsync;
 	} p;
 
@@ -720,6 +835,20 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		}
 		break;
 
+	case S3CFB_GET_VSYNC_INFO:
+		spin_lock_irq(&fbdev->vsync_lock);
+		p.vsync_info.timestamp = ktime_to_ns(fbdev->vsync_timestamp);
+		p.vsync_info.count = fbdev->vsync_count;
+		p.vsync_info.flip_done = win->flip_done;
+		p.vsync_info.flip_pending = win->flip_count +
+						win->flip_latching;
+		spin_unlock_irq(&fbdev->vsync_lock);
+
+		if (copy_to_user((void *)arg, &p.vsync_info,
+				 sizeof(p.vsync_info)))
+			ret = -EFAULT;
+		break;
+
 	case S3CFB_GET_CURR_FB_INFO:
 		next_fb_info.phy_start_addr = fix->smem_start;
 		next_fb_info.xres = var->xres;
@@ -961,6 +1090,26 @@ static int s3cfb_sysfs_store_win_power(struct device *dev,
 static DEVICE_ATTR(win_power, S_IRUGO | S_IWUSR,
 		   s3cfb_sysfs_show_win_power, s3cfb_sysfs_store_win_power);
 
+/* "<count> <timestamp ns>" of the last vsync; poll() wakes on every vsync */
+static ssize_t s3cfb_sysfs_show_vsync_time(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct s3cfb_global *fbdev =
+		platform_get_drvdata(to_platform_device(dev));
+	ktime_t timestamp;
+	u32 count;
+
+	spin_lock_irq(&fbdev->vsync_lock);
+	timestamp = fbdev->vsync_timestamp;
+	count = fbdev->vsync_count;
+	spin_unlock_irq(&fbdev->vsync_lock);
+
+	return sprintf(buf, "%u %llu\n", count,
+			(unsigned long long)ktime_to_ns(timestamp));
+}
+
+static DEVICE_ATTR(vsync_time, S_IRUGO, s3cfb_sysfs_show_vsync_time, NULL);
+
 static int __devinit s3cfb_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fb *pdata;
@@ -977,6 +1126,10 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 	}
 	fbdev->dev = &pdev->dev;
 
+	/* not in s3cfb_init_global(), late resume may have vsync waiters */
+	spin_lock_init(&fbdev->vsync_lock);
+	init_waitqueue_head(&fbdev->vsync_wq);
+
 	fbdev->regulator = regulator_get(&pdev->dev, "pd");
 	if (!fbdev->regulator) {
 		dev_err(fbdev->dev, "failed to get regulator\n");
@@ -1123,6 +1276,13 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 	if (ret < 0)
 		dev_err(fbdev->dev, "failed to add sysfs entries\n");
 
+	ret = device_create_file(&(pdev->dev), &dev_attr_vsync_time);
+	if (ret < 0)
+		dev_err(fbdev->dev, "failed to add sysfs entries\n");
+	else
+		fbdev->vsync_sd = sysfs_get_dirent(pdev->dev.kobj.sd, NULL,
+						   "vsync_time");
+
 	dev_info(fbdev->dev, "registered successfully\n");
 
 	return 0;
@@ -1185,6 +1345,11 @@ static int __devexit s3cfb_remove(struct platform_device *pdev)
 #endif
 
 	free_irq(fbdev->irq, fbdev);
+
+	if (fbdev->vsync_sd)
+		sysfs_put(fbdev->vsync_sd);
+	device_remove_file(&(pdev->dev), &dev_attr_vsync_time);
+
 	iounmap(fbdev->regs);
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -1230,6 +1395,7 @@ void s3cfb_early_suspend(struct early_suspend *h)
 	s3c_mdnie_stop();
 #endif
 
+	s3cfb_flush_flips(fbdev);
 	s3cfb_display_off(fbdev);
 #ifdef CONFIG_FB_S3C_MDNIE
 	s3c_mdnie_off();
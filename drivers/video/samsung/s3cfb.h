@@ -16,6 +16,9 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/sysfs.h>
 #include <linux/fb.h>
 #ifdef CONFIG_HAS_WAKELOCK
 #include <linux/wakelock.h>
@@ -29,6 +32,7 @@
  *
 */
 #define S3CFB_NAME		"s3cfb"
+#define S3CFB_FLIP_QUEUE_LEN	2
 
 #define S3CFB_AVALUE(r, g, b)	(((r & 0xf) << 8) | \
 				((g & 0xf) << 4) | \
@@ -207,6 +211,13 @@ struct s3cfb_window {
 	unsigned int		pseudo_pal[16];
 	struct			s3cfb_alpha alpha;
 	struct			s3cfb_chroma chroma;
+
+	/* pan requests waiting for vsync, protected by vsync_lock */
+	u32			flip_yoffset[S3CFB_FLIP_QUEUE_LEN];
+	int			flip_head;
+	int			flip_count;
+	int			flip_latching;
+	u32			flip_done;
 };
 
 /*
@@ -231,7 +242,13 @@ struct s3cfb_global {
 	struct regulator	*vlcd;
 	int			irq;
 	struct fb_info		**fb;
-	struct completion	fb_complete;
+
+	/* vsync */
+	spinlock_t		vsync_lock;
+	wait_queue_head_t	vsync_wq;
+	ktime_t			vsync_timestamp;
+	u32			vsync_count;
+	struct sysfs_dirent	*vsync_sd;
 
 	/* fimd */
 	int			enabled;
@@ -289,6 +306,13 @@ struct s3cfb_next_info {
 	unsigned int lcd_offset_y;
 };
 
+struct s3cfb_vsync_info {
+	__u64 timestamp;		/* ns, monotonic clock */
+	__u32 count;			/* vsync interrupts so far */
+	__u32 flip_done;		/* flips of this window on screen */
+	__u32 flip_pending;		/* flips still waiting for vsync */
+};
+
 /*
  * C U S T O M  I O C T L S
  *
@@ -312,6 +336,8 @@ struct s3cfb_next_info {
 #define S3CFB_SET_WIN_ADDR		_IOW('F', 309, unsigned long)
 #define S3CFB_SET_WIN_MEM		_IOW('F', 310, \
 						enum s3cfb_mem_owner_t)
+#define S3CFB_GET_VSYNC_INFO		_IOR('F', 311, \
+						struct s3cfb_vsync_info)
 
 /*
  * E X T E R N S
@@ -347,6 +373,8 @@ extern int s3cfb_set_alpha_blending(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id);
+extern int s3cfb_set_buffer_address_at(struct s3cfb_global *ctrl, int id,
+					u32 yoffset);
 extern int s3cfb_set_buffer_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_chroma_key(struct s3cfb_global *ctrl, int id);
 
@@ -568,6 +568,12 @@ int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id)
 }
 
 int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
+{
+	return s3cfb_set_buffer_address_at(ctrl, id, ctrl->fb[id]->var.yoffset);
+}
+
+int s3cfb_set_buffer_address_at(struct s3cfb_global *ctrl, int id,
+				u32 yoffset)
 {
 	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
@@ -577,7 +583,7 @@ int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
 
 	if (fix->smem_start) {
 		start_addr = fix->smem_start + (var->xres_virtual *
-				(var->bits_per_pixel / 8) * var->yoffset);
+				(var->bits_per_pixel / 8) * yoffset);
 
 		end_addr = start_addr + fix->line_length * var->yres;
 	}
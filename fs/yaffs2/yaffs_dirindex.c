@@ -0,0 +1,218 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yaffs_dirindex.h"
+#include "yaffs_trace.h"
+
+/*
+ * Directory name index.
+ *
+ * yaffs_FindObjectByName() used to walk every child of a directory and
+ * compare name sums. Large directories get a hash of their children keyed
+ * by the name sum instead, built on the first lookup that finds the
+ * directory big enough and kept up to date as children come and go or are
+ * renamed. Children whose name has not been loaded yet (lazy loading, or
+ * lost+found entries that only have a made-up name) are kept on a side
+ * list that lookups always check.
+ */
+
+static Y_INLINE int yaffs_DirIndexHash(__u16 sum, int nBuckets)
+{
+	/* Name sums cluster badly, so spread them before masking */
+	return (((__u32)sum * 0x9E3779B1U) >> 16) & (nBuckets - 1);
+}
+
+struct ylist_head *yaffs_DirIndexBucket(yaffs_DirIndex *index, __u16 sum)
+{
+	return &index->buckets[yaffs_DirIndexHash(sum, index->nBuckets)];
+}
+
+static int yaffs_DirIndexSummed(yaffs_Object *obj)
+{
+	return !obj->lazyLoaded && obj->sum != 0 &&
+		obj->objectId != YAFFS_OBJECTID_LOSTNFOUND;
+}
+
+static struct ylist_head *yaffs_DirIndexAllocBuckets(yaffs_Device *dev,
+						     int nBuckets)
+{
+	struct ylist_head *buckets;
+	int i;
+
+	buckets = YMALLOC(nBuckets * sizeof(struct ylist_head));
+	if (!buckets)
+		return NULL;
+
+	for (i = 0; i < nBuckets; i++)
+		YINIT_LIST_HEAD(&buckets[i]);
+
+	dev->dirIndexBytes += nBuckets * sizeof(struct ylist_head);
+	return buckets;
+}
+
+static void yaffs_DirIndexFreeBuckets(yaffs_Device *dev,
+				      struct ylist_head *buckets, int nBuckets)
+{
+	YFREE(buckets);
+	dev->dirIndexBytes -= nBuckets * sizeof(struct ylist_head);
+}
+
+static void yaffs_DirIndexInsert(yaffs_DirIndex *index, yaffs_Object *obj)
+{
+	if (yaffs_DirIndexSummed(obj))
+		ylist_add(&obj->nameLink, yaffs_DirIndexBucket(index, obj->sum));
+	else
+		ylist_add(&obj->nameLink, &index->unsummed);
+}
+
+/* Double the bucket count. Failing to allocate just leaves longer chains. */
+static void yaffs_DirIndexGrow(yaffs_DirIndex *index)
+{
+	yaffs_Device *dev = index->dir->myDev;
+	struct ylist_head *oldBuckets = index->buckets;
+	int oldCount = index->nBuckets;
+	struct ylist_head *newBuckets;
+	struct ylist_head *i, *n;
+	yaffs_Object *obj;
+	int b;
+
+	newBuckets = yaffs_DirIndexAllocBuckets(dev, oldCount * 2);
+	if (!newBuckets)
+		return;
+
+	index->buckets = newBuckets;
+	index->nBuckets = oldCount * 2;
+
+	for (b = 0; b < oldCount; b++) {
+		ylist_for_each_safe(i, n, &oldBuckets[b]) {
+			obj = ylist_entry(i, yaffs_Object, nameLink);
+			ylist_del(&obj->nameLink);
+			ylist_add(&obj->nameLink,
+				  yaffs_DirIndexBucket(index, obj->sum));
+		}
+	}
+
+	yaffs_DirIndexFreeBuckets(dev, oldBuckets, oldCount);
+}
+
+int yaffs_DirIndexCreate(yaffs_Object *dir, int nChildren)
+{
+	yaffs_Device *dev = dir->myDev;
+	yaffs_DirIndex *index;
+	int nBuckets = YAFFS_DIR_INDEX_MIN_BUCKETS;
+
+	while (nBuckets < nChildren && nBuckets < YAFFS_DIR_INDEX_MAX_BUCKETS)
+		nBuckets <<= 1;
+
+	index = YMALLOC(sizeof(yaffs_DirIndex));
+	if (!index)
+		return YAFFS_FAIL;
+
+	index->buckets = yaffs_DirIndexAllocBuckets(dev, nBuckets);
+	if (!index->buckets) {
+		YFREE(index);
+		return YAFFS_FAIL;
+	}
+
+	index->nBuckets = nBuckets;
+	index->nEntries = 0;
+	index->dir = dir;
+	YINIT_LIST_HEAD(&index->unsummed);
+	ylist_add(&index->devLink, &dev->dirIndexes);
+
+	dir->variant.directoryVariant.index = index;
+	dev->dirIndexBytes += sizeof(yaffs_DirIndex);
+	dev->nDirIndexes++;
+
+	T(YAFFS_TRACE_OS,
+		(TSTR("yaffs: name index for directory %d, %d buckets" TENDSTR),
+		dir->objectId, nBuckets));
+
+	return YAFFS_OK;
+}
+
+void yaffs_DirIndexDestroy(yaffs_Object *dir)
+{
+	yaffs_DirIndex *index = dir->variant.directoryVariant.index;
+	yaffs_Device *dev = dir->myDev;
+	struct ylist_head *i, *n;
+	int b;
+
+	if (!index)
+		return;
+
+	for (b = 0; b < index->nBuckets; b++)
+		ylist_for_each_safe(i, n, &index->buckets[b])
+			ylist_del_init(i);
+	ylist_for_each_safe(i, n, &index->unsummed)
+		ylist_del_init(i);
+
+	ylist_del(&index->devLink);
+	yaffs_DirIndexFreeBuckets(dev, index->buckets, index->nBuckets);
+	YFREE(index);
+
+	dir->variant.directoryVariant.index = NULL;
+	dev->dirIndexBytes -= sizeof(yaffs_DirIndex);
+	dev->nDirIndexes--;
+}
+
+void yaffs_DirIndexDestroyAll(yaffs_Device *dev)
+{
+	yaffs_DirIndex *index;
+
+	while (!ylist_empty(&dev->dirIndexes)) {
+		index = ylist_entry(dev->dirIndexes.next,
+				    yaffs_DirIndex, devLink);
+		yaffs_DirIndexDestroy(index->dir);
+	}
+}
+
+void yaffs_DirIndexAdd(yaffs_Object *dir, yaffs_Object *obj)
+{
+	yaffs_DirIndex *index = dir->variant.directoryVariant.index;
+
+	if (!index)
+		return;
+
+	yaffs_DirIndexInsert(index, obj);
+	index->nEntries++;
+
+	if (index->nEntries > 2 * index->nBuckets &&
+	    index->nBuckets < YAFFS_DIR_INDEX_MAX_BUCKETS)
+		yaffs_DirIndexGrow(index);
+}
+
+void yaffs_DirIndexRemove(yaffs_Object *obj)
+{
+	yaffs_DirIndex *index;
+
+	if (ylist_empty(&obj->nameLink))
+		return;
+
+	ylist_del_init(&obj->nameLink);
+	index = obj->parent->variant.directoryVariant.index;
+	index->nEntries--;
+}
+
+/* The object's name, and so its sum, changed: move it to the right bucket */
+void yaffs_DirIndexRehash(yaffs_Object *obj)
+{
+	yaffs_DirIndex *index;
+
+	if (ylist_empty(&obj->nameLink))
+		return;
+
+	index = obj->parent->variant.directoryVariant.index;
+	ylist_del(&obj->nameLink);
+	yaffs_DirIndexInsert(index, obj);
+}
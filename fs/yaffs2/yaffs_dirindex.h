@@ -0,0 +1,49 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1 as
+ * published by the Free Software Foundation.
+ *
+ * Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
+ */
+
+/*
+ * In-memory name index for large directories
+ */
+
+#ifndef __YAFFS_DIRINDEX_H__
+#define __YAFFS_DIRINDEX_H__
+
+#include "yaffs_guts.h"
+
+/* A directory gets an index once a lookup finds this many children */
+#define YAFFS_DIR_INDEX_THRESHOLD	32
+#define YAFFS_DIR_INDEX_MIN_BUCKETS	16
+#define YAFFS_DIR_INDEX_MAX_BUCKETS	4096
+
+struct yaffs_DirIndexStruct {
+	struct ylist_head *buckets;	/* children hashed by name sum */
+	int nBuckets;			/* power of 2 */
+	int nEntries;
+	struct ylist_head unsummed;	/* children whose sum is not known yet */
+	struct ylist_head devLink;	/* entry in dev->dirIndexes */
+	yaffs_Object *dir;
+};
+
+int yaffs_DirIndexCreate(yaffs_Object *dir, int nChildren);
+void yaffs_DirIndexDestroy(yaffs_Object *dir);
+void yaffs_DirIndexDestroyAll(yaffs_Device *dev);
+
+void yaffs_DirIndexAdd(yaffs_Object *dir, yaffs_Object *obj);
+void yaffs_DirIndexRemove(yaffs_Object *obj);
+void yaffs_DirIndexRehash(yaffs_Object *obj);
+
+struct ylist_head *yaffs_DirIndexBucket(yaffs_DirIndex *index, __u16 sum);
+
+#endif
@@ -32,6 +32,8 @@
 
 #include "yaffs_nameval.h"
 #include "yaffs_allocator.h"
+#include "yaffs_dirindex.h"
+#include "yaffs_summary.h"
 
 /* Note YAFFS_GC_GOOD_ENOUGH must be <= YAFFS_GC_PASSIVE_THRESHOLD */
 #define YAFFS_GC_GOOD_ENOUGH 2
@@ -43,8 +45,6 @@
 
 /* Robustification (if it ever comes about...) */
 static void yaffs_RetireBlock(yaffs_Device *dev, int blockInNAND);
-static void yaffs_HandleWriteChunkError(yaffs_Device *dev, int chunkInNAND,
-		int erasedOk);
 static void yaffs_HandleWriteChunkOk(yaffs_Device *dev, int chunkInNAND,
 				const __u8 *data,
 				const yaffs_ExtendedTags *tags);
@@ -201,6 +201,7 @@ __u8 *yaffs_GetTempBuffer(yaffs_Device *dev, int lineNo)
 {
 	int i, j;
 
+	YLOCK_TAKE(&dev->cacheLock);
 	dev->tempInUse++;
 	if (dev->tempInUse > dev->maxTemp)
 		dev->maxTemp = dev->tempInUse;
@@ -215,6 +216,7 @@ __u8 *yaffs_GetTempBuffer(yaffs_Device *dev, int lineNo)
 					    dev->tempBuffer[j].line;
 			}
 
+			YLOCK_GIVE(&dev->cacheLock);
 			return dev->tempBuffer[i].buffer;
 		}
 	}
@@ -233,6 +235,7 @@ __u8 *yaffs_GetTempBuffer(yaffs_Device *dev, int lineNo)
 	 */
 
 	dev->unmanagedTempAllocations++;
+	YLOCK_GIVE(&dev->cacheLock);
 	return YMALLOC(dev->nDataBytesPerChunk);
 
 }
@@ -242,14 +245,17 @@ void yaffs_ReleaseTempBuffer(yaffs_Device *dev, __u8 *buffer,
 {
 	int i;
 
+	YLOCK_TAKE(&dev->cacheLock);
 	dev->tempInUse--;
 
 	for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++) {
 		if (dev->tempBuffer[i].buffer == buffer) {
 			dev->tempBuffer[i].line = 0;
+			YLOCK_GIVE(&dev->cacheLock);
 			return;
 		}
 	}
+	YLOCK_GIVE(&dev->cacheLock);
 
 	if (buffer) {
 		/* assume it is an unmanaged one. */
@@ -257,7 +263,9 @@ void yaffs_ReleaseTempBuffer(yaffs_Device *dev, __u8 *buffer,
 		  (TSTR("Releasing unmanaged temp buffer in line %d" TENDSTR),
 		   lineNo));
 		YFREE(buffer);
+		YLOCK_TAKE(&dev->cacheLock);
 		dev->unmanagedTempDeallocations++;
+		YLOCK_GIVE(&dev->cacheLock);
 	}
 
 }
@@ -287,6 +295,80 @@ int yaffs_IsManagedTempBuffer(yaffs_Device *dev, const __u8 *buffer)
 	return 0;
 }
 
+/*
+ * Locking.
+ *
+ * The OS layer serialises everything that changes the namespace or the
+ * device as a whole.  File data I/O may instead run concurrently from
+ * several tasks, each holding the lock of the object it works on:
+ *
+ * obj->lock covers the file size, the tnode tree, nDataChunks and the
+ * object header fields written back by yaffs_UpdateObjectHeader().
+ *
+ * dev->allocLock covers block info, the chunk bitmap, chunk allocation,
+ * the free chunk counts, summaries, the tnode and object allocator and
+ * garbage collection.  It nests, since gc puts chunks into files and that
+ * can allocate tnodes.  Gc moves chunks belonging to other objects, so it
+ * needs their object locks too: it only ever trylocks them and gives up the
+ * pass (to be resumed later) if one is busy, as they rank above allocLock.
+ * The soft deleted files gc finally removes have no inode, so no file I/O
+ * can be under way on them.
+ *
+ * dev->cacheLock covers the chunk cache lists and entries and the temp
+ * buffers.  Nothing that takes the other locks is called under it.  An
+ * entry with locked set is being filled or written back by its object's
+ * lock holder outside cacheLock, which lets cached data be read with
+ * cacheLock alone (yaffs_ReadCachedDataFromFile).
+ *
+ * Statistics counters are not locked and may be slightly off.
+ */
+
+void yaffs_LockObject(yaffs_Object *obj)
+{
+	YLOCK_TAKE(&obj->lock);
+	obj->lockOwner = Y_CURRENT_TASK();
+}
+
+void yaffs_UnlockObject(yaffs_Object *obj)
+{
+	obj->lockOwner = NULL;
+	YLOCK_GIVE(&obj->lock);
+}
+
+/*
+ * Take an object's lock without waiting, for gc and cache eviction.
+ * Returns 1 if taken, 0 if the caller already holds it (or the OS layer
+ * holds the device exclusively and nobody does), -1 if it is busy.
+ */
+static int yaffs_TryLockObject(yaffs_Object *obj)
+{
+	if (obj->lockOwner == Y_CURRENT_TASK())
+		return 0;
+	if (!YLOCK_TRY(&obj->lock))
+		return -1;
+	obj->lockOwner = Y_CURRENT_TASK();
+	return 1;
+}
+
+static void yaffs_LockAlloc(yaffs_Device *dev)
+{
+	if (dev->allocOwner == Y_CURRENT_TASK()) {
+		dev->allocDepth++;
+		return;
+	}
+	YLOCK_TAKE(&dev->allocLock);
+	dev->allocOwner = Y_CURRENT_TASK();
+	dev->allocDepth = 1;
+}
+
+static void yaffs_UnlockAlloc(yaffs_Device *dev)
+{
+	if (--dev->allocDepth == 0) {
+		dev->allocOwner = NULL;
+		YLOCK_GIVE(&dev->allocLock);
+	}
+}
+
 /*
  * Verification code
  */
@@ -392,6 +474,7 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 	int writeOk = 0;
 	int chunk;
 
+	yaffs_LockAlloc(dev);
 	yaffs2_InvalidateCheckpoint(dev);
 
 	do {
@@ -468,6 +551,8 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 		/* Copy the data into the robustification buffer */
 		yaffs_HandleWriteChunkOk(dev, chunk, data, tags);
 
+		yaffs_SummaryAdd(dev, tags, chunk);
+
 	} while (writeOk != YAFFS_OK &&
 		(yaffs_wr_attempts <= 0 || attempts <= yaffs_wr_attempts));
 
@@ -482,6 +567,7 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 		dev->nRetriedWrites += (attempts - 1);
 	}
 
+	yaffs_UnlockAlloc(dev);
 	return chunk;
 }
 
@@ -555,6 +641,7 @@ static void yaffs_HandleUpdateChunk(yaffs_Device *dev, int chunkInNAND,
 
 void yaffs_HandleChunkError(yaffs_Device *dev, yaffs_BlockInfo *bi)
 {
+	yaffs_LockAlloc(dev);
 	if (!bi->gcPrioritise) {
 		bi->gcPrioritise = 1;
 		dev->hasPendingPrioritisedGCs = 1;
@@ -566,9 +653,10 @@ void yaffs_HandleChunkError(yaffs_Device *dev, yaffs_BlockInfo *bi)
 
 		}
 	}
+	yaffs_UnlockAlloc(dev);
 }
 
-static void yaffs_HandleWriteChunkError(yaffs_Device *dev, int chunkInNAND,
+void yaffs_HandleWriteChunkError(yaffs_Device *dev, int chunkInNAND,
 		int erasedOk)
 {
 	int blockInNAND = chunkInNAND / dev->param.nChunksPerBlock;
@@ -622,6 +710,7 @@ void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
 		obj->shortName[0] = _Y('\0');
 #endif
 	obj->sum = yaffs_CalcNameSum(name);
+	yaffs_DirIndexRehash(obj);
 }
 
 void yaffs_SetObjectNameFromOH(yaffs_Object *obj, const yaffs_ObjectHeader *oh)
@@ -646,13 +735,17 @@ void yaffs_SetObjectNameFromOH(yaffs_Object *obj, const yaffs_ObjectHeader *oh)
 
 yaffs_Tnode *yaffs_GetTnode(yaffs_Device *dev)
 {
-	yaffs_Tnode *tn = yaffs_AllocateRawTnode(dev);
+	yaffs_Tnode *tn;
+
+	yaffs_LockAlloc(dev);
+	tn = yaffs_AllocateRawTnode(dev);
 	if (tn){
 		memset(tn, 0, dev->tnodeSize);
 		dev->nTnodes++;
 	}
 
 	dev->nCheckpointBlocksRequired = 0; /* force recalculation*/
+	yaffs_UnlockAlloc(dev);
 
 	return tn;
 }
@@ -660,9 +753,11 @@ yaffs_Tnode *yaffs_GetTnode(yaffs_Device *dev)
 /* FreeTnode frees up a tnode and puts it back on the free list */
 static void yaffs_FreeTnode(yaffs_Device *dev, yaffs_Tnode *tn)
 {
+	yaffs_LockAlloc(dev);
 	yaffs_FreeRawTnode(dev,tn);
 	dev->nTnodes--;
 	dev->nCheckpointBlocksRequired = 0; /* force recalculation*/
+	yaffs_UnlockAlloc(dev);
 }
 
 static void yaffs_DeinitialiseTnodesAndObjects(yaffs_Device *dev)
@@ -896,6 +991,8 @@ static int yaffs_FindChunkInGroup(yaffs_Device *dev, int theChunk,
 {
 	int j;
 
+	/* No allocLock: the bits of this object's own chunks only change
+	 * under its lock, and other objects' chunks fail the tags match. */
 	for (j = 0; theChunk && j < dev->chunkGroupSize; j++) {
 		if (yaffs_CheckChunkBit(dev, theChunk / dev->param.nChunksPerBlock,
 				theChunk % dev->param.nChunksPerBlock)) {
@@ -1230,6 +1327,7 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 		/* Now sweeten it up... */
 
 		memset(obj, 0, sizeof(yaffs_Object));
+		YLOCK_INIT(&obj->lock);
 		obj->beingCreated = 1;
 
 		obj->myDev = dev;
@@ -1238,12 +1336,14 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 		YINIT_LIST_HEAD(&(obj->hardLinks));
 		YINIT_LIST_HEAD(&(obj->hashLink));
 		YINIT_LIST_HEAD(&obj->siblings);
+		YINIT_LIST_HEAD(&obj->nameLink);
 
 
 		/* Now make the directory sane */
 		if (dev->rootDir) {
 			obj->parent = dev->rootDir;
 			ylist_add(&(obj->siblings), &dev->rootDir->variant.directoryVariant.children);
+			yaffs_DirIndexAdd(dev->rootDir, obj);
 		}
 
 		/* Add it to the lost and found directory.
@@ -1309,6 +1409,8 @@ static void yaffs_FreeObject(yaffs_Object *obj)
 	if (!ylist_empty(&obj->siblings))
 		YBUG();
 
+	if (obj->variantType == YAFFS_OBJECT_TYPE_DIRECTORY)
+		yaffs_DirIndexDestroy(obj);
 
 	if (obj->myInode) {
 		/* We're still hooked up to a cached inode.
@@ -1491,6 +1593,7 @@ yaffs_Object *yaffs_CreateNewObject(yaffs_Device *dev, int number,
 					children);
 			YINIT_LIST_HEAD(&theObject->variant.directoryVariant.
 					dirty);
+			theObject->variant.directoryVariant.index = NULL;
 			break;
 		case YAFFS_OBJECT_TYPE_SYMLINK:
 		case YAFFS_OBJECT_TYPE_HARDLINK:
@@ -1924,6 +2027,14 @@ void yaffs_BlockBecameDirty(yaffs_Device *dev, int blockNo)
 		}
 	}
 
+	/* A summary chunk is never counted free (see yaffs_summary.c), so
+	 * erasing or losing the block has one more chunk to account for.
+	 */
+	if (bi->hasSummary) {
+		dev->nFreeChunks++;
+		bi->hasSummary = 0;
+	}
+
 	if (erasedOk) {
 		/* Clean it up... */
 		bi->blockState = YAFFS_BLOCK_STATE_EMPTY;
@@ -2005,12 +2116,17 @@ int yaffs_CheckSpaceForAllocation(yaffs_Device *dev, int nChunks)
 	int reservedChunks;
 	int reservedBlocks = dev->param.nReservedBlocks;
 	int checkpointBlocks;
+	int ok;
 
+	yaffs_LockAlloc(dev);
 	checkpointBlocks = yaffs2_CalcCheckpointBlocksRequired(dev);
 
 	reservedChunks = ((reservedBlocks + checkpointBlocks) * dev->param.nChunksPerBlock);
 
-	return (dev->nFreeChunks > (reservedChunks + nChunks));
+	ok = (dev->nFreeChunks > (reservedChunks + nChunks));
+	yaffs_UnlockAlloc(dev);
+
+	return ok;
 }
 
 static int yaffs_AllocateChunk(yaffs_Device *dev, int useReserve,
@@ -2107,6 +2223,8 @@ static int yaffs_GarbageCollectBlock(yaffs_Device *dev, int block,
 	int isCheckpointBlock;
 	int matchingChunk;
 	int maxCopies;
+	int locked;
+	int firstBusy = -1;
 
 	int chunksBefore = yaffs_GetErasedChunks(dev);
 	int chunksAfter;
@@ -2175,6 +2293,16 @@ static int yaffs_GarbageCollectBlock(yaffs_Device *dev, int block,
 				    yaffs_FindObjectByNumber(dev,
 							     tags.objectId);
 
+				/* Someone is working on the object: leave
+				 * this chunk for a later pass. */
+				locked = object ? yaffs_TryLockObject(object) : 0;
+				if (locked < 0) {
+					dev->gcObjectBusy++;
+					if (firstBusy < 0)
+						firstBusy = dev->gcChunk;
+					continue;
+				}
+
 				T(YAFFS_TRACE_GC_DETAIL,
 				  (TSTR
 				   ("Collecting chunk in block %d, %d %d %d " TENDSTR),
@@ -2308,9 +2436,14 @@ static int yaffs_GarbageCollectBlock(yaffs_Device *dev, int block,
 				if (retVal == YAFFS_OK)
 					yaffs_DeleteChunk(dev, oldChunk, markNAND, __LINE__);
 
+				if (locked > 0)
+					yaffs_UnlockObject(object);
 			}
 		}
 
+		if (firstBusy >= 0)
+			dev->gcChunk = firstBusy;
+
 		yaffs_ReleaseTempBuffer(dev, buffer, __LINE__);
 
 
@@ -2538,7 +2671,7 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
  * The idea is to help clear out space in a more spread-out manner.
  * Dunno if it really does anything useful.
  */
-static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
+static int yaffs_DoCheckGarbageCollection(yaffs_Device *dev, int background)
 {
 	int aggressive = 0;
 	int gcOk = YAFFS_OK;
@@ -2628,6 +2761,17 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 	return aggressive ? gcOk : YAFFS_OK;
 }
 
+static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
+{
+	int retVal;
+
+	yaffs_LockAlloc(dev);
+	retVal = yaffs_DoCheckGarbageCollection(dev, background);
+	yaffs_UnlockAlloc(dev);
+
+	return retVal;
+}
+
 /*
  * yaffs_BackgroundGarbageCollect()
  * Garbage collects. Intended to be called from a background thread.
@@ -2635,12 +2779,18 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
  */
 int yaffs_BackgroundGarbageCollect(yaffs_Device *dev, unsigned urgency)
 {
-	int erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
+	int erasedChunks;
+	int retVal;
 
 	T(YAFFS_TRACE_BACKGROUND, (TSTR("Background gc %u" TENDSTR),urgency));
 
-	yaffs_CheckGarbageCollection(dev, 1);
-	return erasedChunks > dev->nFreeChunks/2;
+	yaffs_LockAlloc(dev);
+	erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
+	yaffs_DoCheckGarbageCollection(dev, 1);
+	retVal = erasedChunks > dev->nFreeChunks/2;
+	yaffs_UnlockAlloc(dev);
+
+	return retVal;
 }
 
 /*-------------------------  TAGS --------------------------------*/
@@ -2876,6 +3026,7 @@ void yaffs_DeleteChunk(yaffs_Device *dev, int chunkId, int markNAND, int lyn)
 	if (chunkId <= 0)
 		return;
 
+	yaffs_LockAlloc(dev);
 	dev->nDeletions++;
 	block = chunkId / dev->param.nChunksPerBlock;
 	page = chunkId % dev->param.nChunksPerBlock;
@@ -2928,6 +3079,7 @@ void yaffs_DeleteChunk(yaffs_Device *dev, int chunkId, int markNAND, int lyn)
 
 	}
 
+	yaffs_UnlockAlloc(dev);
 }
 
 static int yaffs_WriteChunkDataToObject(yaffs_Object *in, int chunkInInode,
@@ -3150,9 +3302,11 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
 
 			/* If this was a shrink, then mark the block that the chunk lives on */
 			if (isShrink) {
+				yaffs_LockAlloc(dev);
 				bi = yaffs_GetBlockInfo(in->myDev,
 					newChunkId / in->myDev->param.nChunksPerBlock);
 				bi->hasShrinkHeader = 1;
+				yaffs_UnlockAlloc(dev);
 			}
 
 		}
@@ -3176,68 +3330,132 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   Entries in use are hashed on (object, chunkId) and kept on an LRU list so
+ *   that lookup and replacement do not depend on the number of cache chunks;
+ *   this lets the cache be sized up to a few hundred chunks per mount and
+ *   double as a read cache. Dirty entries are also on their own list so that
+ *   flushing only looks at chunks that need writing.
  */
 
+static struct ylist_head *yaffs_CacheBucket(yaffs_Device *dev,
+					const yaffs_Object *obj, int chunkId)
+{
+	__u32 h = obj->objectId * 0x9E3779B1U + chunkId;
+
+	return &dev->srHash[h & dev->srHashMask];
+}
+
+static void yaffs_SetChunkCacheDirty(yaffs_Device *dev, yaffs_ChunkCache *cache,
+				int dirty)
+{
+	if (dirty && !cache->dirty) {
+		ylist_add_tail(&cache->dirtyLink, &dev->srDirty);
+		dev->srDirtyCount++;
+	} else if (!dirty && cache->dirty) {
+		ylist_del_init(&cache->dirtyLink);
+		dev->srDirtyCount--;
+	}
+	cache->dirty = dirty;
+}
+
+/* Attach a free cache entry to a chunk of an object. */
+static void yaffs_AssignChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
+				yaffs_Object *obj, int chunkId)
+{
+	cache->object = obj;
+	cache->chunkId = chunkId;
+	cache->dirty = 0;
+	cache->locked = 0;
+	cache->prefetched = 0;
+	cache->nBytes = 0;
+	ylist_add(&cache->hashLink, yaffs_CacheBucket(dev, obj, chunkId));
+	ylist_del(&cache->lruLink);
+	ylist_add_tail(&cache->lruLink, &dev->srLru);
+}
+
+/* Drop whatever a cache entry holds and put it back on the free list. */
+static void yaffs_ReleaseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache)
+{
+	yaffs_SetChunkCacheDirty(dev, cache, 0);
+	ylist_del_init(&cache->hashLink);
+	ylist_del(&cache->lruLink);
+	ylist_add(&cache->lruLink, &dev->srFree);
+	cache->object = NULL;
+	cache->prefetched = 0;
+}
+
 static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
+	struct ylist_head *i;
 	yaffs_ChunkCache *cache;
-	int nCaches = obj->myDev->param.nShortOpCaches;
+	int retVal = 0;
 
-	for (i = 0; i < nCaches; i++) {
-		cache = &dev->srCache[i];
-		if (cache->object == obj &&
-		    cache->dirty)
-			return 1;
+	YLOCK_TAKE(&dev->cacheLock);
+	ylist_for_each(i, &dev->srDirty) {
+		cache = ylist_entry(i, yaffs_ChunkCache, dirtyLink);
+		if (cache->object == obj) {
+			retVal = 1;
+			break;
+		}
 	}
+	YLOCK_GIVE(&dev->cacheLock);
 
-	return 0;
+	return retVal;
 }
 
 
+/* Write back an object's dirty chunks.  The caller holds the object's lock
+ * (or the device exclusively).  Each entry is marked locked while it is
+ * written out, since that has to be done without cacheLock.
+ */
 static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
 	int lowest = -99;	/* Stop compiler whining. */
-	int i;
+	struct ylist_head *i;
 	yaffs_ChunkCache *cache;
+	yaffs_ChunkCache *c;
 	int chunkWritten = 0;
 	int nCaches = obj->myDev->param.nShortOpCaches;
 
 	if (nCaches > 0) {
+		YLOCK_TAKE(&dev->cacheLock);
 		do {
 			cache = NULL;
 
 			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < nCaches; i++) {
-				if (dev->srCache[i].object == obj &&
-				    dev->srCache[i].dirty) {
-					if (!cache
-					    || dev->srCache[i].chunkId <
-					    lowest) {
-						cache = &dev->srCache[i];
-						lowest = cache->chunkId;
-					}
+			ylist_for_each(i, &dev->srDirty) {
+				c = ylist_entry(i, yaffs_ChunkCache, dirtyLink);
+				if (c->object == obj &&
+				    (!cache || c->chunkId < lowest)) {
+					cache = c;
+					lowest = cache->chunkId;
 				}
 			}
 
-			if (cache && !cache->locked) {
-				/* Write it out and free it up */
-
-				chunkWritten =
-				    yaffs_WriteChunkDataToObject(cache->object,
-								 cache->chunkId,
-								 cache->data,
-								 cache->nBytes,
-								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
+			if (!cache || cache->locked) {
+				cache = NULL;
+				break;
 			}
 
-		} while (cache && chunkWritten > 0);
+			/* Write it out and free it up */
+			cache->locked = 1;
+			YLOCK_GIVE(&dev->cacheLock);
+
+			chunkWritten =
+			    yaffs_WriteChunkDataToObject(cache->object,
+							 cache->chunkId,
+							 cache->data,
+							 cache->nBytes,
+							 1);
+
+			YLOCK_TAKE(&dev->cacheLock);
+			cache->locked = 0;
+			yaffs_ReleaseChunkCache(dev, cache);
+
+		} while (chunkWritten > 0);
+		YLOCK_GIVE(&dev->cacheLock);
 
 		if (cache) {
 			/* Hoosterman, disk full while writing cache out. */
@@ -3251,26 +3469,26 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 
 /*yaffs_FlushEntireDeviceCache(dev)
  *
- *
+ * Called with the device held exclusively, so no object locks are needed.
  */
 
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
 {
 	yaffs_Object *obj;
-	int nCaches = dev->param.nShortOpCaches;
-	int i;
+
+	if (dev->param.nShortOpCaches <= 0)
+		return;
 
 	/* Find a dirty object in the cache and flush it...
 	 * until there are no further dirty objects.
 	 */
 	do {
 		obj = NULL;
-		for (i = 0; i < nCaches && !obj; i++) {
-			if (dev->srCache[i].object &&
-			    dev->srCache[i].dirty)
-				obj = dev->srCache[i].object;
-
-		}
+		YLOCK_TAKE(&dev->cacheLock);
+		if (!ylist_empty(&dev->srDirty))
+			obj = ylist_entry(dev->srDirty.next,
+					yaffs_ChunkCache, dirtyLink)->object;
+		YLOCK_GIVE(&dev->cacheLock);
 		if (obj)
 			yaffs_FlushFilesChunkCache(obj);
 
@@ -3286,30 +3504,50 @@ void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
  */
 static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device *dev)
 {
-	int i;
+	if (dev->param.nShortOpCaches > 0 && !ylist_empty(&dev->srFree))
+		return ylist_entry(dev->srFree.next, yaffs_ChunkCache, lruLink);
 
-	if (dev->param.nShortOpCaches > 0) {
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (!dev->srCache[i].object)
-				return &dev->srCache[i];
+	return NULL;
+}
+
+/* Like the worker, but also evicts the least recently used clean entry.
+ * Never writes anything, so it is safe for read ahead.
+ */
+static yaffs_ChunkCache *yaffs_GrabCleanChunkCache(yaffs_Device *dev)
+{
+	yaffs_ChunkCache *cache;
+	struct ylist_head *i;
+
+	cache = yaffs_GrabChunkCacheWorker(dev);
+	if (cache)
+		return cache;
+
+	ylist_for_each(i, &dev->srLru) {
+		cache = ylist_entry(i, yaffs_ChunkCache, lruLink);
+		if (!cache->locked && !cache->dirty) {
+			yaffs_ReleaseChunkCache(dev, cache);
+			return cache;
 		}
 	}
 
 	return NULL;
 }
 
+/* Called with cacheLock held.  Flushing an object means dropping cacheLock,
+ * so only objects whose lock can be had without waiting are flushed, and
+ * NULL is returned if nothing could be freed up.
+ */
 static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 {
 	yaffs_ChunkCache *cache;
 	yaffs_Object *theObj;
-	int usage;
-	int i;
-	int pushout;
+	struct ylist_head *i;
+	int locked = 0;
 
 	if (dev->param.nShortOpCaches > 0) {
 		/* Try find a non-dirty one... */
 
-		cache = yaffs_GrabChunkCacheWorker(dev);
+		cache = yaffs_GrabCleanChunkCache(dev);
 
 		if (!cache) {
 			/* They were all dirty, find the last recently used object and flush
@@ -3321,25 +3559,27 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 			/* With locking we can't assume we can use entry zero */
 
 			theObj = NULL;
-			usage = -1;
-			cache = NULL;
-			pushout = -1;
 
-			for (i = 0; i < dev->param.nShortOpCaches; i++) {
-				if (dev->srCache[i].object &&
-				    !dev->srCache[i].locked &&
-				    (dev->srCache[i].lastUse < usage || !cache)) {
-					usage = dev->srCache[i].lastUse;
-					theObj = dev->srCache[i].object;
-					cache = &dev->srCache[i];
-					pushout = i;
+			ylist_for_each(i, &dev->srLru) {
+				cache = ylist_entry(i, yaffs_ChunkCache, lruLink);
+				if (!cache->locked) {
+					locked = yaffs_TryLockObject(cache->object);
+					if (locked >= 0) {
+						theObj = cache->object;
+						break;
+					}
 				}
 			}
 
-			if (!cache || cache->dirty) {
+			cache = NULL;
+			if (theObj) {
 				/* Flush and try again */
+				YLOCK_GIVE(&dev->cacheLock);
 				yaffs_FlushFilesChunkCache(theObj);
-				cache = yaffs_GrabChunkCacheWorker(dev);
+				if (locked > 0)
+					yaffs_UnlockObject(theObj);
+				YLOCK_TAKE(&dev->cacheLock);
+				cache = yaffs_GrabCleanChunkCache(dev);
 			}
 
 		}
@@ -3349,23 +3589,46 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 
 }
 
+/* Look up a cached chunk without touching the statistics */
+static yaffs_ChunkCache *yaffs_LookupChunkCache(const yaffs_Object *obj,
+						int chunkId)
+{
+	yaffs_Device *dev = obj->myDev;
+	struct ylist_head *i;
+	yaffs_ChunkCache *cache;
+
+	if (dev->param.nShortOpCaches > 0) {
+		ylist_for_each(i, yaffs_CacheBucket(dev, obj, chunkId)) {
+			cache = ylist_entry(i, yaffs_ChunkCache, hashLink);
+			if (cache->object == obj &&
+			    cache->chunkId == chunkId)
+				return cache;
+		}
+	}
+	return NULL;
+}
+
 /* Find a cached chunk */
 static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
 					      int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
-	if (dev->param.nShortOpCaches > 0) {
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
-				dev->cacheHits++;
+	yaffs_ChunkCache *cache;
 
-				return &dev->srCache[i];
-			}
+	if (dev->param.nShortOpCaches <= 0)
+		return NULL;
+
+	cache = yaffs_LookupChunkCache(obj, chunkId);
+	if (cache) {
+		dev->cacheHits++;
+		if (cache->prefetched) {
+			dev->cachePrefetchHits++;
+			cache->prefetched = 0;
 		}
-	}
-	return NULL;
+	} else
+		dev->cacheMisses++;
+
+	return cache;
 }
 
 /* Mark the chunk for the least recently used algorithym */
@@ -3374,21 +3637,59 @@ static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
 {
 
 	if (dev->param.nShortOpCaches > 0) {
-		if (dev->srLastUse < 0 || dev->srLastUse > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->param.nShortOpCaches; i++)
-				dev->srCache[i].lastUse = 0;
+		ylist_del(&cache->lruLink);
+		ylist_add_tail(&cache->lruLink, &dev->srLru);
+
+		if (isAWrite)
+			yaffs_SetChunkCacheDirty(dev, cache, 1);
+	}
+}
 
-			dev->srLastUse = 0;
+/* Read ahead the chunks following chunkId into the cache.
+ * Only free or clean entries are used so this never causes a write, and
+ * holes and chunks past the end of file are skipped.
+ */
+static void yaffs_PrefetchChunkCache(yaffs_Object *in, int chunkId)
+{
+	yaffs_Device *dev = in->myDev;
+	yaffs_ChunkCache *cache;
+	loff_t fileSize = in->variant.fileVariant.fileSize;
+	int chunk;
+	int i;
+
+	for (i = 1; i <= dev->param.nPrefetchChunks; i++) {
+		chunk = chunkId + i;
+
+		if ((loff_t)(chunk - 1) * dev->nDataBytesPerChunk >= fileSize)
+			break;
+
+		YLOCK_TAKE(&dev->cacheLock);
+		cache = yaffs_LookupChunkCache(in, chunk);
+		YLOCK_GIVE(&dev->cacheLock);
+		if (cache)
+			continue;
+
+		if (yaffs_FindChunkInFile(in, chunk, NULL) <= 0)
+			continue;
+
+		YLOCK_TAKE(&dev->cacheLock);
+		cache = yaffs_GrabCleanChunkCache(dev);
+		if (!cache) {
+			YLOCK_GIVE(&dev->cacheLock);
+			break;
 		}
 
-		dev->srLastUse++;
+		yaffs_AssignChunkCache(dev, cache, in, chunk);
+		cache->prefetched = 1;
+		cache->locked = 1;
+		YLOCK_GIVE(&dev->cacheLock);
 
-		cache->lastUse = dev->srLastUse;
+		yaffs_ReadChunkDataFromObject(in, chunk, cache->data);
 
-		if (isAWrite)
-			cache->dirty = 1;
+		YLOCK_TAKE(&dev->cacheLock);
+		cache->locked = 0;
+		dev->cachePrefetches++;
+		YLOCK_GIVE(&dev->cacheLock);
 	}
 }
 
@@ -3398,11 +3699,16 @@ static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
  */
 static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
 {
-	if (object->myDev->param.nShortOpCaches > 0) {
-		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
+	yaffs_Device *dev = object->myDev;
 
+	if (dev->param.nShortOpCaches > 0) {
+		yaffs_ChunkCache *cache;
+
+		YLOCK_TAKE(&dev->cacheLock);
+		cache = yaffs_LookupChunkCache(object, chunkId);
 		if (cache)
-			cache->object = NULL;
+			yaffs_ReleaseChunkCache(dev, cache);
+		YLOCK_GIVE(&dev->cacheLock);
 	}
 }
 
@@ -3411,15 +3717,22 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
  */
 static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in)
 {
-	int i;
+	struct ylist_head *i;
+	struct ylist_head *n;
+	yaffs_ChunkCache *cache;
 	yaffs_Device *dev = in->myDev;
 
 	if (dev->param.nShortOpCaches > 0) {
 		/* Invalidate it. */
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (dev->srCache[i].object == in)
-				dev->srCache[i].object = NULL;
+		YLOCK_TAKE(&dev->cacheLock);
+		ylist_for_each_safe(i, n, &dev->srLru) {
+			cache = ylist_entry(i, yaffs_ChunkCache, lruLink);
+			if (cache->object == in)
+				yaffs_ReleaseChunkCache(dev, cache);
 		}
+		if (dev->srSeqObject == in)
+			dev->srSeqObject = NULL;
+		YLOCK_GIVE(&dev->cacheLock);
 	}
 }
 
@@ -3463,6 +3776,7 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 		else
 			nToCopy = dev->nDataBytesPerChunk - start;
 
+		YLOCK_TAKE(&dev->cacheLock);
 		cache = yaffs_FindChunkCache(in, chunk);
 
 		/* If the chunk is already in the cache or it is less than a whole chunk
@@ -3470,32 +3784,46 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 		 * else bypass the cache.
 		 */
 		if (cache || nToCopy != dev->nDataBytesPerChunk || dev->param.inbandTags) {
-			if (dev->param.nShortOpCaches > 0) {
+			int missed = !cache;
 
-				/* If we can't find the data in the cache, then load it up. */
+			/* If we can't find the data in the cache, then load it up. */
+			if (!cache)
+				cache = yaffs_GrabChunkCache(dev);
 
-				if (!cache) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+			if (cache) {
+				int prefetch;
+
+				if (missed) {
+					yaffs_AssignChunkCache(dev, cache, in, chunk);
+					cache->locked = 1;
+					YLOCK_GIVE(&dev->cacheLock);
 					yaffs_ReadChunkDataFromObject(in, chunk,
 								      cache->
 								      data);
-					cache->nBytes = 0;
+					YLOCK_TAKE(&dev->cacheLock);
+					cache->locked = 0;
 				}
 
 				yaffs_UseChunkCache(dev, cache, 0);
 
-				cache->locked = 1;
+				memcpy(buffer, &cache->data[start], nToCopy);
 
+				/* A miss right after the previous chunk: read ahead. */
+				prefetch = missed && dev->param.nPrefetchChunks > 0 &&
+				    dev->srSeqObject == in &&
+				    dev->srSeqChunk == chunk - 1;
 
-				memcpy(buffer, &cache->data[start], nToCopy);
+				dev->srSeqObject = in;
+				dev->srSeqChunk = chunk;
+				YLOCK_GIVE(&dev->cacheLock);
 
-				cache->locked = 0;
+				if (prefetch)
+					yaffs_PrefetchChunkCache(in, chunk);
 			} else {
-				/* Read into the local buffer then copy..*/
+				YLOCK_GIVE(&dev->cacheLock);
+
+				/* No cache entry to be had.
+				 * Read into the local buffer then copy..*/
 
 				__u8 *localBuffer =
 				    yaffs_GetTempBuffer(dev, __LINE__);
@@ -3510,6 +3838,7 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 			}
 
 		} else {
+			YLOCK_GIVE(&dev->cacheLock);
 
 			/* A full chunk. Read directly into the supplied buffer. */
 			yaffs_ReadChunkDataFromObject(in, chunk, buffer);
@@ -3526,6 +3855,61 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 	return nDone;
 }
 
+/* Read what can be had from the chunk cache without the object lock, for
+ * callers that do not hold it.  Stops at the first chunk that is not cached
+ * (or is being filled) and returns the number of bytes copied.
+ */
+int yaffs_ReadCachedDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
+			int nBytes)
+{
+	int chunk;
+	__u32 start;
+	int nToCopy;
+	int n = nBytes;
+	int nDone = 0;
+	yaffs_ChunkCache *cache;
+
+	yaffs_Device *dev;
+
+	dev = in->myDev;
+
+	if (dev->param.nShortOpCaches <= 0)
+		return 0;
+
+	YLOCK_TAKE(&dev->cacheLock);
+	while (n > 0) {
+		yaffs_AddrToChunk(dev, offset, &chunk, &start);
+		chunk++;
+
+		if ((start + n) < dev->nDataBytesPerChunk)
+			nToCopy = n;
+		else
+			nToCopy = dev->nDataBytesPerChunk - start;
+
+		cache = yaffs_LookupChunkCache(in, chunk);
+		if (!cache || cache->locked)
+			break;
+
+		if (cache->prefetched) {
+			dev->cachePrefetchHits++;
+			cache->prefetched = 0;
+		}
+		dev->cacheHits++;
+		dev->cacheLocklessHits++;
+		yaffs_UseChunkCache(dev, cache, 0);
+
+		memcpy(buffer, &cache->data[start], nToCopy);
+
+		n -= nToCopy;
+		offset += nToCopy;
+		buffer += nToCopy;
+		nDone += nToCopy;
+	}
+	YLOCK_GIVE(&dev->cacheLock);
+
+	return nDone;
+}
+
 int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 			int nBytes, int writeThrough)
 {
@@ -3595,23 +3979,30 @@ int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 			/* An incomplete start or end chunk (or maybe both start and end chunk),
 			 * or we're using inband tags, so we want to use the cache buffers.
 			 */
+			int spaceOk = 0;
+			yaffs_ChunkCache *cache = NULL;
+
 			if (dev->param.nShortOpCaches > 0) {
-				yaffs_ChunkCache *cache;
+				spaceOk = yaffs_CheckSpaceForAllocation(dev, 1);
+
 				/* If we can't find the data in the cache, then load the cache */
+				YLOCK_TAKE(&dev->cacheLock);
 				cache = yaffs_FindChunkCache(in, chunk);
 
-				if (!cache
-				    && yaffs_CheckSpaceForAllocation(dev, 1)) {
+				if (!cache && spaceOk) {
 					cache = yaffs_GrabChunkCache(dev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_ReadChunkDataFromObject(in, chunk,
-								      cache->data);
+					if (cache) {
+						yaffs_AssignChunkCache(dev, cache, in, chunk);
+						cache->locked = 1;
+						YLOCK_GIVE(&dev->cacheLock);
+						yaffs_ReadChunkDataFromObject(in, chunk,
+									      cache->data);
+						YLOCK_TAKE(&dev->cacheLock);
+						cache->locked = 0;
+					}
 				} else if (cache &&
 					!cache->dirty &&
-					!yaffs_CheckSpaceForAllocation(dev, 1)) {
+					!spaceOk) {
 					/* Drop the cache if it was a read cache item and
 					 * no space check has been made for it.
 					 */
@@ -3620,31 +4011,35 @@ int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 
 				if (cache) {
 					yaffs_UseChunkCache(dev, cache, 1);
-					cache->locked = 1;
-
 
 					memcpy(&cache->data[start], buffer,
 					       nToCopy);
 
-
-					cache->locked = 0;
 					cache->nBytes = nToWriteBack;
 
 					if (writeThrough) {
+						cache->locked = 1;
+						YLOCK_GIVE(&dev->cacheLock);
 						chunkWritten =
 						    yaffs_WriteChunkDataToObject
 						    (cache->object,
 						     cache->chunkId,
 						     cache->data, cache->nBytes,
 						     1);
-						cache->dirty = 0;
+						YLOCK_TAKE(&dev->cacheLock);
+						cache->locked = 0;
+						yaffs_SetChunkCacheDirty(dev, cache, 0);
 					}
+				}
+				YLOCK_GIVE(&dev->cacheLock);
 
-				} else {
+				if (!cache && !spaceOk)
 					chunkWritten = -1;	/* fail the write */
-				}
-			} else {
+			}
+
+			if (!cache && chunkWritten >= 0) {
 				/* An incomplete start or end chunk (or maybe both start and end chunk)
+				 * and no cache entry to be had.
 				 * Read into the local buffer then copy, then copy over and write back.
 				 */
 
@@ -4478,6 +4873,7 @@ static void yaffs_RemoveObjectFromDirectory(yaffs_Object *obj)
 		dev->param.removeObjectCallback(obj);
 
 
+	yaffs_DirIndexRemove(obj);
 	ylist_del_init(&obj->siblings);
 	obj->parent = NULL;
 	
@@ -4517,6 +4913,7 @@ void yaffs_AddObjectToDirectory(yaffs_Object *directory,
 	/* Now add it */
 	ylist_add(&obj->siblings, &directory->variant.directoryVariant.children);
 	obj->parent = directory;
+	yaffs_DirIndexAdd(directory, obj);
 
 	if (directory == obj->myDev->unlinkedDir
 			|| directory == obj->myDev->deletedDir) {
@@ -4529,6 +4926,65 @@ void yaffs_AddObjectToDirectory(yaffs_Object *directory,
 	yaffs_VerifyObjectInDirectory(obj);
 }
 
+/* Does child l of a directory go by name? sum is the name's sum. */
+static int yaffs_ObjectNameMatches(yaffs_Object *l, const YCHAR *name,
+				   __u16 sum, YCHAR *buffer)
+{
+	yaffs_CheckObjectDetailsLoaded(l);
+
+	/* Special case for lost-n-found */
+	if (l->objectId == YAFFS_OBJECTID_LOSTNFOUND)
+		return yaffs_strcmp(name, YAFFS_LOSTNFOUND_NAME) == 0;
+
+	if (yaffs_SumCompare(l->sum, sum) || l->hdrChunk <= 0) {
+		/* LostnFound chunk called Objxxx
+		 * Do a real check
+		 */
+		yaffs_GetObjectName(l, buffer, YAFFS_MAX_NAME_LENGTH + 1);
+		return yaffs_strncmp(name, buffer, YAFFS_MAX_NAME_LENGTH) == 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Build the name index for a directory once it turns out to be large.
+ * Returns the index, or NULL if the directory is small or memory is short,
+ * in which case the caller falls back to walking the children.
+ */
+static yaffs_DirIndex *yaffs_GetDirIndex(yaffs_Object *directory)
+{
+	struct ylist_head *i;
+	yaffs_Object *l;
+	int nChildren = 0;
+
+	if (directory->variant.directoryVariant.index)
+		return directory->variant.directoryVariant.index;
+
+	ylist_for_each(i, &directory->variant.directoryVariant.children) {
+		if (++nChildren >= YAFFS_DIR_INDEX_THRESHOLD)
+			break;
+	}
+	if (nChildren < YAFFS_DIR_INDEX_THRESHOLD)
+		return NULL;
+
+	nChildren = 0;
+	ylist_for_each(i, &directory->variant.directoryVariant.children)
+		nChildren++;
+
+	if (yaffs_DirIndexCreate(directory, nChildren) != YAFFS_OK)
+		return NULL;
+
+	ylist_for_each(i, &directory->variant.directoryVariant.children) {
+		l = ylist_entry(i, yaffs_Object, siblings);
+		/* Hash on the real name, not a lazy-loaded placeholder */
+		yaffs_CheckObjectDetailsLoaded(l);
+		yaffs_DirIndexAdd(directory, l);
+	}
+
+	return directory->variant.directoryVariant.index;
+}
+
 yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 				     const YCHAR *name)
 {
@@ -4538,6 +4994,7 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 	YCHAR buffer[YAFFS_MAX_NAME_LENGTH + 1];
 
 	yaffs_Object *l;
+	yaffs_DirIndex *index;
 
 	if (!name)
 		return NULL;
@@ -4559,6 +5016,33 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 
 	sum = yaffs_CalcNameSum(name);
 
+	index = yaffs_GetDirIndex(directory);
+	if (index) {
+		ylist_for_each(i, yaffs_DirIndexBucket(index, sum)) {
+			l = ylist_entry(i, yaffs_Object, nameLink);
+			if (yaffs_SumCompare(l->sum, sum) &&
+			    yaffs_ObjectNameMatches(l, name, sum, buffer))
+				return l;
+		}
+		/*
+		 * Loading details can rehash an entry off this list, so
+		 * restart rather than continue after one is loaded.
+		 */
+restart:
+		ylist_for_each(i, &index->unsummed) {
+			l = ylist_entry(i, yaffs_Object, nameLink);
+			if (l->lazyLoaded && l->hdrChunk > 0) {
+				yaffs_CheckObjectDetailsLoaded(l);
+				if (yaffs_ObjectNameMatches(l, name, sum, buffer))
+					return l;
+				goto restart;
+			}
+			if (yaffs_ObjectNameMatches(l, name, sum, buffer))
+				return l;
+		}
+		return NULL;
+	}
+
 	ylist_for_each(i, &directory->variant.directoryVariant.children) {
 		if (i) {
 			l = ylist_entry(i, yaffs_Object, siblings);
@@ -4566,21 +5050,8 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 			if (l->parent != directory)
 				YBUG();
 
-			yaffs_CheckObjectDetailsLoaded(l);
-
-			/* Special case for lost-n-found */
-			if (l->objectId == YAFFS_OBJECTID_LOSTNFOUND) {
-				if (yaffs_strcmp(name, YAFFS_LOSTNFOUND_NAME) == 0)
-					return l;
-			} else if (yaffs_SumCompare(l->sum, sum) || l->hdrChunk <= 0) {
-				/* LostnFound chunk called Objxxx
-				 * Do a real check
-				 */
-				yaffs_GetObjectName(l, buffer,
-						    YAFFS_MAX_NAME_LENGTH + 1);
-				if (yaffs_strncmp(name, buffer, YAFFS_MAX_NAME_LENGTH) == 0)
-					return l;
-			}
+			if (yaffs_ObjectNameMatches(l, name, sum, buffer))
+				return l;
 		}
 	}
 
@@ -5136,6 +5607,11 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 
 	dev->gcBlock = 0;
 
+	YLOCK_INIT(&dev->allocLock);
+	dev->allocOwner = NULL;
+	dev->allocDepth = 0;
+	YLOCK_INIT(&dev->cacheLock);
+
 	if (dev->param.startBlock == 0) {
 		dev->internalStartBlock = dev->param.startBlock + 1;
 		dev->internalEndBlock = dev->param.endBlock + 1;
@@ -5285,6 +5761,9 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	dev->gcDisable= 0;
 	dev->hasPendingPrioritisedGCs = 1; /* Assume the worst for now, will get fixed on first GC */
 	YINIT_LIST_HEAD(&dev->dirtyDirectories);
+	YINIT_LIST_HEAD(&dev->dirIndexes);
+	dev->nDirIndexes = 0;
+	dev->dirIndexBytes = 0;
 	dev->oldestDirtySequence = 0;
 	dev->oldestDirtyBlock = 0;
 
@@ -5292,7 +5771,17 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	if (!yaffs_InitialiseTempBuffers(dev))
 		init_failed = 1;
 
+	if (!init_failed && !yaffs_SummaryInitialise(dev))
+		init_failed = 1;
+
 	dev->srCache = NULL;
+	dev->srHash = NULL;
+	YINIT_LIST_HEAD(&dev->srLru);
+	YINIT_LIST_HEAD(&dev->srFree);
+	YINIT_LIST_HEAD(&dev->srDirty);
+	dev->srDirtyCount = 0;
+	dev->srSeqObject = NULL;
+	dev->srSeqChunk = 0;
 	dev->gcCleanupList = NULL;
 
 
@@ -5300,31 +5789,54 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	    dev->param.nShortOpCaches > 0) {
 		int i;
 		void *buf;
-		int srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+		int srCacheBytes;
+		int nBuckets;
 
 		if (dev->param.nShortOpCaches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->param.nShortOpCaches = YAFFS_MAX_SHORT_OP_CACHES;
+		if (dev->param.nPrefetchChunks > YAFFS_MAX_PREFETCH_CHUNKS)
+			dev->param.nPrefetchChunks = YAFFS_MAX_PREFETCH_CHUNKS;
+
+		srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+
+		/* One bucket per entry, rounded up to a power of two */
+		for (nBuckets = 1; nBuckets < dev->param.nShortOpCaches; nBuckets <<= 1)
+			;
 
 		dev->srCache =  YMALLOC(srCacheBytes);
+		dev->srHash = YMALLOC(nBuckets * sizeof(struct ylist_head));
+		dev->srHashMask = nBuckets - 1;
 
 		buf = (__u8 *) dev->srCache;
 
 		if (dev->srCache)
 			memset(dev->srCache, 0, srCacheBytes);
 
+		if (dev->srHash) {
+			for (i = 0; i < nBuckets; i++)
+				YINIT_LIST_HEAD(&dev->srHash[i]);
+		} else
+			buf = NULL;
+
 		for (i = 0; i < dev->param.nShortOpCaches && buf; i++) {
 			dev->srCache[i].object = NULL;
-			dev->srCache[i].lastUse = 0;
 			dev->srCache[i].dirty = 0;
+			YINIT_LIST_HEAD(&dev->srCache[i].hashLink);
+			YINIT_LIST_HEAD(&dev->srCache[i].dirtyLink);
+			ylist_add_tail(&dev->srCache[i].lruLink, &dev->srFree);
 			dev->srCache[i].data = buf = YMALLOC_DMA(dev->param.totalBytesPerChunk);
 		}
 		if (!buf)
 			init_failed = 1;
-
-		dev->srLastUse = 0;
 	}
 
 	dev->cacheHits = 0;
+	dev->cacheMisses = 0;
+	dev->cachePrefetches = 0;
+	dev->cachePrefetchHits = 0;
+	dev->nSummaryWrites = 0;
+	dev->nScanSummaries = 0;
+	dev->nScanTagReads = 0;
 
 	if (!init_failed) {
 		dev->gcCleanupList = YMALLOC(dev->param.nChunksPerBlock * sizeof(__u32));
@@ -5358,6 +5870,7 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 				 */
 				yaffs_DeinitialiseBlocks(dev);
 
+				yaffs_DirIndexDestroyAll(dev);
 				yaffs_DeinitialiseTnodesAndObjects(dev);
 
 				dev->nErasedBlocks = 0;
@@ -5425,6 +5938,7 @@ void yaffs_Deinitialise(yaffs_Device *dev)
 		int i;
 
 		yaffs_DeinitialiseBlocks(dev);
+		yaffs_DirIndexDestroyAll(dev);
 		yaffs_DeinitialiseTnodesAndObjects(dev);
 		if (dev->param.nShortOpCaches > 0 &&
 		    dev->srCache) {
@@ -5437,10 +5951,16 @@ void yaffs_Deinitialise(yaffs_Device *dev)
 
 			YFREE(dev->srCache);
 			dev->srCache = NULL;
+
+			if (dev->srHash)
+				YFREE(dev->srHash);
+			dev->srHash = NULL;
 		}
 
 		YFREE(dev->gcCleanupList);
 
+		yaffs_SummaryDeinitialise(dev);
+
 		for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++)
 			YFREE(dev->tempBuffer[i].buffer);
 
@@ -5467,7 +5987,7 @@ int yaffs_CountFreeChunks(yaffs_Device *dev)
 		case YAFFS_BLOCK_STATE_FULL:
 			nFree +=
 			    (dev->param.nChunksPerBlock - blk->pagesInUse +
-			     blk->softDeletions);
+			     blk->softDeletions - blk->hasSummary);
 			break;
 		default:
 			break;
@@ -5485,8 +6005,8 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device *dev)
 	int nFree;
 	int nDirtyCacheChunks;
 	int blocksForCheckpoint;
-	int i;
 
+	yaffs_LockAlloc(dev);
 #if 1
 	nFree = dev->nFreeChunks;
 #else
@@ -5497,10 +6017,9 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device *dev)
 
 	/* Now count the number of dirty chunks in the cache and subtract those */
 
-	for (nDirtyCacheChunks = 0, i = 0; i < dev->param.nShortOpCaches; i++) {
-		if (dev->srCache[i].dirty)
-			nDirtyCacheChunks++;
-	}
+	YLOCK_TAKE(&dev->cacheLock);
+	nDirtyCacheChunks = dev->srDirtyCount;
+	YLOCK_GIVE(&dev->cacheLock);
 
 	nFree -= nDirtyCacheChunks;
 
@@ -5510,6 +6029,7 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device *dev)
 	blocksForCheckpoint = yaffs2_CalcCheckpointBlocksRequired(dev);
 
 	nFree -= (blocksForCheckpoint * dev->param.nChunksPerBlock);
+	yaffs_UnlockAlloc(dev);
 
 	if (nFree < 0)
 		nFree = 0;
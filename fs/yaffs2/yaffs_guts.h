@@ -87,8 +87,12 @@
 #define YAFFS_OBJECTID_CHECKPOINT_DATA	0x20
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
 
+/* Pseudo object id for block summaries */
+#define YAFFS_OBJECTID_SUMMARY		0x30
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+
+#define YAFFS_MAX_SHORT_OP_CACHES	512
+#define YAFFS_MAX_PREFETCH_CHUNKS	32
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -111,14 +115,21 @@
 /* Special sequence number for bad block that failed to be marked bad */
 #define YAFFS_SEQUENCE_BAD_BLOCK	0xFFFF0000
 
-/* ChunkCache is used for short read/write operations.*/
+/* ChunkCache is used for short read/write operations.
+ * Entries in use are hashed on (object, chunkId) and kept on an LRU list,
+ * unused ones sit on the free list.
+ */
 typedef struct {
 	struct yaffs_ObjectStruct *object;
 	int chunkId;
-	int lastUse;
+	struct ylist_head hashLink;	/* Hash bucket or unhashed */
+	struct ylist_head lruLink;	/* LRU list or free list */
+	struct ylist_head dirtyLink;	/* Dirty list while dirty */
 	int dirty;
 	int nBytes;		/* Only valid if the cache is dirty */
-	int locked;		/* Can't push out or flush while locked. */
+	int locked;		/* Being filled or written outside cacheLock:
+				 * can't push out, flush or read locklessly. */
+	int prefetched;		/* Read ahead and not used yet */
 	__u8 *data;
 } yaffs_ChunkCache;
 
@@ -289,11 +300,18 @@ typedef struct {
 
 #ifdef CONFIG_YAFFS_YAFFS2
 	__u32 hasShrinkHeader:1; /* This block has at least one shrink object header */
+	__u32 hasSummary:1;	 /* The last chunk of this block holds its summary */
 	__u32 sequenceNumber;	 /* block sequence number for yaffs2 */
 #endif
 
 } yaffs_BlockInfo;
 
+/* A block to scan and its sequence number, for yaffs2_ScanBackwards() */
+typedef struct {
+	int seq;
+	int block;
+} yaffs_BlockIndex;
+
 /* -------------------------- Object structure -------------------------------*/
 /* This is the object structure as stored on NAND */
 
@@ -374,9 +392,12 @@ typedef struct {
 	yaffs_Tnode *top;
 } yaffs_FileStructure;
 
+typedef struct yaffs_DirIndexStruct yaffs_DirIndex;
+
 typedef struct {
 	struct ylist_head children;     /* list of child links */
 	struct ylist_head dirty;	/* Entry for list of dirty directories */
+	yaffs_DirIndex *index;		/* name index, only for large directories */
 } yaffs_DirectoryStructure;
 
 typedef struct {
@@ -434,6 +455,7 @@ struct yaffs_ObjectStruct {
 	/* also used for linking up the free list */
 	struct yaffs_ObjectStruct *parent;
 	struct ylist_head siblings;
+	struct ylist_head nameLink;	/* entry in the parent's name index */
 
 	/* Where's my object header in NAND? */
 	int hdrChunk;
@@ -464,6 +486,9 @@ struct yaffs_ObjectStruct {
 
 	void *myInode;
 
+	YLOCK lock;		/* File size, tnode tree and data chunks */
+	void *lockOwner;	/* Task holding lock, so gc can move our chunks */
+
 	yaffs_ObjectType variantType;
 
 	yaffs_ObjectVariant variant;
@@ -535,7 +560,11 @@ struct yaffs_DeviceParamStruct {
 
 	int nShortOpCaches;	/* If <= 0, then short op caching is disabled, else
 				 * the number of short op caches (don't use too many).
-                                 * 10 to 20 is a good bet.
+                                 * 10 to 20 is a good bet for write
+				 * buffering, a few hundred makes a read cache).
+				 */
+	int nPrefetchChunks;	/* Chunks to read ahead into the cache when a
+				 * sequential read misses. 0 disables.
 				 */
 	int useNANDECC;		/* Flag to decide whether or not to use NANDECC on data (yaffs1) */
 	int noTagsECC;		/* Flag to decide whether or not to do ECC on packed tags (yaffs2) */ 
@@ -575,6 +604,27 @@ struct yaffs_DeviceParamStruct {
 	int (*markNANDBlockBad) (struct yaffs_DeviceStruct *dev, int blockNo);
 	int (*queryNANDBlock) (struct yaffs_DeviceStruct *dev, int blockNo,
 			       yaffs_BlockState *state, __u32 *sequenceNumber);
+	/* Optional: read only the tags of nChunks consecutive chunks. buffer
+	 * is one chunk of scratch space. It must not use any other buffer of
+	 * the device, so that the scan can run it from another thread.
+	 */
+	int (*readTagsBatchFromNAND) (struct yaffs_DeviceStruct *dev,
+				      int chunkInNAND, int nChunks,
+				      yaffs_ExtendedTags *tags, __u8 *buffer);
+
+	/* Optional: read the tags of the blocks yaffs2_ScanBackwards() is
+	 * about to scan in another thread, while it works on earlier ones.
+	 * The reader goes from blocks[nBlocks - 1] down, as the scan does,
+	 * calling yaffs_ScanReadBlockTags(). scanReadAheadGet() hands over
+	 * the tags for blk and returns as that does, or -1 if it has none.
+	 * Only for drivers whose readChunkWithTagsFromNAND() and
+	 * readTagsBatchFromNAND() may run in two threads at once.
+	 */
+	int (*scanReadAheadStart) (struct yaffs_DeviceStruct *dev,
+				   const yaffs_BlockIndex *blocks, int nBlocks);
+	int (*scanReadAheadGet) (struct yaffs_DeviceStruct *dev, int blk,
+				 yaffs_ExtendedTags *tags, int *nTagReads);
+	void (*scanReadAheadStop) (struct yaffs_DeviceStruct *dev);
 #endif
 
 	/* The removeObjectCallback function must be supplied by OS flavours that
@@ -593,6 +643,7 @@ struct yaffs_DeviceParamStruct {
         /* Debug control flags. Don't use unless you know what you're doing */
 	int useHeaderFileSize;	/* Flag to determine if we should use file sizes from the header */
 	int disableLazyLoad;	/* Disable lazy loading on this device */
+	int enableSummary;	/* yaffs2 only: write block summaries */
 	int wideTnodesDisabled; /* Set to disable wide tnodes */
 	int disableSoftDelete;  /* yaffs 1 only: Set to disable the use of softdeletion. */
 	
@@ -692,6 +743,14 @@ struct yaffs_DeviceStruct {
 
 	int nFreeChunks;
 
+	/* Locks for file I/O that does not hold the OS layer's device lock
+	 * exclusively.  Order is object lock, allocLock, cacheLock.
+	 */
+	YLOCK allocLock;	/* Block state, allocation and gc */
+	void *allocOwner;	/* allocLock nests: gc allocates tnodes */
+	int allocDepth;
+	YLOCK cacheLock;	/* Chunk cache and temp buffers */
+
 	/* Garbage collection control */
 	__u32 *gcCleanupList;	/* objects to delete at the end of a GC. */
 	__u32 nCleanups;
@@ -719,7 +778,14 @@ struct yaffs_DeviceStruct {
 	int doingBufferedBlockRewrite;
 
 	yaffs_ChunkCache *srCache;
-	int srLastUse;
+	struct ylist_head *srHash;	/* Buckets keyed on (object, chunkId) */
+	int srHashMask;
+	struct ylist_head srLru;	/* In use, least recently used first */
+	struct ylist_head srFree;	/* Not in use */
+	struct ylist_head srDirty;	/* Holding data not yet written */
+	int srDirtyCount;
+	yaffs_Object *srSeqObject;	/* Last cached read, for prefetch */
+	int srSeqChunk;
 
 	/* Stuff for background deletion and unlinked files.*/
 	yaffs_Object *unlinkedDir;	/* Directory where unlinked and deleted files live. */
@@ -747,6 +813,16 @@ struct yaffs_DeviceStruct {
 	/* Dirty directory handling */
 	struct ylist_head dirtyDirectories; /* List of dirty directories */
 
+	/* Block summary being built for the allocation block */
+	int chunksPerSummary;	/* 0 if summaries are not in use */
+	int summaryBlock;
+	struct yaffs_SummaryTagsStruct *summaryTags;
+
+	/* Directory name indexes */
+	struct ylist_head dirIndexes;
+	int nDirIndexes;
+	__u32 dirIndexBytes;	/* memory used by all name indexes */
+
 
 	/* Statistcs */
 	__u32 nPageWrites;
@@ -769,6 +845,14 @@ struct yaffs_DeviceStruct {
 	__u32 nUnmarkedDeletions;
 	__u32 refreshCount;
 	__u32 cacheHits;
+	__u32 cacheMisses;
+	__u32 cachePrefetches;
+	__u32 cachePrefetchHits;
+	__u32 nSummaryWrites;
+	__u32 nScanSummaries;	/* blocks scanned from their summary */
+	__u32 nScanTagReads;	/* chunk tags read from NAND during scan */
+	__u32 gcObjectBusy;	/* gc passes stopped by a locked object */
+	__u32 cacheLocklessHits; /* reads served by yaffs_ReadCachedDataFromFile */
 
 };
 
@@ -855,6 +939,8 @@ int yaffs_GetAttributes(yaffs_Object *obj, struct iattr *attr);
 /* File operations */
 int yaffs_ReadDataFromFile(yaffs_Object *obj, __u8 *buffer, loff_t offset,
 				int nBytes);
+int yaffs_ReadCachedDataFromFile(yaffs_Object *obj, __u8 *buffer, loff_t offset,
+				int nBytes);
 int yaffs_WriteDataToFile(yaffs_Object *obj, const __u8 *buffer, loff_t offset,
 				int nBytes, int writeThrough);
 int yaffs_ResizeFile(yaffs_Object *obj, loff_t newSize);
@@ -864,6 +950,9 @@ yaffs_Object *yaffs_MknodFile(yaffs_Object *parent, const YCHAR *name,
 
 int yaffs_FlushFile(yaffs_Object *obj, int updateTime, int dataSync);
 
+void yaffs_LockObject(yaffs_Object *obj);
+void yaffs_UnlockObject(yaffs_Object *obj);
+
 /* Flushing and checkpointing */
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev);
 
@@ -925,6 +1014,8 @@ void yaffs_GutsTest(yaffs_Device *dev);
 void yaffs_DeleteChunk(yaffs_Device *dev, int chunkId, int markNAND, int lyn);
 int yaffs_CheckFF(__u8 *buffer, int nBytes);
 void yaffs_HandleChunkError(yaffs_Device *dev, yaffs_BlockInfo *bi);
+void yaffs_HandleWriteChunkError(yaffs_Device *dev, int chunkInNAND,
+		int erasedOk);
 
 __u8 *yaffs_GetTempBuffer(yaffs_Device *dev, int lineNo);
 void yaffs_ReleaseTempBuffer(yaffs_Device *dev, __u8 *buffer, int lineNo);
@@ -25,7 +25,11 @@ struct yaffs_LinuxContext {
 	struct super_block * superBlock;
 	struct task_struct *bgThread; /* Background thread for this device */
 	int bgRunning;
-        struct semaphore grossLock;     /* Gross locking semaphore */
+	struct rw_semaphore grossLock;	/* Shared for file data, else exclusive */
+	atomic_t lockWaiters;		/* Tasks blocked on grossLock */
+	unsigned lockContended;		/* grossLock acquisitions that blocked */
+	unsigned bgDeferrals;		/* Background passes given up to waiters */
+	struct yaffs_ScanAhead *scanAhead; /* Tag reader for the mount scan */
 	__u8 *spareBuffer;      /* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
 				 */
@@ -141,7 +141,9 @@ int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 		ops.len = data ? dev->nDataBytesPerChunk : packed_tags_size;
 		ops.ooboffs = 0;
 		ops.datbuf = data;
-		ops.oobbuf = yaffs_DeviceToLC(dev)->spareBuffer;
+		/* Straight into pt rather than spareBuffer, so that the scan
+		 * can read ahead from another thread. */
+		ops.oobbuf = packed_tags_ptr;
 		retval = mtd->read_oob(mtd, addr, &ops);
 	}
 #else
@@ -171,7 +173,9 @@ int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 		}
 	} else {
 		if (tags) {
+#if (LINUX_VERSION_CODE <= KERNEL_VERSION(2, 6, 17))
 			memcpy(packed_tags_ptr, yaffs_DeviceToLC(dev)->spareBuffer, packed_tags_size);
+#endif
 			yaffs_UnpackTags2(tags, &pt, !dev->param.noTagsECC);
 		}
 	}
@@ -193,6 +197,81 @@ int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 		return YAFFS_FAIL;
 }
 
+/* Read just the tags of a run of chunks.
+ * MTD will read the oob of several pages in one read_oob call, so the tags
+ * are fetched as many pages at a time as fit in a temporary buffer, which
+ * saves a driver round trip and device lock per chunk during a scan.
+ */
+int nandmtd2_ReadTagsBatchFromNAND(yaffs_Device *dev, int chunkInNAND,
+				int nChunks, yaffs_ExtendedTags *tags,
+				__u8 *buffer)
+{
+#if (MTD_VERSION_CODE > MTD_VERSION(2, 6, 17))
+	struct mtd_info *mtd = yaffs_DeviceToMtd(dev);
+	struct mtd_oob_ops ops;
+	yaffs_PackedTags2 pt;
+	int packed_tags_size = dev->param.noTagsECC ? sizeof(pt.t) : sizeof(pt);
+	void * packed_tags_ptr = dev->param.noTagsECC ? (void *) &pt.t: (void *)&pt;
+	int oobavail = mtd->ecclayout ? mtd->ecclayout->oobavail : 0;
+	int perRead;
+	int n;
+	int i;
+	int retval;
+
+	if (oobavail < packed_tags_size)
+		goto single;
+
+	perRead = dev->param.totalBytesPerChunk / oobavail;
+	if (perRead < 2)
+		goto single;
+
+	T(YAFFS_TRACE_MTD,
+	  (TSTR("nandmtd2_ReadTagsBatchFromNAND chunk %d n %d" TENDSTR),
+	   chunkInNAND, nChunks));
+
+	while (nChunks > 0) {
+		n = (nChunks < perRead) ? nChunks : perRead;
+
+		ops.mode = MTD_OOB_AUTO;
+		ops.ooblen = n * oobavail;
+		ops.len = ops.ooblen;
+		ops.ooboffs = 0;
+		ops.datbuf = NULL;
+		ops.oobbuf = buffer;
+		retval = mtd->read_oob(mtd,
+				((loff_t) chunkInNAND) * dev->param.totalBytesPerChunk,
+				&ops);
+
+		if (retval && retval != -EUCLEAN) {
+			/* Let the single chunk path sort it out */
+			for (i = 0; i < n; i++)
+				nandmtd2_ReadChunkWithTagsFromNAND(dev,
+						chunkInNAND + i, NULL, &tags[i]);
+		} else {
+			for (i = 0; i < n; i++) {
+				memcpy(packed_tags_ptr, buffer + i * oobavail,
+					packed_tags_size);
+				yaffs_UnpackTags2(&tags[i], &pt,
+						!dev->param.noTagsECC);
+			}
+		}
+
+		chunkInNAND += n;
+		tags += n;
+		nChunks -= n;
+	}
+
+	return YAFFS_OK;
+
+single:
+#endif
+	while (nChunks-- > 0)
+		nandmtd2_ReadChunkWithTagsFromNAND(dev, chunkInNAND++, NULL,
+						tags++);
+
+	return YAFFS_OK;
+}
+
 int nandmtd2_MarkNANDBlockBad(struct yaffs_DeviceStruct *dev, int blockNo)
 {
 	struct mtd_info *mtd = yaffs_DeviceToMtd(dev);
@@ -0,0 +1,286 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yaffs_summary.h"
+#include "yaffs_packedtags2.h"
+#include "yaffs_getblockinfo.h"
+#include "yaffs_bitmap.h"
+#include "yaffs_nand.h"
+#include "yaffs_trace.h"
+#include "yaffs_tagsvalidity.h"
+
+/*
+ * Block summaries.
+ *
+ * Without a checkpoint, yaffs2_ScanBackwards() has to read the tags of every
+ * chunk on the device. To cut that down, the tags of each chunk written to
+ * the allocation block are also collected in RAM, and once all but the last
+ * chunk of the block are written the collection is written to that last
+ * chunk. The scan then reads one chunk per full block instead of all of them.
+ *
+ * Summaries are only written when the mount asks for them (the "summary"
+ * option): a yaffs that does not know about them reads the summary chunk
+ * as data of a phantom object, so they change the on-flash format.
+ *
+ * The summary chunk is written with the pseudo object id
+ * YAFFS_OBJECTID_SUMMARY and never counted as in use, so garbage collection
+ * simply drops it. Blocks without a valid summary (the block being allocated
+ * from at power loss, blocks skipped after a write error, or blocks written
+ * by code that does not know about summaries) are scanned the old way, as
+ * are any chunks missing from a summary.
+ */
+
+int yaffs_SummaryInitialise(yaffs_Device *dev)
+{
+	int nBytes;
+
+	dev->chunksPerSummary = 0;
+	dev->summaryBlock = -1;
+	dev->summaryTags = NULL;
+
+	if (!dev->param.isYaffs2 || !dev->param.enableSummary)
+		return YAFFS_OK;
+
+	nBytes = sizeof(yaffs_SummaryHeader) +
+		(dev->param.nChunksPerBlock - 1) * sizeof(yaffs_SummaryTags);
+
+	if (nBytes > dev->nDataBytesPerChunk) {
+		T(YAFFS_TRACE_ALWAYS,
+		  (TSTR("yaffs: block summary does not fit in a chunk, disabled"
+		  TENDSTR)));
+		return YAFFS_OK;
+	}
+
+	dev->summaryTags = YMALLOC(dev->param.nChunksPerBlock *
+				sizeof(yaffs_SummaryTags));
+	if (!dev->summaryTags)
+		return YAFFS_FAIL;
+
+	memset(dev->summaryTags, 0,
+		dev->param.nChunksPerBlock * sizeof(yaffs_SummaryTags));
+	dev->chunksPerSummary = dev->param.nChunksPerBlock - 1;
+
+	return YAFFS_OK;
+}
+
+void yaffs_SummaryDeinitialise(yaffs_Device *dev)
+{
+	if (dev->summaryTags)
+		YFREE(dev->summaryTags);
+	dev->summaryTags = NULL;
+	dev->chunksPerSummary = 0;
+}
+
+static unsigned yaffs_SummarySum(const __u8 *b, int n)
+{
+	unsigned sum = 0;
+
+	while (n-- > 0)
+		sum += *b++;
+
+	return sum;
+}
+
+static void yaffs_SummaryWrite(yaffs_Device *dev, int blk)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blk);
+	yaffs_ExtendedTags tags;
+	yaffs_SummaryHeader hdr;
+	int nBytes = dev->chunksPerSummary * sizeof(yaffs_SummaryTags);
+	__u8 *buffer;
+	int chunk;
+
+	/* The summary takes the last chunk of the block. It is allocated like
+	 * any other chunk, so that a failed write can be cleaned up by
+	 * yaffs_HandleWriteChunkError(), but once written it is not in use.
+	 * It is not free either: garbage collection drops it, but the next
+	 * fill of the block writes another. So it stays out of nFreeChunks
+	 * until the block is erased, and hasSummary tells the block
+	 * accounting so.
+	 */
+	chunk = blk * dev->param.nChunksPerBlock + dev->allocationPage;
+	bi->pagesInUse++;
+	yaffs_SetChunkBit(dev, blk, dev->allocationPage);
+	dev->allocationPage++;
+	dev->nFreeChunks--;
+	if (dev->allocationPage >= dev->param.nChunksPerBlock) {
+		bi->blockState = YAFFS_BLOCK_STATE_FULL;
+		dev->allocationBlock = -1;
+	}
+
+	hdr.version = YAFFS_SUMMARY_VERSION;
+	hdr.block = blk;
+	hdr.sequenceNumber = bi->sequenceNumber;
+	hdr.sum = yaffs_SummarySum((__u8 *) dev->summaryTags, nBytes);
+
+	buffer = yaffs_GetTempBuffer(dev, __LINE__);
+	memset(buffer, 0xff, dev->nDataBytesPerChunk);
+	memcpy(buffer, &hdr, sizeof(hdr));
+	memcpy(buffer + sizeof(hdr), dev->summaryTags, nBytes);
+
+	yaffs_InitialiseTags(&tags);
+	tags.objectId = YAFFS_OBJECTID_SUMMARY;
+	tags.chunkId = 1;
+	tags.byteCount = sizeof(hdr) + nBytes;
+
+	if (yaffs_WriteChunkWithTagsToNAND(dev, chunk, buffer, &tags) == YAFFS_OK) {
+		yaffs_ClearChunkBit(dev, blk, chunk % dev->param.nChunksPerBlock);
+		bi->pagesInUse--;
+		bi->hasSummary = 1;
+		dev->nSummaryWrites++;
+	} else {
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR("yaffs: summary write for block %d failed" TENDSTR),
+		  blk));
+		/* The block was written up to here, so it was erased */
+		yaffs_HandleWriteChunkError(dev, chunk, 1);
+	}
+
+	yaffs_ReleaseTempBuffer(dev, buffer, __LINE__);
+}
+
+/* Record the tags of a chunk just written to the allocation block and write
+ * the summary once the block is full up to the summary chunk.
+ */
+void yaffs_SummaryAdd(yaffs_Device *dev, const yaffs_ExtendedTags *tags,
+			int chunkInNAND)
+{
+	yaffs_PackedTags2TagsPart ptt;
+	yaffs_SummaryTags *st;
+	int blk = chunkInNAND / dev->param.nChunksPerBlock;
+	int c = chunkInNAND % dev->param.nChunksPerBlock;
+
+	if (!dev->chunksPerSummary || c >= dev->chunksPerSummary)
+		return;
+
+	if (blk != dev->summaryBlock) {
+		memset(dev->summaryTags, 0,
+			dev->chunksPerSummary * sizeof(yaffs_SummaryTags));
+		dev->summaryBlock = blk;
+	}
+
+	yaffs_PackTags2TagsPart(&ptt, tags);
+	st = &dev->summaryTags[c];
+	st->objectId = ptt.objectId;
+	st->chunkId = ptt.chunkId;
+	st->byteCount = ptt.byteCount;
+
+	/* Only write it if the block was filled in order, otherwise the
+	 * allocator has already moved on.
+	 */
+	if (c == dev->chunksPerSummary - 1 &&
+	    dev->allocationBlock == blk &&
+	    dev->allocationPage == dev->chunksPerSummary) {
+		yaffs_SummaryWrite(dev, blk);
+		dev->summaryBlock = -1;
+	}
+}
+
+/* Read the tags of nChunks chunks from NAND using only the buffer given */
+static void yaffs_ScanReadTags(yaffs_Device *dev, int chunkInNAND, int nChunks,
+				yaffs_ExtendedTags *tags, __u8 *buffer)
+{
+	chunkInNAND -= dev->chunkOffset;
+
+	if (dev->param.readTagsBatchFromNAND && !dev->param.inbandTags) {
+		dev->param.readTagsBatchFromNAND(dev, chunkInNAND, nChunks,
+						 tags, buffer);
+		return;
+	}
+
+	while (nChunks-- > 0)
+		dev->param.readChunkWithTagsFromNAND(dev, chunkInNAND++, NULL,
+						     tags++);
+}
+
+/* Can yaffs_ScanReadBlockTags() run in a read-ahead thread? Not with
+ * inband tags, whose reads go through the device's temporary buffers.
+ */
+int yaffs_ScanCanReadAhead(yaffs_Device *dev)
+{
+	return !dev->param.inbandTags;
+}
+
+/* Fill in the tags for every chunk in block blk, from its summary if it has
+ * a valid one and from the NAND tags otherwise. buffer is one chunk and
+ * summary has room for chunksPerSummary entries. When
+ * yaffs_ScanCanReadAhead() says so, no other buffer of the device is used
+ * and this may run in a read-ahead thread while the scan goes on. The
+ * caller accounts the reads and handles ECC errors in the tags.
+ * Returns 1 if the summary was used, 0 if not.
+ */
+int yaffs_ScanReadBlockTags(yaffs_Device *dev, int blk, unsigned sequenceNumber,
+			yaffs_ExtendedTags *blockTags, __u8 *buffer,
+			yaffs_SummaryTags *summary, int *nTagReads)
+{
+	yaffs_ExtendedTags tags;
+	yaffs_SummaryHeader hdr;
+	yaffs_PackedTags2TagsPart ptt;
+	int nBytes = dev->chunksPerSummary * sizeof(yaffs_SummaryTags);
+	int chunkBase = blk * dev->param.nChunksPerBlock;
+	int c;
+
+	*nTagReads = 0;
+
+	if (!dev->chunksPerSummary)
+		goto no_summary;
+
+	dev->param.readChunkWithTagsFromNAND(dev,
+			chunkBase + dev->chunksPerSummary - dev->chunkOffset,
+			buffer, &tags);
+	(*nTagReads)++;
+
+	if (!tags.chunkUsed ||
+	    tags.eccResult > YAFFS_ECC_RESULT_FIXED ||
+	    tags.objectId != YAFFS_OBJECTID_SUMMARY ||
+	    tags.sequenceNumber != sequenceNumber ||
+	    tags.byteCount != sizeof(hdr) + nBytes)
+		goto no_summary;
+
+	memcpy(&hdr, buffer, sizeof(hdr));
+	memcpy(summary, buffer + sizeof(hdr), nBytes);
+
+	if (hdr.version != YAFFS_SUMMARY_VERSION ||
+	    hdr.block != blk ||
+	    hdr.sequenceNumber != sequenceNumber ||
+	    hdr.sum != yaffs_SummarySum((__u8 *) summary, nBytes))
+		goto no_summary;
+
+	for (c = 0; c < dev->chunksPerSummary; c++) {
+		yaffs_SummaryTags *st = &summary[c];
+
+		if (st->objectId == 0) {
+			/* Not recorded, so go and look */
+			yaffs_ScanReadTags(dev, chunkBase + c, 1,
+					   &blockTags[c], buffer);
+			(*nTagReads)++;
+			continue;
+		}
+
+		ptt.sequenceNumber = sequenceNumber;
+		ptt.objectId = st->objectId;
+		ptt.chunkId = st->chunkId;
+		ptt.byteCount = st->byteCount;
+		yaffs_UnpackTags2TagsPart(&blockTags[c], &ptt);
+	}
+	blockTags[dev->chunksPerSummary] = tags;
+
+	return 1;
+
+no_summary:
+	yaffs_ScanReadTags(dev, chunkBase, dev->param.nChunksPerBlock,
+			   blockTags, buffer);
+	*nTagReads += dev->param.nChunksPerBlock;
+
+	return 0;
+}
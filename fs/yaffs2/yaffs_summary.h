@@ -0,0 +1,54 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1 as
+ * published by the Free Software Foundation.
+ *
+ * Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
+ */
+
+/*
+ * Per-block tag summaries for fast yaffs2 scanning
+ */
+
+#ifndef __YAFFS_SUMMARY_H__
+#define __YAFFS_SUMMARY_H__
+
+#include "yaffs_guts.h"
+
+#define YAFFS_SUMMARY_VERSION	1
+
+/* Tags of one chunk, as packed by yaffs_PackTags2TagsPart() less the
+ * sequence number, which is the same for the whole block.
+ */
+struct yaffs_SummaryTagsStruct {
+	unsigned objectId;
+	unsigned chunkId;
+	unsigned byteCount;
+};
+
+typedef struct yaffs_SummaryTagsStruct yaffs_SummaryTags;
+
+typedef struct {
+	unsigned version;
+	unsigned block;
+	unsigned sequenceNumber;
+	unsigned sum;
+} yaffs_SummaryHeader;
+
+int yaffs_SummaryInitialise(yaffs_Device *dev);
+void yaffs_SummaryDeinitialise(yaffs_Device *dev);
+void yaffs_SummaryAdd(yaffs_Device *dev, const yaffs_ExtendedTags *tags,
+			int chunkInNAND);
+int yaffs_ScanCanReadAhead(yaffs_Device *dev);
+int yaffs_ScanReadBlockTags(yaffs_Device *dev, int blk, unsigned sequenceNumber,
+			yaffs_ExtendedTags *blockTags, __u8 *buffer,
+			yaffs_SummaryTags *summary, int *nTagReads);
+
+#endif
@@ -169,6 +169,7 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 #include "yaffs_mtdif.h"
 #include "yaffs_mtdif1.h"
 #include "yaffs_mtdif2.h"
+#include "yaffs_summary.h"
 
 unsigned int yaffs_traceMask = YAFFS_TRACE_BAD_BLOCKS | YAFFS_TRACE_ALWAYS;
 unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
@@ -512,17 +513,81 @@ static unsigned yaffs_gc_control_callback(yaffs_Device *dev)
 	return yaffs_gc_control;
 }
                 	                                                                                          	
+/*
+ * The gross lock is taken shared for file data I/O and background gc, which
+ * yaffs_guts.c serialises with its per-object, allocator and cache locks,
+ * and exclusively for everything else: namespace changes, attributes,
+ * directory updates, checkpointing and unmount.  yaffs1 devices always take
+ * it exclusively.
+ */
 static void yaffs_GrossLock(yaffs_Device *dev)
 {
+	struct yaffs_LinuxContext *lc = yaffs_DeviceToLC(dev);
+
 	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locking %p\n"), current));
-	down(&(yaffs_DeviceToLC(dev)->grossLock));
+	if (!down_write_trylock(&lc->grossLock)) {
+		/* Let the background thread know someone is waiting */
+		atomic_inc(&lc->lockWaiters);
+		down_write(&lc->grossLock);
+		atomic_dec(&lc->lockWaiters);
+		lc->lockContended++;
+	}
 	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locked %p\n"), current));
 }
 
+/* True if a foreground task is blocked on the gross lock */
+static int yaffs_GrossLockWanted(yaffs_Device *dev)
+{
+	return atomic_read(&yaffs_DeviceToLC(dev)->lockWaiters) > 0;
+}
+
 static void yaffs_GrossUnlock(yaffs_Device *dev)
 {
 	T(YAFFS_TRACE_LOCK, (TSTR("yaffs unlocking %p\n"), current));
-	up(&(yaffs_DeviceToLC(dev)->grossLock));
+	up_write(&(yaffs_DeviceToLC(dev)->grossLock));
+}
+
+static void yaffs_GrossLockShared(yaffs_Device *dev)
+{
+	struct yaffs_LinuxContext *lc = yaffs_DeviceToLC(dev);
+
+	if (!dev->param.isYaffs2) {
+		yaffs_GrossLock(dev);
+		return;
+	}
+
+	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locking shared %p\n"), current));
+	if (!down_read_trylock(&lc->grossLock)) {
+		atomic_inc(&lc->lockWaiters);
+		down_read(&lc->grossLock);
+		atomic_dec(&lc->lockWaiters);
+		lc->lockContended++;	/* Racy, it is only a statistic */
+	}
+	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locked shared %p\n"), current));
+}
+
+static void yaffs_GrossUnlockShared(yaffs_Device *dev)
+{
+	if (!dev->param.isYaffs2) {
+		yaffs_GrossUnlock(dev);
+		return;
+	}
+
+	T(YAFFS_TRACE_LOCK, (TSTR("yaffs unlocking shared %p\n"), current));
+	up_read(&(yaffs_DeviceToLC(dev)->grossLock));
+}
+
+/* Lock a file for reading or writing its data */
+static void yaffs_FileLock(yaffs_Object *obj)
+{
+	yaffs_GrossLockShared(obj->myDev);
+	yaffs_LockObject(obj);
+}
+
+static void yaffs_FileUnlock(yaffs_Object *obj)
+{
+	yaffs_UnlockObject(obj);
+	yaffs_GrossUnlockShared(obj->myDev);
 }
 
 #ifdef YAFFS_COMPILE_EXPORTFS
@@ -970,17 +1035,15 @@ static int yaffs_file_flush(struct file *file)
 {
 	yaffs_Object *obj = yaffs_DentryToObject(file->f_dentry);
 
-	yaffs_Device *dev = obj->myDev;
-
 	T(YAFFS_TRACE_OS,
 		(TSTR("yaffs_file_flush object %d (%s)\n"), obj->objectId,
 		obj->dirty ? "dirty" : "clean"));
 
-	yaffs_GrossLock(dev);
+	yaffs_FileLock(obj);
 
 	yaffs_FlushFile(obj, 1, 0);
 
-	yaffs_GrossUnlock(dev);
+	yaffs_FileUnlock(obj);
 
 	return 0;
 }
@@ -991,10 +1054,10 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 
 	yaffs_Object *obj;
 	unsigned char *pg_buf;
+	loff_t pos = (loff_t)pg->index << PAGE_CACHE_SHIFT;
+	int nCached;
 	int ret;
 
-	yaffs_Device *dev;
-
 	T(YAFFS_TRACE_OS,
 		(TSTR("yaffs_readpage_nolock at %08x, size %08x\n"),
 		(unsigned)(pg->index << PAGE_CACHE_SHIFT),
@@ -1002,8 +1065,6 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 
 	obj = yaffs_DentryToObject(f->f_dentry);
 
-	dev = obj->myDev;
-
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 	BUG_ON(!PageLocked(pg));
 #else
@@ -1014,13 +1075,19 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_GrossLock(dev);
-
-	ret = yaffs_ReadDataFromFile(obj, pg_buf,
-				pg->index << PAGE_CACHE_SHIFT,
+	/* Chunks sitting in the short op cache need no file lock */
+	nCached = yaffs_ReadCachedDataFromFile(obj, pg_buf, pos,
 				PAGE_CACHE_SIZE);
+	ret = nCached;
 
-	yaffs_GrossUnlock(dev);
+	if (nCached < PAGE_CACHE_SIZE) {
+		yaffs_FileLock(obj);
+
+		ret = yaffs_ReadDataFromFile(obj, pg_buf + nCached,
+				pos + nCached, PAGE_CACHE_SIZE - nCached);
+
+		yaffs_FileUnlock(obj);
+	}
 
 	if (ret >= 0)
 		ret = 0;
@@ -1114,7 +1181,7 @@ static int yaffs_writepage(struct page *page)
 
 	obj = yaffs_InodeToObject(inode);
 	dev = obj->myDev;
-	yaffs_GrossLock(dev);
+	yaffs_FileLock(obj);
 
 	T(YAFFS_TRACE_OS,
 		(TSTR("yaffs_writepage at %08x, size %08x\n"),
@@ -1132,7 +1199,7 @@ static int yaffs_writepage(struct page *page)
 		(TSTR("writepag1: obj = %05x, ino = %05x\n"),
 		(int)obj->variant.fileVariant.fileSize, (int)inode->i_size));
 
-	yaffs_GrossUnlock(dev);
+	yaffs_FileUnlock(obj);
 
 	kunmap(page);
 	set_page_writeback(page);
@@ -1448,7 +1515,7 @@ static ssize_t yaffs_file_write(struct file *f, const char *buf, size_t n,
 
 	dev = obj->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_FileLock(obj);
 
 	inode = f->f_dentry->d_inode;
 
@@ -1488,7 +1555,7 @@ static ssize_t yaffs_file_write(struct file *f, const char *buf, size_t n,
 		}
 
 	}
-	yaffs_GrossUnlock(dev);
+	yaffs_FileUnlock(obj);
 	return (nWritten == 0) && (n > 0) ? -ENOSPC : nWritten;
 }
 
@@ -1508,29 +1575,18 @@ static ssize_t yaffs_hold_space(struct file *f)
 
 	dev = obj->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_GrossLockShared(dev);
 
 	nFreeChunks = yaffs_GetNumberOfFreeChunks(dev);
 
-	yaffs_GrossUnlock(dev);
+	yaffs_GrossUnlockShared(dev);
 
 	return (nFreeChunks > 20) ? 1 : 0;
 }
 
 static void yaffs_release_space(struct file *f)
 {
-	yaffs_Object *obj;
-	yaffs_Device *dev;
-
-
-	obj = yaffs_DentryToObject(f->f_dentry);
-
-	dev = obj->myDev;
-
-	yaffs_GrossLock(dev);
-
-
-	yaffs_GrossUnlock(dev);
+	/* Nothing is reserved by yaffs_hold_space() yet */
 }
 
 
@@ -1901,20 +1957,17 @@ static int yaffs_sync_object(struct file *file, struct dentry *dentry,
 {
 
 	yaffs_Object *obj;
-	yaffs_Device *dev;
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 34))
 	struct dentry *dentry = file->f_path.dentry;
 #endif
 
 	obj = yaffs_DentryToObject(dentry);
 
-	dev = obj->myDev;
-
 	T(YAFFS_TRACE_OS | YAFFS_TRACE_SYNC,
 		(TSTR("yaffs_sync_object\n")));
-	yaffs_GrossLock(dev);
+	yaffs_FileLock(obj);
 	yaffs_FlushFile(obj, 1, datasync);
-	yaffs_GrossUnlock(dev);
+	yaffs_FileUnlock(obj);
 	return 0;
 }
 
@@ -2307,6 +2360,9 @@ static int yaffs_do_sync_fs(struct super_block *sb,
 
 #ifdef YAFFS_COMPILE_BACKGROUND
 
+/* Gc passes in a row the background thread may give up to readers */
+#define YAFFS_BG_MAX_DEFERRALS	10
+
 void yaffs_background_waker(unsigned long data)
 {
 	wake_up_process((struct task_struct *)data);
@@ -2321,6 +2377,7 @@ static int yaffs_BackgroundThread(void *data)
 	unsigned long next_gc = now;
 	unsigned long expires;
 	unsigned int urgency;
+	unsigned int gcDeferred = 0;
 
 	int gcResult;
 	struct timer_list timer;
@@ -2343,16 +2400,30 @@ static int yaffs_BackgroundThread(void *data)
 		if(try_to_freeze())
 			continue;
 #endif
-		yaffs_GrossLock(dev);
-
 		now = jiffies;
 
 		if(time_after(now, next_dir_update) && yaffs_bg_enable){
+			yaffs_GrossLock(dev);
 			yaffs_UpdateDirtyDirectories(dev);
+			yaffs_GrossUnlock(dev);
 			next_dir_update = now + HZ;
 		}
 
-		if(time_after(now,next_gc) && yaffs_bg_enable){
+		/* Gc only holds the gross lock shared, so file reads and
+		 * writes carry on beside it.  Tasks queued on the lock are
+		 * still let through first, but only for
+		 * YAFFS_BG_MAX_DEFERRALS passes in a row so that a steady
+		 * load cannot starve gc.
+		 */
+		if(time_after(now,next_gc) && yaffs_bg_enable &&
+		   yaffs_GrossLockWanted(dev) &&
+		   gcDeferred < YAFFS_BG_MAX_DEFERRALS){
+			context->bgDeferrals++;
+			gcDeferred++;
+			next_gc = now + 1;
+		} else if(time_after(now,next_gc) && yaffs_bg_enable){
+			gcDeferred = 0;
+			yaffs_GrossLockShared(dev);
 			if(!dev->isCheckpointed){
 				urgency = yaffs_bg_gc_urgency(dev);
 				gcResult = yaffs_BackgroundGarbageCollect(dev, urgency);
@@ -2367,8 +2438,8 @@ static int yaffs_BackgroundThread(void *data)
 				* to cut down on wake ups
 				*/
 				next_gc = next_dir_update;
+			yaffs_GrossUnlockShared(dev);
 		}
-		yaffs_GrossUnlock(dev);
 #if 1
 		expires = next_dir_update;
 		if (time_before(next_gc,expires))
@@ -2441,6 +2512,182 @@ static void yaffs_BackgroundStop(yaffs_Device *dev)
 }
 #endif
 
+/*
+ * Scan read-ahead.
+ * Without a checkpoint, yaffs2_ScanBackwards() reads the tags (or summary)
+ * of each block and then rebuilds the objects from them. A reader thread
+ * fills a small ring with the tags of the next blocks in scan order, so the
+ * NAND reads for those overlap with the rebuild of the current block.
+ * The reader only uses its own buffers; MTD serialises it against the
+ * scan's own reads.
+ */
+
+#ifdef YAFFS_COMPILE_BACKGROUND
+
+#define YAFFS_SCAN_AHEAD_BLOCKS	4
+
+struct yaffs_ScanAheadSlot {
+	int blk;
+	int fromSummary;
+	int nTagReads;
+	yaffs_ExtendedTags *tags;
+};
+
+struct yaffs_ScanAhead {
+	yaffs_Device *dev;
+	struct task_struct *thread;
+	wait_queue_head_t wq;
+	const yaffs_BlockIndex *blocks;
+	int nBlocks;
+	int nRead;		/* Slots filled, only the reader writes this */
+	int nTaken;		/* Slots used up, only the scan writes this */
+	__u8 *buffer;
+	yaffs_SummaryTags *summary;
+	struct yaffs_ScanAheadSlot slot[YAFFS_SCAN_AHEAD_BLOCKS];
+};
+
+static int yaffs_ScanAheadThread(void *data)
+{
+	struct yaffs_ScanAhead *sa = data;
+	const yaffs_BlockIndex *bx;
+	struct yaffs_ScanAheadSlot *s;
+	int i;
+
+	for (i = 0; i < sa->nBlocks; i++) {
+		wait_event(sa->wq, kthread_should_stop() ||
+			   i - ACCESS_ONCE(sa->nTaken) < YAFFS_SCAN_AHEAD_BLOCKS);
+		if (kthread_should_stop())
+			return 0;
+		/* The scan is done with the slot before we refill it */
+		smp_mb();
+
+		bx = &sa->blocks[sa->nBlocks - 1 - i];
+		s = &sa->slot[i % YAFFS_SCAN_AHEAD_BLOCKS];
+		s->blk = bx->block;
+		s->fromSummary = yaffs_ScanReadBlockTags(sa->dev, bx->block,
+					bx->seq, s->tags, sa->buffer,
+					sa->summary, &s->nTagReads);
+
+		smp_wmb();
+		sa->nRead = i + 1;
+		wake_up(&sa->wq);
+	}
+
+	/* kthread_stop() needs us to still be here */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static int yaffs_ScanAheadGet(yaffs_Device *dev, int blk,
+			yaffs_ExtendedTags *tags, int *nTagReads)
+{
+	struct yaffs_ScanAhead *sa = yaffs_DeviceToLC(dev)->scanAhead;
+	struct yaffs_ScanAheadSlot *s;
+	int found;
+	int ret = -1;
+
+	/* Blocks come in scan order; drop any the scan has skipped */
+	do {
+		if (sa->nTaken >= sa->nBlocks)
+			return -1;
+
+		wait_event(sa->wq, ACCESS_ONCE(sa->nRead) > sa->nTaken);
+		smp_rmb();
+
+		s = &sa->slot[sa->nTaken % YAFFS_SCAN_AHEAD_BLOCKS];
+		found = (s->blk == blk);
+		if (found) {
+			memcpy(tags, s->tags, dev->param.nChunksPerBlock *
+					sizeof(yaffs_ExtendedTags));
+			*nTagReads = s->nTagReads;
+			ret = s->fromSummary;
+		}
+
+		smp_mb();
+		sa->nTaken++;
+		wake_up(&sa->wq);
+	} while (!found);
+
+	return ret;
+}
+
+static void yaffs_ScanAheadFree(struct yaffs_ScanAhead *sa)
+{
+	int i;
+
+	for (i = 0; i < YAFFS_SCAN_AHEAD_BLOCKS; i++)
+		kfree(sa->slot[i].tags);
+	kfree(sa->summary);
+	kfree(sa->buffer);
+	kfree(sa);
+}
+
+static void yaffs_ScanAheadStop(yaffs_Device *dev)
+{
+	struct yaffs_LinuxContext *context = yaffs_DeviceToLC(dev);
+	struct yaffs_ScanAhead *sa = context->scanAhead;
+
+	if (!sa)
+		return;
+
+	kthread_stop(sa->thread);
+	yaffs_ScanAheadFree(sa);
+	context->scanAhead = NULL;
+}
+
+static int yaffs_ScanAheadStart(yaffs_Device *dev,
+			const yaffs_BlockIndex *blocks, int nBlocks)
+{
+	struct yaffs_LinuxContext *context = yaffs_DeviceToLC(dev);
+	struct yaffs_ScanAhead *sa;
+	int i;
+
+	sa = kzalloc(sizeof(*sa), GFP_KERNEL);
+	if (!sa)
+		return YAFFS_FAIL;
+
+	sa->dev = dev;
+	sa->blocks = blocks;
+	sa->nBlocks = nBlocks;
+	init_waitqueue_head(&sa->wq);
+
+	sa->buffer = kmalloc(dev->param.totalBytesPerChunk, GFP_KERNEL);
+	if (!sa->buffer)
+		goto fail;
+	if (dev->chunksPerSummary) {
+		sa->summary = kmalloc(dev->chunksPerSummary *
+				sizeof(yaffs_SummaryTags), GFP_KERNEL);
+		if (!sa->summary)
+			goto fail;
+	}
+	for (i = 0; i < YAFFS_SCAN_AHEAD_BLOCKS; i++) {
+		sa->slot[i].tags = kmalloc(dev->param.nChunksPerBlock *
+				sizeof(yaffs_ExtendedTags), GFP_KERNEL);
+		if (!sa->slot[i].tags)
+			goto fail;
+	}
+
+	sa->thread = kthread_run(yaffs_ScanAheadThread, sa, "yaffs-scan-%d",
+				 context->mount_id);
+	if (IS_ERR(sa->thread))
+		goto fail;
+
+	context->scanAhead = sa;
+	return YAFFS_OK;
+
+fail:
+	yaffs_ScanAheadFree(sa);
+	return YAFFS_FAIL;
+}
+#endif
+
+
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 17))
 static void yaffs_write_super(struct super_block *sb)
@@ -2606,6 +2853,10 @@ typedef struct {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int summary;
+	int summary_overridden;
+	int n_caches;		/* 0 means use the default */
+	int n_prefetch;
 	int tags_ecc_on;
 	int tags_ecc_overridden;
 	int lazy_loading_enabled;
@@ -2660,6 +2911,16 @@ static int yaffs_parse_options(yaffs_options *options, const char *options_str)
 			options->empty_lost_and_found_overridden=1;
 		} else if (!strcmp(cur_opt, "no-cache"))
 			options->no_cache = 1;
+		else if (!strcmp(cur_opt, "summary")) {
+			options->summary = 1;
+			options->summary_overridden = 1;
+		} else if (!strcmp(cur_opt, "no-summary")) {
+			options->summary = 0;
+			options->summary_overridden = 1;
+		} else if (!strncmp(cur_opt, "cache=", 6))
+			options->n_caches = simple_strtoul(cur_opt + 6, NULL, 0);
+		else if (!strncmp(cur_opt, "prefetch=", 9))
+			options->n_prefetch = simple_strtoul(cur_opt + 9, NULL, 0);
 		else if (!strcmp(cur_opt, "no-checkpoint-read"))
 			options->skip_checkpoint_read = 1;
 		else if (!strcmp(cur_opt, "no-checkpoint-write"))
@@ -2916,8 +3177,15 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	param->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	param->totalBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	param->nReservedBlocks = 5;
-	param->nShortOpCaches = (options.no_cache) ? 0 : 10;
+	param->nShortOpCaches = (options.no_cache) ? 0 :
+				(options.n_caches > 0) ? options.n_caches : 10;
+	param->nPrefetchChunks = options.n_prefetch;
 	param->inbandTags = options.inband_tags;
+#ifdef CONFIG_YAFFS_SUMMARY
+	param->enableSummary = 1;
+#endif
+	if (options.summary_overridden)
+		param->enableSummary = options.summary;
 
 #ifdef CONFIG_YAFFS_DISABLE_LAZY_LOAD
 	param->disableLazyLoad = 1;
@@ -2965,6 +3233,12 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 		    nandmtd2_ReadChunkWithTagsFromNAND;
 		param->markNANDBlockBad = nandmtd2_MarkNANDBlockBad;
 		param->queryNANDBlock = nandmtd2_QueryNANDBlock;
+		param->readTagsBatchFromNAND = nandmtd2_ReadTagsBatchFromNAND;
+#ifdef YAFFS_COMPILE_BACKGROUND
+		param->scanReadAheadStart = yaffs_ScanAheadStart;
+		param->scanReadAheadGet = yaffs_ScanAheadGet;
+		param->scanReadAheadStop = yaffs_ScanAheadStop;
+#endif
 		yaffs_DeviceToLC(dev)->spareBuffer = YMALLOC(mtd->oobsize);
 		param->isYaffs2 = 1;
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 17))
@@ -3036,7 +3310,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
         YINIT_LIST_HEAD(&(yaffs_DeviceToLC(dev)->searchContexts));
         param->removeObjectCallback = yaffs_RemoveObjectCallback;
 
-	init_MUTEX(&(yaffs_DeviceToLC(dev)->grossLock));
+	init_rwsem(&(yaffs_DeviceToLC(dev)->grossLock));
+	atomic_set(&(yaffs_DeviceToLC(dev)->lockWaiters), 0);
 
 	yaffs_GrossLock(dev);
 
@@ -3196,8 +3471,10 @@ static char *yaffs_dump_dev_part0(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "inbandTags......... %d\n", dev->param.inbandTags);
 	buf += sprintf(buf, "emptyLostAndFound.. %d\n", dev->param.emptyLostAndFound);
 	buf += sprintf(buf, "disableLazyLoad.... %d\n", dev->param.disableLazyLoad);
+	buf += sprintf(buf, "enableSummary...... %d\n", dev->param.enableSummary);
 	buf += sprintf(buf, "refreshPeriod...... %d\n", dev->param.refreshPeriod);
 	buf += sprintf(buf, "nShortOpCaches..... %d\n", dev->param.nShortOpCaches);
+	buf += sprintf(buf, "nPrefetchChunks.... %d\n", dev->param.nPrefetchChunks);
 	buf += sprintf(buf, "nReservedBlocks.... %d\n", dev->param.nReservedBlocks);
 	buf += sprintf(buf, "alwaysCheckErased.. %d\n", dev->param.alwaysCheckErased);
 
@@ -3217,6 +3494,8 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "nTnodes............ %d\n", dev->nTnodes);
 	buf += sprintf(buf, "nObjects........... %d\n", dev->nObjects);
+	buf += sprintf(buf, "nDirIndexes........ %d\n", dev->nDirIndexes);
+	buf += sprintf(buf, "dirIndexBytes...... %u\n", dev->dirIndexBytes);
 	buf += sprintf(buf, "nFreeChunks........ %d\n", dev->nFreeChunks);
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "nPageWrites........ %u\n", dev->nPageWrites);
@@ -3228,6 +3507,7 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "oldestDirtyGCs..... %u\n", dev->oldestDirtyGCs);
 	buf += sprintf(buf, "nGCBlocks.......... %u\n", dev->nGCBlocks);
 	buf += sprintf(buf, "backgroundGCs...... %u\n", dev->backgroundGCs);
+	buf += sprintf(buf, "gcObjectBusy....... %u\n", dev->gcObjectBusy);
 	buf += sprintf(buf, "nRetriedWrites..... %u\n", dev->nRetriedWrites);
 	buf += sprintf(buf, "nRetireBlocks...... %u\n", dev->nRetiredBlocks);
 	buf += sprintf(buf, "eccFixed........... %u\n", dev->eccFixed);
@@ -3235,11 +3515,27 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "tagsEccFixed....... %u\n", dev->tagsEccFixed);
 	buf += sprintf(buf, "tagsEccUnfixed..... %u\n", dev->tagsEccUnfixed);
 	buf += sprintf(buf, "cacheHits.......... %u\n", dev->cacheHits);
+	buf += sprintf(buf, "cacheMisses........ %u\n", dev->cacheMisses);
+	buf += sprintf(buf, "cacheHitPercent.... %u\n",
+		(dev->cacheHits + dev->cacheMisses) ?
+		(unsigned)div_u64((__u64)dev->cacheHits * 100,
+			dev->cacheHits + dev->cacheMisses) : 0);
+	buf += sprintf(buf, "cacheDirty......... %d\n", dev->srDirtyCount);
+	buf += sprintf(buf, "cachePrefetches.... %u\n", dev->cachePrefetches);
+	buf += sprintf(buf, "cachePrefetchHits.. %u\n", dev->cachePrefetchHits);
+	buf += sprintf(buf, "cacheLocklessHits.. %u\n", dev->cacheLocklessHits);
 	buf += sprintf(buf, "nDeletedFiles...... %u\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %u\n", dev->nUnlinkedFiles);
 	buf += sprintf(buf, "refreshCount....... %u\n", dev->refreshCount);
+	buf += sprintf(buf, "nSummaryWrites..... %u\n", dev->nSummaryWrites);
+	buf += sprintf(buf, "nScanSummaries..... %u\n", dev->nScanSummaries);
+	buf += sprintf(buf, "nScanTagReads...... %u\n", dev->nScanTagReads);
 	buf +=
 	    sprintf(buf, "nBackgroudDeletions %u\n", dev->nBackgroundDeletions);
+	buf += sprintf(buf, "lockContended...... %u\n",
+			yaffs_DeviceToLC(dev)->lockContended);
+	buf += sprintf(buf, "bgDeferrals........ %u\n",
+			yaffs_DeviceToLC(dev)->bgDeferrals);
 
 	return buf;
 }
@@ -21,6 +21,7 @@
 #include "yaffs_nand.h"
 #include "yaffs_getblockinfo.h"
 #include "yaffs_verify.h"
+#include "yaffs_summary.h"
 
 /*
  * Checkpoints are really no benefit on very small partitions.
@@ -891,12 +892,6 @@ int yaffs2_HandleHole(yaffs_Object *obj, loff_t newSize)
 }
 
 
-typedef struct {
-	int seq;
-	int block;
-} yaffs_BlockIndex;
-
-
 static int yaffs2_ybicmp(const void *a, const void *b)
 {
 	register int aseq = ((yaffs_BlockIndex *)a)->seq;
@@ -909,6 +904,35 @@ static int yaffs2_ybicmp(const void *a, const void *b)
 		return aseq - bseq;
 }
 
+/* Get the tags of every chunk in a block to be scanned, from the read-ahead
+ * thread if there is one, and account for the reads.
+ */
+static void yaffs2_ScanGetBlockTags(yaffs_Device *dev, int blk, int readAhead,
+				yaffs_ExtendedTags *blockTags, __u8 *buffer)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blk);
+	int fromSummary = -1;
+	int nTagReads = 0;
+	int c;
+
+	if (readAhead)
+		fromSummary = dev->param.scanReadAheadGet(dev, blk, blockTags,
+							  &nTagReads);
+	if (fromSummary < 0)
+		fromSummary = yaffs_ScanReadBlockTags(dev, blk,
+					bi->sequenceNumber, blockTags, buffer,
+					dev->summaryTags, &nTagReads);
+
+	dev->nPageReads += nTagReads;
+	dev->nScanTagReads += nTagReads;
+	if (fromSummary)
+		dev->nScanSummaries++;
+
+	for (c = 0; c < dev->param.nChunksPerBlock; c++)
+		if (blockTags[c].eccResult > YAFFS_ECC_RESULT_NO_ERROR)
+			yaffs_HandleChunkError(dev, bi);
+}
+
 int yaffs2_ScanBackwards(yaffs_Device *dev)
 {
 	yaffs_ExtendedTags tags;
@@ -942,6 +966,9 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 
 	yaffs_BlockIndex *blockIndex = NULL;
 	int altBlockIndex = 0;
+	yaffs_ExtendedTags *blockTags;
+	__u8 *tagsBuffer;
+	int readAhead = 0;
 
 	T(YAFFS_TRACE_SCAN,
 	  (TSTR
@@ -964,9 +991,20 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 		return YAFFS_FAIL;
 	}
 
+	/* Tags of the block being scanned, from its summary or a batched read */
+	blockTags = YMALLOC(dev->param.nChunksPerBlock * sizeof(yaffs_ExtendedTags));
+	if (!blockTags) {
+		if (altBlockIndex)
+			YFREE_ALT(blockIndex);
+		else
+			YFREE(blockIndex);
+		return YAFFS_FAIL;
+	}
+
 	dev->blocksInCheckpoint = 0;
 
 	chunkData = yaffs_GetTempBuffer(dev, __LINE__);
+	tagsBuffer = yaffs_GetTempBuffer(dev, __LINE__);
 
 	/* Scan all the blocks to determine their state */
 	bi = dev->blockInfo;
@@ -1046,6 +1084,12 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 	T(YAFFS_TRACE_SCAN_DEBUG,
 	  (TSTR("%d blocks to be scanned" TENDSTR), nBlocksToScan));
 
+	/* Have the tags of the next blocks read while we work on this one */
+	if (nBlocksToScan > 1 && dev->param.scanReadAheadStart &&
+	    yaffs_ScanCanReadAhead(dev))
+		readAhead = dev->param.scanReadAheadStart(dev, blockIndex,
+						nBlocksToScan) == YAFFS_OK;
+
 	/* For each block.... backwards */
 	for (blockIterator = endIterator; !alloc_failed && blockIterator >= startIterator;
 			blockIterator--) {
@@ -1063,6 +1107,10 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 
 		deleted = 0;
 
+		if (state == YAFFS_BLOCK_STATE_NEEDS_SCANNING)
+			yaffs2_ScanGetBlockTags(dev, blk, readAhead, blockTags,
+						tagsBuffer);
+
 		/* For each chunk in each block that needs scanning.... */
 		foundChunksInBlock = 0;
 		for (c = dev->param.nChunksPerBlock - 1;
@@ -1075,8 +1123,7 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 
 			chunk = blk * dev->param.nChunksPerBlock + c;
 
-			result = yaffs_ReadChunkWithTagsFromNAND(dev, chunk, NULL,
-							&tags);
+			tags = blockTags[c];
 
 			/* Let's have a good look at this chunk... */
 
@@ -1142,6 +1189,14 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 
 				  dev->nFreeChunks++;
 
+			} else if (tags.objectId == YAFFS_OBJECTID_SUMMARY) {
+				/* The block summary. It is not in use, but
+				 * it is not free either: garbage collecting
+				 * the block just writes another one.
+				 */
+				foundChunksInBlock = 1;
+				bi->hasSummary = 1;
+
 			} else if (tags.chunkId > 0) {
 				/* chunkId > 0 so it is a data chunk... */
 				unsigned int endpos;
@@ -1516,11 +1571,18 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 	
 	yaffs_SkipRestOfBlock(dev);
 
+	/* Before the index goes, the reader may still be walking it */
+	if (readAhead)
+		dev->param.scanReadAheadStop(dev);
+
 	if (altBlockIndex)
 		YFREE_ALT(blockIndex);
 	else
 		YFREE(blockIndex);
 
+	YFREE(blockTags);
+	yaffs_ReleaseTempBuffer(dev, tagsBuffer, __LINE__);
+
 	/* Ok, we've done all the scanning.
 	 * Fix up the hard link chains.
 	 * We should now have scanned all the objects, now it's time to add these
@@ -1534,7 +1596,9 @@ int yaffs2_ScanBackwards(yaffs_Device *dev)
 	if (alloc_failed)
 		return YAFFS_FAIL;
 
-	T(YAFFS_TRACE_SCAN, (TSTR("yaffs2_ScanBackwards ends" TENDSTR)));
+	T(YAFFS_TRACE_SCAN,
+	  (TSTR("yaffs2_ScanBackwards ends, %u summaries %u tag reads" TENDSTR),
+	  dev->nScanSummaries, dev->nScanTagReads));
 
 	return YAFFS_OK;
 }
@@ -44,6 +44,7 @@
 
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/string.h>
 #include <linux/slab.h>
@@ -76,6 +77,13 @@
 #define YYIELD() schedule()
 #define Y_DUMP_STACK() dump_stack()
 
+#define YLOCK			struct mutex
+#define YLOCK_INIT(l)		mutex_init(l)
+#define YLOCK_TAKE(l)		mutex_lock(l)
+#define YLOCK_TRY(l)		mutex_trylock(l)
+#define YLOCK_GIVE(l)		mutex_unlock(l)
+#define Y_CURRENT_TASK()	((void *)current)
+
 #define YAFFS_ROOT_MODE			0755
 #define YAFFS_LOSTNFOUND_MODE		0700
 
@@ -320,6 +328,16 @@
 #define Y_DUMP_STACK() do { } while (0)
 #endif
 
+/* Single threaded environments get no-op object, allocator and cache locks */
+#ifndef YLOCK
+#define YLOCK			int
+#define YLOCK_INIT(l)		do { *(l) = 0; } while (0)
+#define YLOCK_TAKE(l)		do { } while (0)
+#define YLOCK_TRY(l)		1
+#define YLOCK_GIVE(l)		do { } while (0)
+#define Y_CURRENT_TASK()	NULL
+#endif
+
 #ifndef YBUG
 #define YBUG() do {\
 	T(YAFFS_TRACE_BUG,\
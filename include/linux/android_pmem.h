@@ -34,6 +34,18 @@
  */
 #define PMEM_GET_TOTAL_SIZE	_IOW(PMEM_IOCTL_MAGIC, 7, unsigned int)
 #define PMEM_CACHE_FLUSH	_IOW(PMEM_IOCTL_MAGIC, 8, unsigned int)
+/* Cleans, invalidates or flushes only the parts of the allocation listed in
+ * a pmem_dirty_rects struct, and returns the number of bytes the cache
+ * operations covered in its flushed field.
+ */
+#define PMEM_CACHE_SYNC_RECTS	_IOWR(PMEM_IOCTL_MAGIC, 9, unsigned int)
+
+/* cache operation for PMEM_CACHE_SYNC_RECTS, chosen by the DMA direction */
+#define PMEM_CACHE_OP_FLUSH	0	/* cpu and device both read and write */
+#define PMEM_CACHE_OP_CLEAN	1	/* cpu wrote, device will read */
+#define PMEM_CACHE_OP_INV	2	/* device wrote, cpu will read */
+
+#define PMEM_MAX_DIRTY_RECTS	16
 
 struct android_pmem_platform_data
 {
@@ -57,6 +69,23 @@ struct pmem_region {
 	unsigned long len;
 };
 
+/* height lines of width bytes, stride bytes apart, starting offset bytes
+ * into the allocation; a plain byte range has a height of 1 */
+struct pmem_dirty_rect {
+	unsigned long offset;
+	unsigned long stride;
+	unsigned long width;
+	unsigned long height;
+};
+
+struct pmem_dirty_rects {
+	unsigned int op;
+	unsigned int count;
+	struct pmem_dirty_rect rects[PMEM_MAX_DIRTY_RECTS];
+	/* set by the driver */
+	unsigned long flushed;
+};
+
 #ifdef CONFIG_ANDROID_PMEM
 int is_pmem_file(struct file *file);
 int get_pmem_file(int fd, unsigned long *start, unsigned long *vstart,
@@ -65,6 +94,9 @@ int get_pmem_user_addr(struct file *file, unsigned long *start,
 		       unsigned long *end);
 void put_pmem_file(struct file* file);
 void flush_pmem_file(struct file *file, unsigned long start, unsigned long len);
+long sync_pmem_file_rects(struct file *file, unsigned int op,
+			  const struct pmem_dirty_rect *rects,
+			  unsigned int count);
 int pmem_setup(struct android_pmem_platform_data *pdata,
 	       long (*ioctl)(struct file *, unsigned int, unsigned long),
 	       int (*release)(struct inode *, struct file *));
@@ -81,6 +113,9 @@ static inline int get_pmem_user_addr(struct file *file, unsigned long *start,
 static inline void put_pmem_file(struct file* file) { return; }
 static inline void flush_pmem_file(struct file *file, unsigned long start,
 				   unsigned long len) { return; }
+static inline long sync_pmem_file_rects(struct file *file, unsigned int op,
+					const struct pmem_dirty_rect *rects,
+					unsigned int count) { return -ENOSYS; }
 static inline int pmem_setup(struct android_pmem_platform_data *pdata,
 	      long (*ioctl)(struct file *, unsigned int, unsigned long),
 	      int (*release)(struct inode *, struct file *)) { return -ENOSYS; }
@@ -90,6 +90,9 @@ enum v4l2_photometry_mode {
 
 #define V4L2_CID_STREAM_PAUSE			(V4L2_CID_PRIVATE_BASE + 53)
 
+/* Shared buffer import: v4l2_buffer.m.offset carries the handle's fd */
+#define V4L2_MEMORY_S5P_SHBUF			0x100
+
 /* CID Extensions for camera sensor operations */
 #define V4L2_CID_CAM_PREVIEW_ONOFF		(V4L2_CID_PRIVATE_BASE + 64)
 #define V4L2_CID_CAM_CAPTURE			(V4L2_CID_PRIVATE_BASE + 65)
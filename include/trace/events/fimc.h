@@ -0,0 +1,68 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fimc
+
+#if !defined(_TRACE_FIMC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FIMC_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fimc_capbuf_get,
+
+	TP_PROTO(int id, dma_addr_t base, size_t length, int align,
+		 int reused, unsigned int alloc_cnt, unsigned int reuse_cnt),
+
+	TP_ARGS(id, base, length, align, reused, alloc_cnt, reuse_cnt),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+		__field(	dma_addr_t,	base		)
+		__field(	size_t,		length		)
+		__field(	int,		align		)
+		__field(	int,		reused		)
+		__field(	unsigned int,	alloc_cnt	)
+		__field(	unsigned int,	reuse_cnt	)
+	),
+
+	TP_fast_assign(
+		__entry->id		= id;
+		__entry->base		= base;
+		__entry->length		= length;
+		__entry->align		= align;
+		__entry->reused		= reused;
+		__entry->alloc_cnt	= alloc_cnt;
+		__entry->reuse_cnt	= reuse_cnt;
+	),
+
+	TP_printk("fimc%d base=0x%08lx len=%zu align=%d %s allocs=%u reuses=%u",
+		  __entry->id, (unsigned long)__entry->base, __entry->length,
+		  __entry->align, __entry->reused ? "reuse" : "alloc",
+		  __entry->alloc_cnt, __entry->reuse_cnt)
+);
+
+TRACE_EVENT(fimc_capbuf_shrink,
+
+	TP_PROTO(int id, int nr_slots, size_t released),
+
+	TP_ARGS(id, nr_slots, released),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+		__field(	int,		nr_slots	)
+		__field(	size_t,		released	)
+	),
+
+	TP_fast_assign(
+		__entry->id		= id;
+		__entry->nr_slots	= nr_slots;
+		__entry->released	= released;
+	),
+
+	TP_printk("fimc%d slots=%d released=%zu",
+		  __entry->id, __entry->nr_slots, __entry->released)
+);
+
+#endif /* _TRACE_FIMC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -19,14 +19,19 @@
 #include <linux/suspend.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
+#include <linux/rbtree.h>
 #ifdef CONFIG_WAKELOCK_STAT
 #include <linux/proc_fs.h>
+#include <linux/percpu.h>
 #endif
 #include "power.h"
 #ifdef CONFIG_SVNET_WHITELIST
 #include "portlist.h"
 #endif
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/wakelock.h>
+
 enum {
 	DEBUG_EXIT_SUSPEND = 1U << 0,
 	DEBUG_WAKEUP = 1U << 1,
@@ -46,6 +51,10 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/* Active locks with a timeout, ordered by expiry */
+static struct rb_root expire_tree[WAKE_LOCK_TYPE_COUNT];
+/* Number of active locks without a timeout */
+static int untimed_count[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct workqueue_struct *sync_work_queue;
@@ -56,9 +65,22 @@ static struct wake_lock unknown_wakeup;
 
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
-static ktime_t last_sleep_time_update;
 static int wait_for_wakeup;
 
+/*
+ * Event counts kept per CPU so the hot paths do not share a cache line.
+ * They are bumped after list_lock is dropped; only expirations, which are
+ * found while walking the expiry tree, are counted under it.
+ */
+struct wakelock_cpu_stats {
+	unsigned long acquire_count;
+	unsigned long timeout_count;
+	unsigned long release_count;
+	unsigned long expire_count;
+};
+static DEFINE_PER_CPU(struct wakelock_cpu_stats, wakelock_cpu_stats);
+#define wakelock_cpu_stat_inc(field) this_cpu_inc(wakelock_cpu_stats.field)
+
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 {
 	struct timespec ts;
@@ -109,7 +131,8 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 		total_time = ktime_add(total_time, add_time);
 		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)
 			prevent_suspend_time = ktime_add(prevent_suspend_time,
-					ktime_sub(now, last_sleep_time_update));
+					ktime_sub(now,
+					lock->stat.prevent_suspend_start));
 		if (add_time.tv64 > max_time.tv64)
 			max_time = add_time;
 	}
@@ -144,6 +167,21 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int wakelock_cpu_stats_show(struct seq_file *m, void *unused)
+{
+	struct wakelock_cpu_stats *st;
+	int cpu;
+
+	seq_puts(m, "cpu\tacquire\ttimeout\trelease\texpire\n");
+	for_each_possible_cpu(cpu) {
+		st = &per_cpu(wakelock_cpu_stats, cpu);
+		seq_printf(m, "%d\t%lu\t%lu\t%lu\t%lu\n", cpu,
+			   st->acquire_count, st->timeout_count,
+			   st->release_count, st->expire_count);
+	}
+	return 0;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -163,46 +201,96 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 		lock->stat.max_time = duration;
 	lock->stat.last_time = ktime_get();
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-		duration = ktime_sub(now, last_sleep_time_update);
+		duration = ktime_sub(now, lock->stat.prevent_suspend_start);
 		lock->stat.prevent_suspend_time = ktime_add(
 			lock->stat.prevent_suspend_time, duration);
 		lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
 	}
 }
 
+/*
+ * Called when the main lock is taken (done) or dropped: every active
+ * suspend lock stops or starts being charged for preventing suspend.
+ */
 static void update_sleep_wait_stats_locked(int done)
 {
 	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
+	ktime_t now, etime, add;
 	int expired;
 
 	now = ktime_get();
-	elapsed = ktime_sub(now, last_sleep_time_update);
 	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
 		expired = get_expired_time(lock, &etime);
 		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-			if (expired)
-				add = ktime_sub(etime, last_sleep_time_update);
-			else
-				add = elapsed;
+			add = ktime_sub(expired ? etime : now,
+					lock->stat.prevent_suspend_start);
 			lock->stat.prevent_suspend_time = ktime_add(
 				lock->stat.prevent_suspend_time, add);
 		}
-		if (done || expired)
+		if (done || expired) {
 			lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
-		else
+		} else {
 			lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
+			lock->stat.prevent_suspend_start = now;
+		}
 	}
-	last_sleep_time_update = now;
 }
+
+/*
+ * Called when @lock is taken while the main lock is not held. The other
+ * active locks are already being charged, so only @lock needs to start.
+ */
+static void update_sleep_wait_stats_lock_locked(struct wake_lock *lock)
+{
+	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)
+		return;
+	lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
+	lock->stat.prevent_suspend_start = ktime_get();
+}
+#else
+#define wakelock_cpu_stat_inc(field) do { } while (0)
 #endif
 
+static void expire_tree_insert(struct wake_lock *lock, int type)
+{
+	struct rb_node **p = &expire_tree[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct wake_lock, expire_node);
+		if (time_before(lock->expires, entry->expires))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&lock->expire_node, parent, p);
+	rb_insert_color(&lock->expire_node, &expire_tree[type]);
+}
+
+/* Take an active lock off the expire tree or out of the untimed count */
+static void wake_lock_unlink_locked(struct wake_lock *lock)
+{
+	int type = lock->flags & WAKE_LOCK_TYPE_MASK;
+
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE)
+		rb_erase(&lock->expire_node, &expire_tree[type]);
+	else
+		untimed_count[type]--;
+}
+
 
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 1);
 #endif
+	trace_wakelock_expire(lock);
+	wakelock_cpu_stat_inc(expire_count);
+	wake_lock_unlink_locked(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -235,21 +323,23 @@ static void print_active_locks(int type)
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct wake_lock *lock;
+	struct rb_node *node;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	while ((node = rb_first(&expire_tree[type]))) {
+		lock = rb_entry(node, struct wake_lock, expire_node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	if (untimed_count[type])
+		return -1;
+	node = rb_last(&expire_tree[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, expire_node);
+	return lock->expires - jiffies;
 }
 
 long has_wake_lock(int type)
@@ -387,7 +477,9 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
-	lock->flags &= ~WAKE_LOCK_INITIALIZED;
+	wake_lock_unlink_locked(lock);
+	lock->flags &= ~(WAKE_LOCK_INITIALIZED | WAKE_LOCK_ACTIVE |
+			 WAKE_LOCK_AUTO_EXPIRE);
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
 		deleted_wake_locks.stat.count += lock->stat.count;
@@ -432,12 +524,14 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	wake_lock_unlink_locked(lock);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
 		lock->stat.last_time = ktime_get();
 #endif
 	}
+	trace_wakelock_acquire(lock, type, has_timeout ? timeout : 0);
 	list_del(&lock->link);
 	if (has_timeout) {
 		if (debug_mask & DEBUG_WAKE_LOCK)
@@ -447,12 +541,14 @@ static void wake_lock_internal(
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
 		list_add_tail(&lock->link, &active_wake_locks[type]);
+		expire_tree_insert(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
+		untimed_count[type]++;
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
@@ -460,7 +556,7 @@ static void wake_lock_internal(
 		if (lock == &main_wake_lock)
 			update_sleep_wait_stats_locked(1);
 		else if (!wake_lock_active(&main_wake_lock))
-			update_sleep_wait_stats_locked(0);
+			update_sleep_wait_stats_lock_locked(lock);
 #endif
 		if (has_timeout)
 			expire_in = has_wake_lock_locked(type);
@@ -481,6 +577,11 @@ static void wake_lock_internal(
 		}
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+
+	if (has_timeout)
+		wakelock_cpu_stat_inc(timeout_count);
+	else
+		wakelock_cpu_stat_inc(acquire_count);
 }
 
 void wake_lock(struct wake_lock *lock)
@@ -498,6 +599,7 @@ EXPORT_SYMBOL(wake_lock_timeout);
 void wake_unlock(struct wake_lock *lock)
 {
 	int type;
+	int was_active;
 	unsigned long irqflags;
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
@@ -506,6 +608,10 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	was_active = lock->flags & WAKE_LOCK_ACTIVE;
+	if (was_active)
+		trace_wakelock_release(lock);
+	wake_lock_unlink_locked(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -533,6 +639,9 @@ void wake_unlock(struct wake_lock *lock)
 		}
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+
+	if (was_active)
+		wakelock_cpu_stat_inc(release_count);
 }
 EXPORT_SYMBOL(wake_unlock);
 
@@ -555,13 +664,28 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_cpu_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_cpu_stats_show, NULL);
+}
+
+static const struct file_operations wakelock_cpu_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_cpu_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		expire_tree[i] = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -598,6 +722,8 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelocks_percpu", S_IRUGO, NULL,
+		    &wakelock_cpu_stats_fops);
 #endif
 
 	return 0;
@@ -621,6 +747,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelocks_percpu", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(sync_work_queue);
@@ -1574,6 +1574,11 @@ void wm8994_shutdown(struct snd_pcm_substream *substream,
 		return;
 	}
 
+	/* the other playback device still runs on AIF1 */
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+			codec_dai->playback.active)
+		return;
+
 #ifdef CONFIG_SND_S5P_RP
 	DEBUG_LOG("S5p_rp_is_running = [0x%X]", s5p_rp_is_running);
 	/* Because RP use dummy data, shutdown is called during RP is running.
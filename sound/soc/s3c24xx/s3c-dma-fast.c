@@ -0,0 +1,510 @@
+/*
+ * s3c-dma-fast.c  --  Low-latency PCM on the I2S primary FIFO
+ *
+ * Copyright (c) 2010 Samsung Electronics Co. Ltd
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ * Playback only, with small fixed periods for games and UI sounds.  The
+ * buffer is looped by the system DMA and the position is read back from
+ * the DMA engine on every pointer call, so no timer is involved.  When the
+ * application falls behind, the part of the ring it has not written yet
+ * is filled with silence so that a stream kept running past an underrun
+ * plays silence instead of stale samples.
+ *
+ * Period interrupt jitter and xrun counts are kept in
+ * /proc/asound/cardN/fast-pcm.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/dma-mapping.h>
+
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+#include <sound/info.h>
+#include <sound/soc.h>
+
+#include <asm/dma.h>
+#include <mach/hardware.h>
+#include <mach/dma.h>
+
+#include "s3c-dma.h"
+
+#define FAST_PERIOD_BYTES	1024	/* 256 frames, ~5.8ms at 44.1kHz */
+#define FAST_PERIODS_MAX	8
+#define FAST_BUFFER_BYTES	(FAST_PERIOD_BYTES * FAST_PERIODS_MAX)
+
+static const struct snd_pcm_hardware s3c_fast_hardware = {
+	.info			= SNDRV_PCM_INFO_INTERLEAVED |
+				    SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				    SNDRV_PCM_INFO_MMAP |
+				    SNDRV_PCM_INFO_MMAP_VALID |
+				    SNDRV_PCM_INFO_PAUSE |
+				    SNDRV_PCM_INFO_RESUME,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE,
+	.rates			= SNDRV_PCM_RATE_44100,
+	.rate_min		= 44100,
+	.rate_max		= 44100,
+	.channels_min		= 2,
+	.channels_max		= 2,
+	.buffer_bytes_max	= FAST_BUFFER_BYTES,
+	.period_bytes_min	= FAST_PERIOD_BYTES,
+	.period_bytes_max	= FAST_PERIOD_BYTES,
+	.periods_min		= 2,
+	.periods_max		= FAST_PERIODS_MAX,
+	.fifo_size		= 32,
+};
+
+struct s3c_fast_runtime_data {
+	spinlock_t lock;
+	int state;
+	unsigned int dma_period;
+	unsigned int dma_periods;
+	dma_addr_t dma_start;
+	snd_pcm_uframes_t silence_end;
+	struct s3c_dma_params *params;
+};
+
+/* Measured over the current run, reset on every start */
+static struct s3c_fast_stats {
+	spinlock_t lock;
+	u32 period_ns;
+	ktime_t last;
+	unsigned int periods;
+	u64 interval_min;
+	u64 interval_max;
+	u64 jitter_sum;
+	u64 jitter_max;
+	unsigned int late;
+	unsigned int xruns;
+} s3c_fast_stats = {
+	.lock = __SPIN_LOCK_UNLOCKED(s3c_fast_stats.lock),
+};
+
+static void s3c_fast_stats_reset(u32 period_ns)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&s3c_fast_stats.lock, flags);
+	s3c_fast_stats.period_ns = period_ns;
+	s3c_fast_stats.last = ktime_set(0, 0);
+	s3c_fast_stats.periods = 0;
+	s3c_fast_stats.interval_min = ULLONG_MAX;
+	s3c_fast_stats.interval_max = 0;
+	s3c_fast_stats.jitter_sum = 0;
+	s3c_fast_stats.jitter_max = 0;
+	s3c_fast_stats.late = 0;
+	s3c_fast_stats.xruns = 0;
+	spin_unlock_irqrestore(&s3c_fast_stats.lock, flags);
+}
+
+static void s3c_fast_stats_period(ktime_t now)
+{
+	struct s3c_fast_stats *st = &s3c_fast_stats;
+	u64 interval, jitter;
+
+	spin_lock(&st->lock);
+	if (st->last.tv64) {
+		interval = ktime_to_ns(ktime_sub(now, st->last));
+		jitter = (interval > st->period_ns) ?
+			interval - st->period_ns : st->period_ns - interval;
+
+		if (interval < st->interval_min)
+			st->interval_min = interval;
+		if (interval > st->interval_max)
+			st->interval_max = interval;
+		if (jitter > st->jitter_max)
+			st->jitter_max = jitter;
+		st->jitter_sum += jitter;
+		st->periods++;
+	}
+	st->last = now;
+	spin_unlock(&st->lock);
+}
+
+/* Signed distance a - b on the ALSA position ring */
+static snd_pcm_sframes_t s3c_fast_diff(struct snd_pcm_runtime *runtime,
+		snd_pcm_uframes_t a, snd_pcm_uframes_t b)
+{
+	snd_pcm_sframes_t d = a - b;
+
+	if (d < -(snd_pcm_sframes_t)(runtime->boundary / 2))
+		d += runtime->boundary;
+	else if (d >= (snd_pcm_sframes_t)(runtime->boundary / 2))
+		d -= runtime->boundary;
+
+	return d;
+}
+
+/* s3c_fast_silence
+ *
+ * Called with the stream lock held after the hw pointer was updated.
+ * If less than a period is queued the DMA is about to loop into data
+ * the application never wrote; overwrite everything between appl_ptr
+ * and one buffer ahead of hw_ptr with silence.
+*/
+static void s3c_fast_silence(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd = runtime->private_data;
+	snd_pcm_uframes_t from, end, ofs, n;
+	snd_pcm_sframes_t frames;
+
+	if (snd_pcm_playback_hw_avail(runtime) >= runtime->period_size)
+		return;
+
+	spin_lock(&s3c_fast_stats.lock);
+	s3c_fast_stats.late++;
+	spin_unlock(&s3c_fast_stats.lock);
+
+	end = runtime->status->hw_ptr + runtime->buffer_size;
+	if (end >= runtime->boundary)
+		end -= runtime->boundary;
+
+	from = runtime->control->appl_ptr;
+	if (s3c_fast_diff(runtime, prtd->silence_end, from) > 0)
+		from = prtd->silence_end;
+
+	frames = s3c_fast_diff(runtime, end, from);
+	if (frames <= 0)
+		return;
+
+	ofs = from % runtime->buffer_size;
+	while (frames > 0) {
+		n = min_t(snd_pcm_uframes_t, frames, runtime->buffer_size - ofs);
+		snd_pcm_format_set_silence(runtime->format,
+				runtime->dma_area + frames_to_bytes(runtime, ofs),
+				n * runtime->channels);
+		frames -= n;
+		ofs = 0;
+	}
+
+	prtd->silence_end = end;
+}
+
+static void s3c_fast_buffdone(struct s3c2410_dma_chan *channel,
+				void *dev_id, int size,
+				enum s3c2410_dma_buffresult result)
+{
+	struct snd_pcm_substream *substream = dev_id;
+	struct s3c_fast_runtime_data *prtd;
+	unsigned long flags;
+
+	if (result == S3C2410_RES_ABORT || result == S3C2410_RES_ERR)
+		return;
+
+	if (!substream || !substream->runtime)
+		return;
+
+	prtd = substream->runtime->private_data;
+	if (!(prtd->state & ST_RUNNING))
+		return;
+
+	s3c_fast_stats_period(ktime_get());
+
+	snd_pcm_period_elapsed(substream);
+
+	snd_pcm_stream_lock_irqsave(substream, flags);
+	if (snd_pcm_running(substream)) {
+		s3c_fast_silence(substream);
+	} else if (substream->runtime->status->state == SNDRV_PCM_STATE_XRUN) {
+		spin_lock(&s3c_fast_stats.lock);
+		s3c_fast_stats.xruns++;
+		spin_unlock(&s3c_fast_stats.lock);
+	}
+	snd_pcm_stream_unlock_irqrestore(substream, flags);
+}
+
+static int s3c_fast_hw_params(struct snd_pcm_substream *substream,
+	struct snd_pcm_hw_params *params)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd = runtime->private_data;
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct s3c_dma_params *dma =
+		snd_soc_dai_get_dma_data(rtd->dai->cpu_dai, substream);
+	int ret;
+
+	pr_debug("Entered %s\n", __func__);
+
+	if (!dma)
+		return -ENODEV;
+
+	if (prtd->params == NULL) {
+		prtd->params = dma;
+
+		ret = s3c2410_dma_request(prtd->params->channel,
+					  prtd->params->client, NULL);
+		if (ret < 0) {
+			printk(KERN_ERR "fast-pcm: failed to get dma channel\n");
+			prtd->params = NULL;
+			return ret;
+		}
+
+		s3c2410_dma_setflags(prtd->params->channel,
+				     S3C2410_DMAF_CIRCULAR);
+	}
+
+	s3c2410_dma_set_buffdone_fn(prtd->params->channel,
+				    s3c_fast_buffdone);
+
+	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+	runtime->dma_bytes = params_buffer_bytes(params);
+
+	spin_lock_irq(&prtd->lock);
+	prtd->dma_period = params_period_bytes(params);
+	prtd->dma_periods = params_periods(params);
+	prtd->dma_start = runtime->dma_addr;
+	spin_unlock_irq(&prtd->lock);
+
+	return 0;
+}
+
+static int s3c_fast_hw_free(struct snd_pcm_substream *substream)
+{
+	struct s3c_fast_runtime_data *prtd = substream->runtime->private_data;
+
+	pr_debug("Entered %s\n", __func__);
+
+	snd_pcm_set_runtime_buffer(substream, NULL);
+
+	if (prtd->params) {
+		s3c2410_dma_free(prtd->params->channel, prtd->params->client);
+		prtd->params = NULL;
+	}
+
+	return 0;
+}
+
+static int s3c_fast_prepare(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd = runtime->private_data;
+
+	pr_debug("Entered %s\n", __func__);
+
+	s3c2410_dma_devconfig(prtd->params->channel, S3C2410_DMASRC_MEM,
+			      prtd->params->dma_addr);
+	s3c2410_dma_config(prtd->params->channel, prtd->params->dma_size);
+	s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_FLUSH);
+
+	/* Start from silence so a late first write does not replay
+	 * whatever the last stream left in the buffer.
+	 */
+	memset(runtime->dma_area, 0, runtime->dma_bytes);
+	prtd->silence_end = 0;
+
+	return s3c2410_dma_enqueue_autoload(prtd->params->channel, substream,
+			prtd->dma_start, prtd->dma_period, prtd->dma_periods);
+}
+
+static int s3c_fast_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd = runtime->private_data;
+	int ret = 0;
+
+	pr_debug("Entered %s\n", __func__);
+
+	spin_lock(&prtd->lock);
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+		s3c_fast_stats_reset(div_u64((u64)runtime->period_size *
+					     NSEC_PER_SEC, runtime->rate));
+		/* fall through */
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		prtd->state |= ST_RUNNING;
+		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_START);
+		break;
+
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		prtd->state &= ~ST_RUNNING;
+		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_STOP);
+		break;
+
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	spin_unlock(&prtd->lock);
+
+	return ret;
+}
+
+static snd_pcm_uframes_t
+s3c_fast_pointer(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd = runtime->private_data;
+	dma_addr_t src, dst;
+	unsigned long res;
+
+	if (s3c2410_dma_getposition(prtd->params->channel, &src, &dst) < 0)
+		return 0;
+
+	res = src - prtd->dma_start;
+	if (res >= runtime->dma_bytes)
+		res = 0;
+
+	return bytes_to_frames(runtime, res);
+}
+
+static int s3c_fast_open(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct s3c_fast_runtime_data *prtd;
+
+	pr_debug("Entered %s\n", __func__);
+
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+		return -ENODEV;
+
+	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+	snd_soc_set_runtime_hwparams(substream, &s3c_fast_hardware);
+
+	prtd = kzalloc(sizeof(struct s3c_fast_runtime_data), GFP_KERNEL);
+	if (prtd == NULL)
+		return -ENOMEM;
+
+	spin_lock_init(&prtd->lock);
+
+	runtime->private_data = prtd;
+	return 0;
+}
+
+static int s3c_fast_close(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	pr_debug("Entered %s\n", __func__);
+
+	kfree(runtime->private_data);
+
+	return 0;
+}
+
+static int s3c_fast_mmap(struct snd_pcm_substream *substream,
+	struct vm_area_struct *vma)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	return dma_mmap_writecombine(substream->pcm->card->dev, vma,
+				     runtime->dma_area,
+				     runtime->dma_addr,
+				     runtime->dma_bytes);
+}
+
+static struct snd_pcm_ops s3c_fast_ops = {
+	.open		= s3c_fast_open,
+	.close		= s3c_fast_close,
+	.ioctl		= snd_pcm_lib_ioctl,
+	.hw_params	= s3c_fast_hw_params,
+	.hw_free	= s3c_fast_hw_free,
+	.prepare	= s3c_fast_prepare,
+	.trigger	= s3c_fast_trigger,
+	.pointer	= s3c_fast_pointer,
+	.mmap		= s3c_fast_mmap,
+};
+
+static void s3c_fast_proc_read(struct snd_info_entry *entry,
+			       struct snd_info_buffer *buffer)
+{
+	struct s3c_fast_stats st;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s3c_fast_stats.lock, flags);
+	st = s3c_fast_stats;
+	spin_unlock_irqrestore(&s3c_fast_stats.lock, flags);
+
+	snd_iprintf(buffer, "period_us:      %u\n", st.period_ns / 1000);
+	snd_iprintf(buffer, "periods:        %u\n", st.periods);
+	if (st.periods) {
+		snd_iprintf(buffer, "interval_min_us: %llu\n",
+			    div_u64(st.interval_min, 1000));
+		snd_iprintf(buffer, "interval_max_us: %llu\n",
+			    div_u64(st.interval_max, 1000));
+		snd_iprintf(buffer, "jitter_avg_us:  %llu\n",
+			    div_u64(div_u64(st.jitter_sum, st.periods), 1000));
+		snd_iprintf(buffer, "jitter_max_us:  %llu\n",
+			    div_u64(st.jitter_max, 1000));
+	}
+	snd_iprintf(buffer, "late_periods:   %u\n", st.late);
+	snd_iprintf(buffer, "xruns:          %u\n", st.xruns);
+}
+
+static void s3c_fast_pcm_free(struct snd_pcm *pcm)
+{
+	struct snd_pcm_substream *substream;
+	struct snd_dma_buffer *buf;
+
+	pr_debug("Entered %s\n", __func__);
+
+	substream = pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream;
+	if (!substream)
+		return;
+
+	buf = &substream->dma_buffer;
+	if (!buf->area)
+		return;
+
+	dma_free_writecombine(pcm->card->dev, buf->bytes,
+			      buf->area, buf->addr);
+	buf->area = NULL;
+}
+
+static u64 s3c_fast_mask = DMA_BIT_MASK(32);
+
+static int s3c_fast_pcm_new(struct snd_card *card,
+	struct snd_soc_dai *dai, struct snd_pcm *pcm)
+{
+	struct snd_pcm_substream *substream;
+	struct snd_dma_buffer *buf;
+	struct snd_info_entry *entry;
+
+	pr_debug("Entered %s\n", __func__);
+
+	if (!card->dev->dma_mask)
+		card->dev->dma_mask = &s3c_fast_mask;
+	if (!card->dev->coherent_dma_mask)
+		card->dev->coherent_dma_mask = DMA_BIT_MASK(32);
+
+	substream = pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream;
+	if (!substream)
+		return 0;
+
+	buf = &substream->dma_buffer;
+	buf->dev.type = SNDRV_DMA_TYPE_DEV;
+	buf->dev.dev = pcm->card->dev;
+	buf->private_data = NULL;
+	buf->area = dma_alloc_writecombine(pcm->card->dev, FAST_BUFFER_BYTES,
+					   &buf->addr, GFP_KERNEL);
+	if (!buf->area)
+		return -ENOMEM;
+	buf->bytes = FAST_BUFFER_BYTES;
+
+	if (!snd_card_proc_new(card, "fast-pcm", &entry))
+		snd_info_set_text_ops(entry, NULL, s3c_fast_proc_read);
+
+	return 0;
+}
+
+struct snd_soc_platform s3c_fast_soc_platform = {
+	.name		= "s5p-fast-audio",
+	.pcm_ops	= &s3c_fast_ops,
+	.pcm_new	= s3c_fast_pcm_new,
+	.pcm_free	= s3c_fast_pcm_free,
+};
+EXPORT_SYMBOL_GPL(s3c_fast_soc_platform);
@@ -14,17 +14,27 @@
 #include "s3c-dma.h"
 #include "s3c-idma.h"
 
-static int s3c_wrpdma_hw_params(struct snd_pcm_substream *substream,
-		struct snd_pcm_hw_params *params)
+/* Playback goes to the LP-audio iDMA, except on the low-latency device
+ * which always runs on the system DMA; capture always uses the system DMA.
+ */
+static struct snd_soc_platform *s3c_wrpdma_platform(
+		struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
+#ifdef CONFIG_SND_S5P_FAST_PCM
+	if (s3c_pcm_is_fast(substream))
+		return &s3c_fast_soc_platform;
+#endif
 #ifdef CONFIG_S5P_INTERNAL_DMA
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
+		return &idma_soc_platform;
 #endif
-		platform = &s3c24xx_soc_platform;
+	return &s3c24xx_soc_platform;
+}
+
+static int s3c_wrpdma_hw_params(struct snd_pcm_substream *substream,
+		struct snd_pcm_hw_params *params)
+{
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->hw_params)
 		return platform->pcm_ops->hw_params(substream, params);
@@ -34,14 +44,7 @@ static int s3c_wrpdma_hw_params(struct snd_pcm_substream *substream,
 
 static int s3c_wrpdma_hw_free(struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->hw_free)
 		return platform->pcm_ops->hw_free(substream);
@@ -51,14 +54,7 @@ static int s3c_wrpdma_hw_free(struct snd_pcm_substream *substream)
 
 static int s3c_wrpdma_prepare(struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->prepare)
 		return platform->pcm_ops->prepare(substream);
@@ -68,14 +64,7 @@ static int s3c_wrpdma_prepare(struct snd_pcm_substream *substream)
 
 static int s3c_wrpdma_trigger(struct snd_pcm_substream *substream, int cmd)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->trigger)
 		return platform->pcm_ops->trigger(substream, cmd);
@@ -85,14 +74,7 @@ static int s3c_wrpdma_trigger(struct snd_pcm_substream *substream, int cmd)
 
 static snd_pcm_uframes_t s3c_wrpdma_pointer(struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->pointer)
 		return platform->pcm_ops->pointer(substream);
@@ -102,14 +84,7 @@ static snd_pcm_uframes_t s3c_wrpdma_pointer(struct snd_pcm_substream *substream)
 
 static int s3c_wrpdma_open(struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->open)
 		return platform->pcm_ops->open(substream);
@@ -119,14 +94,7 @@ static int s3c_wrpdma_open(struct snd_pcm_substream *substream)
 
 static int s3c_wrpdma_close(struct snd_pcm_substream *substream)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->close)
 		return platform->pcm_ops->close(substream);
@@ -137,14 +105,7 @@ static int s3c_wrpdma_close(struct snd_pcm_substream *substream)
 static int s3c_wrpdma_ioctl(struct snd_pcm_substream *substream,
 		unsigned int cmd, void *arg)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->ioctl)
 		return platform->pcm_ops->ioctl(substream, cmd, arg);
@@ -155,14 +116,7 @@ static int s3c_wrpdma_ioctl(struct snd_pcm_substream *substream,
 static int s3c_wrpdma_mmap(struct snd_pcm_substream *substream,
 		struct vm_area_struct *vma)
 {
-	struct snd_soc_platform *platform;
-
-#ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		platform = &idma_soc_platform;
-	else
-#endif
-		platform = &s3c24xx_soc_platform;
+	struct snd_soc_platform *platform = s3c_wrpdma_platform(substream);
 
 	if (platform->pcm_ops->mmap)
 		return platform->pcm_ops->mmap(substream, vma);
@@ -189,6 +143,13 @@ static void s3c_wrpdma_pcm_free(struct snd_pcm *pcm)
 	struct snd_soc_platform *idma_platform;
 #endif
 
+#ifdef CONFIG_SND_S5P_FAST_PCM
+	if (pcm->device == S3C_FAST_PCM_DEVICE) {
+		s3c_fast_soc_platform.pcm_free(pcm);
+		return;
+	}
+#endif
+
 #ifdef CONFIG_S5P_INTERNAL_DMA
 	idma_platform = &idma_soc_platform;
 	if (idma_platform->pcm_free)
@@ -207,6 +168,12 @@ static int s3c_wrpdma_pcm_new(struct snd_card *card,
 	struct snd_soc_platform *idma_platform;
 #endif
 
+#ifdef CONFIG_SND_S5P_FAST_PCM
+	/* The low-latency device has its own small buffer */
+	if (pcm->device == S3C_FAST_PCM_DEVICE)
+		return s3c_fast_soc_platform.pcm_new(card, dai, pcm);
+#endif
+
 	/* sec_fifo i/f always use internal h/w buffers
 	 * irrespective of the xfer method (iDMA or SysDMA) */
 
@@ -24,10 +24,24 @@ struct s3c_dma_params {
 
 #define S3C24XX_DAI_I2S			0
 
+/* The low-latency playback device is the second dai_link of the card.
+ * It always runs on the I2S primary FIFO through the system DMA, so it
+ * can play alongside the LP-audio stream on the secondary FIFO.
+ */
+#define S3C_FAST_PCM_DEVICE		1
+
+#ifdef CONFIG_SND_S5P_FAST_PCM
+#define s3c_pcm_is_fast(substream)	\
+		((substream)->pcm->device == S3C_FAST_PCM_DEVICE)
+#else
+#define s3c_pcm_is_fast(substream)	0
+#endif
+
 //#define pr_debug(fmt...) printk(fmt) 
 /* platform data */
 extern struct snd_soc_platform s3c24xx_soc_platform;
 extern struct snd_soc_platform s3c24xx_pcm_soc_platform;
+extern struct snd_soc_platform s3c_fast_soc_platform;
 extern struct snd_ac97_bus_ops s3c24xx_ac97_ops;
 
 #endif
@@ -126,7 +126,8 @@ static int s5p_i2s_wr_hw_params(struct snd_pcm_substream *substream,
 		struct snd_soc_dai *dai)
 {
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+			!s3c_pcm_is_fast(substream))
 		s5p_i2s_hw_params(substream, params, dai);
 	else
 		s3c2412_i2s_hw_params(substream, params, dai);
@@ -139,7 +140,8 @@ static int s5p_i2s_wr_trigger(struct snd_pcm_substream *substream,
 		int cmd, struct snd_soc_dai *dai)
 {
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+			!s3c_pcm_is_fast(substream))
 		s5p_i2s_trigger(substream, cmd, dai);
 	else
 		s3c2412_i2s_trigger(substream, cmd, dai);
@@ -518,12 +520,13 @@ static int s5p_i2s_wr_startup(struct snd_pcm_substream *substream,
 	s5p_i2s_do_resume(dai);
 
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		tx_clk_enabled = 1;
+		tx_clk_enabled++;
 	else
-		rx_clk_enabled = 1;
+		rx_clk_enabled++;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+			!s3c_pcm_is_fast(substream))
 		s5p_i2s_startup(dai);
 #endif
 
@@ -535,10 +538,11 @@ static void s5p_i2s_wr_shutdown(struct snd_pcm_substream *substream,
 {
 	pr_debug("iis: %s:\n", __func__);
 
+	/* Both the LP-audio and the low-latency device may be playing */
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		tx_clk_enabled = 0;
+		tx_clk_enabled--;
 	else
-		rx_clk_enabled = 0;
+		rx_clk_enabled--;
 
 	/* Tx/Rx both off? */
 	if (!tx_clk_enabled && !rx_clk_enabled)
@@ -283,25 +283,119 @@ int smdkc110_hw_params(struct snd_pcm_substream *substream,
 
 }
 
+/*
+ * Every stream on the card, LP-audio, low-latency playback and capture,
+ * runs over the same I2S and codec AIF, and hw_params re-clocks both.
+ * Once one stream is configured the others are held to its rate and
+ * format so that opening a second device cannot re-clock the first.
+ */
+static DEFINE_MUTEX(smdkc110_aif_lock);
+static unsigned long smdkc110_aif_users;	/* Configured streams */
+static unsigned int smdkc110_aif_rate;
+static snd_pcm_format_t smdkc110_aif_format;
+
+/* One bit per PCM device and direction */
+static unsigned long smdkc110_aif_bit(struct snd_pcm_substream *substream)
+{
+	return 1UL << (substream->pcm->device * 2 + substream->stream);
+}
+
+static int smdkc110_startup(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	int ret = 0;
+
+	mutex_lock(&smdkc110_aif_lock);
+	if (smdkc110_aif_users & ~smdkc110_aif_bit(substream)) {
+		ret = snd_pcm_hw_constraint_minmax(runtime,
+				SNDRV_PCM_HW_PARAM_RATE,
+				smdkc110_aif_rate, smdkc110_aif_rate);
+		if (ret >= 0)
+			ret = snd_pcm_hw_constraint_mask64(runtime,
+				SNDRV_PCM_HW_PARAM_FORMAT,
+				1ULL << (__force int)smdkc110_aif_format);
+	}
+	mutex_unlock(&smdkc110_aif_lock);
+
+	return ret < 0 ? ret : 0;
+}
+
+static int smdkc110_aif_hw_params(struct snd_pcm_substream *substream,
+	struct snd_pcm_hw_params *params)
+{
+	unsigned long bit = smdkc110_aif_bit(substream);
+	int ret;
+
+	mutex_lock(&smdkc110_aif_lock);
+	if (smdkc110_aif_users & ~bit) {
+		/* Startup constrained us, unless the other stream was
+		 * configured after this one was opened.
+		 */
+		if (params_rate(params) != smdkc110_aif_rate ||
+				params_format(params) != smdkc110_aif_format) {
+			printk(KERN_ERR "smdkc110: AIF busy at %uHz\n",
+					smdkc110_aif_rate);
+			ret = -EBUSY;
+			goto out;
+		}
+	}
+
+	ret = smdkc110_hw_params(substream, params);
+	if (ret < 0) {
+		smdkc110_aif_users &= ~bit;
+		goto out;
+	}
+
+	smdkc110_aif_rate = params_rate(params);
+	smdkc110_aif_format = params_format(params);
+	smdkc110_aif_users |= bit;
+out:
+	mutex_unlock(&smdkc110_aif_lock);
+	return ret;
+}
+
+static int smdkc110_hw_free(struct snd_pcm_substream *substream)
+{
+	mutex_lock(&smdkc110_aif_lock);
+	smdkc110_aif_users &= ~smdkc110_aif_bit(substream);
+	mutex_unlock(&smdkc110_aif_lock);
+
+	return 0;
+}
+
 /* machine stream operations */
 static struct snd_soc_ops smdkc110_ops = {
-	.hw_params = smdkc110_hw_params,
+	.startup = smdkc110_startup,
+	.hw_params = smdkc110_aif_hw_params,
+	.hw_free = smdkc110_hw_free,
 };
 
 /* digital audio interface glue - connects codec <--> CPU */
-static struct snd_soc_dai_link smdkc1xx_dai = {
-	.name = "WM8994",
-	.stream_name = "WM8994 HiFi Playback",
-	.cpu_dai = &s3c64xx_i2s_dai[I2S_NUM],
-	.codec_dai = &wm8994_dai,
-	.ops = &smdkc110_ops,
+static struct snd_soc_dai_link smdkc1xx_dai[] = {
+	{
+		.name = "WM8994",
+		.stream_name = "WM8994 HiFi Playback",
+		.cpu_dai = &s3c64xx_i2s_dai[I2S_NUM],
+		.codec_dai = &wm8994_dai,
+		.ops = &smdkc110_ops,
+	},
+#ifdef CONFIG_SND_S5P_FAST_PCM
+	/* Must stay at index S3C_FAST_PCM_DEVICE */
+	{
+		.name = "WM8994 Fast",
+		.stream_name = "WM8994 Low Latency Playback",
+		.cpu_dai = &s3c64xx_i2s_dai[I2S_NUM],
+		.codec_dai = &wm8994_dai,
+		.ops = &smdkc110_ops,
+	},
+#endif
 };
 
 static struct snd_soc_card smdkc100 = {
 	.name = "smdkc110",
 	.platform = &s3c_dma_wrapper,
-	.dai_link = &smdkc1xx_dai,
-	.num_links = 1,
+	.dai_link = smdkc1xx_dai,
+	.num_links = ARRAY_SIZE(smdkc1xx_dai),
 };
 
 static struct wm8994_setup_data smdkc110_wm8994_setup = {
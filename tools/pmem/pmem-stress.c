@@ -0,0 +1,209 @@
+/*
+ * pmem-stress.c -- allocate/free stress test for an Android pmem region
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* $(CROSS_COMPILE)cc -Wall -Wextra -O2 -o pmem-stress pmem-stress.c */
+
+/*
+ * Keeps up to a given number of allocations live in one pmem region,
+ * each on its own file descriptor: PMEM_ALLOCATE makes an allocation and
+ * close() frees it again.  Sizes are random, mostly small with the odd
+ * large one, like camera and video buffers.  Every allocation is checked
+ * against all the live ones for overlap, and the time per operation is
+ * printed together with the allocator statistics from debugfs:
+ *
+ *	mount -t debugfs none /sys/kernel/debug
+ *	pmem-stress -n 200000 /dev/pmem_gpu1
+ *
+ * Run it while nothing else uses the region, or failures and overlap
+ * checks only cover this program's share of it.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <linux/ioctl.h>
+
+/* From include/linux/android_pmem.h */
+#define PMEM_IOCTL_MAGIC	'p'
+#define PMEM_GET_SIZE		_IOW(PMEM_IOCTL_MAGIC, 3, unsigned int)
+#define PMEM_ALLOCATE		_IOW(PMEM_IOCTL_MAGIC, 5, unsigned int)
+#define PMEM_GET_TOTAL_SIZE	_IOW(PMEM_IOCTL_MAGIC, 7, unsigned int)
+
+struct pmem_region {
+	unsigned long offset;
+	unsigned long len;
+};
+
+struct alloc {
+	int fd;
+	unsigned long start, len;
+};
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Mostly up to 64KiB, sometimes up to 1MiB, rarely up to an eighth */
+static unsigned long pick_size(unsigned long total)
+{
+	int r = rand() % 100;
+
+	if (r < 80)
+		return 4096 + rand() % (64 << 10);
+	if (r < 98)
+		return 4096 + rand() % (1 << 20);
+	return 4096 + rand() % (total / 8);
+}
+
+static int overlaps(const struct alloc *live, int n, const struct alloc *a)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (a->start < live[i].start + live[i].len &&
+		    live[i].start < a->start + a->len)
+			return 1;
+	return 0;
+}
+
+/* Prints the allocator part of the debugfs node for the device */
+static void print_stats(const char *dev)
+{
+	const char *name = strrchr(dev, '/');
+	char path[256], line[256];
+	FILE *f;
+
+	snprintf(path, sizeof path, "/sys/kernel/debug/%s",
+		 name ? name + 1 : dev);
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return;
+	}
+	while (fgets(line, sizeof line, f) && strncmp(line, "pid #:", 6))
+		fputs(line, stdout);
+	fclose(f);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n ops] [-l live] [-s seed] device\n"
+		"  -n  number of allocations and frees, default 100000\n"
+		"  -l  most allocations live at once, default 64\n"
+		"  -s  random seed\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long n_ops = 100000, n_alloc = 0, n_free = 0, n_fail = 0;
+	struct pmem_region region;
+	struct alloc *live;
+	int max_live = 64, n_live = 0, opt, fd;
+	unsigned long i, total;
+	double t;
+
+	while ((opt = getopt(argc, argv, "n:l:s:")) != -1) {
+		switch (opt) {
+		case 'n':
+			n_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			max_live = atoi(optarg);
+			break;
+		case 's':
+			srand(strtoul(optarg, NULL, 0));
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || max_live < 1)
+		usage(argv[0]);
+
+	fd = open(argv[optind], O_RDWR);
+	if (fd < 0 || ioctl(fd, PMEM_GET_TOTAL_SIZE, &region) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	total = region.len;
+	close(fd);
+	if (total < (64 << 10)) {
+		fprintf(stderr, "%s: region too small\n", argv[optind]);
+		return 1;
+	}
+
+	live = calloc(max_live, sizeof *live);
+	if (!live) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	t = now();
+	for (i = 0; i < n_ops; i++) {
+		struct alloc *a;
+
+		if (n_live && (n_live == max_live || rand() % 2)) {
+			int k = rand() % n_live;
+
+			close(live[k].fd);
+			live[k] = live[--n_live];
+			n_free++;
+			continue;
+		}
+
+		a = &live[n_live];
+		a->fd = open(argv[optind], O_RDWR);
+		if (a->fd < 0) {
+			perror(argv[optind]);
+			return 1;
+		}
+		n_alloc++;
+		/*
+		 * A failed PMEM_ALLOCATE leaves the file without a region.
+		 * PMEM_GET_SIZE also returns the physical start, without the
+		 * printk PMEM_GET_PHYS does.
+		 */
+		if (ioctl(a->fd, PMEM_ALLOCATE, pick_size(total)) < 0 ||
+		    ioctl(a->fd, PMEM_GET_SIZE, &region) < 0 || !region.len) {
+			close(a->fd);
+			n_fail++;
+			continue;
+		}
+		a->start = region.offset;
+		a->len = region.len;
+		if (overlaps(live, n_live, a)) {
+			fprintf(stderr, "allocation %#lx+%#lx overlaps a live "
+				"one\n", a->start, a->len);
+			return 1;
+		}
+		n_live++;
+	}
+	t = now() - t;
+
+	printf("%lu allocs (%lu failed), %lu frees in %.3f s: "
+	       "%.1f us per operation\n", n_alloc, n_fail, n_free, t,
+	       t * 1e6 / (n_alloc + n_free));
+	print_stats(argv[optind]);
+
+	while (n_live)
+		close(live[--n_live].fd);
+	free(live);
+	return 0;
+}
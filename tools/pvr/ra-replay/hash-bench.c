@@ -0,0 +1,242 @@
+/*
+ * hash-bench.c -- time HASH_Insert, HASH_Retrieve and HASH_Remove in user space
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Builds the driver's hash.c against the same shim as ra-replay and times
+ * each operation on tables of 1K, 10K and 100K entries (or the sizes given
+ * with -n).  Every table starts at the initial size the driver uses, so
+ * the timed inserts include its growth, and the timed removes its shrink.
+ *
+ * Two kinds of table are measured:
+ *
+ *   word	single-word keys with the default hash and compare, as used for
+ *		RA segments, BM buffers and per-process data;
+ *   handle	three-word keys through HASH_*_Extended, as handle.c uses.
+ *
+ * Keys are page-aligned addresses in a random order, which is what the
+ * driver mostly hashes.  Lookups are done once for keys that are present
+ * and once for keys that are not.  The best of -r runs is reported.
+ *
+ *	make hash-bench && ./hash-bench
+ *
+ * To compare against an older table, build again with PVR pointing at a
+ * checkout of that driver.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash.h"
+
+#define INITIAL_LEN	32
+#define HANDLE_WORDS	3
+
+enum { OP_INSERT, OP_HIT, OP_MISS, OP_REMOVE, N_OPS };
+
+static const char *const op_names[N_OPS] = {
+	"insert", "hit", "miss", "remove"
+};
+
+static IMG_UINTPTR_T *keys;
+
+static unsigned int rnd(void)
+{
+	static unsigned int x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* 2n distinct page addresses, shuffled: the first n go in, the rest miss */
+static void make_keys(unsigned long n)
+{
+	unsigned long i, j;
+	IMG_UINTPTR_T t;
+
+	keys = realloc(keys, 2 * n * sizeof *keys);
+	if (!keys) {
+		perror("realloc");
+		exit(1);
+	}
+	for (i = 0; i < 2 * n; i++)
+		keys[i] = 0x10000000 + (IMG_UINTPTR_T) i * 0x1000;
+	for (i = 2 * n - 1; i > 0; i--) {
+		j = rnd() % (i + 1);
+		t = keys[i];
+		keys[i] = keys[j];
+		keys[j] = t;
+	}
+}
+
+static void handle_key(IMG_UINTPTR_T *aKey, IMG_UINTPTR_T k)
+{
+	/* data, type and parent, as in handle.c's InitKey() */
+	aKey[0] = k;
+	aKey[1] = 1 + (k >> 12) % 8;
+	aKey[2] = 0;
+}
+
+static int run_word(unsigned long n, double *t)
+{
+	HASH_TABLE *pHash = HASH_Create(INITIAL_LEN);
+	unsigned long i, found = 0;
+	double start;
+
+	if (!pHash)
+		return -1;
+
+	start = now();
+	for (i = 0; i < n; i++)
+		if (!HASH_Insert(pHash, keys[i], keys[i]))
+			return -1;
+	t[OP_INSERT] = now() - start;
+
+	start = now();
+	for (i = 0; i < n; i++)
+		found += HASH_Retrieve(pHash, keys[i]) == keys[i];
+	t[OP_HIT] = now() - start;
+
+	start = now();
+	for (i = n; i < 2 * n; i++)
+		found += HASH_Retrieve(pHash, keys[i]) != 0;
+	t[OP_MISS] = now() - start;
+
+	start = now();
+	for (i = 0; i < n; i++)
+		found += HASH_Remove(pHash, keys[i]) == keys[i];
+	t[OP_REMOVE] = now() - start;
+
+	HASH_Delete(pHash);
+	return found == 2 * n ? 0 : -1;
+}
+
+static int run_handle(unsigned long n, double *t)
+{
+	HASH_TABLE *pHash;
+	IMG_UINTPTR_T aKey[HANDLE_WORDS];
+	unsigned long i, found = 0;
+	double start;
+
+	pHash = HASH_Create_Extended(INITIAL_LEN, sizeof aKey,
+				     HASH_Func_Default, HASH_Key_Comp_Default);
+	if (!pHash)
+		return -1;
+
+	start = now();
+	for (i = 0; i < n; i++) {
+		handle_key(aKey, keys[i]);
+		if (!HASH_Insert_Extended(pHash, aKey, keys[i]))
+			return -1;
+	}
+	t[OP_INSERT] = now() - start;
+
+	start = now();
+	for (i = 0; i < n; i++) {
+		handle_key(aKey, keys[i]);
+		found += HASH_Retrieve_Extended(pHash, aKey) == keys[i];
+	}
+	t[OP_HIT] = now() - start;
+
+	start = now();
+	for (i = n; i < 2 * n; i++) {
+		handle_key(aKey, keys[i]);
+		found += HASH_Retrieve_Extended(pHash, aKey) != 0;
+	}
+	t[OP_MISS] = now() - start;
+
+	start = now();
+	for (i = 0; i < n; i++) {
+		handle_key(aKey, keys[i]);
+		found += HASH_Remove_Extended(pHash, aKey) == keys[i];
+	}
+	t[OP_REMOVE] = now() - start;
+
+	HASH_Delete(pHash);
+	return found == 2 * n ? 0 : -1;
+}
+
+static int bench(const char *name, int (*run)(unsigned long, double *),
+		 unsigned long n, int runs)
+{
+	double best[N_OPS], t[N_OPS];
+	int i, op;
+
+	for (i = 0; i < runs; i++) {
+		if (run(n, t)) {
+			fprintf(stderr, "%s table of %lu entries: wrong result\n",
+				name, n);
+			return -1;
+		}
+		for (op = 0; op < N_OPS; op++)
+			if (!i || t[op] < best[op])
+				best[op] = t[op];
+	}
+
+	printf("%-6s %7lu", name, n);
+	for (op = 0; op < N_OPS; op++)
+		printf("  %6s %6.1f", op_names[op], best[op] * 1e9 / n);
+	printf("  ns/op\n");
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-r runs] [-n entries]...\n"
+		"  -r  repeat each table this many times, default 5\n"
+		"  -n  table size, default 1000, 10000 and 100000\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	static unsigned long sizes[16] = { 1000, 10000, 100000 };
+	int n_sizes = 0, runs = 5, opt, i, err = 0;
+
+	while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			if (n_sizes == 16)
+				usage(argv[0]);
+			sizes[n_sizes] = strtoul(optarg, NULL, 0);
+			if (!sizes[n_sizes++])
+				usage(argv[0]);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || runs < 1)
+		usage(argv[0]);
+	if (!n_sizes)
+		n_sizes = 3;
+
+	for (i = 0; i < n_sizes && !err; i++) {
+		make_keys(sizes[i]);
+		err = bench("word", run_word, sizes[i], runs) ||
+		      bench("handle", run_handle, sizes[i], runs);
+	}
+	free(keys);
+	return err;
+}
@@ -0,0 +1,503 @@
+/*
+ * ra-replay.c -- replay resource arena traces against ra.c in user space
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Reads the RA_Create, RA_Add, RA_Alloc, RA_Free and RA_Delete messages a
+ * DEBUG services driver prints at PVR_DBG_MESSAGE level, as captured from
+ * the kernel log, and replays them against the ra.c and hash.c this tool
+ * is built from.  The trace is parsed up front, so only the time spent in
+ * the arena is measured.  The statistics RA_GetStats() reports for each
+ * arena are printed once the trace has been replayed.
+ *
+ * The log does not give the quantum of an arena (-q, default 0x1000), and
+ * arenas created with an import callback get spans from a simple bump
+ * allocator.  Allocation bases are mapped from the trace to the replay, so
+ * a different allocator may place segments anywhere it likes.
+ *
+ * With -g, a synthetic trace in the same format is written to stdout
+ * instead: a 1GiB arena with a few thousand live allocations, mostly of a
+ * few pages, with some larger ones and some 64KiB aligned ones.
+ *
+ *	make && ./ra-replay -g 1000000 > trace && ./ra-replay trace
+ *
+ * To compare against an older arena, build again with PVR pointing at a
+ * checkout of that driver.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ra.h"
+
+#define MAX_ARENAS	64
+#define NAME_LEN	64
+#define MAP_BITS	16
+
+enum op_type { OP_CREATE, OP_ADD, OP_ALLOC, OP_FREE, OP_DELETE };
+
+struct op {
+	unsigned char type;
+	unsigned char arena;
+	unsigned int slot;
+	IMG_UINT32 base;
+	IMG_UINT32 size;
+	IMG_UINT32 align;
+	IMG_UINT32 offset;
+};
+
+struct arena {
+	char name[NAME_LEN];
+	int import;
+	RA_ARENA *ra;
+	/* Pending RA_Alloc request, until its result line is seen */
+	int pending;
+	IMG_UINT32 size, align, offset;
+};
+
+struct base_map {
+	struct base_map *next;
+	int arena;
+	IMG_UINT32 base;
+	unsigned int slot;
+};
+
+static struct arena arenas[MAX_ARENAS];
+static int n_arenas;
+
+static struct op *ops;
+static size_t n_ops, max_ops;
+
+static struct base_map *base_map[1 << MAP_BITS];
+static unsigned int *free_slots;
+static unsigned int n_free_slots, n_slots, max_slots;
+
+/* Replayed base of each live allocation, or NO_BASE */
+static IMG_UINTPTR_T *slot_base;
+#define NO_BASE		((IMG_UINTPTR_T) ~0u)
+static IMG_UINT32 quantum = 0x1000;
+static IMG_UINTPTR_T import_next = 0x40000000;
+
+static void *xrealloc(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (!p) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+static struct op *new_op(int type, int arena)
+{
+	struct op *op;
+
+	if (n_ops == max_ops) {
+		max_ops = max_ops ? max_ops * 2 : 4096;
+		ops = xrealloc(ops, max_ops * sizeof *ops);
+	}
+	op = &ops[n_ops++];
+	memset(op, 0, sizeof *op);
+	op->type = type;
+	op->arena = arena;
+	return op;
+}
+
+static int find_arena(const char *name, int create)
+{
+	int i;
+
+	for (i = 0; i < n_arenas; i++)
+		if (!strcmp(arenas[i].name, name))
+			return i;
+	if (!create || n_arenas == MAX_ARENAS)
+		return -1;
+	snprintf(arenas[n_arenas].name, NAME_LEN, "%s", name);
+	return n_arenas++;
+}
+
+static unsigned int map_hash(int arena, IMG_UINT32 base)
+{
+	return ((base >> 12) * 2654435761u + arena) >> (32 - MAP_BITS);
+}
+
+static unsigned int map_add(int arena, IMG_UINT32 base)
+{
+	struct base_map *m = xrealloc(NULL, sizeof *m);
+	unsigned int h = map_hash(arena, base);
+
+	if (n_free_slots) {
+		m->slot = free_slots[--n_free_slots];
+	} else {
+		if (n_slots == max_slots) {
+			max_slots = max_slots ? max_slots * 2 : 4096;
+			free_slots = xrealloc(free_slots,
+					      max_slots * sizeof *free_slots);
+		}
+		m->slot = n_slots++;
+	}
+	m->arena = arena;
+	m->base = base;
+	m->next = base_map[h];
+	base_map[h] = m;
+	return m->slot;
+}
+
+static int map_remove(int arena, IMG_UINT32 base, unsigned int *slot)
+{
+	struct base_map **pp, *m;
+
+	for (pp = &base_map[map_hash(arena, base)]; (m = *pp);
+	     pp = &m->next) {
+		if (m->arena == arena && m->base == base) {
+			*pp = m->next;
+			*slot = m->slot;
+			free_slots[n_free_slots++] = m->slot;
+			free(m);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* Copies the quoted arena name following key in line, or returns NULL */
+static const char *get_name(const char *line, const char *key, char *name)
+{
+	const char *p = strstr(line, key), *end;
+
+	if (!p)
+		return NULL;
+	p += strlen(key);
+	end = strchr(p, '\'');
+	if (!end || end - p >= NAME_LEN)
+		return NULL;
+	memcpy(name, p, end - p);
+	name[end - p] = '\0';
+	return end + 1;
+}
+
+static void parse(FILE *f)
+{
+	unsigned int base, size, align, offset, dummy, imp, slot;
+	char line[512], name[NAME_LEN];
+	unsigned long unmatched = 0;
+	const char *p;
+	struct op *op;
+	int a, ok;
+
+	while (fgets(line, sizeof line, f)) {
+		if ((p = get_name(line, "RA_Create: name='", name))) {
+			if (sscanf(p, ", base=0x%x, uSize=0x%x, alloc=0x%x",
+				   &base, &size, &imp) != 3 ||
+			    (a = find_arena(name, 1)) < 0)
+				continue;
+			arenas[a].import = imp != 0;
+			op = new_op(OP_CREATE, a);
+			op->base = base;
+			op->size = size;
+		} else if ((p = get_name(line, "RA_Add: name='", name))) {
+			if (sscanf(p, ", base=0x%x, size=0x%x",
+				   &base, &size) != 2 ||
+			    (a = find_arena(name, 0)) < 0)
+				continue;
+			op = new_op(OP_ADD, a);
+			op->base = base;
+			op->size = size;
+		} else if ((p = get_name(line, "RA_Alloc: arena='", name))) {
+			if (sscanf(p, ", size=0x%x(0x%x), alignment=0x%x, "
+				   "offset=0x%x", &size, &dummy, &align,
+				   &offset) != 4 ||
+			    (a = find_arena(name, 0)) < 0)
+				continue;
+			arenas[a].pending = 1;
+			arenas[a].size = size;
+			arenas[a].align = align;
+			arenas[a].offset = offset;
+		} else if ((p = get_name(line, "RA_Alloc: name='", name))) {
+			if (sscanf(p, ", size=0x%x, *base=0x%x = %d",
+				   &size, &base, &ok) != 3 ||
+			    (a = find_arena(name, 0)) < 0 ||
+			    !arenas[a].pending)
+				continue;
+			arenas[a].pending = 0;
+			op = new_op(OP_ALLOC, a);
+			op->size = arenas[a].size;
+			op->align = arenas[a].align;
+			op->offset = arenas[a].offset;
+			op->slot = ok ? map_add(a, base) : ~0u;
+		} else if ((p = get_name(line, "RA_Free: name='", name))) {
+			if (sscanf(p, ", base=0x%x", &base) != 1 ||
+			    (a = find_arena(name, 0)) < 0)
+				continue;
+			if (map_remove(a, base, &slot)) {
+				unmatched++;
+				continue;
+			}
+			op = new_op(OP_FREE, a);
+			op->slot = slot;
+		} else if (get_name(line, "RA_Delete: name='", name)) {
+			if ((a = find_arena(name, 0)) < 0)
+				continue;
+			new_op(OP_DELETE, a);
+		}
+	}
+
+	if (unmatched)
+		fprintf(stderr, "%lu frees of unknown bases skipped\n",
+			unmatched);
+}
+
+static IMG_BOOL import_alloc(IMG_VOID *handle, IMG_SIZE_T uSize,
+			     IMG_SIZE_T *pActualSize, BM_MAPPING **ppsMapping,
+			     IMG_UINT32 flags, IMG_UINTPTR_T *pBase)
+{
+	(void) handle;
+	(void) flags;
+
+	uSize = (uSize + 0xfffff) & ~0xfffff;
+	if (import_next + uSize < import_next)
+		return IMG_FALSE;
+	*pBase = import_next;
+	import_next += uSize;
+	*pActualSize = uSize;
+	*ppsMapping = IMG_NULL;
+	return IMG_TRUE;
+}
+
+static IMG_VOID import_free(IMG_VOID *handle, IMG_UINTPTR_T base,
+			    BM_MAPPING *psMapping)
+{
+	(void) handle;
+	(void) base;
+	(void) psMapping;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_stats(RA_ARENA *ra)
+{
+	static char buf[4096];
+	IMG_CHAR *p = buf;
+	IMG_UINT32 len = sizeof buf;
+
+	/*
+	 * The counters come first, then every segment until the buffer is
+	 * full, at which point RA_GetStats() gives up.  Only the counters
+	 * are of interest.
+	 */
+	buf[0] = '\0';
+	RA_GetStats(ra, &p, &len);
+	if ((p = strstr(buf, "  segment Chain:")))
+		*p = '\0';
+	fputs(buf, stdout);
+}
+
+/* With stats set, arenas print their statistics before being deleted */
+static double replay(int stats, unsigned long *n_alloc,
+		     unsigned long *n_failed, unsigned long *n_free)
+{
+	double t;
+	size_t i;
+
+	*n_alloc = *n_failed = *n_free = 0;
+	import_next = 0x40000000;
+
+	t = now();
+	for (i = 0; i < n_ops; i++) {
+		struct op *op = &ops[i];
+		struct arena *a = &arenas[op->arena];
+		IMG_UINTPTR_T base;
+
+		switch (op->type) {
+		case OP_CREATE:
+			if (a->ra)
+				RA_Delete(a->ra);
+			a->ra = RA_Create(a->name, op->base, op->size,
+					  IMG_NULL, quantum,
+					  a->import ? import_alloc : IMG_NULL,
+					  a->import ? import_free : IMG_NULL,
+					  IMG_NULL, IMG_NULL);
+			if (!a->ra) {
+				fprintf(stderr, "RA_Create %s failed\n",
+					a->name);
+				exit(1);
+			}
+			break;
+		case OP_ADD:
+			if (a->ra)
+				RA_Add(a->ra, op->base, op->size);
+			break;
+		case OP_ALLOC:
+			if (!a->ra)
+				break;
+			(*n_alloc)++;
+			if (!RA_Alloc(a->ra, op->size, IMG_NULL, IMG_NULL, 0,
+				      op->align, op->offset, &base)) {
+				(*n_failed)++;
+				base = NO_BASE;
+			}
+			if (op->slot != ~0u)
+				slot_base[op->slot] = base;
+			break;
+		case OP_FREE:
+			/* Only free what the replay managed to allocate */
+			if (!a->ra || slot_base[op->slot] == NO_BASE)
+				break;
+			(*n_free)++;
+			RA_Free(a->ra, slot_base[op->slot], IMG_FALSE);
+			slot_base[op->slot] = NO_BASE;
+			break;
+		case OP_DELETE:
+			if (!a->ra)
+				break;
+			if (stats)
+				print_stats(a->ra);
+			RA_Delete(a->ra);
+			a->ra = IMG_NULL;
+			break;
+		}
+	}
+	return now() - t;
+}
+
+static void cleanup(int stats)
+{
+	int i;
+
+	for (i = 0; i < n_arenas; i++) {
+		if (!arenas[i].ra)
+			continue;
+		if (stats)
+			print_stats(arenas[i].ra);
+		RA_Delete(arenas[i].ra);
+		arenas[i].ra = IMG_NULL;
+	}
+	memset(slot_base, 0xff, (n_slots + 1) * sizeof *slot_base);
+}
+
+static unsigned int rnd(void)
+{
+	static unsigned int x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void generate(unsigned long n)
+{
+	const unsigned int target = 4000;
+	unsigned int *live = xrealloc(NULL, target * sizeof *live);
+	unsigned int n_live = 0, next_base = 0x1000, size, align;
+	unsigned long i;
+
+	printf("RA_Create: name='synth', base=0x10000000, uSize=0x40000000, "
+	       "alloc=0x0, free=0x0\n");
+	for (i = 0; i < n; i++) {
+		if (n_live && (n_live == target || rnd() % 100 >= 55)) {
+			unsigned int k = rnd() % n_live;
+
+			printf("RA_Free: name='synth', base=0x%x\n", live[k]);
+			live[k] = live[--n_live];
+			continue;
+		}
+
+		if (rnd() % 100 < 85)
+			size = (rnd() % 4 + 1) * 0x1000;
+		else if (rnd() % 100 < 87)
+			size = (rnd() % 60 + 5) * 0x1000;
+		else
+			size = (rnd() % 1984 + 65) * 0x1000;
+		align = rnd() % 100 < 20 ? 0x10000 : 0x1000;
+
+		/* The base only has to tell live allocations apart */
+		live[n_live++] = next_base;
+		printf("RA_Alloc: arena='synth', size=0x%x(0x%x), "
+		       "alignment=0x%x, offset=0x0\n", size, size, align);
+		printf("RA_Alloc: name='synth', size=0x%x, *base=0x%x = 1\n",
+		       size, next_base);
+		next_base += 0x1000;
+	}
+	printf("RA_Delete: name='synth'\n");
+	free(live);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-q quantum] [-r runs] [trace]\n"
+		"       %s -g ops\n"
+		"  -q  arena quantum, default 0x1000\n"
+		"  -r  replay the trace this many times, default 5\n"
+		"  -g  write a synthetic trace of this many operations\n",
+		name, name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long n_alloc, n_failed, n_free;
+	double t, best = 0;
+	int runs = 5, opt, i;
+	FILE *f = stdin;
+
+	while ((opt = getopt(argc, argv, "g:q:r:")) != -1) {
+		switch (opt) {
+		case 'g':
+			generate(strtoul(optarg, NULL, 0));
+			return 0;
+		case 'q':
+			quantum = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind > 1 || !quantum || runs < 1)
+		usage(argv[0]);
+	if (optind < argc && !(f = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	parse(f);
+	if (!n_ops) {
+		fprintf(stderr, "no arena operations in the trace\n");
+		return 1;
+	}
+	slot_base = xrealloc(NULL, (n_slots + 1) * sizeof *slot_base);
+
+	for (i = 0; i < runs; i++) {
+		cleanup(0);
+		t = replay(0, &n_alloc, &n_failed, &n_free);
+		if (!i || t < best)
+			best = t;
+	}
+	printf("%lu allocs (%lu failed), %lu frees in %.3f s: "
+	       "%.1f ns per operation\n", n_alloc, n_failed, n_free, best,
+	       best * 1e9 / (n_alloc + n_free));
+
+	/* Once more, untimed, for the statistics of every arena */
+	cleanup(0);
+	replay(1, &n_alloc, &n_failed, &n_free);
+	cleanup(1);
+	return 0;
+}
@@ -0,0 +1,2 @@
+/* For lib/rbtree.c; see pvr-shim.h */
+#define EXPORT_SYMBOL(sym)
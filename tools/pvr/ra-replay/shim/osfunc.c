@@ -0,0 +1,92 @@
+/*
+ * osfunc.c -- OSAllocMem/OSFreeMem for ra-replay
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The arena stores boundary tag pointers as 32-bit hash values, so on a
+ * 64-bit host the memory handed out here comes from a MAP_32BIT pool.
+ * Blocks are rounded to a power of two and recycled through one free list
+ * per size, which is close to what kmalloc does for the driver.
+ */
+
+#define _GNU_SOURCE /* for MAP_32BIT */
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "pvr-shim.h"
+
+#ifndef MAP_32BIT
+#define MAP_32BIT 0
+#endif
+
+#define POOL_SIZE	(512UL << 20)
+#define MIN_SHIFT	5
+#define MAX_SHIFT	30
+#define HDR_SIZE	16
+
+static char *pool, *pool_end;
+static void *free_list[MAX_SHIFT + 1];
+
+static int size_shift(size_t size)
+{
+	int shift = MIN_SHIFT;
+
+	while (shift < MAX_SHIFT && ((size_t) 1 << shift) < size)
+		shift++;
+	return shift;
+}
+
+PVRSRV_ERROR OSAllocMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+			IMG_PVOID *ppvLinAddr, IMG_HANDLE *phBlockAlloc,
+			IMG_CHAR *pszLog)
+{
+	int shift = size_shift(uSize + HDR_SIZE);
+	char *p;
+
+	(void) ui32Flags;
+	(void) pszLog;
+
+	if (!pool) {
+		p = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+			 MAP_32BIT, -1, 0);
+		if (p == MAP_FAILED)
+			return PVRSRV_ERROR_OUT_OF_MEMORY;
+		pool = p;
+		pool_end = p + POOL_SIZE;
+	}
+
+	if (free_list[shift]) {
+		p = free_list[shift];
+		free_list[shift] = *(void **) (p + HDR_SIZE);
+	} else {
+		if (pool_end - pool < (1L << shift))
+			return PVRSRV_ERROR_OUT_OF_MEMORY;
+		p = pool;
+		pool += 1L << shift;
+		*(int *) p = shift;
+	}
+
+	*ppvLinAddr = p + HDR_SIZE;
+	if (phBlockAlloc)
+		*phBlockAlloc = IMG_NULL;
+	return PVRSRV_OK;
+}
+
+PVRSRV_ERROR OSFreeMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+		       IMG_PVOID pvLinAddr, IMG_HANDLE hBlockAlloc)
+{
+	char *p = (char *) pvLinAddr - HDR_SIZE;
+	int shift = *(int *) p;
+
+	(void) ui32Flags;
+	(void) uSize;
+	(void) hBlockAlloc;
+
+	*(void **) pvLinAddr = free_list[shift];
+	free_list[shift] = p;
+	return PVRSRV_OK;
+}
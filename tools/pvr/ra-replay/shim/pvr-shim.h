@@ -0,0 +1,52 @@
+/*
+ * pvr-shim.h -- just enough of the services environment for ra.c and hash.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Included ahead of every driver source.  It claims the include guards of
+ * the services headers that would drag in the rest of the driver, and
+ * provides the handful of OS functions the arena and the hash table use.
+ */
+
+#ifndef PVR_SHIM_H
+#define PVR_SHIM_H
+
+#define SERVICES_HEADERS_H
+#define __OSFUNC_H__
+#define _BUFFER_MANAGER_H_
+#define __SERVICES_PROC_H__
+
+#include <stdio.h>
+#include <string.h>
+
+#include "img_defs.h"
+#include "services.h"
+#include "pvr_debug.h"
+
+#define PVRSRV_OS_PAGEABLE_HEAP		1
+#define PVRSRV_OS_NON_PAGEABLE_HEAP	2
+#define PVRSRV_PAGEABLE_SELECT		PVRSRV_OS_PAGEABLE_HEAP
+
+/*
+ * The driver keeps boundary tag pointers in IMG_UINTPTR_T hash values,
+ * which is 32 bits wide, so everything it allocates has to live below
+ * 4GiB.  See osfunc.c.
+ */
+PVRSRV_ERROR OSAllocMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+			IMG_PVOID *ppvLinAddr, IMG_HANDLE *phBlockAlloc,
+			IMG_CHAR *pszLog);
+PVRSRV_ERROR OSFreeMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+		       IMG_PVOID pvLinAddr, IMG_HANDLE hBlockAlloc);
+
+#define OSMemSet	memset
+#define OSMemCopy	memcpy
+#define OSSNPrintf	snprintf
+
+/* The arena only looks at the flags of an imported span */
+struct _BM_MAPPING_ {
+	IMG_UINT32 ui32Flags;
+};
+
+#endif
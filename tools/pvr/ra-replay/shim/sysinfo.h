@@ -0,0 +1 @@
+/* Nothing from the system layer is needed; see pvr-shim.h */
@@ -0,0 +1,185 @@
+/*
+ * msc-bench.c -- sequential throughput test for a USB mass storage LUN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* $(CROSS_COMPILE)cc -Wall -Wextra -O2 -o msc-bench msc-bench.c */
+
+/*
+ * Writes and then reads back a large sequential range of a block device
+ * with O_DIRECT, so that every byte crosses the USB link, and prints the
+ * throughput and the CPU time used by the whole machine while it ran.
+ *
+ * To measure the mass storage gadget without hardware, run host and
+ * gadget on one machine over dummy_hcd:
+ *
+ *	dd if=/dev/zero of=/tmp/lun bs=1M count=1024
+ *	modprobe dummy_hcd
+ *	modprobe g_mass_storage file=/tmp/lun removable=1
+ *	msc-bench -s 512 /dev/sdX
+ *
+ * and repeat with kernels built with different
+ * CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS values.  Use a backing file on
+ * real storage rather than tmpfs to see the backing file I/O overlap.
+ * The data on the device is overwritten.
+ */
+
+#define _GNU_SOURCE /* for O_DIRECT */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+
+struct cpu_sample {
+	unsigned long long busy, total;
+};
+
+static int cpu_sample(struct cpu_sample *s)
+{
+	unsigned long long v[8];
+	FILE *f = fopen("/proc/stat", "r");
+	int n;
+
+	if (!f)
+		return -1;
+	memset(v, 0, sizeof v);
+	n = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+	fclose(f);
+	if (n < 4)
+		return -1;
+
+	/* user nice system idle iowait irq softirq steal */
+	s->busy = v[0] + v[1] + v[2] + v[5] + v[6] + v[7];
+	s->total = s->busy + v[3] + v[4];
+	return 0;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int run(const char *path, int writing, char *buf, size_t bs,
+	       unsigned long long size)
+{
+	struct cpu_sample c0, c1;
+	unsigned long long done = 0;
+	double t0, t1, cpu = -1;
+	int fd;
+
+	fd = open(path, (writing ? O_WRONLY : O_RDONLY) | O_DIRECT);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	cpu_sample(&c0);
+	t0 = now();
+	while (done < size) {
+		ssize_t ret;
+
+		if (writing)
+			ret = write(fd, buf, bs);
+		else
+			ret = read(fd, buf, bs);
+		if (ret < 0) {
+			perror(writing ? "write" : "read");
+			close(fd);
+			return -1;
+		}
+		if (ret == 0)
+			break;
+		done += ret;
+	}
+	if (writing && fsync(fd) < 0) {
+		perror("fsync");
+		close(fd);
+		return -1;
+	}
+	t1 = now();
+	close(fd);
+
+	if (!cpu_sample(&c1) && c1.total > c0.total)
+		cpu = 100.0 * (c1.busy - c0.busy) / (c1.total - c0.total);
+
+	printf("%-5s %8llu KiB in %7.3f s: %8.2f MiB/s, cpu %5.1f%%\n",
+	       writing ? "write" : "read", done >> 10, t1 - t0,
+	       done / (t1 - t0) / (1 << 20), cpu);
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-r | -w] [-s size_MiB] [-b block_KiB] device\n"
+		"  -r  read only (keep the data on the device)\n"
+		"  -w  write only\n"
+		"  -s  amount to transfer, default 256 MiB\n"
+		"  -b  size of each read or write, default 64 KiB\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long size = 256ULL << 20;
+	size_t bs = 64 << 10;
+	int do_read = 1, do_write = 1;
+	void *buf;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "rws:b:")) != -1) {
+		switch (opt) {
+		case 'r':
+			do_write = 0;
+			break;
+		case 'w':
+			do_read = 0;
+			break;
+		case 's':
+			size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 'b':
+			bs = strtoul(optarg, NULL, 0) << 10;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || !size || !bs || !(do_read || do_write))
+		usage(argv[0]);
+
+	if (posix_memalign(&buf, 4096, bs)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	memset(buf, 0x5a, bs);
+
+	if (do_write && run(argv[optind], 1, buf, bs, size))
+		return 1;
+	if (do_read && run(argv[optind], 0, buf, bs, size))
+		return 1;
+
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * lookup-bench.c -- name lookup cost in one large directory
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* $(CROSS_COMPILE)cc -Wall -Wextra -O2 -o lookup-bench lookup-bench.c */
+
+/*
+ * Creates n empty files in dir, looks every one of them up again with
+ * stat() and then unlinks them, timing each pass.  Creating and unlinking
+ * make the file system look the name up itself; for the stat() pass the
+ * dentry cache is dropped first when running as root, so the lookups
+ * reach the file system rather than the dcache.  Lookups of names that
+ * do not exist are timed too.
+ *
+ * With a per-directory name index the time per file stays flat as n
+ * grows; without one it grows with n.  See nandsim-lookup.sh.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(const char *what, int n, double t)
+{
+	printf("%-8s %7d in %8.3f s: %8.1f us each\n", what, n, t,
+	       t * 1e6 / n);
+}
+
+static void drop_dentries(void)
+{
+	int fd;
+
+	sync();
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0)
+		return;
+	if (write(fd, "2\n", 2) != 2)
+		perror("drop_caches");
+	close(fd);
+}
+
+int main(int argc, char **argv)
+{
+	char name[4096];
+	struct stat st;
+	double t;
+	int n, i;
+
+	if (argc != 3 || (n = atoi(argv[2])) <= 0) {
+		fprintf(stderr, "usage: %s dir n\n", argv[0]);
+		return 1;
+	}
+
+	if (mkdir(argv[1], 0755) && errno != EEXIST) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		int fd;
+
+		snprintf(name, sizeof name, "%s/file-%08d", argv[1], i);
+		fd = open(name, O_CREAT | O_EXCL | O_WRONLY, 0644);
+		if (fd < 0) {
+			perror(name);
+			return 1;
+		}
+		close(fd);
+	}
+	report("create", n, now() - t);
+
+	drop_dentries();
+	t = now();
+	for (i = 0; i < n; i++) {
+		/* Stride through the directory rather than in create order */
+		snprintf(name, sizeof name, "%s/file-%08d", argv[1],
+			 (int) ((i * 7919LL) % n));
+		if (stat(name, &st)) {
+			perror(name);
+			return 1;
+		}
+	}
+	report("stat", n, now() - t);
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		snprintf(name, sizeof name, "%s/missing-%08d", argv[1], i);
+		if (!stat(name, &st) || errno != ENOENT) {
+			fprintf(stderr, "%s: unexpected result\n", name);
+			return 1;
+		}
+	}
+	report("missing", n, now() - t);
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		snprintf(name, sizeof name, "%s/file-%08d", argv[1], i);
+		if (unlink(name)) {
+			perror(name);
+			return 1;
+		}
+	}
+	report("unlink", n, now() - t);
+
+	rmdir(argv[1]);
+	return 0;
+}
@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# nandsim-lookup.sh -- yaffs2 name lookups in large directories, on nandsim
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# Runs lookup-bench for growing directory sizes on a yaffs2 file system on
+# a simulated NAND and prints the directory index counters from /proc/yaffs.
+# Run it on kernels with and without the name index to compare them.
+#
+# Needs nandsim and yaffs2 as modules or built in, root, and lookup-bench
+# built next to this script.
+#
+# usage: nandsim-lookup.sh [n ...]
+
+BENCH=$(dirname $0)/lookup-bench
+MNT=${MNT:-/tmp/yaffs-bench}
+SIZES=${*:-100 1000 5000 10000}
+
+# 256MiB, 2KiB pages, 128KiB blocks
+NANDSIM="first_id_byte=0x20 second_id_byte=0xaa third_id_byte=0x00 \
+	fourth_id_byte=0x15"
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ -x $BENCH ] || die "build $BENCH first"
+
+rmmod nandsim 2>/dev/null
+modprobe nandsim $NANDSIM || die "cannot load nandsim"
+n=$(grep "NAND simulator" /proc/mtd | head -n 1 | cut -d: -f1)
+[ -n "$n" ] || die "no nandsim mtd device"
+
+mkdir -p $MNT
+mount -t yaffs2 /dev/mtdblock${n#mtd} $MNT || die "mount failed"
+
+for size in $SIZES; do
+	echo "== $size files"
+	$BENCH $MNT/dir $size || break
+	grep -E "nDirIndexes|dirIndexBytes" /proc/yaffs
+done
+
+umount $MNT
+rmmod nandsim
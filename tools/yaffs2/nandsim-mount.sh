@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# nandsim-mount.sh -- time a yaffs2 mount that has to scan, on nandsim
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# Fills a simulated NAND with files, then times a mount that ignores the
+# checkpoint, as after a power cut.  This is done once with the summary
+# mount option and once with no-summary, and the scan counters from
+# /proc/yaffs are printed for each.
+#
+# Needs nandsim and yaffs2 as modules or built in, and root.
+#
+# usage: nandsim-mount.sh [files [file_KiB]]
+
+FILES=${1:-2000}
+FILE_KIB=${2:-64}
+MNT=${MNT:-/tmp/yaffs-bench}
+
+# 256MiB, 2KiB pages, 128KiB blocks.  do_delays makes reads cost about
+# what they do on a real chip.
+NANDSIM="first_id_byte=0x20 second_id_byte=0xaa third_id_byte=0x00 \
+	fourth_id_byte=0x15 do_delays=1 access_delay=25 output_cycle=25"
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+mtdblock() {
+	n=$(grep "NAND simulator" /proc/mtd | head -n 1 | cut -d: -f1)
+	[ -n "$n" ] || die "no nandsim mtd device"
+	echo /dev/mtdblock${n#mtd}
+}
+
+now_ms() {
+	echo $(($(date +%s%N) / 1000000))
+}
+
+run() {
+	opts=$1
+
+	rmmod nandsim 2>/dev/null
+	modprobe nandsim $NANDSIM || die "cannot load nandsim"
+	dev=$(mtdblock)
+
+	mkdir -p $MNT
+	mount -t yaffs2 -o $opts $dev $MNT || die "mount failed"
+	i=0
+	while [ $i -lt $FILES ]; do
+		d=$MNT/d$((i / 100))
+		[ -d $d ] || mkdir $d
+		dd if=/dev/urandom of=$d/f$i bs=1k count=$FILE_KIB 2>/dev/null
+		i=$((i + 1))
+	done
+	umount $MNT
+
+	t0=$(now_ms)
+	mount -t yaffs2 -o no-checkpoint-read,$opts $dev $MNT || die "remount failed"
+	t1=$(now_ms)
+
+	echo "$opts: mount took $((t1 - t0)) ms"
+	grep -E "nScanSummaries|nScanTagReads|nPageReads" /proc/yaffs
+	umount $MNT
+}
+
+echo "$FILES files of $FILE_KIB KiB"
+run summary
+run no-summary
+rmmod nandsim
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# nandsim-rw.sh -- concurrent yaffs2 file reads and writes, on nandsim
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# Runs rw-bench with a growing number of readers beside a fixed number of
+# writers on a yaffs2 file system on a simulated NAND, and prints the lock
+# and gc counters from /proc/yaffs after each run.  Run it on kernels with
+# and without the split yaffs locking to compare them; the readers only
+# scale on a machine with more than one CPU.
+#
+# Needs nandsim and yaffs2 as modules or built in, root, and rw-bench
+# built next to this script.
+#
+# usage: nandsim-rw.sh [writers [seconds]]
+
+BENCH=$(dirname $0)/rw-bench
+MNT=${MNT:-/tmp/yaffs-bench}
+WRITERS=${1:-2}
+RUNTIME=${2:-10}
+READERS=${READERS:-"1 2 4 8"}
+
+# 256MiB, 2KiB pages, 128KiB blocks.  do_delays makes NAND access cost
+# about what it does on a real chip, which is what the locks serialise.
+NANDSIM="first_id_byte=0x20 second_id_byte=0xaa third_id_byte=0x00 \
+	fourth_id_byte=0x15 do_delays=1 access_delay=25 output_cycle=25"
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ -x $BENCH ] || die "build $BENCH first"
+
+rmmod nandsim 2>/dev/null
+modprobe nandsim $NANDSIM || die "cannot load nandsim"
+n=$(grep "NAND simulator" /proc/mtd | head -n 1 | cut -d: -f1)
+[ -n "$n" ] || die "no nandsim mtd device"
+
+mkdir -p $MNT
+mount -t yaffs2 /dev/mtdblock${n#mtd} $MNT || die "mount failed"
+
+for readers in $READERS; do
+	echo "== $readers readers, $WRITERS writers"
+	$BENCH $MNT/rw $readers $WRITERS $RUNTIME || break
+	grep -E "lockContended|bgDeferrals|gcObjectBusy|cacheLocklessHits" \
+		/proc/yaffs
+done
+
+umount $MNT
+rmmod nandsim
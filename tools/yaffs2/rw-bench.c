@@ -0,0 +1,234 @@
+/*
+ * rw-bench.c -- concurrent file reads and writes on one file system
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* $(CROSS_COMPILE)cc -Wall -Wextra -O2 -pthread -o rw-bench rw-bench.c */
+
+/*
+ * Starts r reader and w writer threads for a number of seconds, each on a
+ * file of its own in dir.  Readers read random 4KiB pages of a file that
+ * was filled beforehand, dropping the page from the page cache first so
+ * the read reaches the file system, and check what they get back.
+ * Writers overwrite random pages of theirs, which keeps garbage collection
+ * busy, and fsync every 64 writes.  Operations per second are reported
+ * for each kind of thread.
+ *
+ * With a single device lock the readers stall behind every write and gc
+ * pass; with file data under per-object locks they should scale with the
+ * number of CPUs.  See nandsim-rw.sh.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define PAGE		4096
+#define FILE_PAGES	256	/* 1MiB per file */
+#define SYNC_EVERY	64
+
+struct worker {
+	pthread_t thread;
+	char name[4096];
+	int writer;
+	unsigned seed;
+	unsigned long ops;
+	int failed;
+};
+
+static volatile int stop;
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Every word of a reader's page holds its page number */
+static void fill(unsigned *buf, unsigned page)
+{
+	unsigned i;
+
+	for (i = 0; i < PAGE / sizeof *buf; i++)
+		buf[i] = page;
+}
+
+static int make_file(struct worker *w)
+{
+	unsigned buf[PAGE / sizeof(unsigned)];
+	unsigned page;
+	int fd;
+
+	fd = open(w->name, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0) {
+		perror(w->name);
+		return -1;
+	}
+	for (page = 0; page < FILE_PAGES; page++) {
+		fill(buf, page);
+		if (write(fd, buf, PAGE) != PAGE) {
+			perror(w->name);
+			close(fd);
+			return -1;
+		}
+	}
+	if (fsync(fd))
+		perror(w->name);
+	close(fd);
+	return 0;
+}
+
+static void *reader(void *arg)
+{
+	struct worker *w = arg;
+	unsigned buf[PAGE / sizeof(unsigned)];
+	unsigned page;
+	int fd;
+
+	fd = open(w->name, O_RDONLY);
+	if (fd < 0) {
+		perror(w->name);
+		w->failed = 1;
+		return NULL;
+	}
+	while (!stop) {
+		page = rand_r(&w->seed) % FILE_PAGES;
+		posix_fadvise(fd, (off_t) page * PAGE, PAGE,
+			      POSIX_FADV_DONTNEED);
+		if (pread(fd, buf, PAGE, (off_t) page * PAGE) != PAGE ||
+		    buf[0] != page || buf[PAGE / sizeof *buf - 1] != page) {
+			fprintf(stderr, "%s: bad read of page %u\n",
+				w->name, page);
+			w->failed = 1;
+			break;
+		}
+		w->ops++;
+	}
+	close(fd);
+	return NULL;
+}
+
+static void *writer(void *arg)
+{
+	struct worker *w = arg;
+	unsigned buf[PAGE / sizeof(unsigned)];
+	unsigned page;
+	int fd;
+
+	fd = open(w->name, O_WRONLY);
+	if (fd < 0) {
+		perror(w->name);
+		w->failed = 1;
+		return NULL;
+	}
+	while (!stop) {
+		page = rand_r(&w->seed) % FILE_PAGES;
+		fill(buf, page ^ (unsigned) w->ops);
+		if (pwrite(fd, buf, PAGE, (off_t) page * PAGE) != PAGE) {
+			perror(w->name);
+			w->failed = 1;
+			break;
+		}
+		if (++w->ops % SYNC_EVERY == 0 && fsync(fd)) {
+			perror(w->name);
+			w->failed = 1;
+			break;
+		}
+	}
+	close(fd);
+	return NULL;
+}
+
+static void report(const char *what, struct worker *w, int n, double t)
+{
+	unsigned long ops = 0;
+	int i;
+
+	if (!n)
+		return;
+	for (i = 0; i < n; i++)
+		ops += w[i].ops;
+	printf("%-7s %3d threads %9lu ops in %6.2f s: %9.1f ops/s\n",
+	       what, n, ops, t, ops / t);
+}
+
+int main(int argc, char **argv)
+{
+	struct worker *workers;
+	int nreaders, nwriters, seconds, n, i, err = 0;
+	double t;
+
+	if (argc != 5 || (nreaders = atoi(argv[2])) < 0 ||
+	    (nwriters = atoi(argv[3])) < 0 || (seconds = atoi(argv[4])) <= 0 ||
+	    nreaders + nwriters == 0) {
+		fprintf(stderr, "usage: %s dir readers writers seconds\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (mkdir(argv[1], 0755) && errno != EEXIST) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	n = nreaders + nwriters;
+	workers = calloc(n, sizeof *workers);
+	if (!workers) {
+		perror("calloc");
+		return 1;
+	}
+	for (i = 0; i < n; i++) {
+		struct worker *w = &workers[i];
+
+		w->writer = i >= nreaders;
+		w->seed = i + 1;
+		snprintf(w->name, sizeof w->name, "%s/%s-%03d", argv[1],
+			 w->writer ? "writer" : "reader", i);
+		if (make_file(w))
+			return 1;
+	}
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		struct worker *w = &workers[i];
+
+		if (pthread_create(&w->thread, NULL,
+				   w->writer ? writer : reader, w)) {
+			fprintf(stderr, "cannot start thread %d\n", i);
+			stop = 1;
+			n = i;
+			err = 1;
+			break;
+		}
+	}
+	if (!err)
+		sleep(seconds);
+	stop = 1;
+	for (i = 0; i < n; i++) {
+		pthread_join(workers[i].thread, NULL);
+		err |= workers[i].failed;
+	}
+	t = now() - t;
+
+	report("read", workers, nreaders, t);
+	report("write", workers + nreaders, nwriters, t);
+
+	for (i = 0; i < nreaders + nwriters; i++)
+		unlink(workers[i].name);
+	rmdir(argv[1]);
+	free(workers);
+	return err;
+}